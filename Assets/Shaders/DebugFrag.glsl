@@ -1,7 +1,7 @@
 #version 400 core
 
 uniform sampler2D 	mainTex;
-uniform int useTexture;
+uniform int useTexture; //0 for lines, 1 for bitmap text, 2 for distance field text
 
 in Vertex
 {
@@ -16,6 +16,18 @@ void main(void)
 	if(useTexture == 0) {
 		fragColor = IN.colour;
 	}
+	else if(useTexture == 2) {
+		//The edge is at 0.5 - blend across about a pixel of it, whatever the text's size
+		float distance	= texture(mainTex, IN.texCoord).r;
+		float width		= max(fwidth(distance) * 0.5, 0.0001);
+		float alpha		= smoothstep(0.5 - width, 0.5 + width, distance);
+
+		if(alpha < 0.00001f) {
+			discard;
+		}
+
+		fragColor = IN.colour * vec4(1,1,1,alpha);
+	}
 	else {
 		float alpha = texture(mainTex, IN.texCoord).r;
 		
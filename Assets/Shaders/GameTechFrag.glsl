@@ -1,22 +1,33 @@
 #version 400 core
 
-uniform vec4 		objectColour;
-uniform sampler2D 	mainTex;
-uniform sampler2DShadow shadowTex;
-
-uniform vec3	lightPos;
-uniform float	lightRadius;
-uniform vec4	lightColour;
+layout(std140) uniform FrameData {
+	mat4 viewMatrix;
+	mat4 projMatrix;
+	mat4 shadowMatrices[4];
+	mat4 lightViewProj[4];
+	vec4 cameraPos;
+	vec4 lightPos;		//w is the light's radius
+	vec4 lightColour;
+	vec4 cascadeSplits;	//how far from the camera each cascade reaches
+	int  cascadeCount;
+};
 
-uniform vec3	cameraPos;
+layout(std140) uniform DrawData {
+	mat4 modelMatrix;
+	vec4 objectColour;
+	int  hasVertexColours;
+	int  hasTexture;
+	int  useInstancing;
+	int  shadowCascade;
+};
 
-uniform bool hasTexture;
+uniform sampler2D 	mainTex;
+uniform sampler2DArrayShadow shadowTex;
 
 in Vertex
 {
 	vec4 colour;
 	vec2 texCoord;
-	vec4 shadowProj;
 	vec3 normal;
 	vec3 worldPos;
 } IN;
@@ -25,16 +36,23 @@ out vec4 fragColor;
 
 void main(void)
 {
-	float shadow = 1.0; // New !
-	
-	if( IN . shadowProj . w > 0.0) { // New !
-		shadow = textureProj ( shadowTex , IN . shadowProj ) * 0.5f;
+	float shadow = 0.5; //fully lit, past the last cascade
+
+	//The nearest cascade that reaches this far has the sharpest shadows
+	float viewDepth = -(viewMatrix * vec4(IN.worldPos, 1.0)).z;
+	int cascade = 0;
+	while(cascade < cascadeCount && viewDepth > cascadeSplits[cascade]) {
+		cascade++;
+	}
+	if(cascade < cascadeCount) {
+		vec4 shadowProj = shadowMatrices[cascade] * vec4(IN.worldPos, 1.0);
+		shadow = texture(shadowTex, vec4(shadowProj.xy, cascade, shadowProj.z)) * 0.5f;
 	}
 
-	vec3  incident = normalize ( lightPos - IN.worldPos );
+	vec3  incident = normalize ( lightPos.xyz - IN.worldPos );
 	float lambert  = max (0.0 , dot ( incident , IN.normal )) * 0.9; 
 	
-	vec3 viewDir = normalize ( cameraPos - IN . worldPos );
+	vec3 viewDir = normalize ( cameraPos.xyz - IN . worldPos );
 	vec3 halfDir = normalize ( incident + viewDir );
 
 	float rFactor = max (0.0 , dot ( halfDir , IN.normal ));
@@ -42,7 +60,7 @@ void main(void)
 	
 	vec4 albedo = IN.colour;
 	
-	if(hasTexture) {
+	if(hasTexture != 0) {
 	 albedo *= texture(mainTex, IN.texCoord);
 	}
 	
@@ -1,12 +1,35 @@
 #version 400 core
 
-uniform mat4 mvpMatrix 		= mat4(1.0f);
+layout(std140) uniform FrameData {
+	mat4 viewMatrix;
+	mat4 projMatrix;
+	mat4 shadowMatrices[4];
+	mat4 lightViewProj[4];
+	vec4 cameraPos;
+	vec4 lightPos;		//w is the light's radius
+	vec4 lightColour;
+	vec4 cascadeSplits;	//how far from the camera each cascade reaches
+	int  cascadeCount;
+};
+
+layout(std140) uniform DrawData {
+	mat4 modelMatrix;
+	vec4 objectColour;
+	int  hasVertexColours;
+	int  hasTexture;
+	int  useInstancing;
+	int  shadowCascade;
+};
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec4 colour;
 layout(location = 2) in vec2 texCoord;
 
+//Only read when drawing instanced
+layout(location = 8) in mat4 instanceModelMatrix;
+
 void main(void)
 {
-	gl_Position		= mvpMatrix * vec4(position, 1.0);
+	mat4 model = useInstancing != 0 ? instanceModelMatrix : modelMatrix;
+	gl_Position	= lightViewProj[shadowCascade] * (model * vec4(position, 1.0));
 }
\ No newline at end of file
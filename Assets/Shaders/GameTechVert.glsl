@@ -1,42 +1,62 @@
 #version 400 core
 
-uniform mat4 modelMatrix 	= mat4(1.0f);
-uniform mat4 viewMatrix 	= mat4(1.0f);
-uniform mat4 projMatrix 	= mat4(1.0f);
-uniform mat4 shadowMatrix 	= mat4(1.0f);
+layout(std140) uniform FrameData {
+	mat4 viewMatrix;
+	mat4 projMatrix;
+	mat4 shadowMatrices[4];
+	mat4 lightViewProj[4];
+	vec4 cameraPos;
+	vec4 lightPos;		//w is the light's radius
+	vec4 lightColour;
+	vec4 cascadeSplits;	//how far from the camera each cascade reaches
+	int  cascadeCount;
+};
+
+layout(std140) uniform DrawData {
+	mat4 modelMatrix;
+	vec4 objectColour;
+	int  hasVertexColours;
+	int  hasTexture;
+	int  useInstancing;
+	int  shadowCascade;
+};
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec4 colour;
 layout(location = 2) in vec2 texCoord;
 layout(location = 3) in vec3 normal;
 
-uniform vec4 		objectColour = vec4(1,1,1,1);
-
-uniform bool hasVertexColours = false;
+//Only read when drawing instanced
+layout(location = 8) in mat4 instanceModelMatrix;
+layout(location = 12) in vec4 instanceColour;
 
 out Vertex
 {
 	vec4 colour;
 	vec2 texCoord;
-	vec4 shadowProj;
 	vec3 normal;
 	vec3 worldPos;
 } OUT;
 
 void main(void)
 {
-	mat4 mvp 		  = (projMatrix * viewMatrix * modelMatrix);
-	mat3 normalMatrix = transpose ( inverse ( mat3 ( modelMatrix )));
+	mat4 model		= modelMatrix;
+	vec4 baseColour	= objectColour;
+	if(useInstancing != 0) {
+		model		= instanceModelMatrix;
+		baseColour	= instanceColour;
+	}
+	mat4 mvp 		  = (projMatrix * viewMatrix * model);
+	mat3 normalMatrix = transpose ( inverse ( mat3 ( model )));
 
-	OUT.shadowProj 	=  shadowMatrix * vec4 ( position,1);
-	OUT.worldPos 	= ( modelMatrix * vec4 ( position ,1)). xyz ;
+	OUT.worldPos 	= ( model * vec4 ( position ,1)). xyz ;
 	OUT.normal 		= normalize ( normalMatrix * normalize ( normal ));
 	
 	OUT.texCoord	= texCoord;
-	OUT.colour		= objectColour;
+	OUT.colour		= baseColour;
 
-	if(hasVertexColours) {
-		OUT.colour		= objectColour * colour;
+	if(hasVertexColours != 0) {
+		OUT.colour		= baseColour * colour;
 	}
 	gl_Position		= mvp * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -1,8 +1,16 @@
 #version 330 core
 
-uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projMatrix;
+layout(std140) uniform FrameData {
+	mat4 viewMatrix;
+	mat4 projMatrix;
+	mat4 shadowMatrices[4];
+	mat4 lightViewProj[4];
+	vec4 cameraPos;
+	vec4 lightPos;		//w is the light's radius
+	vec4 lightColour;
+	vec4 cascadeSplits;	//how far from the camera each cascade reaches
+	int  cascadeCount;
+};
 
 in  vec3 position;
 
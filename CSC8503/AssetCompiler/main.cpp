@@ -0,0 +1,2337 @@
+/*
+Offline asset compiler - turns the text assets we author into the binary
+formats the game loads directly. Run from this folder, with paths relative
+to the usual Assets subfolders:
+
+	AssetCompiler navgrid TestGrid1.txt TestGrid1.navbin
+	AssetCompiler navmesh test.navmesh test.navbin
+	AssetCompiler mesh Male1.msh Male1.mshb quantise lods
+
+Compiled meshes are run through the MeshOptimiser first, and can have a
+LOD chain built by the MeshSimplifier. It can also report vertex cache
+stats for every mesh, before and after optimising, time the simplifier
+on every mesh, compare vertex buffer sizes with and without packing, and
+time how long the game's startup assets take to load without a renderer,
+serially and through the AssetManager:
+
+	AssetCompiler meshreport
+	AssetCompiler lodreport
+	AssetCompiler vertexreport
+	AssetCompiler loadtest
+*/
+#include "../CSC8503Common/NavigationGrid.h"
+#include "../CSC8503Common/NavigationMesh.h"
+#include "../CSC8503Common/NavigationData.h"
+#include "../CSC8503Common/FlowField.h"
+#include "../../Common/Assets.h"
+#include "../../Common/MeshGeometry.h"
+#include "../../Common/AssetManager.h"
+#include "../../Common/TextureLoader.h"
+#include "../../Common/MeshOptimiser.h"
+#include "../../Common/MeshSimplifier.h"
+#include "../../Common/VertexLayout.h"
+#include "../../Common/TextureCooker.h"
+#include "../../Common/TextureWriter.h"
+#include "../../Common/MeshAnimation.h"
+#include "../../Common/SkeletalAnimation.h"
+#include "../../Common/Frustum.h"
+#include "../../Common/RenderSorting.h"
+#include "../../Common/InstanceBatcher.h"
+#include "../../Common/RenderCommands.h"
+#include "../../Common/ParallelFor.h"
+#include "../../Common/FrameRingAllocator.h"
+#include "../../Common/UniformData.h"
+#include "../../Common/ShadowCascades.h"
+#include "../../Common/DebugDrawBuffer.h"
+#include "../../Common/SimpleFont.h"
+#include "../../Common/TextLayoutCache.h"
+#include "../../Common/OcclusionBuffer.h"
+#include "../../Common/Maths.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <iomanip>
+#include <thread>
+#include <cmath>
+#include <cfloat>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace NCL;
+using namespace CSC8503;
+using std::string;
+
+//We only need the CPU side of a mesh here, there's no renderer to upload to
+class CompilerMesh : public MeshGeometry {
+public:
+	CompilerMesh() {}
+	CompilerMesh(const string& filename) : MeshGeometry(filename) {}
+	void UploadToGPU(Rendering::RendererBase* renderer = nullptr) override {}
+};
+
+static float MillisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static vector<string> ListFiles(const string& folder, const string& extension) {
+	vector<string> files;
+#ifdef _WIN32
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA((folder + "*" + extension).c_str(), &findData);
+	if (find != INVALID_HANDLE_VALUE) {
+		do {
+			files.emplace_back(findData.cFileName);
+		} while (FindNextFileA(find, &findData));
+		FindClose(find);
+	}
+#else
+	if (DIR* dir = opendir(folder.c_str())) {
+		while (dirent* entry = readdir(dir)) {
+			string name = entry->d_name;
+			if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+				files.emplace_back(name);
+			}
+		}
+		closedir(dir);
+	}
+#endif
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+//Vertex cache stats for every mesh, before and after the MeshOptimiser has been over them
+static void MeshReport() {
+	std::cout << std::left << std::setw(24) << "Mesh" << std::setw(16) << "Vertices"
+		<< std::setw(18) << "ACMR" << std::setw(18) << "ATVR" << "Time" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	for (const string& name : ListFiles(Assets::MESHDIR, ".msh")) {
+		CompilerMesh mesh(name);
+		if (mesh.GetVertexCount() == 0) {
+			continue;
+		}
+		unsigned int	oldVerts	= mesh.GetVertexCount();
+		MeshCacheStats	before		= MeshOptimiser::AnalyseVertexCache(mesh);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshOptimiser::Optimise(mesh);
+		float ms = MillisecondsSince(start);
+
+		MeshCacheStats after = MeshOptimiser::AnalyseVertexCache(mesh);
+
+		std::cout << std::setw(24) << name
+			<< std::setw(16) << (std::to_string(oldVerts) + "->" + std::to_string(mesh.GetVertexCount()))
+			<< before.acmr << "->" << std::setw(11) << after.acmr
+			<< before.atvr << "->" << std::setw(11) << after.atvr
+			<< ms << "ms" << std::endl;
+	}
+}
+
+//Simplification time and triangle counts for each LOD of every mesh
+static void LODReport() {
+	MeshSimplifyOptions options;
+	std::cout << "Building " << options.levelCount << " levels, keeping " << options.levelRatio
+		<< " of the triangles each time, up to " << options.maxError << " of the radius in error" << std::endl;
+	std::cout << std::left << std::setw(24) << "Mesh" << std::setw(12) << "Time" << "Triangles (error / radius)" << std::endl;
+
+	for (const string& name : ListFiles(Assets::MESHDIR, ".msh")) {
+		CompilerMesh mesh(name);
+		if (mesh.GetVertexCount() == 0) {
+			continue;
+		}
+		//The same radius GenerateLODs scales maxError by, so errors read as a fraction of it
+		Vector3 boundsMin, boundsMax;
+		mesh.GetLocalBounds(boundsMin, boundsMax);
+		float radius = std::max((boundsMax - boundsMin).Length() * 0.5f, FLT_MIN);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshSimplifier::GenerateLODs(mesh, options);
+		float ms = MillisecondsSince(start);
+
+		std::cout << std::setw(24) << name << std::setw(12) << (std::to_string(ms) + "ms") << mesh.GetIndexCount() / 3;
+		for (const MeshLOD& lod : mesh.GetLODData()) {
+			std::cout << " -> " << lod.indices.size() / 3 << " (" << std::setprecision(4) << lod.error / radius << ")";
+		}
+		std::cout << std::endl;
+	}
+}
+
+//Largest difference between a stream and what the packed layout gives back for it
+static float MaxPackingError(const MeshGeometry& mesh, const VertexLayout& layout, const vector<char>& packed, VertexAttribute attribute) {
+	const float*	source		= nullptr;
+	int				components	= 0;
+	size_t			count		= 0;
+	switch (attribute) {
+		case VertexAttribute::Normals:			source = (const float*)mesh.GetNormalData().data();			components = 3; count = mesh.GetNormalData().size();		break;
+		case VertexAttribute::TextureCoords:	source = (const float*)mesh.GetTextureCoordData().data();	components = 2; count = mesh.GetTextureCoordData().size();	break;
+		case VertexAttribute::JointWeights:		source = (const float*)mesh.GetSkinWeightData().data();		components = 4; count = mesh.GetSkinWeightData().size();	break;
+		default: return 0.0f;
+	}
+	float error = 0.0f;
+	for (const VertexElement& e : layout.GetElements()) {
+		if (e.attribute != attribute) {
+			continue;
+		}
+		for (size_t v = 0; v < std::min(count, (size_t)mesh.GetVertexCount()); ++v) {
+			Vector4 unpacked	= layout.Unpack(packed.data() + v * layout.GetStride(), e);
+			Vector4 original	= Vector4(0, 0, 0, 0);
+			memcpy(&original, source + v * components, sizeof(float) * components);
+			if (attribute == VertexAttribute::Normals) {
+				Vector3 n = Vector3(original.x, original.y, original.z);
+				original = Vector4(n.Normalised(), 0.0f); //packing normalises them
+			}
+			for (int i = 0; i < components; ++i) {
+				error = std::max(error, std::abs(unpacked[i] - original[i]));
+			}
+		}
+	}
+	return error;
+}
+
+//GPU vertex data sizes for every mesh, as separate float buffers and packed
+static void VertexReport() {
+	std::cout << std::left << std::setw(24) << "Mesh" << std::setw(10) << "Vertices" << std::setw(14) << "Stride"
+		<< std::setw(22) << "Bytes" << std::setw(10) << "Saved" << "Max error (normal, uv, weight)" << std::endl;
+	std::cout << std::fixed;
+
+	size_t totalFloat	= 0;
+	size_t totalPacked	= 0;
+	for (const string& name : ListFiles(Assets::MESHDIR, ".msh")) {
+		CompilerMesh mesh(name);
+		if (mesh.GetVertexCount() == 0) {
+			continue;
+		}
+		VertexLayout floatLayout	= VertexLayout::FloatLayout(mesh);
+		VertexLayout packedLayout	= VertexLayout::PackedLayout(mesh);
+
+		vector<char> packed;
+		packedLayout.Pack(mesh, packed);
+
+		size_t floatBytes = VertexLayout::StreamSize(mesh);
+		totalFloat	+= floatBytes;
+		totalPacked += packed.size();
+
+		std::cout << std::setw(24) << name << std::setw(10) << mesh.GetVertexCount()
+			<< std::setw(14) << (std::to_string(floatLayout.GetStride()) + "->" + std::to_string(packedLayout.GetStride()))
+			<< std::setw(22) << (std::to_string(floatBytes) + "->" + std::to_string(packed.size()))
+			<< std::setw(10) << std::setprecision(1) << (std::to_string((int)(100.0f - 100.0f * packed.size() / floatBytes)) + "%")
+			<< std::setprecision(5)
+			<< MaxPackingError(mesh, packedLayout, packed, VertexAttribute::Normals) << " "
+			<< MaxPackingError(mesh, packedLayout, packed, VertexAttribute::TextureCoords) << " "
+			<< MaxPackingError(mesh, packedLayout, packed, VertexAttribute::JointWeights) << std::endl;
+	}
+	std::cout << "Total: " << totalFloat << " -> " << totalPacked << " bytes" << std::endl;
+}
+
+static const char* FormatName(TextureFormat format) {
+	switch (format) {
+		case TextureFormat::BC1:	return "BC1";
+		case TextureFormat::BC3:	return "BC3";
+		case TextureFormat::BC5:	return "BC5";
+		default:					return "RGBA8";
+	}
+}
+
+//Peak signal to noise ratio of the top level, over the channels the format keeps
+static float TexturePSNR(const unsigned char* original, const vector<unsigned char>& decoded, int width, int height, TextureFormat format) {
+	int		channels	= format == TextureFormat::BC5 ? 2 : (format == TextureFormat::BC1 ? 3 : 4);
+	double	squared		= 0.0;
+	for (size_t i = 0; i < (size_t)width * height; ++i) {
+		for (int c = 0; c < channels; ++c) {
+			double d = (double)original[i * 4 + c] - decoded[i * 4 + c];
+			squared += d * d;
+		}
+	}
+	double mse = squared / ((double)width * height * channels);
+	return mse > 0.0 ? (float)(10.0 * std::log10(255.0 * 255.0 / mse)) : 99.0f;
+}
+
+//Cooks every top level texture, and compares sizes, times and quality against the source
+static void TextureReport() {
+	std::cout << std::left << std::setw(24) << "Texture" << std::setw(14) << "Size" << std::setw(8) << "Format"
+		<< std::setw(26) << "Bytes (RGBA8 + mips)" << std::setw(12) << "PSNR" << "Time" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	for (const string& name : ListFiles(Assets::TEXTUREDIR, ".png")) {
+		TextureData data;
+		if (!TextureLoader::LoadTexture(name, data.data, data.width, data.height, data.channels, data.flags)) {
+			continue;
+		}
+		auto start = std::chrono::high_resolution_clock::now();
+		vector<char>	cooked;
+		int				mipCount	= 1;
+		TextureFormat	format		= TextureCooker::Cook((const unsigned char*)data.data, data.width, data.height, TextureCookOptions(), cooked, mipCount);
+		float ms = MillisecondsSince(start);
+
+		vector<unsigned char> decoded;
+		TextureCooker::DecodeLevel(cooked.data(), format, data.width, data.height, decoded);
+
+		size_t uncompressed = TextureLoader::GetDataSize(data.width, data.height, TextureLoader::MakeFlags(TextureFormat::RGBA8, mipCount));
+
+		std::cout << std::setw(24) << name << std::setw(14) << (std::to_string(data.width) + "x" + std::to_string(data.height))
+			<< std::setw(8) << FormatName(format)
+			<< std::setw(26) << (std::to_string(uncompressed) + " -> " + std::to_string(cooked.size()))
+			<< std::setw(12) << (std::to_string(TexturePSNR((const unsigned char*)data.data, decoded, data.width, data.height, format)).substr(0, 5) + "dB")
+			<< ms << "ms" << std::endl;
+	}
+}
+
+//Cooks a texture, then loads it back through the registered .tex loader to check it
+static bool CompileTexture(const string& input, const string& output, const TextureCookOptions& options) {
+	if (!TextureCooker::CookFile(input, output, options)) {
+		return false;
+	}
+	TextureData source;
+	TextureData cooked;
+	TextureLoader::LoadTexture(input, source.data, source.width, source.height, source.channels, source.flags);
+
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	if (!TextureLoader::LoadTexture(output, cooked.data, cooked.width, cooked.height, cooked.channels, cooked.flags)) {
+		return false;
+	}
+	float cookedMS = MillisecondsSince(loadStart);
+
+	TextureFormat format = TextureLoader::GetFormat(cooked.flags);
+	vector<unsigned char> decoded;
+	TextureCooker::DecodeLevel(cooked.data, format, cooked.width, cooked.height, decoded);
+
+	std::cout << input << ": " << cooked.width << "x" << cooked.height << " " << FormatName(format) << ", "
+		<< TextureLoader::GetMipCount(cooked.flags) << " mip levels, " << TextureLoader::GetDataSize(cooked.width, cooked.height, cooked.flags) << " bytes" << std::endl;
+	if (source.data && source.width == cooked.width && source.height == cooked.height) {
+		std::cout << "	PSNR " << TexturePSNR((const unsigned char*)source.data, decoded, cooked.width, cooked.height, format) << "dB" << std::endl;
+	}
+	std::cout << "	cooked load " << cookedMS << "ms" << std::endl;
+	return true;
+}
+
+//Compiles a mesh, and then loads both versions back to compare load times
+static bool CompileMesh(const string& input, const string& output, bool quantise, bool lods) {
+	auto textStart = std::chrono::high_resolution_clock::now();
+	CompilerMesh mesh(input);
+	float textMS = MillisecondsSince(textStart);
+
+	if (mesh.GetVertexCount() == 0) {
+		return false;
+	}
+	MeshCacheStats before = MeshOptimiser::AnalyseVertexCache(mesh);
+	MeshOptimiser::Optimise(mesh);
+	MeshCacheStats after = MeshOptimiser::AnalyseVertexCache(mesh);
+
+	if (lods) {
+		MeshSimplifier::GenerateLODs(mesh);
+	}
+	if (!mesh.SaveBinaryMesh(Assets::MESHDIR + output, quantise)) {
+		return false;
+	}
+	auto binaryStart = std::chrono::high_resolution_clock::now();
+	CompilerMesh binaryMesh(output);
+	float binaryMS = MillisecondsSince(binaryStart);
+
+	std::cout << input << ": " << mesh.GetVertexCount() << " vertices, " << mesh.GetIndexCount() / 3 << " triangles" << std::endl;
+	for (unsigned int i = 1; i < mesh.GetLODCount(); ++i) {
+		std::cout << "	LOD " << i << ": " << mesh.GetLODData()[i - 1].indices.size() / 3 << " triangles, error " << mesh.GetLODError(i) << std::endl;
+	}
+	std::cout << "	ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	std::cout << "	text load " << textMS << "ms, binary load " << binaryMS << "ms" << std::endl;
+	return binaryMesh.GetVertexCount() == mesh.GetVertexCount() && binaryMesh.GetLODCount() == mesh.GetLODCount();
+}
+
+//The same set of assets CourseworkGame and GameTechRenderer load at startup
+static const string startupMeshes[] = {
+	"Cube.msh", "Sphere.msh", "Male1.msh", "courier.msh", "security.msh", "coin.msh", "Capsule.msh"
+};
+static const string startupTextures[] = {
+	"checkerboard.png",
+	"/Cubemap/skyrender0001.png", "/Cubemap/skyrender0002.png", "/Cubemap/skyrender0003.png",
+	"/Cubemap/skyrender0004.png", "/Cubemap/skyrender0005.png", "/Cubemap/skyrender0006.png"
+};
+
+static void LoadTest() {
+	auto serialStart = std::chrono::high_resolution_clock::now();
+	{
+		NullAssetUploader uploader;
+		vector<MeshGeometry*> meshes;
+		for (const string& m : startupMeshes) {
+			meshes.emplace_back(uploader.CreateMesh(m));
+		}
+		for (const string& t : startupTextures) {
+			TextureData data;
+			TextureLoader::LoadTexture(t, data.data, data.width, data.height, data.channels, data.flags);
+		}
+		for (MeshGeometry* m : meshes) {
+			delete m;
+		}
+	}
+	float serialMS = MillisecondsSince(serialStart);
+
+	auto parallelStart = std::chrono::high_resolution_clock::now();
+	{
+		AssetManager assets(new NullAssetUploader());
+		for (const string& m : startupMeshes) {
+			assets.LoadMesh(m);
+		}
+		for (const string& t : startupTextures) {
+			assets.LoadTexture(t);
+		}
+		assets.WaitForAll();
+	}
+	float parallelMS = MillisecondsSince(parallelStart);
+
+	std::cout << "Startup assets: serial " << serialMS << "ms, AssetManager " << parallelMS << "ms" << std::endl;
+
+	//A second path with the same bytes should come back as the same mesh
+	const string copyName = "LoadTestCopy.msh";
+	{
+		std::ifstream	in(Assets::MESHDIR + startupMeshes[0], std::ios::binary);
+		std::ofstream	out(Assets::MESHDIR + copyName, std::ios::binary);
+		out << in.rdbuf();
+	}
+	{
+		AssetManager assets(new NullAssetUploader());
+		AssetManager::MeshHandle original	= assets.LoadMesh(startupMeshes[0]);
+		AssetManager::MeshHandle copy		= assets.LoadMesh(copyName);
+		assets.WaitForAll();
+
+		bool shared = original.Get() == copy.Get() && assets.GetSharedCount() == 1;
+		std::cout << "	" << copyName << " shares " << startupMeshes[0] << ": " << (shared ? "yes" : "no") << std::endl;
+	}
+	std::remove((Assets::MESHDIR + copyName).c_str());
+}
+
+//A bumpy grid, big enough that the vertex maths dominates the timings
+static void BuildBenchGrid(CompilerMesh& mesh, size_t triangles) {
+	size_t side = std::max((size_t)2, (size_t)std::sqrt(triangles / 2.0)) + 1;
+
+	vector<Vector3>			positions;
+	vector<Vector2>			texCoords;
+	vector<unsigned int>	indices;
+	positions.reserve(side * side);
+	texCoords.reserve(side * side);
+	for (size_t z = 0; z < side; ++z) {
+		for (size_t x = 0; x < side; ++x) {
+			float height = std::sin(x * 0.05f) * std::cos(z * 0.07f) * 4.0f;
+			positions.emplace_back(Vector3((float)x, height, (float)z));
+			texCoords.emplace_back(Vector2(x / (float)side, z / (float)side));
+		}
+	}
+	indices.reserve((side - 1) * (side - 1) * 6);
+	for (size_t z = 0; z + 1 < side; ++z) {
+		for (size_t x = 0; x + 1 < side; ++x) {
+			unsigned int a = (unsigned int)(z * side + x);
+			unsigned int b = a + 1;
+			unsigned int c = a + (unsigned int)side;
+			unsigned int d = c + 1;
+			indices.insert(indices.end(), { a, c, b, b, c, d });
+		}
+	}
+	mesh.SetVertexPositions(positions);
+	mesh.SetVertexTextureCoords(texCoords);
+	mesh.SetVertexIndices(indices);
+}
+
+//The straightforward single threaded way, to compare against
+static void SerialNormals(const MeshGeometry& mesh, vector<Vector3>& normals) {
+	normals.assign(mesh.GetVertexCount(), Vector3());
+	const vector<Vector3>&		positions	= mesh.GetPositionData();
+	const vector<unsigned int>& indices		= mesh.GetIndexData();
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const Vector3& a = positions[indices[i + 0]];
+		const Vector3& b = positions[indices[i + 1]];
+		const Vector3& c = positions[indices[i + 2]];
+		Vector3 n = Vector3::Cross(b - a, c - a);
+		normals[indices[i + 0]] += n;
+		normals[indices[i + 1]] += n;
+		normals[indices[i + 2]] += n;
+	}
+	for (Vector3& n : normals) {
+		n.Normalise();
+	}
+}
+
+//Times the vertex processing functions against their single threaded equivalents
+static void NormalBench(size_t triangles) {
+	CompilerMesh mesh;
+	BuildBenchGrid(mesh, triangles);
+	std::cout << "Grid of " << mesh.GetIndexCount() / 3 << " triangles, " << mesh.GetVertexCount() << " vertices, "
+		<< std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	vector<Vector3> reference;
+	auto start = std::chrono::high_resolution_clock::now();
+	SerialNormals(mesh, reference);
+	std::cout << std::left << std::setw(32) << "Serial normals" << MillisecondsSince(start) << "ms" << std::endl;
+
+	start = std::chrono::high_resolution_clock::now();
+	mesh.RecalculateNormals(NormalWeighting::Area);
+	float ms = MillisecondsSince(start);
+
+	float maxError = 0.0f;
+	for (size_t i = 0; i < reference.size(); ++i) {
+		maxError = std::max(maxError, (reference[i] - mesh.GetNormalData()[i]).Length());
+	}
+	std::cout << std::setw(32) << "RecalculateNormals (area)" << ms << "ms, max difference " << std::setprecision(6) << maxError << std::setprecision(2) << std::endl;
+
+	start = std::chrono::high_resolution_clock::now();
+	mesh.RecalculateNormals(NormalWeighting::Angle);
+	std::cout << std::setw(32) << "RecalculateNormals (angle)" << MillisecondsSince(start) << "ms" << std::endl;
+
+	start = std::chrono::high_resolution_clock::now();
+	mesh.RecalculateTangents();
+	std::cout << std::setw(32) << "RecalculateTangents" << MillisecondsSince(start) << "ms" << std::endl;
+
+	Matrix4 transform = Matrix4::Translation(Vector3(10, 0, -5)) * Matrix4::Rotation(30.0f, Vector3(0, 1, 0)) * Matrix4::Scale(Vector3(2, 2, 2));
+
+	vector<Vector3> serialPositions = mesh.GetPositionData();
+	start = std::chrono::high_resolution_clock::now();
+	for (Vector3& p : serialPositions) {
+		p = transform * p;
+	}
+	std::cout << std::setw(32) << "Serial position transform" << MillisecondsSince(start) << "ms" << std::endl;
+
+	start = std::chrono::high_resolution_clock::now();
+	mesh.TransformVertices(transform);
+	ms = MillisecondsSince(start);
+
+	maxError = 0.0f;
+	for (size_t i = 0; i < serialPositions.size(); ++i) {
+		maxError = std::max(maxError, (serialPositions[i] - mesh.GetPositionData()[i]).Length());
+	}
+	std::cout << std::setw(32) << "TransformVertices (all streams)" << ms << "ms, max difference " << std::setprecision(6) << maxError << std::endl;
+}
+
+//Something like a rendered frame - smooth gradients, flat areas and some detail
+static void BuildBenchFrame(vector<char>& frame, int width, int height, int frameNumber) {
+	frame.resize((size_t)width * height * 4);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			unsigned char* p = (unsigned char*)&frame[((size_t)y * width + x) * 4];
+			bool inBox = ((x + frameNumber * 4) / 160 + y / 120) % 3 == 0;
+			p[0] = (unsigned char)(inBox ? 200 : x * 255 / width);
+			p[1] = (unsigned char)(inBox ? 60 : y * 255 / height);
+			p[2] = (unsigned char)((x ^ y) & 0x1F) + 100;
+			p[3] = 255;
+		}
+	}
+}
+
+//Frames per second encoded at 1280x720, synchronously and through a CaptureWriter
+static void CaptureBench(int frameCount) {
+	const int width		= 1280;
+	const int height	= 720;
+	vector<vector<char>> frames(4);
+	for (size_t i = 0; i < frames.size(); ++i) {
+		BuildBenchFrame(frames[i], width, height, (int)i);
+	}
+	std::cout << frameCount << " frames of " << width << "x" << height << ", " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	std::cout << std::left << std::setw(24) << "Encoder" << std::setw(16) << "Frames/sec" << "Bytes/frame" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+
+	const PNGCompression	modes[]		= { PNGCompression::Stored, PNGCompression::Fast, PNGCompression::Default };
+	const char*				modeNames[] = { "Stored", "Fast", "Default" };
+
+	for (int m = 0; m < 3; ++m) {
+		vector<char> png;
+		size_t totalBytes = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < frameCount; ++i) {
+			TextureWriter::EncodePNG(frames[i % frames.size()].data(), width, height, 4, modes[m], png, true);
+			totalBytes += png.size();
+		}
+		float ms = MillisecondsSince(start);
+		std::cout << std::setw(24) << modeNames[m] << std::setw(16) << (frameCount * 1000.0f / ms) << totalBytes / frameCount << std::endl;
+	}
+
+	//How long the game loop is held up per frame, and how long the files take to appear
+	CaptureWriter writer(PNGCompression::Fast);
+	float quickestSubmit = FLT_MAX;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < frameCount; ++i) {
+		auto submitStart = std::chrono::high_resolution_clock::now();
+		writer.Submit("capturebench" + std::to_string(i) + ".png", frames[i % frames.size()].data(), width, height, 4, true);
+		quickestSubmit = std::min(quickestSubmit, MillisecondsSince(submitStart));
+	}
+	float submitMS = MillisecondsSince(start);
+	writer.WaitForAll();
+	float totalMS = MillisecondsSince(start);
+
+	//Once the queue's full, Submit waits for the encoder, so the average shows the sustained rate
+	std::cout << "CaptureWriter (Fast): submitting took " << quickestSubmit << "ms with room in the queue, "
+		<< submitMS / frameCount << "ms on average, " << (frameCount * 1000.0f / totalMS) << " frames/sec written to disk" << std::endl;
+	for (int i = 0; i < frameCount; ++i) {
+		std::remove(("capturebench" + std::to_string(i) + ".png").c_str());
+	}
+}
+
+//A made up character - a few limbs of 4 joints each, hanging off a spine
+static void BuildBenchSkeleton(int jointCount, vector<int>& parents, vector<Matrix4>& bindLocal) {
+	parents.resize(jointCount);
+	bindLocal.resize(jointCount);
+	for (int j = 0; j < jointCount; ++j) {
+		parents[j]		= j == 0 ? -1 : (j % 4 == 1 ? (j / 8) * 4 : j - 1);
+		bindLocal[j]	= Matrix4::Translation(Vector3(j % 4 == 1 ? 0.1f * ((j / 4) % 3) - 0.1f : 0.0f, 0.15f, 0.0f)) * Matrix4::Rotation(10.0f * (j % 5), Vector3(0, 0, 1));
+	}
+}
+
+//Every joint swings back and forth about its own axis - but some never move, as in a real rig
+static MeshAnimation* BuildBenchClip(const vector<int>& parents, const vector<Matrix4>& bindLocal, unsigned int frameCount, int variation) {
+	size_t jointCount = parents.size();
+	vector<Matrix4> frames(frameCount * jointCount);
+	for (unsigned int f = 0; f < frameCount; ++f) {
+		float phase = 2.0f * 3.14159265f * f / frameCount;
+		Matrix4* frame = &frames[f * jointCount];
+		for (size_t j = 0; j < jointCount; ++j) {
+			Matrix4 local = bindLocal[j];
+			if (j % 3 != 2) {
+				Vector3 axis = Vector3((float)(j % 2), 1.0f, (float)((j + variation) % 3)).Normalised();
+				local = local * Matrix4::Rotation(30.0f * sin(phase * (1 + variation) + j * 0.3f), axis);
+			}
+			if (j == 0) {
+				local = Matrix4::Translation(Vector3(0, 0.05f * sin(phase * 2.0f), 0.5f * sin(phase))) * local;
+			}
+			frame[j] = parents[j] < 0 ? local : frame[parents[j]] * local;
+		}
+	}
+	return new MeshAnimation((unsigned int)jointCount, frameCount, 30.0f, frames);
+}
+
+//Skinning matrices for a crowd, straight from baked frames and through the animation runtime
+static void AnimBench(int characterCount) {
+	const int jointCount = 64;
+	const unsigned int frameCount = 90;
+	vector<int>		parents;
+	vector<Matrix4>	bindLocal;
+	BuildBenchSkeleton(jointCount, parents, bindLocal);
+
+	vector<Matrix4> bindPose(jointCount);
+	vector<Matrix4> inverseBindPose(jointCount);
+	for (int j = 0; j < jointCount; ++j) {
+		bindPose[j]			= parents[j] < 0 ? bindLocal[j] : bindPose[parents[j]] * bindLocal[j];
+		inverseBindPose[j]	= bindPose[j].Inverse();
+	}
+	Skeleton skeleton(parents, inverseBindPose);
+
+	vector<MeshAnimation*>	anims;
+	vector<AnimationClip*>	clips;
+	for (int i = 0; i < 3; ++i) {
+		anims.emplace_back(BuildBenchClip(parents, bindLocal, frameCount, i));
+		clips.emplace_back(new AnimationClip(*anims.back(), skeleton));
+	}
+	std::cout << characterCount << " characters, " << jointCount << " joints, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	size_t rawSize = sizeof(Matrix4) * frameCount * jointCount;
+	std::cout << "Clip of " << frameCount << " frames: " << rawSize << " bytes baked, " << clips[0]->GetCompressedSize() << " bytes compressed" << std::endl;
+
+	//Sampling exactly on each frame should give back the baked matrices, give or take quantisation
+	float maxError = 0.0f;
+	AnimationInstance check(skeleton);
+	check.AddLayer(clips[0]);
+	for (unsigned int f = 0; f < frameCount; ++f) {
+		check.SetLayerTime(0, f / clips[0]->GetFrameRate());
+		check.Evaluate();
+		const Matrix4* baked = anims[0]->GetJointData(f);
+		for (int j = 0; j < jointCount; ++j) {
+			maxError = std::max(maxError, (baked[j].GetPositionVector() - check.GetModelMatrices()[j].GetPositionVector()).Length());
+		}
+	}
+	std::cout << "Max joint position error " << std::setprecision(6) << maxError << std::setprecision(3) << std::endl;
+
+	const int	ticks	= 20;
+	const float	dt		= 1.0f / 60.0f;
+	float		perThousand = 1000.0f / (characterCount * ticks);
+
+	vector<vector<Matrix4>> bakedSkinning(characterCount, vector<Matrix4>(jointCount));
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int t = 0; t < ticks; ++t) {
+		for (int c = 0; c < characterCount; ++c) {
+			unsigned int frame = (unsigned int)((t * dt + c * 0.1f) * anims[0]->GetFrameRate()) % frameCount;
+			const Matrix4* joints = anims[0]->GetJointData(frame);
+			for (int j = 0; j < jointCount; ++j) {
+				bakedSkinning[c][j] = joints[j] * inverseBindPose[j];
+			}
+		}
+	}
+	std::cout << std::left << std::setw(40) << "Baked frames, no interpolation" << MillisecondsSince(start) * perThousand << "ms per 1000" << std::endl;
+
+	for (int layerCount = 1; layerCount <= 3; ++layerCount) {
+		vector<AnimationInstance*> instances;
+		for (int c = 0; c < characterCount; ++c) {
+			AnimationInstance* instance = new AnimationInstance(skeleton);
+			for (int l = 0; l < layerCount; ++l) {
+				instance->AddLayer(clips[l], 1.0f / (l + 1));
+				instance->SetLayerTime(l, c * 0.1f);
+			}
+			instances.emplace_back(instance);
+		}
+		start = std::chrono::high_resolution_clock::now();
+		for (int t = 0; t < ticks; ++t) {
+			AnimationInstance::EvaluateAll(instances, dt);
+		}
+		string name = "Runtime, " + std::to_string(layerCount) + (layerCount == 1 ? " clip" : " clips blended");
+		std::cout << std::setw(40) << name << MillisecondsSince(start) * perThousand << "ms per 1000" << std::endl;
+		for (AnimationInstance* i : instances) {
+			delete i;
+		}
+	}
+	for (int i = 0; i < 3; ++i) {
+		delete clips[i];
+		delete anims[i];
+	}
+}
+
+//Random boxes scattered around a camera, tested one at a time and 4 at a time
+static void CullBench(size_t objectCount) {
+	CullingBounds bounds;
+	bounds.Reserve(objectCount);
+	unsigned int seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	Vector3 localMin(-1, -1, -1);
+	Vector3 localMax(1, 1, 1);
+	for (size_t i = 0; i < objectCount; ++i) {
+		Matrix4 transform = Matrix4::Translation(Vector3(random() * 1000.0f - 500.0f, random() * 40.0f - 35.0f, random() * 1000.0f - 500.0f)) *
+			Matrix4::Rotation(random() * 360.0f, Vector3(0, 1, 0)) * Matrix4::Scale(Vector3(1.0f + random() * 4.0f, 1.0f + random() * 4.0f, 1.0f + random() * 4.0f));
+		bounds.AddTransformedAABB(localMin, localMax, transform);
+	}
+	Matrix4 view = Matrix4::BuildViewMatrix(Vector3(-40, 30, 10), Vector3(0, 0, -100), Vector3(0, 1, 0));
+	Matrix4 proj = Matrix4::Perspective(1.0f, 1000.0f, 16.0f / 9.0f, 45.0f);
+	Frustum frustum(proj * view);
+
+	std::cout << objectCount << " objects" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	const int repeats = 20;
+	vector<char> scalarVisible(objectCount);
+	size_t scalarInside = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		scalarInside = 0;
+		for (size_t i = 0; i < objectCount; ++i) {
+			scalarVisible[i] = frustum.AABBInside(bounds.GetCentre(i), bounds.GetHalfSize(i));
+			scalarInside += scalarVisible[i];
+		}
+	}
+	std::cout << std::left << std::setw(24) << "AABBs, one at a time" << MillisecondsSince(start) / repeats << "ms, " << scalarInside << " inside" << std::endl;
+
+	vector<char> visible;
+	size_t inside = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		inside = frustum.CullAABBs(bounds, visible);
+	}
+	float ms = MillisecondsSince(start) / repeats;
+	size_t mismatches = 0;
+	for (size_t i = 0; i < objectCount; ++i) {
+		mismatches += visible[i] != scalarVisible[i];
+	}
+	std::cout << std::setw(24) << "AABBs, batched" << ms << "ms, " << inside << " inside, " << mismatches << " differ" << std::endl;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		inside = frustum.CullSpheres(bounds, visible);
+	}
+	std::cout << std::setw(24) << "Spheres, batched" << MillisecondsSince(start) / repeats << "ms, " << inside << " inside" << std::endl;
+}
+
+//Runs a draw list through a RenderStateTracker the way GameTechRenderer's camera pass does
+static RenderStateStats CountStateChanges(const vector<DrawItem>& order, const vector<unsigned int>& shaders,
+	const vector<unsigned int>& textures, const vector<unsigned int>& meshes) {
+	RenderStateTracker tracker;
+	for (const DrawItem& d : order) {
+		//IDs stand in for the API objects - offset so no ID looks like a null pointer
+		tracker.ShaderChange((const void*)(size_t)(shaders[d.index] + 1));
+		tracker.TextureChange(0, (const void*)(size_t)(textures[d.index] + 1));
+		tracker.MeshChange((const void*)(size_t)(meshes[d.index] + 1));
+		tracker.CountDraw();
+	}
+	return tracker.GetStats();
+}
+
+static void PrintStateStats(const string& name, const RenderStateStats& stats) {
+	std::cout << std::left << std::setw(24) << name << std::setw(10) << stats.draws << std::setw(10) << stats.shaderChanges
+		<< std::setw(10) << stats.textureChanges << stats.meshChanges << std::endl;
+}
+
+//State changes for a frame's draws in scene order and in sorted order, without needing a GPU
+static void DrawSortBench(size_t drawCount) {
+	const unsigned int shaderCount	= 8;
+	const unsigned int textureCount	= 64;
+	const unsigned int meshCount	= 32;
+	const unsigned int typeCount	= 200; //objects come in types, that share a shader, texture and mesh
+
+	unsigned int seed = 12345;
+	auto random = [&seed](unsigned int range) {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) % range;
+	};
+	vector<unsigned int> typeShader(typeCount), typeTexture(typeCount), typeMesh(typeCount);
+	for (unsigned int t = 0; t < typeCount; ++t) {
+		typeShader[t]	= random(shaderCount);
+		typeTexture[t]	= random(textureCount);
+		typeMesh[t]		= random(meshCount);
+	}
+	vector<unsigned int>	shaders(drawCount), textures(drawCount), meshes(drawCount);
+	vector<DrawItem>		sceneOrder(drawCount);
+	for (size_t i = 0; i < drawCount; ++i) {
+		unsigned int type = random(typeCount);
+		shaders[i]	= typeShader[type];
+		textures[i]	= typeTexture[type];
+		meshes[i]	= typeMesh[type];
+		float depth	= 1.0f + random(100000) * 0.01f;
+		sceneOrder[i] = { DrawKey::Make(0, shaders[i], textures[i], meshes[i], depth), (uint32_t)i };
+	}
+	std::cout << drawCount << " draws, " << shaderCount << " shaders, " << textureCount << " textures, " << meshCount << " meshes" << std::endl;
+	std::cout << std::left << std::setw(24) << "Order" << std::setw(10) << "Draws" << std::setw(10) << "Shaders" << std::setw(10) << "Textures" << "Meshes" << std::endl;
+	PrintStateStats("Scene order", CountStateChanges(sceneOrder, shaders, textures, meshes));
+
+	const int repeats = 50;
+	vector<DrawItem> sorted;
+	vector<DrawItem> scratch;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		sorted = sceneOrder;
+		RadixSortDraws(sorted, scratch);
+	}
+	float radixMS = MillisecondsSince(start) / repeats;
+	PrintStateStats("Sorted by key", CountStateChanges(sorted, shaders, textures, meshes));
+
+	vector<DrawItem> reference;
+	start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		reference = sceneOrder;
+		std::stable_sort(reference.begin(), reference.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+	}
+	float stdMS = MillisecondsSince(start) / repeats;
+
+	bool same = true;
+	for (size_t i = 0; i < drawCount; ++i) {
+		same &= reference[i].index == sorted[i].index;
+	}
+	std::cout << std::fixed << std::setprecision(3) << "Radix sort " << radixMS << "ms, std::stable_sort " << stdMS << "ms, "
+		<< (same ? "same order" : "ORDER DIFFERS") << std::endl;
+}
+
+//Draw calls for a level made of a handful of meshes, one per object and then instanced
+static void InstanceBench(size_t objectCount) {
+	const unsigned int textureCount	= 2;
+	const unsigned int meshCount	= 4;	//cubes, spheres, capsules, and the odd bit of scenery
+	const unsigned int lodCount		= 3;
+
+	unsigned int seed = 12345;
+	auto random = [&seed](unsigned int range) {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) % range;
+	};
+	//Stand-ins for the shader, texture and mesh pointers a renderer would batch on
+	auto handle = [](unsigned int id) {
+		return (const void*)(uintptr_t)(id + 1);
+	};
+	vector<unsigned int>	textures(objectCount), meshes(objectCount), lods(objectCount);
+	vector<Matrix4>			transforms(objectCount);
+	vector<DrawItem>		drawItems(objectCount);
+	for (size_t i = 0; i < objectCount; ++i) {
+		textures[i]		= random(textureCount);
+		meshes[i]		= random(meshCount);
+		lods[i]			= random(lodCount);
+		transforms[i]	= Matrix4::Translation(Vector3((float)random(1000), 0.0f, (float)random(1000)));
+		float depth		= 1.0f + random(100000) * 0.01f;
+		drawItems[i] = { DrawKey::Make(0, 0, textures[i], meshes[i] * lodCount + lods[i], depth), (uint32_t)i };
+	}
+	vector<DrawItem> scratch;
+	RadixSortDraws(drawItems, scratch);
+
+	InstanceBatcher batcher;
+	const int repeats = 50;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		batcher.Clear();
+		for (const DrawItem& d : drawItems) {
+			batcher.Add(handle(0), handle(textures[d.index]), handle(meshes[d.index]), lods[d.index], transforms[d.index], Vector4(1, 1, 1, 1));
+		}
+	}
+	float batchMS = MillisecondsSince(start) / repeats;
+
+	size_t largest = 0;
+	for (const InstanceBatch& b : batcher.GetBatches()) {
+		largest = std::max(largest, (size_t)b.instanceCount);
+	}
+	std::cout << objectCount << " objects, " << textureCount << " textures, " << meshCount << " meshes, " << lodCount << " LODs each" << std::endl;
+	std::cout << "Draw calls: " << objectCount << " -> " << batcher.GetBatches().size() << " (largest batch " << largest << " instances)" << std::endl;
+	std::cout << std::fixed << std::setprecision(3) << "Batching " << batchMS << "ms, "
+		<< batcher.GetInstances().size() * sizeof(InstanceData) / 1024 << "KB of instance data per pass" << std::endl;
+}
+
+struct BenchObject {
+	unsigned int	shader;
+	unsigned int	texture;
+	unsigned int	mesh;
+	Matrix4			transform;
+	Vector4			colour;
+};
+
+//Records a shadow and a camera command per object, splitting the objects between bufferCount buffers
+static void RecordBenchCommands(const vector<BenchObject>& objects, const vector<CompilerMesh>& meshes,
+	vector<RenderCommandBuffer>& buffers, size_t bufferCount) {
+	buffers.resize(bufferCount);
+	size_t rangeSize = (objects.size() + bufferCount - 1) / bufferCount;
+
+	ParallelFor(bufferCount, 1, [&](size_t firstBuffer, size_t lastBuffer) {
+		for (size_t b = firstBuffer; b < lastBuffer; ++b) {
+			size_t begin	= std::min(objects.size(), b * rangeSize);
+			size_t end		= std::min(objects.size(), begin + rangeSize);
+			buffers[b].Reset();
+			for (size_t i = begin; i < end; ++i) {
+				const BenchObject& o = objects[i];
+				float	depth		= o.transform.GetPositionVector().LengthSquared();
+				bool	transparent = o.colour.w < 1.0f;
+
+				DrawMeshCommand& shadow = buffers[b].Record<DrawMeshCommand>(DrawKey::Make(0, 0, 0, o.mesh, depth));
+				shadow.shader		= (ShaderBase*)(size_t)1;
+				shadow.texture		= nullptr;
+				shadow.mesh			= (MeshGeometry*)&meshes[o.mesh];
+				shadow.lodLevel		= 0;
+				shadow.modelMatrix	= o.transform;
+				shadow.colour		= o.colour;
+
+				DrawMeshCommand& camera = buffers[b].Record<DrawMeshCommand>(DrawKey::Make(transparent ? 2 : 1, o.shader, o.texture, o.mesh, depth, transparent));
+				camera.shader		= (ShaderBase*)(size_t)(o.shader + 2);
+				camera.texture		= (TextureBase*)(size_t)(o.texture + 1);
+				camera.mesh			= (MeshGeometry*)&meshes[o.mesh];
+				camera.lodLevel		= 0;
+				camera.modelMatrix	= o.transform;
+				camera.colour		= o.colour;
+			}
+		}
+	});
+}
+
+//Times recording, merging and submitting a frame's commands, without a GPU
+static void CommandBench(size_t objectCount) {
+	const unsigned int shaderCount	= 8;
+	const unsigned int textureCount	= 64;
+	const unsigned int meshCount	= 32;
+
+	unsigned int seed = 12345;
+	auto random = [&seed](unsigned int range) {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) % range;
+	};
+	vector<CompilerMesh> meshes(meshCount);
+	vector<BenchObject> objects(objectCount);
+	for (BenchObject& o : objects) {
+		o.shader	= random(shaderCount);
+		o.texture	= random(textureCount);
+		o.mesh		= random(meshCount);
+		o.transform	= Matrix4::Translation(Vector3((float)random(1000), (float)random(100), (float)random(1000)));
+		o.colour	= Vector4(1, 1, 1, random(10) == 0 ? 0.5f : 1.0f);
+	}
+	size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::cout << objectCount << " objects, " << threadCount << " hardware threads" << std::endl;
+
+	const int			repeats = 20;
+	vector<size_t>		bufferCounts = { 1, 4 };
+	if (threadCount != 1 && threadCount != 4) {
+		bufferCounts.push_back(threadCount);
+	}
+	vector<uint64_t>	referenceKeys;
+	vector<const void*>	referenceMeshes;
+	for (size_t bufferCount : bufferCounts) {
+		vector<RenderCommandBuffer>	buffers;
+		RenderCommandQueue			queue;
+		NullRenderBackend			backend;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < repeats; ++r) {
+			RecordBenchCommands(objects, meshes, buffers, bufferCount);
+		}
+		float recordMS = MillisecondsSince(start) / repeats;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < repeats; ++r) {
+			queue.Merge(buffers);
+		}
+		float mergeMS = MillisecondsSince(start) / repeats;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int r = 0; r < repeats; ++r) {
+			backend.ResetStats();
+			backend.Submit(queue, 3);
+		}
+		float submitMS = MillisecondsSince(start) / repeats;
+
+		//However the objects were split up, the merged order should be the same
+		bool same = true;
+		for (size_t i = 0; i < queue.GetCommandCount(); ++i) {
+			const DrawMeshCommand& c = (const DrawMeshCommand&)queue.GetCommand(i);
+			if (referenceKeys.size() < queue.GetCommandCount()) {
+				referenceKeys.push_back(queue.GetKey(i));
+				referenceMeshes.push_back(c.mesh);
+			}
+			same &= referenceKeys[i] == queue.GetKey(i) && referenceMeshes[i] == c.mesh;
+		}
+		size_t arenaBytes = 0;
+		for (const RenderCommandBuffer& b : buffers) {
+			arenaBytes += b.GetBytesUsed();
+		}
+		const NullBackendStats& stats = backend.GetStats();
+		std::cout << std::fixed << std::setprecision(3) << std::setw(2) << bufferCount << " buffers: record " << recordMS << "ms, merge "
+			<< mergeMS << "ms, submit " << submitMS << "ms, " << stats.draws << " draws, " << stats.invalidCommands << " invalid, "
+			<< arenaBytes / 1024 << "KB recorded, " << (same ? "same order" : "ORDER DIFFERS") << std::endl;
+	}
+}
+
+//Runs a few frames of random allocations, checking every offset lands where it should
+static size_t CheckRingAllocator(size_t alignment) {
+	const int	frames		= 3;
+	size_t		failures	= 0;
+	unsigned int seed = 12345;
+	auto random = [&seed](unsigned int range) {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) % range;
+	};
+	FrameRingAllocator ring(10000, frames, alignment);
+	failures += ring.GetFrameSize() % alignment != 0 || ring.GetFrameSize() < 10000;
+
+	for (int f = 0; f < frames * 4; ++f) {
+		ring.BeginFrame();
+		if (f == frames * 2) {
+			ring.Resize(20000);
+		}
+		size_t regionStart	= ring.GetFrameSize() * ring.GetCurrentFrame();
+		size_t regionEnd	= regionStart + ring.GetFrameSize();
+		size_t lastEnd		= regionStart;
+		size_t offset		= 0;
+		while (true) {
+			size_t bytes = 1 + random(700);
+			if (!ring.Allocate(bytes, offset)) {
+				//Only allowed to fail when there really isn't room left
+				failures += lastEnd + bytes <= regionEnd && ring.AlignedSize(lastEnd) + bytes <= regionEnd;
+				break;
+			}
+			failures += offset % alignment != 0;
+			failures += offset < lastEnd || offset + bytes > regionEnd;
+			lastEnd = offset + bytes;
+		}
+		failures += ring.GetCurrentFrame() != (f + 1) % frames;
+	}
+	return failures;
+}
+
+//Packs per draw uniform blocks the way GameTechRenderer does, and checks the ring allocator's offsets
+static void UniformBench(size_t drawCount) {
+	size_t failures = CheckRingAllocator(256) + CheckRingAllocator(48) + CheckRingAllocator(1);
+
+	vector<DrawUniforms> draws(drawCount);
+	for (size_t i = 0; i < drawCount; ++i) {
+		draws[i].modelMatrix	= Matrix4::Translation(Vector3((float)i, 0.0f, 0.0f));
+		draws[i].objectColour	= Vector4(1, 1, 1, 1);
+		draws[i].hasVertexColours	= (int)(i & 1);
+		draws[i].hasTexture			= (int)((i >> 1) & 1);
+		draws[i].useInstancing		= 0;
+		draws[i].shadowCascade		= 0;
+	}
+	const size_t	stride	= FrameRingAllocator::AlignUp(sizeof(DrawUniforms), 256);
+	const int		repeats = 20;
+
+	vector<char> packed;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		PackUniformArray(draws.data(), drawCount, stride, packed);
+	}
+	float packMS = MillisecondsSince(start) / repeats;
+	for (size_t i = 0; i < drawCount; ++i) {
+		failures += memcmp(packed.data() + i * stride, &draws[i], sizeof(DrawUniforms)) != 0;
+	}
+
+	//The same blocks one allocation at a time, into memory standing in for a mapped buffer
+	FrameRingAllocator ring(drawCount * stride, 3, 256);
+	vector<char> mapped(ring.GetTotalSize());
+	start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		ring.BeginFrame();
+		for (size_t i = 0; i < drawCount; ++i) {
+			size_t offset = 0;
+			if (!ring.Allocate(sizeof(DrawUniforms), offset)) {
+				failures++;
+				break;
+			}
+			memcpy(mapped.data() + offset, &draws[i], sizeof(DrawUniforms));
+		}
+	}
+	float ringMS = MillisecondsSince(start) / repeats;
+
+	float megabytes = drawCount * sizeof(DrawUniforms) / (1024.0f * 1024.0f);
+	std::cout << drawCount << " draws, " << sizeof(FrameUniforms) << " byte frame block, " << sizeof(DrawUniforms)
+		<< " byte draw block, " << stride << " byte stride" << std::endl;
+	std::cout << std::fixed << std::setprecision(3) << "Packed array  " << packMS << "ms, " << std::setprecision(0) << megabytes / (packMS / 1000.0f) << "MB/s" << std::endl;
+	std::cout << std::fixed << std::setprecision(3) << "Ring per draw " << ringMS << "ms, " << std::setprecision(0) << megabytes / (ringMS / 1000.0f) << "MB/s" << std::endl;
+	std::cout << (failures == 0 ? "Ring and packing checks passed" : "Ring and packing checks FAILED: ") << (failures ? std::to_string(failures) : "") << std::endl;
+}
+
+//The corners of the camera's view frustum between two distances, in world space
+static void SliceCorners(const Matrix4& view, float fov, float aspect, float nearDist, float farDist, Vector3* corners) {
+	Matrix4 cameraMatrix	= view.Inverse();
+	float	tanY			= tan(Maths::DegreesToRadians(fov) * 0.5f);
+	float	tanX			= tanY * aspect;
+	float	depths[2]		= { nearDist, farDist };
+	for (int i = 0; i < 8; ++i) {
+		float	d = depths[i >> 2];
+		Vector4 c = cameraMatrix * Vector4((i & 1 ? 1 : -1) * d * tanX, (i & 2 ? 1 : -1) * d * tanY, -d, 1.0f);
+		corners[i] = Vector3(c.x, c.y, c.z);
+	}
+}
+
+//Where a world space point lands on a cascade's shadow map, in texels
+static Vector2 ShadowTexel(const ShadowCascade& cascade, const Vector3& point, int resolution) {
+	Vector4 clip = cascade.viewProj * Vector4(point, 1.0f);
+	return Vector2(clip.x * resolution * 0.5f, clip.y * resolution * 0.5f);
+}
+
+//Fits cascades around a camera the way GameTechRenderer does, checks they cover it and hold still, and counts casters per cascade
+static void CascadeBench(size_t objectCount) {
+	const float		fov			= 45.0f;
+	const float		aspect		= 16.0f / 9.0f;
+	const float		nearPlane	= 0.1f;
+	const float		farPlane	= 500.0f;
+	const int		resolution	= 2048;
+	const Vector3	lightDir	= Vector3(200.0f, -60.0f, 200.0f).Normalised();
+	const Vector3	cameraPos(-40, 30, 10);
+
+	ShadowCascades cascades(ShadowCascades::MaxCascades, resolution);
+	size_t failures = 0;
+
+	float splits[ShadowCascades::MaxCascades + 1];
+	ShadowCascades::ComputeSplits(nearPlane, farPlane, ShadowCascades::MaxCascades, 0.75f, splits);
+	failures += splits[0] != nearPlane || splits[ShadowCascades::MaxCascades] != farPlane;
+	for (int i = 0; i < ShadowCascades::MaxCascades; ++i) {
+		failures += !(splits[i] < splits[i + 1]);
+	}
+
+	//Every corner of each slice has to land on its cascade's map, whichever way the camera faces
+	float radii[ShadowCascades::MaxCascades];
+	for (int yaw = 0; yaw < 360; yaw += 15) {
+		for (int pitch = -80; pitch <= 80; pitch += 40) {
+			float	y = Maths::DegreesToRadians((float)yaw);
+			float	p = Maths::DegreesToRadians((float)pitch);
+			Vector3 forward(sin(y) * cos(p), sin(p), -cos(y) * cos(p));
+			Matrix4 view = Matrix4::BuildViewMatrix(cameraPos, cameraPos + forward, Vector3(0, 1, 0));
+			cascades.Update(view, fov, aspect, nearPlane, farPlane, lightDir);
+
+			for (int c = 0; c < cascades.GetCascadeCount(); ++c) {
+				const ShadowCascade& cascade = cascades.GetCascade(c);
+				Vector3 corners[8];
+				SliceCorners(view, fov, aspect, cascade.splitNear, cascade.splitFar, corners);
+				for (const Vector3& corner : corners) {
+					Vector4 clip = cascade.viewProj * Vector4(corner, 1.0f);
+					failures += std::abs(clip.x) > 1.0f || std::abs(clip.y) > 1.0f || std::abs(clip.z) > 1.0f;
+				}
+				//The map's size mustn't change as the camera turns
+				if (yaw == 0 && pitch == -80) {
+					radii[c] = cascade.radius;
+				}
+				failures += cascade.radius != radii[c];
+			}
+		}
+	}
+
+	//Moving the camera must only ever move the maps by whole texels, or shadow edges shimmer
+	Vector3 forward = Vector3(0, -30, -110).Normalised();
+	cascades.Update(Matrix4::BuildViewMatrix(cameraPos, cameraPos + forward, Vector3(0, 1, 0)), fov, aspect, nearPlane, farPlane, lightDir);
+	ShadowCascades moved(ShadowCascades::MaxCascades, resolution);
+	float worstDrift = 0.0f;
+	for (int step = 1; step <= 100; ++step) {
+		Vector3 pos = cameraPos + Vector3(0.013f, 0.007f, -0.011f) * (float)step;
+		moved.Update(Matrix4::BuildViewMatrix(pos, pos + forward, Vector3(0, 1, 0)), fov, aspect, nearPlane, farPlane, lightDir);
+		for (int c = 0; c < moved.GetCascadeCount(); ++c) {
+			Vector2 before	= ShadowTexel(cascades.GetCascade(c), Vector3(0, 0, 0), resolution);
+			Vector2 after	= ShadowTexel(moved.GetCascade(c), Vector3(0, 0, 0), resolution);
+			Vector2 shift	= after - before;
+			//Map space gets large far from the origin, so allow a little float error
+			worstDrift = std::max(worstDrift, std::max(std::abs(shift.x - std::round(shift.x)), std::abs(shift.y - std::round(shift.y))));
+		}
+	}
+	failures += worstDrift > 0.01f;
+
+	//A scene like CullBench's, culled against each cascade
+	CullingBounds bounds;
+	bounds.Reserve(objectCount);
+	unsigned int seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	for (size_t i = 0; i < objectCount; ++i) {
+		Matrix4 transform = Matrix4::Translation(Vector3(random() * 1000.0f - 500.0f, random() * 40.0f - 35.0f, random() * 1000.0f - 500.0f)) *
+			Matrix4::Rotation(random() * 360.0f, Vector3(0, 1, 0)) * Matrix4::Scale(Vector3(1.0f + random() * 4.0f, 1.0f + random() * 4.0f, 1.0f + random() * 4.0f));
+		bounds.AddTransformedAABB(Vector3(-1, -1, -1), Vector3(1, 1, 1), transform);
+	}
+	Matrix4 view = Matrix4::BuildViewMatrix(cameraPos, Vector3(0, 0, -100), Vector3(0, 1, 0));
+	Matrix4 proj = Matrix4::Perspective(nearPlane, farPlane, aspect, fov);
+	vector<char> cameraVisible;
+	size_t cameraInside = Frustum(proj * view).CullAABBs(bounds, cameraVisible);
+
+	const int repeats = 20;
+	vector<char> visible[ShadowCascades::MaxCascades];
+	size_t casters[ShadowCascades::MaxCascades] = {};
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < repeats; ++r) {
+		cascades.Update(view, fov, aspect, nearPlane, farPlane, lightDir);
+		for (int c = 0; c < cascades.GetCascadeCount(); ++c) {
+			casters[c] = cascades.GetCascade(c).frustum.CullAABBs(bounds, visible[c]);
+		}
+	}
+	float cullMS = MillisecondsSince(start) / repeats;
+
+	size_t anyCascade = 0;
+	for (size_t i = 0; i < objectCount; ++i) {
+		bool casts = false;
+		for (int c = 0; c < cascades.GetCascadeCount(); ++c) {
+			casts |= visible[c][i] != 0;
+		}
+		anyCascade += casts;
+	}
+
+	std::cout << objectCount << " objects, " << cameraInside << " in view, " << anyCascade << " casting into a cascade" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	for (int c = 0; c < cascades.GetCascadeCount(); ++c) {
+		const ShadowCascade& cascade = cascades.GetCascade(c);
+		std::cout << "Cascade " << c << ": " << std::setw(7) << cascade.splitNear << " - " << std::setw(7) << cascade.splitFar
+			<< ", radius " << std::setw(7) << cascade.radius << ", " << std::setprecision(3) << (2.0f * cascade.radius / resolution)
+			<< " units per texel, " << std::setprecision(2) << casters[c] << " casters" << std::endl;
+	}
+	std::cout << std::setprecision(3) << "Fit and cull " << cullMS << "ms, worst texel drift " << worstDrift << std::endl;
+	std::cout << (failures == 0 ? "Cascade checks passed" : "Cascade checks FAILED: ") << (failures ? std::to_string(failures) : "") << std::endl;
+}
+
+//The old debug line path - entries rescanned every frame, then copied out into fresh position and colour arrays
+struct OldDebugLine {
+	Vector3 start;
+	Vector3 end;
+	float	time;
+	Vector4 colour;
+};
+
+static size_t OldDebugFrame(vector<OldDebugLine>& entries, float dt, vector<Vector3>& meshPositions, vector<Vector4>& meshColours) {
+	vector<Vector3> vertPos;
+	vector<Vector4> vertCol;
+	int trim = 0;
+	for (size_t i = 0; i < entries.size(); ) {
+		OldDebugLine* e = &entries[i];
+		vertPos.emplace_back(e->start);
+		vertPos.emplace_back(e->end);
+		vertCol.emplace_back(e->colour);
+		vertCol.emplace_back(e->colour);
+		e->time -= dt;
+		if (e->time < 0) {
+			trim++;
+			entries[i] = entries[entries.size() - trim];
+		}
+		else {
+			++i;
+		}
+		if (i + trim >= entries.size()) {
+			break;
+		}
+	}
+	entries.resize(entries.size() - trim);
+	meshPositions = vertPos;
+	meshColours = vertCol;
+	return vertPos.size();
+}
+
+//Every body's AABB and a contact arrow per body each frame, plus some timed shapes, the old way and through a DebugDrawBuffer
+static void DebugBench(size_t bodyCount) {
+	unsigned int seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	vector<Vector3> centres(bodyCount);
+	vector<Vector3> halfSizes(bodyCount);
+	vector<Vector3> contacts(bodyCount);
+	vector<Vector3> normals(bodyCount);
+	for (size_t i = 0; i < bodyCount; ++i) {
+		centres[i]		= Vector3(random() * 500.0f - 250.0f, random() * 20.0f, random() * 500.0f - 250.0f);
+		halfSizes[i]	= Vector3(0.5f + random() * 2.0f, 0.5f + random() * 2.0f, 0.5f + random() * 2.0f);
+		contacts[i]		= centres[i] + Vector3(0, halfSizes[i].y, 0);
+		normals[i]		= Vector3(random() - 0.5f, 1.0f, random() - 0.5f).Normalised();
+	}
+	const size_t	timedCount	= 1000;
+	const int		frames		= 60;
+	const float		dt			= 1.0f / 60.0f;
+	vector<float>	lifetimes(timedCount);
+	for (float& t : lifetimes) {
+		t = random() * 1.5f;
+	}
+	const Vector4 colour(0, 1, 0, 1);
+	size_t failures = 0;
+
+	//Boxes as 12 lines each, arrows as 5, timed crosses as 3
+	vector<OldDebugLine>	oldEntries;
+	vector<Vector3>			meshPositions;
+	vector<Vector4>			meshColours;
+	size_t					oldVertices = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int f = 0; f < frames; ++f) {
+		if (f == 0) {
+			for (size_t i = 0; i < timedCount; ++i) {
+				for (int axis = 0; axis < 3; ++axis) {
+					Vector3 offset;
+					offset[axis] = 0.5f;
+					oldEntries.push_back({ centres[i] - offset, centres[i] + offset, lifetimes[i], colour });
+				}
+			}
+		}
+		for (size_t i = 0; i < bodyCount; ++i) {
+			Vector3 c = centres[i];
+			Vector3 h = halfSizes[i];
+			Vector3 corners[8];
+			for (int k = 0; k < 8; ++k) {
+				corners[k] = Vector3(c.x + (k & 1 ? h.x : -h.x), c.y + (k & 2 ? h.y : -h.y), c.z + (k & 4 ? h.z : -h.z));
+			}
+			static const int edges[24] = { 0, 1, 2, 3, 4, 5, 6, 7, 0, 2, 1, 3, 4, 6, 5, 7, 0, 4, 1, 5, 2, 6, 3, 7 };
+			for (int e = 0; e < 24; e += 2) {
+				oldEntries.push_back({ corners[edges[e]], corners[edges[e + 1]], 0.0f, colour });
+			}
+			Vector3 tip = contacts[i] + normals[i];
+			oldEntries.push_back({ contacts[i], tip, 0.0f, colour });
+			for (int k = 0; k < 4; ++k) {
+				oldEntries.push_back({ tip, tip - normals[i] * 0.2f, 0.0f, colour });
+			}
+		}
+		oldVertices += OldDebugFrame(oldEntries, dt, meshPositions, meshColours);
+	}
+	float oldMS = MillisecondsSince(start) / frames;
+
+	DebugDrawBuffer buffer;
+	const DebugLineVertex* storage = buffer.GetLineVertices();
+	size_t newVertices	= 0;
+	size_t dropped		= 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (int f = 0; f < frames; ++f) {
+		if (f == 0) {
+			for (size_t i = 0; i < timedCount; ++i) {
+				buffer.AddCross(centres[i], 0.5f, colour, lifetimes[i]);
+			}
+		}
+		buffer.AddBoxes(centres.data(), halfSizes.data(), bodyCount, colour);
+		for (size_t i = 0; i < bodyCount; ++i) {
+			buffer.AddArrow(contacts[i], contacts[i] + normals[i], colour);
+		}
+		buffer.Update(dt);
+		newVertices += buffer.GetLineVertexCount();
+
+		//Timed shapes should last exactly as long as the old path kept them
+		size_t alive = 0;
+		for (float t : lifetimes) {
+			alive += t - dt * (f + 1) >= 0.0f;
+		}
+		failures += buffer.GetTimedShapeCount() != alive;
+
+		buffer.Clear();
+		dropped += buffer.GetLastFrameStats().droppedVertices;
+	}
+	float newMS = MillisecondsSince(start) / frames;
+
+	//Storage is never reallocated, so after the first frame nothing is allocated at all
+	failures += buffer.GetLineVertices() != storage;
+	failures += oldVertices != newVertices;
+
+	std::cout << bodyCount << " bodies, " << timedCount << " timed crosses, " << frames << " frames" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << std::left << std::setw(20) << "Old line entries" << oldMS << "ms per frame, " << oldVertices / frames << " vertices, "
+		<< (sizeof(Vector3) + sizeof(Vector4)) * oldVertices / frames / 1024 << "KB" << std::endl;
+	std::cout << std::setw(20) << "DebugDrawBuffer" << newMS << "ms per frame, " << newVertices / frames << " vertices, "
+		<< sizeof(DebugLineVertex) * newVertices / frames / 1024 << "KB, " << dropped << " dropped" << std::endl;
+	std::cout << (failures == 0 ? "Debug draw checks passed" : "Debug draw checks FAILED: ") << (failures ? std::to_string(failures) : "") << std::endl;
+}
+
+static void TextBench(size_t labelCount) {
+	SimpleFont font("PressStart2P.fnt", "PressStart2P.png");
+	if (!font.GetGlyph('A')) {
+		std::cout << __FUNCTION__ << " can't load the font!" << std::endl;
+		return;
+	}
+	unsigned int seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	//Mostly fixed labels, with every tenth showing a number that changes every few frames
+	vector<string>	labels(labelCount);
+	vector<Vector2>	positions(labelCount);
+	vector<int>		changeEvery(labelCount, 0);
+	for (size_t i = 0; i < labelCount; ++i) {
+		labels[i]		= "Label " + std::to_string(i % 500) + ":";
+		positions[i]	= Vector2(random() * 90.0f, random() * 95.0f);
+		if (i % 10 == 0) {
+			changeEvery[i] = 1 + (int)(random() * 30.0f);
+		}
+	}
+	const int		frames	= 60;
+	const float		size	= 20.0f;
+	const Vector4	colour(1, 1, 1, 1);
+	size_t failures = 0;
+
+	auto frameText = [&](size_t i, int f) {
+		return changeEvery[i] ? "Value : " + std::to_string((f / changeEvery[i]) * 7 + i) : labels[i];
+	};
+
+	//Every string laid out again each frame, into loose arrays, then packed
+	vector<Vector3>			oldPositions;
+	vector<Vector2>			oldTexCoords;
+	vector<Vector4>			oldColours;
+	vector<DebugTextVertex>	oldVertices;
+	size_t					oldCount = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int f = 0; f < frames; ++f) {
+		oldPositions.clear();
+		oldTexCoords.clear();
+		oldColours.clear();
+		for (size_t i = 0; i < labelCount; ++i) {
+			string	text	= frameText(i, f);
+			Vector2	pos		= positions[i];
+			Vector4	c		= colour;
+			font.BuildVerticesForString(text, pos, c, size, oldPositions, oldTexCoords, oldColours);
+		}
+		oldVertices.resize(oldPositions.size());
+		for (size_t v = 0; v < oldPositions.size(); ++v) {
+			oldVertices[v] = { oldPositions[v], PackDebugColour(oldColours[v]), oldTexCoords[v] };
+		}
+		oldCount += oldVertices.size();
+	}
+	float oldMS = MillisecondsSince(start) / frames;
+
+	TextLayoutCache			cache(font);
+	vector<DebugTextVertex>	newVertices;
+	size_t					newCount	= 0;
+	size_t					layouts		= 0;
+	size_t					strings		= 0;
+	size_t					steadyLayouts = 0;
+	start = std::chrono::high_resolution_clock::now();
+	for (int f = 0; f < frames; ++f) {
+		newVertices.clear();
+		for (size_t i = 0; i < labelCount; ++i) {
+			string text = frameText(i, f);
+			cache.AppendString(text.c_str(), text.length(), positions[i], size, colour,
+				changeEvery[i] ? TextUsage::Dynamic : TextUsage::Static, newVertices);
+		}
+		cache.EndFrame();
+		newCount	+= newVertices.size();
+		layouts		+= cache.GetLastFrameStats().layouts;
+		strings		+= cache.GetLastFrameStats().strings;
+		if (f > 0) {
+			steadyLayouts += cache.GetLastFrameStats().layouts;
+		}
+	}
+	float newMS = MillisecondsSince(start) / frames;
+
+	//The cached output should match a fresh layout of the last frame
+	failures += oldVertices.size() != newVertices.size();
+	for (size_t v = 0; v < std::min(oldVertices.size(), newVertices.size()); ++v) {
+		const DebugTextVertex& a = oldVertices[v];
+		const DebugTextVertex& b = newVertices[v];
+		failures += (a.position - b.position).Length() > 0.001f || a.colour != b.colour ||
+			a.texCoord.x != b.texCoord.x || a.texCoord.y != b.texCoord.y;
+	}
+	failures += oldCount != newCount;
+
+	//Once warmed up, only the changing numbers should need laying out
+	size_t maxChanging = 0;
+	for (int c : changeEvery) {
+		maxChanging += c != 0;
+	}
+	failures += steadyLayouts > maxChanging * (frames - 1);
+
+	//Static labels stay cached even after a frame they're not drawn in
+	cache.EndFrame();
+	size_t before = cache.GetLastFrameStats().cachedRuns;
+	string probe = labels[1];
+	newVertices.clear();
+	cache.AppendString(probe.c_str(), probe.length(), positions[1], size, colour, TextUsage::Static, newVertices);
+	cache.EndFrame();
+	failures += cache.GetLastFrameStats().layouts != 0;
+	failures += before == 0;
+
+	std::cout << labelCount << " labels, " << maxChanging << " of them changing, " << frames << " frames" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << std::left << std::setw(20) << "Layout every frame" << oldMS << "ms per frame, " << labelCount << " layouts, "
+		<< oldCount / frames << " vertices" << std::endl;
+	std::cout << std::setw(20) << "TextLayoutCache" << newMS << "ms per frame, " << layouts / frames << " layouts, "
+		<< (strings - layouts) / frames << " cached, " << newCount / frames << " vertices" << std::endl;
+	std::cout << (failures == 0 ? "Text layout checks passed" : "Text layout checks FAILED: ") << (failures ? std::to_string(failures) : "") << std::endl;
+}
+
+//Whether the segment from start to end passes through a box, tested in the box's own space
+static bool SegmentHitsBox(const Vector3& start, const Vector3& end, const Vector3& boxMin, const Vector3& boxMax, const Matrix4& inverse) {
+	Vector3 p = inverse * start;
+	Vector3 d = (inverse * end) - p;
+	float tMin = 0.0f;
+	float tMax = 1.0f;
+	for (int axis = 0; axis < 3; ++axis) {
+		if (std::abs(d[axis]) < 0.000001f) {
+			if (p[axis] < boxMin[axis] || p[axis] > boxMax[axis]) {
+				return false;
+			}
+			continue;
+		}
+		float t0 = (boxMin[axis] - p[axis]) / d[axis];
+		float t1 = (boxMax[axis] - p[axis]) / d[axis];
+		tMin = std::max(tMin, std::min(t0, t1));
+		tMax = std::min(tMax, std::max(t0, t1));
+		if (tMin > tMax) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//A maze of thick walls seen from head height, with objects scattered through it
+static void OcclusionBench(size_t objectCount) {
+	unsigned int seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	const float cellSize	= 20.0f;
+	const int	cells		= 30;
+	const float	mazeSize	= cellSize * cells;
+	Vector3 localMin(-1, -1, -1);
+	Vector3 localMax(1, 1, 1);
+
+	vector<Matrix4> walls;
+	vector<Matrix4> wallInverses;
+	CullingBounds	wallBounds;
+	for (int x = 0; x < cells; ++x) {
+		for (int z = 0; z < cells; ++z) {
+			if (random() > 0.6f) {
+				continue;
+			}
+			//Mostly lined up with the grid, some turned a little
+			float angle = random() < 0.5f ? 0.0f : 90.0f;
+			if (random() < 0.2f) {
+				angle += random() * 40.0f - 20.0f;
+			}
+			Vector3 centre(x * cellSize - mazeSize * 0.5f, 5.0f, z * cellSize - mazeSize * 0.5f);
+			Matrix4 transform = Matrix4::Translation(centre) * Matrix4::Rotation(angle, Vector3(0, 1, 0)) * Matrix4::Scale(Vector3(cellSize * 0.5f, 5.0f, 1.5f));
+			walls.emplace_back(transform);
+			wallInverses.emplace_back(transform.Inverse());
+			wallBounds.AddTransformedAABB(localMin, localMax, transform);
+		}
+	}
+	CullingBounds bounds;
+	bounds.Reserve(objectCount + 1);
+	for (size_t i = 0; i < objectCount; ++i) {
+		Vector3 centre(random() * mazeSize - mazeSize * 0.5f, 1.0f + random() * 2.0f, random() * mazeSize - mazeSize * 0.5f);
+		bounds.AddAABB(centre, Vector3(0.5f + random(), 0.5f + random(), 0.5f + random()));
+	}
+	const int	frames		= 30;
+	const float	aspect		= 16.0f / 9.0f;
+	const size_t maxOccluders = 64;
+	Matrix4 proj = Matrix4::Perspective(1.0f, 1000.0f, aspect, 45.0f);
+
+	//Right in front of the camera, so it can never be hidden while it's in view
+	Vector3 cameraPos(cellSize * 0.5f, 6.0f, cellSize * 0.5f);
+	bounds.AddAABB(cameraPos + Vector3(0, -1.0f, -4.0f), Vector3(0.5f, 0.5f, 0.5f));
+
+	OcclusionBuffer					buffer;
+	vector<std::pair<float, size_t>> scored;
+	vector<size_t>					chosen;
+	vector<char>					visible;
+	size_t failures			= 0;
+	size_t inFrustum		= 0;
+	size_t occluded			= 0;
+	size_t occluders		= 0;
+	size_t triangles		= 0;
+	size_t wronglyOccluded	= 0;
+	size_t trulyHidden		= 0;
+	size_t caught			= 0;
+	float rasteriseMS	= 0.0f;
+	float testMS		= 0.0f;
+
+	for (int f = 0; f < frames; ++f) {
+		float	yaw		= f * 12.0f;
+		Vector3	forward	= Matrix4::Rotation(yaw, Vector3(0, 1, 0)) * Vector3(0, 0, -1);
+		Matrix4 view	= Matrix4::BuildViewMatrix(cameraPos, cameraPos + forward, Vector3(0, 1, 0));
+		Matrix4 viewProj = proj * view;
+		Frustum frustum(viewProj);
+
+		//The biggest walls on screen, as the renderer picks them
+		auto start = std::chrono::high_resolution_clock::now();
+		scored.clear();
+		for (size_t w = 0; w < walls.size(); ++w) {
+			Vector3 centre	= wallBounds.GetCentre(w);
+			float	radius	= wallBounds.GetRadius(w);
+			if (frustum.SphereInside(centre, radius)) {
+				float distance = std::max((centre - cameraPos).LengthSquared(), 1.0f);
+				scored.emplace_back(radius * radius / distance, w);
+			}
+		}
+		size_t count = std::min(scored.size(), maxOccluders);
+		std::partial_sort(scored.begin(), scored.begin() + count, scored.end(), std::greater<std::pair<float, size_t>>());
+		chosen.clear();
+		buffer.Begin(viewProj);
+		for (size_t k = 0; k < count; ++k) {
+			chosen.emplace_back(scored[k].second);
+			buffer.AddOccluder(localMin, localMax, walls[scored[k].second]);
+		}
+		buffer.Rasterise();
+		rasteriseMS += MillisecondsSince(start);
+		occluders += buffer.GetStats().occluders;
+		triangles += buffer.GetStats().triangles;
+
+		start = std::chrono::high_resolution_clock::now();
+		size_t inside = frustum.CullAABBs(bounds, visible);
+		size_t hidden = buffer.CullAABBs(bounds, visible.data(), 0, bounds.Size());
+		testMS += MillisecondsSince(start);
+		inFrustum	+= inside;
+		occluded	+= hidden;
+
+		failures += frustum.AABBInside(bounds.GetCentre(objectCount), bounds.GetHalfSize(objectCount)) && !visible[objectCount];
+
+		//Casting rays at points over each object's box, against the walls that were drawn -
+		//nothing reported as hidden should have a point the camera can see
+		if (f % 10 == 0) {
+			vector<char> frustumVisible;
+			frustum.CullAABBs(bounds, frustumVisible);
+			for (size_t i = 0; i < bounds.Size(); ++i) {
+				if (!frustumVisible[i]) {
+					continue;
+				}
+				Vector3 centre	= bounds.GetCentre(i);
+				Vector3 half	= bounds.GetHalfSize(i) * 0.98f;
+				bool	seen	= false;
+				for (int p = 0; p < 27 && !seen; ++p) {
+					Vector3 point = centre + Vector3(half.x * (p % 3 - 1), half.y * ((p / 3) % 3 - 1), half.z * (p / 9 - 1));
+					bool blocked = false;
+					for (size_t w : chosen) {
+						if (SegmentHitsBox(cameraPos, point, localMin, localMax, wallInverses[w])) {
+							blocked = true;
+							break;
+						}
+					}
+					seen = !blocked;
+				}
+				if (!seen) {
+					trulyHidden++;
+					caught += visible[i] == 0;
+				}
+				else {
+					wronglyOccluded += visible[i] == 0;
+				}
+			}
+		}
+	}
+	failures += wronglyOccluded;
+
+	std::cout << objectCount << " objects, " << walls.size() << " walls, " << frames << " frames, "
+		<< buffer.GetWidth() << "x" << buffer.GetHeight() << " depth buffer" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << std::left << std::setw(12) << "Rasterise" << rasteriseMS / frames << "ms per frame, " << occluders / frames << " occluders, "
+		<< triangles / frames << " triangles" << std::endl;
+	std::cout << std::setw(12) << "Test" << testMS / frames << "ms per frame, " << inFrustum / frames << " in the frustum, "
+		<< occluded / frames << " occluded (" << std::setprecision(1) << 100.0f * occluded / std::max(inFrustum, (size_t)1) << "%)" << std::endl;
+	std::cout << std::setw(12) << "Raycast" << caught << " of " << trulyHidden << " hidden objects caught, "
+		<< wronglyOccluded << " wrongly occluded" << std::endl;
+	std::cout << (failures == 0 ? "Occlusion checks passed" : "Occlusion checks FAILED: ") << (failures ? std::to_string(failures) : "") << std::endl;
+}
+
+//Counts the waypoints on a path, or -1 if there wasn't one. The length runs
+//from start to end, through every waypoint
+static int PathWaypoints(NavigationMap& map, const Vector3& from, const Vector3& to, float* length = nullptr) {
+	NavigationPath path;
+	if (!map.FindPath(from, to, path)) {
+		return -1;
+	}
+	int		count	= 0;
+	Vector3 last	= from;
+	Vector3 waypoint;
+	while (path.PopWaypoint(waypoint)) {
+		if (length) {
+			*length += (waypoint - last).Length();
+		}
+		last = waypoint;
+		count++;
+	}
+	if (length) {
+		*length += (to - last).Length();
+	}
+	return count;
+}
+
+//Copies a compiled nav file, with one int in a section overwritten, or cut short if section is -1
+static bool WriteDamagedNavFile(const string& input, const string& output, int section, size_t element, int value) {
+	using namespace NavigationData;
+	std::ifstream in(Assets::DATADIR + input, std::ios::binary);
+	vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if (data.size() < sizeof(FileHeader)) {
+		return false;
+	}
+	if (section < 0) {
+		data.resize(data.size() / 2);
+	}
+	else {
+		const FileHeader*		header	= (const FileHeader*)data.data();
+		const SectionHeader*	table	= (const SectionHeader*)(data.data() + sizeof(FileHeader));
+		unsigned int i = 0;
+		while (i < header->sectionCount && table[i].id != (SectionID)section) {
+			++i;
+		}
+		if (i == header->sectionCount || (element + 1) * sizeof(int) > table[i].size) {
+			return false;
+		}
+		memcpy(data.data() + table[i].offset + element * sizeof(int), &value, sizeof(int));
+	}
+	std::ofstream out(Assets::DATADIR + output, std::ios::binary);
+	out.write(data.data(), data.size());
+	return (bool)out;
+}
+
+/*
+Loads a size x size grid from text and from its compiled form, then makes
+sure compiled files that have been cut short or have out of range indices
+are turned away, or for grid neighbours, never followed.
+*/
+static void NavLoadBench(int size) {
+	using namespace NavigationData;
+	const string textName		= "navloadbench.txt";
+	const string compiledName	= "navloadbench.navbin";
+	const string damagedName	= "navloadbench_damaged.navbin";
+	const int	 nodeSize		= 20;
+
+	unsigned int seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	{
+		std::ofstream file(Assets::DATADIR + textName);
+		file << nodeSize << "\n" << size << "\n" << size << "\n";
+		string row(size, '.');
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				row[x] = random() < 0.15f ? 'x' : '.';
+			}
+			file << row << "\n";
+		}
+	}
+	std::cout << std::fixed << std::setprecision(3);
+
+	//Short hops, as every search on a grid this big clears a node per cell
+	vector<Vector3> queries;
+	for (int i = 0; i < 4; ++i) {
+		float x = (float)(random() * (size - 64));
+		float z = (float)(random() * (size - 64));
+		queries.emplace_back(Vector3(x * nodeSize, 0, z * nodeSize));
+		queries.emplace_back(Vector3((x + 48) * nodeSize, 0, (z + 48) * nodeSize));
+	}
+	vector<int> textPaths;
+	bool saved = false;
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		NavigationGrid grid(textName);
+		float ms = MillisecondsSince(start);
+
+		for (size_t i = 0; i < queries.size(); i += 2) {
+			textPaths.emplace_back(PathWaypoints(grid, queries[i], queries[i + 1]));
+		}
+		start = std::chrono::high_resolution_clock::now();
+		saved = grid.SaveCompiled(Assets::DATADIR + compiledName);
+		std::cout << size << "x" << size << " grid: text load " << ms << "ms, compiling " << MillisecondsSince(start) << "ms" << std::endl;
+	}
+	bool passed = saved;
+	if (saved) {
+		auto start = std::chrono::high_resolution_clock::now();
+		NavigationGrid grid(compiledName);
+		float ms = MillisecondsSince(start);
+
+		size_t matching = 0;
+		for (size_t i = 0; i < queries.size(); i += 2) {
+			matching += PathWaypoints(grid, queries[i], queries[i + 1]) == textPaths[i / 2];
+		}
+		std::cout << size << "x" << size << " grid: compiled load " << ms << "ms, " << matching << " of " << textPaths.size() << " paths match" << std::endl;
+		passed &= matching == textPaths.size();
+	}
+	std::remove((Assets::DATADIR + textName).c_str());
+	std::remove((Assets::DATADIR + compiledName).c_str());
+
+	//A damaged grid keeps the empty grid it started with
+	NavigationGrid("TestGrid1.txt").SaveCompiled(Assets::DATADIR + compiledName);
+	struct Damage {
+		const char* name;
+		int			section;
+		size_t		element;
+		int			value;
+	};
+	const Damage gridDamage[] = {
+		{ "cut short",				-1,						0,	0 },
+		{ "negative width",			GridInfoSection,		1,	-10 },
+		{ "width past the data",	GridInfoSection,		1,	1 << 30 }
+	};
+	for (const Damage& d : gridDamage) {
+		bool rejected = WriteDamagedNavFile(compiledName, damagedName, d.section, d.element, d.value) &&
+						NavigationGrid(damagedName).GetNodeIndex(Vector3(30, 0, 30)) < 0;
+		std::cout << "Grid " << std::left << std::setw(24) << d.name << std::right << (rejected ? "rejected" : "LOADED") << std::endl;
+		passed &= rejected;
+	}
+	//Neighbours are used in place, so a bad one only shows up when a search
+	//reaches it - it should be taken as no link, and the search go round
+	const Damage linkDamage[] = {
+		{ "neighbour past the end",	GridNeighbourSection,	(11 * 4) + 3,	1 << 20 },
+		{ "negative neighbour",		GridNeighbourSection,	(11 * 4) + 3,	-7 }
+	};
+	for (const Damage& d : linkDamage) {
+		bool ignored = false;
+		if (WriteDamagedNavFile(compiledName, damagedName, d.section, d.element, d.value)) {
+			NavigationGrid grid(damagedName);
+			ignored = PathWaypoints(grid, Vector3(15, 0, -15), Vector3(35, 0, -15)) > 0;
+		}
+		std::cout << "Grid " << std::left << std::setw(24) << d.name << std::right << (ignored ? "ignored" : "FAILED") << std::endl;
+		passed &= ignored;
+	}
+
+	NavigationMesh("test.navmesh").SaveCompiled(Assets::DATADIR + compiledName);
+	int triCount = NavigationMesh(compiledName).GetTriCount();
+	const Damage meshDamage[] = {
+		{ "cut short",				-1,						0,	0 },
+		{ "index past the end",		MeshIndexSection,		4,	1 << 20 },
+		{ "neighbour past the end",	MeshNeighbourSection,	4,	triCount },
+		{ "lookup tri past the end",MeshLookupTriSection,	0,	triCount + 3 },
+		{ "lookup offsets unsorted",MeshLookupOffsetSection,1,	1 << 20 }
+	};
+	for (const Damage& d : meshDamage) {
+		bool rejected = WriteDamagedNavFile(compiledName, damagedName, d.section, d.element, d.value) &&
+						NavigationMesh(damagedName).GetTriCount() == 0;
+		std::cout << "Navmesh " << std::left << std::setw(24) << d.name << std::right << (rejected ? "rejected" : "LOADED") << std::endl;
+		passed &= rejected;
+	}
+	passed &= triCount > 0;
+	std::remove((Assets::DATADIR + compiledName).c_str());
+	std::remove((Assets::DATADIR + damagedName).c_str());
+
+	std::cout << (passed ? "Navigation load checks passed" : "Navigation load checks FAILED") << std::endl;
+}
+
+const int BenchNodeSize = 20;
+
+//Open floor with scattered blocks of wall - 1 for floor, 0 for wall
+static vector<char> BuildBenchLayout(int size, unsigned int& seed) {
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	vector<char> floor(size * size, 1);
+	for (int i = 0; i < size * size / 64; ++i) {
+		int w = 1 + (int)(random() * 6);
+		int h = 1 + (int)(random() * 6);
+		int x = (int)(random() * (size - w));
+		int z = (int)(random() * (size - h));
+		for (int bz = z; bz < z + h; ++bz) {
+			for (int bx = x; bx < x + w; ++bx) {
+				floor[bz * size + bx] = 0;
+			}
+		}
+	}
+	return floor;
+}
+
+//Cells run along +x and +z in the grid, which the game's grid maps to -z in the world
+static Vector3 BenchWorldPos(float x, float z) {
+	return Vector3(x * BenchNodeSize, 0, -z * BenchNodeSize);
+}
+
+//Grid steps cost their length, so searches over it give shortest routes
+static bool WriteBenchGrid(const string& name, const vector<char>& floor, int size) {
+	using namespace NavigationData;
+	size_t numNodes = (size_t)size * size;
+	GridInfo		info = { BenchNodeSize, size, size, 0 };
+	vector<char>	types(numNodes);
+	vector<Vector3>	positions(numNodes);
+	vector<int>		neighbours(numNodes * 4, -1);
+	vector<int>		costs(numNodes * 4, BenchNodeSize);
+	const int offsetX[4] = { 0, 0, -1, 1 };
+	const int offsetZ[4] = { -1, 1, 0, 0 };
+	for (int z = 0; z < size; ++z) {
+		for (int x = 0; x < size; ++x) {
+			int i = z * size + x;
+			types[i]		= floor[i] ? '.' : 'x';
+			positions[i]	= Vector3((float)(x * BenchNodeSize), 0, (float)(z * BenchNodeSize));
+			for (int j = 0; j < 4 && floor[i]; ++j) {
+				int nx = x + offsetX[j];
+				int nz = z + offsetZ[j];
+				if (nx >= 0 && nx < size && nz >= 0 && nz < size && floor[nz * size + nx]) {
+					neighbours[i * 4 + j] = nz * size + nx;
+				}
+			}
+		}
+	}
+	Writer writer(MapType::Grid);
+	writer.AddSection(GridInfoSection, &info, 1);
+	writer.AddSection(GridTypeSection, types.data(), types.size());
+	writer.AddSection(GridPositionSection, positions.data(), positions.size());
+	writer.AddSection(GridNeighbourSection, neighbours.data(), neighbours.size());
+	writer.AddSection(GridCostSection, costs.data(), costs.size());
+	return writer.Save(Assets::DATADIR + name);
+}
+
+/*
+Builds a NavigationGrid and a NavigationMesh over the same generated layout,
+and times FindPath on both over the same queries. The navmesh covers each
+rectangle of floor with tris, its edges split wherever a neighbouring
+rectangle's edge meets them, so shared edges line up.
+*/
+static void NavBench(int size) {
+	const string gridName	= "navbench.navbin";
+	const string meshName	= "navbench.navmesh";
+	const int	 queryCount	= 1000;
+
+	unsigned int seed = 12345;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	vector<char> floor = BuildBenchLayout(size, seed);
+	WriteBenchGrid(gridName, floor, size);
+
+	//Floor split into rectangles, each grown along x and then along z
+	struct Rect {
+		int x;
+		int z;
+		int w;
+		int h;
+	};
+	vector<Rect>	rects;
+	vector<int>		owner(size * size, -1);
+	for (int z = 0; z < size; ++z) {
+		for (int x = 0; x < size; ++x) {
+			if (!floor[z * size + x] || owner[z * size + x] >= 0) {
+				continue;
+			}
+			Rect r = { x, z, 1, 1 };
+			while (r.x + r.w < size && floor[z * size + r.x + r.w] && owner[z * size + r.x + r.w] < 0) {
+				r.w++;
+			}
+			bool grow = true;
+			while (grow && r.z + r.h < size) {
+				for (int bx = r.x; bx < r.x + r.w && grow; ++bx) {
+					grow = floor[(r.z + r.h) * size + bx] && owner[(r.z + r.h) * size + bx] < 0;
+				}
+				r.h += grow;
+			}
+			for (int bz = r.z; bz < r.z + r.h; ++bz) {
+				for (int bx = r.x; bx < r.x + r.w; ++bx) {
+					owner[bz * size + bx] = (int)rects.size();
+				}
+			}
+			rects.emplace_back(r);
+		}
+	}
+	//A rectangle's edge needs a vertex wherever the cell across it changes owner
+	auto ownerAt = [&](int x, int z) {
+		return (x < 0 || x >= size || z < 0 || z >= size) ? -1 : owner[z * size + x];
+	};
+	vector<Vector3> meshVerts;
+	auto addTri = [&](const Vector3& a, const Vector3& b, const Vector3& c) {
+		meshVerts.emplace_back(BenchWorldPos(a.x, a.z));
+		meshVerts.emplace_back(BenchWorldPos(b.x, b.z));
+		meshVerts.emplace_back(BenchWorldPos(c.x, c.z));
+	};
+	for (const Rect& r : rects) {
+		//Anticlockwise from the (x, z) corner, in cells
+		vector<Vector3> outline;
+		for (int x = r.x; x < r.x + r.w; ++x) {
+			if (x == r.x || ownerAt(x, r.z - 1) != ownerAt(x - 1, r.z - 1)) {
+				outline.emplace_back(Vector3((float)x, 0, (float)r.z));
+			}
+		}
+		for (int z = r.z; z < r.z + r.h; ++z) {
+			if (z == r.z || ownerAt(r.x + r.w, z) != ownerAt(r.x + r.w, z - 1)) {
+				outline.emplace_back(Vector3((float)(r.x + r.w), 0, (float)z));
+			}
+		}
+		size_t farCorner = outline.size();
+		for (int x = r.x + r.w; x > r.x; --x) {
+			if (x == r.x + r.w || ownerAt(x, r.z + r.h) != ownerAt(x - 1, r.z + r.h)) {
+				outline.emplace_back(Vector3((float)x, 0, (float)(r.z + r.h)));
+			}
+		}
+		for (int z = r.z + r.h; z > r.z; --z) {
+			if (z == r.z + r.h || ownerAt(r.x - 1, z) != ownerAt(r.x - 1, z - 1)) {
+				outline.emplace_back(Vector3((float)r.x, 0, (float)z));
+			}
+		}
+		/*
+		The two ways round from the first corner to the far one are zipped
+		together along the rectangle's length, so tris span its width and
+		crossing it doesn't mean going round a fan of thin slivers
+		*/
+		vector<Vector3> sideA(outline.begin(), outline.begin() + farCorner + 1);
+		vector<Vector3> sideB(1, outline[0]);
+		for (size_t i = outline.size() - 1; i > farCorner; --i) {
+			sideB.emplace_back(outline[i]);
+		}
+		bool alongX = r.w >= r.h;
+		auto along	= [alongX](const Vector3& v) {
+			return alongX ? v.x : v.z;
+		};
+		addTri(sideA[0], sideA[1], sideB[1]);
+		size_t a = 1;
+		size_t b = 1;
+		while (a + 1 < sideA.size() || b + 1 < sideB.size()) {
+			if (b + 1 >= sideB.size() || (a + 1 < sideA.size() && along(sideA[a + 1]) <= along(sideB[b + 1]))) {
+				addTri(sideA[a], sideA[a + 1], sideB[b]);
+				a++;
+			}
+			else {
+				addTri(sideA[a], sideB[b + 1], sideB[b]);
+				b++;
+			}
+		}
+	}
+	{
+		std::ofstream file(Assets::DATADIR + meshName);
+		file << meshVerts.size() << "\n" << meshVerts.size() << "\n";
+		for (const Vector3& v : meshVerts) {
+			file << v.x << " " << v.y << " " << v.z << "\n";
+		}
+		for (size_t i = 0; i < meshVerts.size(); ++i) {
+			file << i << "\n";
+		}
+	}
+	NavigationGrid grid(gridName);
+	NavigationMesh mesh(meshName);
+	std::remove((Assets::DATADIR + gridName).c_str());
+	std::remove((Assets::DATADIR + meshName).c_str());
+
+	vector<int> floorCells;
+	for (int i = 0; i < size * size; ++i) {
+		if (floor[i]) {
+			floorCells.emplace_back(i);
+		}
+	}
+	vector<Vector3> queries;
+	for (int i = 0; i < queryCount * 2; ++i) {
+		int cell = floorCells[(size_t)(random() * floorCells.size())];
+		queries.emplace_back(BenchWorldPos((cell % size) + 0.5f, (cell / size) + 0.5f));
+	}
+
+	float straight = 0.0f;
+	for (int i = 0; i < queryCount; ++i) {
+		straight += (queries[i * 2 + 1] - queries[i * 2]).Length();
+	}
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << size << "x" << size << " layout, " << floorCells.size() << " floor cells, " << rects.size()
+		<< " rectangles, " << mesh.GetTriCount() << " navmesh tris" << std::endl;
+	std::cout << queryCount << " queries, average straight line distance " << straight / queryCount << std::endl;
+
+	auto run = [&](NavigationMap& map, const string& name, vector<int>& waypoints) {
+		float	length	= 0.0f;
+		size_t	found	= 0;
+		size_t	points	= 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < queryCount; ++i) {
+			waypoints.emplace_back(PathWaypoints(map, queries[i * 2], queries[i * 2 + 1], &length));
+			if (waypoints.back() >= 0) {
+				found++;
+				points += waypoints.back();
+			}
+		}
+		float ms = MillisecondsSince(start);
+		std::cout << std::left << std::setw(10) << name << std::right << ms / queryCount * 1000.0f << "us per path, "
+			<< found << " found, average length " << length / std::max((size_t)1, found)
+			<< ", average waypoints " << (float)points / std::max((size_t)1, found) << std::endl;
+	};
+	vector<int> gridWaypoints;
+	vector<int> meshWaypoints;
+	run(grid, "Grid", gridWaypoints);
+	run(mesh, "Navmesh", meshWaypoints);
+
+	size_t disagree = 0;
+	for (int i = 0; i < queryCount; ++i) {
+		disagree += (gridWaypoints[i] < 0) != (meshWaypoints[i] < 0);
+	}
+	std::cout << disagree << " queries found by only one of them" << std::endl;
+}
+
+/*
+A crowd of agents all after one goal, which walks a cell a frame. Each frame
+every agent either runs its own A* to the goal, or the shared flow field is
+moved after the goal - rebuilt from scratch, or repaired - and each agent
+just looks up its next step. The repaired field is checked against a fresh
+one every frame, and against the A* path lengths.
+*/
+static void FlowBench(int agentCount) {
+	const string	gridName	= "flowbench.navbin";
+	const int		size		= 128;
+	const int		frames		= 10;
+
+	unsigned int seed = 4321;
+	auto random = [&seed]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	vector<char> floor = BuildBenchLayout(size, seed);
+	WriteBenchGrid(gridName, floor, size);
+	NavigationGrid grid(gridName);
+	std::remove((Assets::DATADIR + gridName).c_str());
+
+	vector<int> floorCells;
+	for (int i = 0; i < size * size; ++i) {
+		if (floor[i]) {
+			floorCells.emplace_back(i);
+		}
+	}
+	auto cellCentre = [size](int cell) {
+		return BenchWorldPos((cell % size) + 0.5f, (cell / size) + 0.5f);
+	};
+	vector<Vector3> agents;
+	for (int i = 0; i < agentCount; ++i) {
+		agents.emplace_back(cellCentre(floorCells[(size_t)(random() * floorCells.size())]));
+	}
+	//The goal wanders, never doubling straight back on itself
+	vector<int> goals(1, floorCells[(size_t)(random() * floorCells.size())]);
+	int lastStep = -1;
+	while ((int)goals.size() <= frames) {
+		int cell = goals.back();
+		int step = (int)(random() * 4);
+		int next = cell + (step == 0 ? -size : step == 1 ? size : step == 2 ? -1 : 1);
+		bool edge = (step == 2 && cell % size == 0) || (step == 3 && cell % size == size - 1) || next < 0 || next >= size * size;
+		if (!edge && floor[next] && (step ^ 1) != lastStep) {
+			goals.emplace_back(next);
+			lastStep = step;
+		}
+	}
+	std::cout << agentCount << " agents on a " << size << "x" << size << " grid, goal moving a cell a frame for " << frames << " frames" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+
+	vector<float>	astarLengths(agentCount);
+	Vector3			direction;
+	size_t			steering	= 0;
+	float			astarMS		= 0.0f;
+	float			rebuildMS	= 0.0f;
+	float			repairMS	= 0.0f;
+	float			lookupMS	= 0.0f;
+	size_t			mismatches	= 0;
+
+	FlowField repaired(&grid);
+	repaired.SetGoal(cellCentre(goals[0]));
+
+	for (int f = 1; f <= frames; ++f) {
+		Vector3 goal = cellCentre(goals[f]);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < agentCount; ++i) {
+			astarLengths[i] = -1.0f;
+			int waypoints = PathWaypoints(grid, agents[i], goal);
+			if (waypoints > 0) {
+				astarLengths[i] = (float)(waypoints - 1) * BenchNodeSize;
+			}
+		}
+		astarMS += MillisecondsSince(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		FlowField rebuilt(&grid);
+		rebuilt.SetGoal(goal);
+		rebuildMS += MillisecondsSince(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		repaired.SetGoal(goal);
+		repairMS += MillisecondsSince(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < agentCount; ++i) {
+			steering += repaired.GetDirection(agents[i], direction);
+		}
+		lookupMS += MillisecondsSince(start);
+
+		for (int cell : floorCells) {
+			mismatches += repaired.GetDistance(cellCentre(cell)) != rebuilt.GetDistance(cellCentre(cell));
+		}
+		for (int i = 0; i < agentCount; ++i) {
+			float distance = repaired.GetDistance(agents[i]);
+			mismatches += astarLengths[i] < 0.0f ? distance != FLT_MAX : distance != astarLengths[i];
+		}
+	}
+	std::cout << std::left << std::setw(28) << "Per agent A*" << std::right << astarMS / frames << "ms per frame" << std::endl;
+	std::cout << std::left << std::setw(28) << "Flow field, rebuilt" << std::right << (rebuildMS + lookupMS) / frames << "ms per frame ("
+		<< rebuildMS / frames << "ms building)" << std::endl;
+	std::cout << std::left << std::setw(28) << "Flow field, repaired" << std::right << (repairMS + lookupMS) / frames << "ms per frame ("
+		<< repairMS / frames << "ms repairing, " << repaired.GetRepairCount() << " repairs, " << repaired.GetRebuildCount() << " rebuilds)" << std::endl;
+	std::cout << steering / frames << " agents steering each frame, " << mismatches << " distances differ" << std::endl;
+	std::cout << (mismatches == 0 ? "Flow field checks passed" : "Flow field checks FAILED") << std::endl;
+}
+
+static void PrintUsage() {
+	std::cout << "Usage: AssetCompiler <type> <input> <output>" << std::endl;
+	std::cout << "	navgrid	- text NavigationGrid file to compiled grid (Assets/Data)" << std::endl;
+	std::cout << "	navmesh	- text .navmesh file to compiled navmesh (Assets/Data)" << std::endl;
+	std::cout << "	mesh	- text .msh file to binary mesh (Assets/Meshes), add 'quantise' to pack vertex streams, 'lods' to build LODs" << std::endl;
+	std::cout << "	texture	- image to cooked .tex (Assets/Textures), optionally 'bc1', 'bc3', 'bc5' or 'rgba', plus 'normalmap', 'linear' or 'nomips'" << std::endl;
+	std::cout << "Or: AssetCompiler meshreport - vertex cache stats for every mesh" << std::endl;
+	std::cout << "Or: AssetCompiler lodreport - simplifier timings and LOD sizes for every mesh" << std::endl;
+	std::cout << "Or: AssetCompiler vertexreport - vertex buffer sizes for every mesh, unpacked and packed" << std::endl;
+	std::cout << "Or: AssetCompiler texturereport - cooked sizes and quality for every texture" << std::endl;
+	std::cout << "Or: AssetCompiler normalbench [triangles] - times normal, tangent and transform recalculation on a generated grid" << std::endl;
+	std::cout << "Or: AssetCompiler capturebench [frames] - PNG encoding throughput for 1280x720 frames" << std::endl;
+	std::cout << "Or: AssetCompiler animbench [characters] - CPU time to animate a crowd of generated characters" << std::endl;
+	std::cout << "Or: AssetCompiler cullbench [objects] - frustum culling throughput, one at a time and batched" << std::endl;
+	std::cout << "Or: AssetCompiler drawsortbench [draws] - render state changes per frame, in scene order and sorted" << std::endl;
+	std::cout << "Or: AssetCompiler instancebench [objects] - draw calls per frame with and without instancing" << std::endl;
+	std::cout << "Or: AssetCompiler commandbench [objects] - records, merges and submits a frame's commands to a null backend" << std::endl;
+	std::cout << "Or: AssetCompiler uniformbench [draws] - uniform block packing throughput, and ring allocator checks" << std::endl;
+	std::cout << "Or: AssetCompiler cascadebench [objects] - fits shadow cascades to a camera, checks them, and counts casters per cascade" << std::endl;
+	std::cout << "Or: AssetCompiler debugbench [bodies] - debug drawing every body's AABB and a contact each frame, the old way and batched" << std::endl;
+	std::cout << "Or: AssetCompiler textbench [labels] - lays out a screen of labels every frame, from scratch and through the layout cache" << std::endl;
+	std::cout << "Or: AssetCompiler occlusionbench [objects] - software occlusion culling of objects in a maze of walls, checked by raycasts" << std::endl;
+	std::cout << "Or: AssetCompiler navbench [size] - FindPath on a grid and a navmesh over the same generated layout" << std::endl;
+	std::cout << "Or: AssetCompiler flowbench [agents] - a crowd chasing one goal, by per agent A* and by a shared flow field" << std::endl;
+	std::cout << "Or: AssetCompiler navloadbench [size] - text and compiled load times for a generated size x size grid, and damaged file checks" << std::endl;
+	std::cout << "Or: AssetCompiler loadtest - times loading the game's startup assets" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	TextureCooker::RegisterLoadFunction();
+
+	if (argc == 2 && string(argv[1]) == "loadtest") {
+		LoadTest();
+		return 0;
+	}
+	if (argc == 2 && string(argv[1]) == "meshreport") {
+		MeshReport();
+		return 0;
+	}
+	if (argc == 2 && string(argv[1]) == "lodreport") {
+		LODReport();
+		return 0;
+	}
+	if (argc == 2 && string(argv[1]) == "vertexreport") {
+		VertexReport();
+		return 0;
+	}
+	if (argc == 2 && string(argv[1]) == "texturereport") {
+		TextureReport();
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "capturebench") {
+		CaptureBench(argc > 2 ? std::stoi(argv[2]) : 60);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "drawsortbench") {
+		DrawSortBench(argc > 2 ? std::stoul(argv[2]) : 5000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "instancebench") {
+		InstanceBench(argc > 2 ? std::stoul(argv[2]) : 5000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "commandbench") {
+		CommandBench(argc > 2 ? std::stoul(argv[2]) : 10000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "uniformbench") {
+		UniformBench(argc > 2 ? std::stoul(argv[2]) : 10000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "cascadebench") {
+		CascadeBench(argc > 2 ? std::stoul(argv[2]) : 100000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "debugbench") {
+		DebugBench(argc > 2 ? std::stoul(argv[2]) : 10000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "textbench") {
+		TextBench(argc > 2 ? std::stoul(argv[2]) : 10000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "occlusionbench") {
+		OcclusionBench(argc > 2 ? std::stoul(argv[2]) : 10000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "cullbench") {
+		CullBench(argc > 2 ? std::stoul(argv[2]) : 100000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "animbench") {
+		AnimBench(argc > 2 ? std::stoi(argv[2]) : 1000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "navbench") {
+		NavBench(argc > 2 ? std::stoi(argv[2]) : 128);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "flowbench") {
+		FlowBench(argc > 2 ? std::stoi(argv[2]) : 1000);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "navloadbench") {
+		NavLoadBench(argc > 2 ? std::stoi(argv[2]) : 4096);
+		return 0;
+	}
+	if (argc >= 2 && string(argv[1]) == "normalbench") {
+		NormalBench(argc > 2 ? std::stoul(argv[2]) : 2000000);
+		return 0;
+	}
+	if (argc < 4) {
+		PrintUsage();
+		return 1;
+	}
+	string type		= argv[1];
+	string input	= argv[2];
+	string output	= argv[3];
+
+	auto start = std::chrono::high_resolution_clock::now();
+	bool result = false;
+
+	if (type == "navgrid") {
+		NavigationGrid grid(input);
+		result = grid.SaveCompiled(Assets::DATADIR + output);
+	}
+	else if (type == "navmesh") {
+		NavigationMesh mesh(input);
+		result = mesh.SaveCompiled(Assets::DATADIR + output);
+	}
+	else if (type == "mesh") {
+		bool quantise	= false;
+		bool lods		= false;
+		for (int i = 4; i < argc; ++i) {
+			quantise	|= string(argv[i]) == "quantise";
+			lods		|= string(argv[i]) == "lods";
+		}
+		result = CompileMesh(input, output, quantise, lods);
+	}
+	else if (type == "texture") {
+		TextureCookOptions options;
+		for (int i = 4; i < argc; ++i) {
+			string option = argv[i];
+			if		(option == "bc1")		{ options.format = TextureFormat::BC1;		options.chooseFormat = false; }
+			else if (option == "bc3")		{ options.format = TextureFormat::BC3;		options.chooseFormat = false; }
+			else if (option == "bc5")		{ options.format = TextureFormat::BC5;		options.chooseFormat = false; }
+			else if (option == "rgba")		{ options.format = TextureFormat::RGBA8;	options.chooseFormat = false; }
+			else if (option == "normalmap")	{ options.normalMap		= true; }
+			else if (option == "linear")	{ options.srgb			= false; }
+			else if (option == "nomips")	{ options.generateMips	= false; }
+		}
+		result = CompileTexture(input, output, options);
+	}
+	else {
+		PrintUsage();
+		return 1;
+	}
+	float ms = MillisecondsSince(start);
+
+	std::cout << (result ? "Compiled " : "Failed to compile ") << input << " -> " << output << " in " << ms << "ms" << std::endl;
+	return result ? 0 : 1;
+}
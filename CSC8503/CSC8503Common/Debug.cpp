@@ -4,9 +4,6 @@ using namespace NCL;
 
 OGLRenderer* Debug::renderer = nullptr;
 
-std::vector<Debug::DebugStringEntry>	Debug::stringEntries;
-std::vector<Debug::DebugLineEntry>		Debug::lineEntries;
-
 const Vector4 Debug::RED	= Vector4(1, 0, 0, 1);
 const Vector4 Debug::GREEN	= Vector4(0, 1, 0, 1);
 const Vector4 Debug::BLUE	= Vector4(0, 0, 1, 1);
@@ -19,25 +16,59 @@ const Vector4 Debug::MAGENTA	= Vector4(1, 0, 1, 1);
 const Vector4 Debug::CYAN		= Vector4(0, 1, 1, 1);
 
 
+//Everything goes straight into the renderer's DebugDrawBuffer, which keeps hold of anything timed
 void Debug::Print(const std::string& text, const Vector2&pos, const Vector4& colour) {
-	DebugStringEntry newEntry;
+	if (renderer) {
+		renderer->DrawString(text, pos, colour);
+	}
+}
 
-	newEntry.data		= text;
-	newEntry.position	= pos;
-	newEntry.colour		= colour;
+void Debug::PrintStatic(const std::string& text, const Vector2&pos, const Vector4& colour) {
+	if (renderer) {
+		renderer->DrawString(text, pos, colour, 20.0f, TextUsage::Static);
+	}
+}
 
-	stringEntries.emplace_back(newEntry);
+void Debug::Print3D(const std::string& text, const Vector3& position, const Vector4& colour, float size) {
+	if (renderer) {
+		renderer->GetDebugDraw().AddText(text, position, colour, size, true);
+	}
 }
 
 void Debug::DrawLine(const Vector3& startpoint, const Vector3& endpoint, const Vector4& colour, float time) {
-	DebugLineEntry newEntry;
+	if (renderer) {
+		renderer->GetDebugDraw().AddLine(startpoint, endpoint, colour, time);
+	}
+}
+
+void Debug::DrawBox(const Vector3& centre, const Vector3& halfSize, const Vector4& colour, float time) {
+	if (renderer) {
+		renderer->GetDebugDraw().AddBox(centre, halfSize, colour, time);
+	}
+}
+
+void Debug::DrawSphere(const Vector3& centre, float radius, const Vector4& colour, float time) {
+	if (renderer) {
+		renderer->GetDebugDraw().AddSphere(centre, radius, colour, time);
+	}
+}
+
+void Debug::DrawCapsule(const Vector3& start, const Vector3& end, float radius, const Vector4& colour, float time) {
+	if (renderer) {
+		renderer->GetDebugDraw().AddCapsule(start, end, radius, colour, time);
+	}
+}
 
-	newEntry.start	= startpoint;
-	newEntry.end	= endpoint;
-	newEntry.colour = colour;
-	newEntry.time	= time;
+void Debug::DrawArrow(const Vector3& start, const Vector3& end, const Vector4& colour, float time) {
+	if (renderer) {
+		renderer->GetDebugDraw().AddArrow(start, end, colour, time);
+	}
+}
 
-	lineEntries.emplace_back(newEntry);
+void Debug::DrawCross(const Vector3& position, float size, const Vector4& colour, float time) {
+	if (renderer) {
+		renderer->GetDebugDraw().AddCross(position, size, colour, time);
+	}
 }
 
 void Debug::DrawAxisLines(const Matrix4& modelMatrix, float scaleBoost, float time) {
@@ -60,26 +91,5 @@ void Debug::FlushRenderables(float dt) {
 	if (!renderer) {
 		return;
 	}
-	for (const auto& i : stringEntries) {
-		renderer->DrawString(i.data, i.position);
-	}
-	int trim = 0;
-	for (int i = 0; i < lineEntries.size(); ) {
-		DebugLineEntry* e = &lineEntries[i]; 
-		renderer->DrawLine(e->start, e->end, e->colour);
-		e->time -= dt;
-		if (e->time < 0) {			
-			trim++;				
-			lineEntries[i] = lineEntries[lineEntries.size() - trim];
-		}
-		else {
-			++i;
-		}		
-		if (i + trim >= lineEntries.size()) {
-			break;
-		}
-	}
-	lineEntries.resize(lineEntries.size() - trim);
-
-	stringEntries.clear();
-}
\ No newline at end of file
+	renderer->GetDebugDraw().Update(dt);
+}
@@ -8,10 +8,21 @@ namespace NCL {
 	{
 	public:
 		static void Print(const std::string& text, const Vector2&pos, const Vector4& colour = Vector4(1, 1, 1, 1));
+		//For labels that never change - their layout is kept, even over frames they aren't shown
+		static void PrintStatic(const std::string& text, const Vector2&pos, const Vector4& colour = Vector4(1, 1, 1, 1));
 		static void DrawLine(const Vector3& startpoint, const Vector3& endpoint, const Vector4& colour = Vector4(1, 1, 1, 1), float time = 0.0f);
 
 		static void DrawAxisLines(const Matrix4 &modelMatrix, float scaleBoost = 1.0f, float time = 0.0f);
 
+		static void DrawBox(const Vector3& centre, const Vector3& halfSize, const Vector4& colour = Vector4(1, 1, 1, 1), float time = 0.0f);
+		static void DrawSphere(const Vector3& centre, float radius, const Vector4& colour = Vector4(1, 1, 1, 1), float time = 0.0f);
+		static void DrawCapsule(const Vector3& start, const Vector3& end, float radius, const Vector4& colour = Vector4(1, 1, 1, 1), float time = 0.0f);
+		static void DrawArrow(const Vector3& start, const Vector3& end, const Vector4& colour = Vector4(1, 1, 1, 1), float time = 0.0f);
+		static void DrawCross(const Vector3& position, float size, const Vector4& colour = Vector4(1, 1, 1, 1), float time = 0.0f);
+
+		//Text that follows a point in the world around the screen
+		static void Print3D(const std::string& text, const Vector3& position, const Vector4& colour = Vector4(1, 1, 1, 1), float size = 20.0f);
+
 		static void SetRenderer(OGLRenderer* r) {
 			renderer = r;
 		}
@@ -31,25 +42,9 @@ namespace NCL {
 		static const Vector4 CYAN;
 
 	protected:
-		struct DebugStringEntry {
-			std::string	data;
-			Vector2 position;
-			Vector4 colour;
-		};
-
-		struct DebugLineEntry {
-			Vector3 start;
-			Vector3 end;
-			float	time;
-			Vector4 colour;
-		};
-
 		Debug() {}
 		~Debug() {}
 
-		static std::vector<DebugStringEntry>	stringEntries;
-		static std::vector<DebugLineEntry>	lineEntries;
-
 		static OGLRenderer* renderer;
 	};
 }
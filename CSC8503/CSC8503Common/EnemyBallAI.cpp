@@ -105,19 +105,74 @@ void NCL::CSC8503::EnemyBallAI::UpdateParentedPos()
 	this->GetTransform().SetOrientation(parent->GetTransform().GetOrientation());
 }
 
+void NCL::CSC8503::EnemyBallAI::findPathTo(const Vector3& to, vector<Vector3>& pathNodes)
+{
+	Vector3 currentPos = this->getParentedPosition();
+
+	if (!pathService)
+	{
+		NavigationPath outPath;
+		navGrid->FindPath(currentPos, to, outPath);
+
+		Vector3 pos;
+		while (outPath.PopWaypoint(pos))
+			pathNodes.push_back(pos);
+		return;
+	}
+
+	// Keep following the last path we got back until the new one arrives
+	if (!pathPending)
+	{
+		pathPending = true;
+		int requestID = ++pathRequestID;
+		pathService->RequestPath(currentPos, to, [this, requestID](const PathResult& result)
+			{
+				if (requestID != pathRequestID)
+					return; // asked for before the target changed
+
+				pathPending = false;
+				latestPath.clear();
+
+				NavigationPath path = result.path;
+				Vector3 pos;
+				while (path.PopWaypoint(pos))
+					latestPath.push_back(pos);
+			}
+		);
+	}
+	pathNodes = latestPath;
+}
+
+// Switching target drops the path to the old one, and any request still on its way
+void NCL::CSC8503::EnemyBallAI::setPathTarget(GameObject* target)
+{
+	if (target == pathTarget)
+		return;
+
+	pathTarget = target;
+	pathRequestID++;
+	pathPending = false;
+	latestPath.clear();
+
+	// Hold still until there's a waypoint towards the new target
+	currentWaypoint = this->getParentedPosition();
+	movingToWaypoint = false;
+	waypointTimer = 0;
+}
+
 void NCL::CSC8503::EnemyBallAI::followPlayer(float dt)
 {
+	setPathTarget(player);
+
 	Vector3 currentPos = this->getParentedPosition();
 	vector <Vector3> pathNodes;
 
-	// Find path to player
-	NavigationPath outPath;
+	// Find path to player - every chaser shares the same flow field if there is one
 	Vector3 to = player->GetTransform().GetPosition();
-	navGrid->FindPath(currentPos, to, outPath);
-
-	Vector3 pos;
-	while (outPath.PopWaypoint(pos))
-		pathNodes.push_back(pos);
+	if (playerFlowField)
+		playerFlowField->GetWaypoints(currentPos, 2, pathNodes);
+	else
+		findPathTo(to, pathNodes);
 
 	if (!movingToWaypoint)
 	{
@@ -169,17 +224,14 @@ void NCL::CSC8503::EnemyBallAI::followPlayer(float dt)
 
 void NCL::CSC8503::EnemyBallAI::moveToBonus(float dt)
 {
+	setPathTarget(closestBonus);
+
 	Vector3 currentPos = this->getParentedPosition();
 	vector <Vector3> pathNodes;
 
 	// Find path to bonus
-	NavigationPath outPath;
 	Vector3 to = closestBonus->getParentedPosition();
-	navGrid->FindPath(currentPos, to, outPath);
-
-	Vector3 pos;
-	while (outPath.PopWaypoint(pos))
-		pathNodes.push_back(pos);
+	findPathTo(to, pathNodes);
 
 	if (!movingToWaypoint)
 	{
@@ -3,6 +3,8 @@
 #include "../CSC8503Common/GameObject.h"
 #include "../CSC8503Common/NavigationGrid.h"
 #include "../CSC8503Common/NavigationPath.h"
+#include "../CSC8503Common/PathRequestService.h"
+#include "../CSC8503Common/FlowField.h"
 #include "StateMachine.h"
 #include "GameWorld.h"
 namespace NCL
@@ -17,6 +19,8 @@ namespace NCL
 			~EnemyBallAI();
 			void calculateDistances();
 			void setNavGrid(NavigationGrid* grid) { navGrid = grid; }
+			void setPathService(PathRequestService* service) { pathService = service; }
+			void setPlayerFlowField(FlowField* field) { playerFlowField = field; }
 			void setGameWorld(GameWorld* world) { this->world = world; }
 			void setBonuses(vector<GameObject*> objects) { bonuses = objects; }
 			void setPlayer(GameObject* p) { player = p; }
@@ -26,11 +30,20 @@ namespace NCL
 			void moveToBonus(float dt);
 			void UpdateParentedPos();
 		protected:
+			void findPathTo(const Vector3& to, vector<Vector3>& pathNodes);
+			void setPathTarget(GameObject* target);
+
 			vector<GameObject*> bonuses;
 			GameObject* player;
 			GameObject* closestBonus;
 			GameWorld* world;
 			NavigationGrid* navGrid;
+			PathRequestService* pathService = nullptr;
+			FlowField* playerFlowField = nullptr;
+			GameObject* pathTarget = nullptr;	// what latestPath leads to
+			vector<Vector3> latestPath;
+			bool pathPending = false;
+			int pathRequestID = 0;	// only the newest request's path is kept
 			bool chasePlayer = true;
 			bool grabBonus = false;
 			bool movingToWaypoint = false;
@@ -0,0 +1,190 @@
+#include "FlowField.h"
+#include <queue>
+#include <cfloat>
+
+using namespace NCL;
+using namespace CSC8503;
+
+FlowField::FlowField(NavigationGrid* grid) {
+	this->grid		= grid;
+	goalCell		= -1;
+	builtVersion	= -1;
+	rebuildCount	= 0;
+	repairCount		= 0;
+}
+
+FlowField::~FlowField() {
+}
+
+void FlowField::SetGoal(const Vector3& goal) {
+	int newGoal = grid->GetNodeIndex(goal);
+
+	if (newGoal == goalCell && builtVersion == grid->GetVersion()) {
+		return; //the field we have is still good
+	}
+	std::shared_lock<std::shared_timed_mutex> lock(grid->nodeLock);
+
+	bool repaired = builtVersion == grid->version && MoveGoal(newGoal);
+	goalCell = newGoal;
+	if (repaired) {
+		repairCount++;
+	}
+	else {
+		Rebuild();
+	}
+}
+
+//Must be called with the grid's nodeLock held
+void FlowField::Rebuild() {
+	int numCells = grid->gridWidth * grid->gridHeight;
+	integration.assign(numCells, FLT_MAX);
+	nextCell.assign(numCells, -1);
+
+	builtVersion = grid->version;
+	rebuildCount++;
+
+	if (goalCell < 0) {
+		return;
+	}
+	OpenList openList;
+
+	integration[goalCell] = 0.0f;
+	openList.push({ 0.0f, goalCell });
+
+	Propagate(openList);
+}
+
+/*
+Only works for a step into a connected neighbour - anything else returns
+false, and gets a full rebuild. Distances stay exact: a route that ran
+through the new goal is still the shortest from there, and every other
+cell can at worst carry on to the old goal and take the one extra step.
+*/
+bool FlowField::MoveGoal(int newGoal) {
+	if (goalCell < 0 || newGoal < 0 || integration[newGoal] == FLT_MAX) {
+		return false;
+	}
+	float stepCost = -1.0f;
+	for (int i = 0; i < 4; ++i) {
+		if (grid->GetNeighbour(goalCell, i) == newGoal) {
+			stepCost = (float)grid->nodeCosts[(goalCell * 4) + i];
+		}
+	}
+	if (stepCost < 0.0f) {
+		return false;
+	}
+	//Which cells' routes pass through the new goal - 0 unknown, 1 through it, 2 not
+	int numCells = (int)integration.size();
+	std::vector<char>	through(numCells, 0);
+	std::vector<int>	route;
+	through[newGoal] = 1;
+	for (int cell = 0; cell < numCells; ++cell) {
+		int c = cell;
+		while (c >= 0 && through[c] == 0) {
+			route.emplace_back(c);
+			c = nextCell[c];
+		}
+		char result = c >= 0 ? through[c] : 2;
+		for (int r : route) {
+			through[r] = result;
+		}
+		route.clear();
+	}
+
+	float shift = integration[newGoal];
+	for (int cell = 0; cell < numCells; ++cell) {
+		if (through[cell] == 1) {
+			integration[cell] -= shift;
+		}
+		else if (integration[cell] != FLT_MAX) {
+			integration[cell] += stepCost;
+		}
+	}
+	nextCell[newGoal]	= -1;
+	nextCell[goalCell]	= newGoal;
+
+	//Any shorter routes left to find come in across the edge of the cells
+	//already routed through the new goal, so that's where Dijkstra starts
+	OpenList openList;
+	for (int cell = 0; cell < numCells; ++cell) {
+		if (through[cell] != 1) {
+			continue;
+		}
+		for (int i = 0; i < 4; ++i) {
+			int neighbour = grid->GetNeighbour(cell, i);
+			if (neighbour >= 0 && through[neighbour] != 1) {
+				openList.push({ integration[cell], cell });
+				break;
+			}
+		}
+	}
+	Propagate(openList);
+	return true;
+}
+
+//Searching backwards from the goal, so for each cell we look at who can
+//step *into* it, and at what cost
+void FlowField::Propagate(OpenList& openList) {
+	while (!openList.empty()) {
+		OpenEntry current = openList.top();
+		openList.pop();
+
+		if (current.distance > integration[current.cell]) {
+			continue; //stale entry
+		}
+		for (int i = 0; i < 4; ++i) {
+			int neighbourCell = grid->GetNeighbour(current.cell, i);
+			if (neighbourCell < 0) {
+				continue;
+			}
+			for (int j = 0; j < 4; ++j) {
+				if (grid->GetNeighbour(neighbourCell, j) != current.cell) {
+					continue;
+				}
+				float distance = current.distance + grid->nodeCosts[(neighbourCell * 4) + j];
+
+				if (distance < integration[neighbourCell]) {
+					integration[neighbourCell]	= distance;
+					nextCell[neighbourCell]		= current.cell;
+					openList.push({ distance, neighbourCell });
+				}
+			}
+		}
+	}
+}
+
+Vector3 FlowField::CellCentre(int cell) const {
+	const Vector3&	position	= grid->nodePositions[cell];
+	float			halfSize	= grid->nodeSize / 2.0f;
+	return Vector3(position.x + halfSize, position.y, -position.z - halfSize);
+}
+
+bool FlowField::GetDirection(const Vector3& from, Vector3& outDirection) const {
+	int cell = grid->GetNodeIndex(from);
+	if (cell < 0 || cell >= (int)nextCell.size() || nextCell[cell] < 0) {
+		return false;
+	}
+	outDirection	= CellCentre(nextCell[cell]) - from;
+	outDirection.y	= 0.0f;
+	outDirection.Normalise();
+	return true;
+}
+
+float FlowField::GetDistance(const Vector3& from) const {
+	int cell = grid->GetNodeIndex(from);
+	if (cell < 0 || cell >= (int)integration.size()) {
+		return FLT_MAX;
+	}
+	return integration[cell];
+}
+
+void FlowField::GetWaypoints(const Vector3& from, int maxWaypoints, std::vector<Vector3>& outWaypoints) const {
+	int cell = grid->GetNodeIndex(from);
+	if (cell < 0 || cell >= (int)integration.size() || integration[cell] == FLT_MAX) {
+		return; //can't reach the goal from here
+	}
+	for (int i = 0; i < maxWaypoints && cell >= 0; ++i) {
+		outWaypoints.emplace_back(CellCentre(cell));
+		cell = nextCell[cell];
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "NavigationGrid.h"
+#include <vector>
+#include <queue>
+#include <functional>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Shared steering data for any number of agents heading to the same goal.
+		Rather than each agent running its own A*, one Dijkstra pass out from
+		the goal cell gives every cell its distance to the goal, and which of
+		its neighbours to step to next - so each agent is just a lookup.
+
+		When the goal steps into a neighbouring cell, the field is repaired
+		rather than rebuilt. Cells whose route already ran through the new
+		goal keep their step, a little closer, and everything else starts
+		from the route via the old goal, with Dijkstra only spreading out
+		over the cells the move has given a shorter way round.
+		*/
+		class FlowField {
+		public:
+			FlowField(NavigationGrid* grid);
+			~FlowField();
+
+			//Only updates if the goal has changed cell, or the grid has changed
+			void SetGoal(const Vector3& goal);
+
+			bool	GetDirection(const Vector3& from, Vector3& outDirection) const;
+			float	GetDistance(const Vector3& from) const;
+
+			//Walks the field from the given position, writing out the centre of
+			//each cell passed through - the same waypoints FindPath would give
+			void	GetWaypoints(const Vector3& from, int maxWaypoints, std::vector<Vector3>& outWaypoints) const;
+
+			int GetRebuildCount() const {
+				return rebuildCount;
+			}
+
+			int GetRepairCount() const {
+				return repairCount;
+			}
+
+		protected:
+			struct OpenEntry {
+				float	distance;
+				int		cell;
+				bool operator>(const OpenEntry& o) const {
+					return distance > o.distance;
+				}
+			};
+			typedef std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> OpenList;
+
+			void	Rebuild();
+			bool	MoveGoal(int newGoal);
+			void	Propagate(OpenList& openList);
+			Vector3	CellCentre(int cell) const;
+
+			NavigationGrid*		grid;
+
+			std::vector<float>	integration;	//distance to the goal, per cell
+			std::vector<int>	nextCell;		//cell to step to next, -1 for none
+
+			int goalCell;
+			int builtVersion;
+			int rebuildCount;
+			int repairCount;
+		};
+	}
+}
@@ -0,0 +1,109 @@
+#include "NavigationData.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+using namespace NCL;
+using namespace CSC8503;
+using namespace NavigationData;
+
+static unsigned long long AlignUp(unsigned long long value) {
+	return (value + (ALIGNMENT - 1)) & ~(unsigned long long)(ALIGNMENT - 1);
+}
+
+Writer::Writer(MapType type) {
+	this->type = type;
+}
+
+void Writer::AddSection(SectionID id, const void* data, size_t elementSize, size_t count) {
+	PendingSection s;
+	s.id			= id;
+	s.elementSize	= (unsigned int)elementSize;
+	s.data.resize(elementSize * count);
+	if (count > 0) {
+		memcpy(s.data.data(), data, s.data.size());
+	}
+	sections.emplace_back(std::move(s));
+}
+
+bool Writer::Save(const std::string& filename) const {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cout << __FUNCTION__ << " can't write file " << filename << std::endl;
+		return false;
+	}
+	FileHeader header;
+	header.magic		= FILE_MAGIC;
+	header.version		= FILE_VERSION;
+	header.mapType		= type;
+	header.sectionCount	= (unsigned int)sections.size();
+
+	std::vector<SectionHeader> table(sections.size());
+
+	unsigned long long offset = AlignUp(sizeof(FileHeader) + sizeof(SectionHeader) * table.size());
+	for (size_t i = 0; i < sections.size(); ++i) {
+		table[i].id				= sections[i].id;
+		table[i].elementSize	= sections[i].elementSize;
+		table[i].offset			= offset;
+		table[i].size			= sections[i].data.size();
+		offset = AlignUp(offset + table[i].size);
+	}
+
+	file.write((const char*)&header, sizeof(FileHeader));
+	file.write((const char*)table.data(), sizeof(SectionHeader) * table.size());
+
+	const char padding[ALIGNMENT] = { 0 };
+	for (size_t i = 0; i < sections.size(); ++i) {
+		file.write(padding, table[i].offset - file.tellp());
+		file.write(sections[i].data.data(), sections[i].data.size());
+	}
+	return (bool)file;
+}
+
+Reader::Reader(const std::string& filename) : file(filename) {
+}
+
+bool Reader::IsValid(MapType type) const {
+	if (!file.IsValid() || file.GetSize() < sizeof(FileHeader)) {
+		return false;
+	}
+	const FileHeader* header = (const FileHeader*)file.GetData();
+	if (header->magic != FILE_MAGIC || header->version != FILE_VERSION || header->mapType != type) {
+		return false;
+	}
+	return file.GetSize() >= sizeof(FileHeader) + sizeof(SectionHeader) * header->sectionCount;
+}
+
+const SectionHeader* Reader::FindSection(SectionID id, size_t elementSize) const {
+	const FileHeader*		header	= (const FileHeader*)file.GetData();
+	const SectionHeader*	table	= (const SectionHeader*)(file.GetData() + sizeof(FileHeader));
+
+	for (unsigned int i = 0; i < header->sectionCount; ++i) {
+		const SectionHeader& s = table[i];
+		if (s.id != id) {
+			continue;
+		}
+		if (s.elementSize != elementSize || s.offset > file.GetSize() || s.size > file.GetSize() - s.offset || s.size % elementSize != 0) {
+			std::cout << __FUNCTION__ << " section " << id << " is malformed!" << std::endl;
+			return nullptr;
+		}
+		return &s;
+	}
+	return nullptr;
+}
+
+bool NavigationData::IndicesInRange(const int* values, size_t count, int minValue, size_t limit) {
+	for (size_t i = 0; i < count; ++i) {
+		if (values[i] < minValue || (values[i] >= 0 && (size_t)values[i] >= limit)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Reader::IsCompiledFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	unsigned int magic = 0;
+	file.read((char*)&magic, sizeof(magic));
+	return file && magic == FILE_MAGIC;
+}
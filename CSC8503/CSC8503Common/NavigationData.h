@@ -0,0 +1,123 @@
+#pragma once
+#include "../../Common/MappedFile.h"
+#include <string>
+#include <vector>
+
+namespace NCL {
+	namespace CSC8503 {
+		/*
+		Compiled navigation data - written offline by the AssetCompiler, and
+		memory mapped at load time. The file is a header, a table of sections,
+		and then each section's raw array, 16 byte aligned so they can be used
+		straight out of the mapping.
+		*/
+		namespace NavigationData {
+			const unsigned int FILE_MAGIC	= 0x4256414E; //"NAVB"
+			const unsigned int FILE_VERSION = 1;
+			const unsigned int ALIGNMENT	= 16;
+
+			enum class MapType : unsigned int {
+				Grid,
+				Mesh
+			};
+
+			enum SectionID : unsigned int {
+				GridInfoSection,		//GridInfo
+				GridTypeSection,		//char per cell
+				GridPositionSection,	//Vector3 per cell
+				GridNeighbourSection,	//int[4] per cell, -1 for none
+				GridCostSection,		//int[4] per cell
+
+				MeshVertexSection,		//Vector3 per vertex
+				MeshIndexSection,		//int per index
+				MeshNeighbourSection,	//int[3] per tri, -1 for none
+				MeshLookupInfoSection,	//MeshLookupInfo
+				MeshLookupOffsetSection,//int per bucket, plus one
+				MeshLookupTriSection	//int per bucket entry
+			};
+
+			struct FileHeader {
+				unsigned int magic;
+				unsigned int version;
+				MapType		 mapType;
+				unsigned int sectionCount;
+			};
+
+			struct SectionHeader {
+				SectionID			id;
+				unsigned int		elementSize;
+				unsigned long long	offset;
+				unsigned long long	size;
+			};
+
+			struct GridInfo {
+				int nodeSize;
+				int width;
+				int height;
+				int padding;
+			};
+
+			struct MeshLookupInfo {
+				float	minX;
+				float	minZ;
+				float	cellSize;
+				int		width;
+				int		height;
+				int		padding[3];
+			};
+
+			//Are all count values in [minValue, limit)? Anything read from a file
+			//gets checked with this before it's used to index into an array
+			bool IndicesInRange(const int* values, size_t count, int minValue, size_t limit);
+
+			class Writer {
+			public:
+				Writer(MapType type);
+
+				template<class T>
+				void AddSection(SectionID id, const T* data, size_t count) {
+					AddSection(id, data, sizeof(T), count);
+				}
+				void AddSection(SectionID id, const void* data, size_t elementSize, size_t count);
+
+				bool Save(const std::string& filename) const;
+
+			protected:
+				struct PendingSection {
+					SectionID			id;
+					unsigned int		elementSize;
+					std::vector<char>	data;
+				};
+				MapType type;
+				std::vector<PendingSection> sections;
+			};
+
+			class Reader {
+			public:
+				Reader(const std::string& filename);
+
+				//Is the file there, and compiled for this kind of map?
+				bool IsValid(MapType type) const;
+
+				template<class T>
+				const T* GetSection(SectionID id, size_t& count) const {
+					const SectionHeader* s = FindSection(id, sizeof(T));
+					if (!s) {
+						count = 0;
+						return nullptr;
+					}
+					count = (size_t)(s->size / sizeof(T));
+					return (const T*)(file.GetData() + s->offset);
+				}
+
+				//Checks the first few bytes of a file, without mapping it
+				static bool IsCompiledFile(const std::string& filename);
+
+			protected:
+				const SectionHeader* FindSection(SectionID id, size_t elementSize) const;
+
+				MappedFile file;
+			};
+		}
+	}
+}
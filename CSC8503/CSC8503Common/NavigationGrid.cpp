@@ -1,7 +1,12 @@
 #include "NavigationGrid.h"
 #include "../../Common/Assets.h"
+#include "NavigationData.h"
 
 #include <fstream>
+#include <queue>
+#include <chrono>
+#include <climits>
+#include <algorithm>
 
 using namespace NCL;
 using namespace CSC8503;
@@ -16,56 +21,57 @@ const char FLOOR_NODE	= '.';
 
 NavigationGrid::NavigationGrid()	{
 	nodeSize	= 0;
-	gridWidth	= 12;
-	gridHeight	= 12;
-	allNodes	= nullptr;
-
-	allNodes = new GridNode[gridWidth * gridHeight];
+	ResizeNodes(12, 12);
 }
 
 NavigationGrid::NavigationGrid(const std::string&filename) : NavigationGrid() {
+	if (NavigationData::Reader::IsCompiledFile(Assets::DATADIR + filename)) {
+		LoadCompiled(Assets::DATADIR + filename);
+		return;
+	}
 	std::ifstream infile(Assets::DATADIR + filename);
 
 	infile >> nodeSize;
 	infile >> gridWidth;
 	infile >> gridHeight;
 
-	allNodes = new GridNode[gridWidth * gridHeight];
+	ResizeNodes(gridWidth, gridHeight);
 
 	for (int y = 0; y < gridHeight; ++y) {
 		for (int x = 0; x < gridWidth; ++x) {
-			GridNode& n = allNodes[(gridWidth * y) + x];
+			int i = (gridWidth * y) + x;
 			char type = 0;
 			infile >> type;
-			n.type = type;
-			n.position = Vector3((float)(x * nodeSize + 10), 0, (float)(y * nodeSize + 10));
+			types[i]		= type;
+			positions[i]	= Vector3((float)(x * nodeSize + 10), 0, (float)(y * nodeSize + 10));
 		}
 	}
 	
 	//now to build the connectivity between the nodes
 	for (int y = 0; y < gridHeight; ++y) {
 		for (int x = 0; x < gridWidth; ++x) {
-			GridNode&n = allNodes[(gridWidth * y) + x];		
+			int		i		= (gridWidth * y) + x;
+			int*	links	= &neighbours[i * 4];
 
 			if (y > 0) { //get the above node
-				n.connected[0] = &allNodes[(gridWidth * (y - 1)) + x];
+				links[0] = i - gridWidth;
 			}
 			if (y < gridHeight - 1) { //get the below node
-				n.connected[1] = &allNodes[(gridWidth * (y + 1)) + x];
+				links[1] = i + gridWidth;
 			}
 			if (x > 0) { //get left node
-				n.connected[2] = &allNodes[(gridWidth * (y)) + (x - 1)];
+				links[2] = i - 1;
 			}
 			if (x < gridWidth - 1) { //get right node
-				n.connected[3] = &allNodes[(gridWidth * (y)) + (x + 1)];
+				links[3] = i + 1;
 			}
-			for (int i = 0; i < 4; ++i) {
-				if (n.connected[i]) {
-					if (n.connected[i]->type == '.') {
-						n.costs[i]		= 1;
+			for (int j = 0; j < 4; ++j) {
+				if (links[j] >= 0) {
+					if (types[links[j]] == '.') {
+						costs[(i * 4) + j] = 1;
 					}
-					if (n.connected[i]->type == 8) {
-						n.connected[i] = nullptr; //actually a wall, disconnect!
+					if (types[links[j]] == 8) {
+						links[j] = -1; //actually a wall, disconnect!
 					}
 				}
 			}
@@ -73,109 +79,254 @@ NavigationGrid::NavigationGrid(const std::string&filename) : NavigationGrid() {
 	}
 }
 
-NavigationGrid::~NavigationGrid()	{
-	delete[] allNodes;
+/*
+The sections are only checked for size here, and then used where they sit
+in the mapping - nothing is copied, so loading doesn't touch the node data
+at all. GetNeighbour keeps any bad indices in the file from being followed.
+*/
+bool NavigationGrid::LoadCompiled(const std::string& path) {
+	using namespace NavigationData;
+	Reader* file = new Reader(path);
+
+	if (!file->IsValid(MapType::Grid)) {
+		std::cout << __FUNCTION__ << " " << path << " isn't a compiled grid!" << std::endl;
+		delete file;
+		return false;
+	}
+	size_t infoCount, typeCount, posCount, neighbourCount, costCount;
+	const GridInfo*	info			= file->GetSection<GridInfo>(GridInfoSection, infoCount);
+	const char*		fileTypes		= file->GetSection<char>(GridTypeSection, typeCount);
+	const Vector3*	filePositions	= file->GetSection<Vector3>(GridPositionSection, posCount);
+	const int*		fileNeighbours	= file->GetSection<int>(GridNeighbourSection, neighbourCount);
+	const int*		fileCosts		= file->GetSection<int>(GridCostSection, costCount);
+
+	if (!info || infoCount != 1 || info->width <= 0 || info->height <= 0 || info->width > INT_MAX / 4 / info->height) {
+		std::cout << __FUNCTION__ << " " << path << " has no grid size!" << std::endl;
+		delete file;
+		return false;
+	}
+	size_t numNodes = (size_t)info->width * info->height;
+	if (typeCount != numNodes || posCount != numNodes || neighbourCount != numNodes * 4 || costCount != numNodes * 4) {
+		std::cout << __FUNCTION__ << " " << path << " has mismatched sections!" << std::endl;
+		delete file;
+		return false;
+	}
+	delete compiled;
+	compiled	= file;
+	nodeSize	= info->nodeSize;
+	gridWidth	= info->width;
+	gridHeight	= info->height;
+
+	types.clear();
+	positions.clear();
+	neighbours.clear();
+	costs.clear();
+
+	nodeTypes		= fileTypes;
+	nodePositions	= filePositions;
+	nodeNeighbours	= fileNeighbours;
+	nodeCosts		= fileCosts;
+
+	LogChange(-1);
+	return true;
 }
 
-bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
-	//need to work out which node 'from' sits in, and 'to' sits in
-	int fromX = ((int)from.x / nodeSize);
-	int fromZ = (abs((int)from.z) / nodeSize);
+bool NavigationGrid::SaveCompiled(const std::string& path) const {
+	using namespace NavigationData;
+	std::shared_lock<std::shared_timed_mutex> lock(nodeLock);
 
-	int toX = ((int)to.x / nodeSize);
-	int toZ = (-(int)to.z / nodeSize);
+	size_t numNodes = (size_t)gridWidth * gridHeight;
 
-	if (fromX < 0 || fromX > gridWidth - 1 ||
-		fromZ < 0 || fromZ > gridHeight - 1) {
-		return false; //outside of map region!
+	GridInfo info = { nodeSize, gridWidth, gridHeight, 0 };
+
+	std::vector<int> links(numNodes * 4);
+	for (size_t i = 0; i < numNodes; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			links[(i * 4) + j] = GetNeighbour((int)i, j);
+		}
 	}
+	Writer writer(MapType::Grid);
+	writer.AddSection(GridInfoSection, &info, 1);
+	writer.AddSection(GridTypeSection, nodeTypes, numNodes);
+	writer.AddSection(GridPositionSection, nodePositions, numNodes);
+	writer.AddSection(GridNeighbourSection, links.data(), links.size());
+	writer.AddSection(GridCostSection, nodeCosts, numNodes * 4);
+
+	return writer.Save(path);
+}
 
-	if (toX < 0 || toX > gridWidth - 1 ||
-		toZ < 0 || toZ > gridHeight - 1) {
-		return false; //outside of map region!
+NavigationGrid::~NavigationGrid()	{
+	delete compiled;
+	delete pathCache;
+}
+
+//Empty, unconnected cells, held in the owned vectors
+void NavigationGrid::ResizeNodes(int width, int height) {
+	gridWidth	= std::max(0, width);
+	gridHeight	= std::max(0, height);
+	size_t numNodes = (size_t)gridWidth * gridHeight;
+
+	types.assign(numNodes, 0);
+	positions.assign(numNodes, Vector3());
+	neighbours.assign(numNodes * 4, -1);
+	costs.assign(numNodes * 4, 0);
+	UseOwnedNodes();
+
+	delete compiled;
+	compiled = nullptr;
+}
+
+//Changes can't be made to the mapped file, so the first one to a compiled
+//grid copies its nodes out
+void NavigationGrid::MakeNodesWritable() {
+	if (!compiled) {
+		return;
 	}
+	size_t numNodes = (size_t)gridWidth * gridHeight;
+
+	types.assign(nodeTypes, nodeTypes + numNodes);
+	positions.assign(nodePositions, nodePositions + numNodes);
+	costs.assign(nodeCosts, nodeCosts + numNodes * 4);
+	neighbours.resize(numNodes * 4);
+	for (size_t i = 0; i < numNodes; ++i) {
+		for (int j = 0; j < 4; ++j) {
+			neighbours[(i * 4) + j] = GetNeighbour((int)i, j);
+		}
+	}
+	UseOwnedNodes();
+	delete compiled;
+	compiled = nullptr;
+}
 
-	GridNode* startNode = &allNodes[(fromZ * gridWidth) + fromX];
-	GridNode* endNode	= &allNodes[(toZ * gridWidth) + toX];
+void NavigationGrid::UseOwnedNodes() {
+	nodeTypes		= types.data();
+	nodePositions	= positions.data();
+	nodeNeighbours	= neighbours.data();
+	nodeCosts		= costs.data();
+}
 
-	// Consider other container types
-	std::vector<GridNode*>  openList;
-	std::vector<GridNode*>  closedList;
+void NavigationGrid::EnablePathCache(size_t capacity) {
+	std::unique_lock<std::shared_timed_mutex> lock(nodeLock);
+	delete pathCache;
+	pathCache = new PathCache(capacity);
+}
 
-	openList.emplace_back(startNode);
+bool NavigationGrid::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
+	std::shared_lock<std::shared_timed_mutex> lock(nodeLock);
 
-	startNode->f = 0;
-	startNode->g = 0;
-	startNode->parent = nullptr;
+	//need to work out which node 'from' sits in, and 'to' sits in
+	int startIndex	= GetNodeIndex(from);
+	int endIndex	= GetNodeIndex(to);
+
+	if (startIndex < 0 || endIndex < 0) {
+		return false; //outside of map region!
+	}
+
+	if (pathCache) {
+		bool found = false;
+		auto changes = [&](int sinceVersion, std::vector<int>& changed) {
+			return GetChangedCells(sinceVersion, changed);
+		};
+		if (pathCache->Find(startIndex, endIndex, version, changes, found, outPath)) {
+			return found;
+		}
+	}
+	auto searchStart = std::chrono::high_resolution_clock::now();
+	auto storeResult = [&](bool found, const std::vector<Vector3>& waypoints, const std::vector<int>& cells) {
+		if (pathCache) {
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - searchStart).count();
+			pathCache->Store(startIndex, endIndex, version, found, waypoints, cells, ms);
+		}
+	};
+
+	//The search state lives here rather than in the grid, so that
+	//several threads can search the same grid at once
+	struct SearchNode {
+		float	f		= 0.0f;
+		float	g		= 0.0f;
+		int		parent	= -1;
+		bool	open	= false;
+		bool	closed	= false;
+	};
+	struct OpenEntry {
+		float	f;
+		int		node;
+		bool operator>(const OpenEntry& o) const {
+			return f > o.f;
+		}
+	};
+	std::vector<SearchNode> search(gridWidth * gridHeight);
+	std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> openList;
 
-	GridNode* currentBestNode = nullptr;
+	search[startIndex].open = true;
+	openList.push({ 0.0f, startIndex });
 
 	while (!openList.empty()) {
-		currentBestNode = RemoveBestNode(openList);
+		int currentIndex = openList.top().node;
+		openList.pop();
 
-		if (currentBestNode == endNode) {			//we've found the path!
-			GridNode* node = endNode;
-			while (node != nullptr) {
-				outPath.PushWaypoint(Vector3(node->position.x + nodeSize / 2 , node->position.y , -node->position.z - nodeSize / 2));
-				node = node->parent;
+		if (search[currentIndex].closed) {
+			continue; //stale entry, a better route was found after it was pushed
+		}
+		if (currentIndex == endIndex) {			//we've found the path!
+			std::vector<Vector3>	waypoints;
+			std::vector<int>		cells;
+			for (int i = endIndex; i != -1; i = search[i].parent) {
+				const Vector3& position = nodePositions[i];
+				waypoints.emplace_back(Vector3(position.x + nodeSize / 2 , position.y , -position.z - nodeSize / 2));
+				cells.emplace_back(i);
+			}
+			for (const Vector3& wp : waypoints) {
+				outPath.PushWaypoint(wp);
 			}
+			storeResult(true, waypoints, cells);
 			return true;
 		}
-		else {
-			for (int i = 0; i < 4; ++i) {
-				GridNode* neighbour = currentBestNode->connected[i];
-				if (!neighbour) { //might not be connected...
-					continue;
-				}	
-				bool inClosed	= NodeInList(neighbour, closedList);
-				if (inClosed) {
-					continue; //already discarded this neighbour...
-				}
+		search[currentIndex].closed = true;
 
-				float h = Heuristic(neighbour, endNode);				
-				float g = currentBestNode->g + currentBestNode->costs[i];
-				float f = h + g;
+		for (int i = 0; i < 4; ++i) {
+			int neighbourIndex = GetNeighbour(currentIndex, i);
+			if (neighbourIndex < 0) { //might not be connected...
+				continue;
+			}
+			SearchNode& n = search[neighbourIndex];
+			if (n.closed) {
+				continue; //already discarded this neighbour...
+			}
 
-				bool inOpen		= NodeInList(neighbour, openList);
+			float h = Heuristic(neighbourIndex, endIndex);
+			float g = search[currentIndex].g + nodeCosts[(currentIndex * 4) + i];
+			float f = h + g;
 
-				if (!inOpen) { //first time we've seen this neighbour
-					openList.emplace_back(neighbour);
-				}
-				if (!inOpen || f < neighbour->f) {//might be a better route to this neighbour
-					neighbour->parent = currentBestNode;
-					neighbour->f = f;
-					neighbour->g = g;
-				}
+			if (!n.open || f < n.f) {//might be a better route to this neighbour
+				n.open		= true;
+				n.parent	= currentIndex;
+				n.f			= f;
+				n.g			= g;
+				openList.push({ f, neighbourIndex });
 			}
-			closedList.emplace_back(currentBestNode);
 		}
 	}
+	storeResult(false, {}, {});
 	return false; //open list emptied out with no path!
 }
 
-bool NavigationGrid::NodeInList(GridNode* n, std::vector<GridNode*>& list) const {
-	std::vector<GridNode*>::iterator i = std::find(list.begin(), list.end(), n);
-	return i == list.end() ? false : true;
-}
-
-GridNode*  NavigationGrid::RemoveBestNode(std::vector<GridNode*>& list) const {
-	std::vector<GridNode*>::iterator bestI = list.begin();
-
-	GridNode* bestNode = *list.begin();
-
-	for (auto i = list.begin(); i != list.end(); ++i) {
-		if ((*i)->f < bestNode->f) {
-			bestNode	= (*i);
-			bestI		= i;
-		}
+int NavigationGrid::GetNodeIndex(const Vector3& pos) const {
+	if (nodeSize <= 0) {
+		return -1; //no connectivity built yet
 	}
-	list.erase(bestI);
+	int x = ((int)pos.x / nodeSize);
+	int z = (abs((int)pos.z) / nodeSize);
 
-	return bestNode;
+	if (x < 0 || x > gridWidth - 1 ||
+		z < 0 || z > gridHeight - 1) {
+		return -1;
+	}
+	return (z * gridWidth) + x;
 }
 
-float NavigationGrid::Heuristic(GridNode* hNode, GridNode* endNode) const {
-	return (hNode->position - endNode->position).Length();
+float NavigationGrid::Heuristic(int cell, int endCell) const {
+	return (nodePositions[cell] - nodePositions[endCell]).Length();
 }
 
 void NavigationGrid::PrintGrid()
@@ -202,8 +353,7 @@ void NavigationGrid::PrintNodeGrid()
 
 	for (int y = 0; y < gridHeight; ++y) {
 		for (int x = 0; x < gridWidth; ++x) {
-			GridNode& n = allNodes[(gridWidth * y) + x];
-			out = out + std::to_string(n.type) + " ";
+			out = out + std::to_string((int)nodeTypes[(gridWidth * y) + x]) + " ";
 		}
 		out += '\n';
 	}
@@ -259,16 +409,18 @@ int NavigationGrid::coordToIndex(Vector3 pos)
 
 void NavigationGrid::createConnectivity()
 {
+	std::unique_lock<std::shared_timed_mutex> lock(nodeLock);
+	LogChange(-1);
+
 	nodeSize = 20;
-	gridWidth = 12;
-	gridHeight = 12;
+	ResizeNodes(12, 12);
 	grid[0][0] = 1;
 
 	for (int y = 0; y < gridHeight; ++y) {
 		for (int x = 0; x < gridWidth; ++x) {
-			GridNode& n = allNodes[(gridWidth * y) + x];
-			n.type = grid[y][x];
-			n.position = Vector3((float)(x * nodeSize), 0, (float)(y * nodeSize));
+			int i = (gridWidth * y) + x;
+			types[i]		= grid[y][x];
+			positions[i]	= Vector3((float)(x * nodeSize), 0, (float)(y * nodeSize));
 		}
 	}
 
@@ -278,27 +430,28 @@ void NavigationGrid::createConnectivity()
 	//now to build the connectivity between the nodes
 	for (int y = 0; y < gridHeight; ++y) {
 		for (int x = 0; x < gridWidth; ++x) {
-			GridNode& n = allNodes[(gridWidth * y) + x];
+			int		i		= (gridWidth * y) + x;
+			int*	links	= &neighbours[i * 4];
 
 			if (y > 0) { //get the above node
-				n.connected[0] = &allNodes[(gridWidth * (y - 1)) + x];
+				links[0] = i - gridWidth;
 			}
 			if (y < gridHeight - 1) { //get the below node
-				n.connected[1] = &allNodes[(gridWidth * (y + 1)) + x];
+				links[1] = i + gridWidth;
 			}
 			if (x > 0) { //get left node
-				n.connected[2] = &allNodes[(gridWidth * (y)) + (x - 1)];
+				links[2] = i - 1;
 			}
 			if (x < gridWidth - 1) { //get right node
-				n.connected[3] = &allNodes[(gridWidth * (y)) + (x + 1)];
+				links[3] = i + 1;
 			}
-			for (int i = 0; i < 4; ++i) {
-				if (n.connected[i]) {
-					if (n.connected[i]->type != 8) {
-						n.costs[i] = 1;
+			for (int j = 0; j < 4; ++j) {
+				if (links[j] >= 0) {
+					if (types[links[j]] != 8) {
+						costs[(i * 4) + j] = 1;
 					}
-					if (n.connected[i]->type == 8) {
-						n.connected[i] = nullptr; //actually a wall, disconnect!
+					if (types[links[j]] == 8) {
+						links[j] = -1; //actually a wall, disconnect!
 					}
 				}
 			}
@@ -308,8 +461,12 @@ void NavigationGrid::createConnectivity()
 
 void NCL::CSC8503::NavigationGrid::emplaceObstacle(GameObject* obj)
 {
+	std::unique_lock<std::shared_timed_mutex> lock(nodeLock);
+	MakeNodesWritable();
+
 	int index = coordToIndex(obj->getParentedPosition());
-	allNodes[index].type = 8;
+	types[index] = 8;
+	LogChange(index);
 	
 	int x = index / 12;
 	int y = index - x * 12;
@@ -319,8 +476,12 @@ void NCL::CSC8503::NavigationGrid::emplaceObstacle(GameObject* obj)
 
 void NCL::CSC8503::NavigationGrid::emplaceBonus(GameObject* obj)
 {
+	std::unique_lock<std::shared_timed_mutex> lock(nodeLock);
+	MakeNodesWritable();
+
 	int index = coordToIndex(obj->getParentedPosition());
-	allNodes[index].type = 3;
+	types[index] = 3;
+	LogChange(index);
 
 	int x = index / 12;
 	int y = index - x * 12;
@@ -332,13 +493,47 @@ void NCL::CSC8503::NavigationGrid::emplaceBonus(GameObject* obj)
 
 void NCL::CSC8503::NavigationGrid::removeBonus(GameObject* obj)
 {
-	int index = coordToIndex(obj->getParentedPosition());
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(nodeLock);
+		MakeNodesWritable();
 
-	allNodes[index].type = 0;
-	int x = index / 12;
-	int y = index - x * 12;
+		int index = coordToIndex(obj->getParentedPosition());
 
-	grid[x][y] = 0;
+		types[index] = 0;
+		LogChange(-1); //opening a cell up could give any path a shortcut
+		int x = index / 12;
+		int y = index - x * 12;
 
+		grid[x][y] = 0;
+	}
 	createConnectivity();
-}
\ No newline at end of file
+}
+
+void NavigationGrid::LogChange(int cell)
+{
+	version++;
+	changeLog.push_back({ version, cell });
+	if (changeLog.size() > MAX_LOGGED_CHANGES) {
+		changeLog.pop_front();
+	}
+}
+
+bool NavigationGrid::GetChangedCells(int sinceVersion, std::vector<int>& outCells) const
+{
+	if (sinceVersion >= version) {
+		return true;
+	}
+	if (changeLog.empty() || changeLog.front().version > sinceVersion + 1) {
+		return false; // log doesn't go back that far
+	}
+	for (const GridChange& c : changeLog) {
+		if (c.version <= sinceVersion) {
+			continue;
+		}
+		if (c.cell < 0) {
+			return false;
+		}
+		outCells.emplace_back(c.cell);
+	}
+	return true;
+}
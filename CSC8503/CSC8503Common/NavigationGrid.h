@@ -1,43 +1,32 @@
 #pragma once
 #include "NavigationMap.h"
 #include "GameObject.h"
+#include "PathCache.h"
 #include <string>
+#include <shared_mutex>
+#include <mutex>
+#include <deque>
+#include <vector>
 namespace NCL {
 	namespace CSC8503 {
-		struct GridNode {
-			GridNode* parent;
-
-			GridNode* connected[4];
-			int		  costs[4];
-
-			Vector3		position;
-
-			float f;
-			float g;
-
-			int type;
-
-			GridNode() {
-				for (int i = 0; i < 4; ++i) {
-					connected[i] = nullptr;
-					costs[i] = 0;
-				}
-				f = 0;
-				g = 0;
-				type = 0;
-				parent = nullptr;
-			}
-			~GridNode() {	}
-		};
+		namespace NavigationData {
+			class Reader;
+		}
 
 		class NavigationGrid : public NavigationMap {
+			friend class FlowField;
 		public:
 			NavigationGrid();
 			NavigationGrid(const std::string& filename);
 			~NavigationGrid();
 
 			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) override;
+			int  GetNodeIndex(const Vector3& pos) const override;
 			
+			//Writes the grid out in the binary format the AssetCompiler produces.
+			//Compiled files can then be passed to the filename constructor.
+			bool SaveCompiled(const std::string& path) const;
+
 			void UpdateGrid();
 			void PrintGrid();
 			void PrintNodeGrid();
@@ -50,16 +39,67 @@ namespace NCL {
 			void emplaceBonus(GameObject* obj);
 			void removeBonus(GameObject* obj);
 			int grid[12][12] = { 0 };
+
+			//Bumped whenever node types or connectivity change, so anything
+			//derived from the grid knows when it has gone stale
+			int GetVersion() const { return version; }
+
+			//Remembers found paths between cells until the grid changes under them
+			void		EnablePathCache(size_t capacity = 256);
+			PathCache*	GetPathCache() const { return pathCache; }
+
+			//Fills outCells with every cell changed since the given version.
+			//Returns false if the whole grid might have changed since then.
+			//Must be called with nodeLock held, as FindPath does.
+			bool GetChangedCells(int sinceVersion, std::vector<int>& outCells) const;
 			
 			vector<GameObject*> gameObjects;
 		protected:
-			bool		NodeInList(GridNode* n, std::vector<GridNode*>& list) const;
-			GridNode*	RemoveBestNode(std::vector<GridNode*>& list) const;
-			float		Heuristic(GridNode* hNode, GridNode* endNode) const;
+			float		Heuristic(int cell, int endCell) const;
 			int nodeSize;
 			int gridWidth = 12;
 			int gridHeight = 12;
-			GridNode* allNodes;
+			void		LogChange(int cell);
+			bool		LoadCompiled(const std::string& path);
+			void		ResizeNodes(int width, int height);
+			void		MakeNodesWritable();
+			void		UseOwnedNodes();
+
+			//Compiled data isn't walked at load time, so every neighbour read
+			//goes through here, and anything out of range counts as a wall
+			int GetNeighbour(int cell, int direction) const {
+				int n = nodeNeighbours[(cell * 4) + direction];
+				return (unsigned int)n < (unsigned int)(gridWidth * gridHeight) ? n : -1;
+			}
+
+			//Per cell node data, with four neighbours and costs per cell in the
+			//order up, down, left, right. A compiled grid points these straight
+			//into its mapped file, and anything else at the vectors below - as
+			//does a compiled grid, once one of its cells has been changed
+			const char*		nodeTypes		= nullptr;
+			const Vector3*	nodePositions	= nullptr;
+			const int*		nodeNeighbours	= nullptr;	//-1 for none
+			const int*		nodeCosts		= nullptr;
+
+			std::vector<char>		types;
+			std::vector<Vector3>	positions;
+			std::vector<int>		neighbours;
+			std::vector<int>		costs;
+			NavigationData::Reader*	compiled = nullptr;
+
+			int version = 0;
+			PathCache* pathCache = nullptr;
+
+			struct GridChange {
+				int version;
+				int cell;	//-1 if the change affects the whole grid
+			};
+			std::deque<GridChange> changeLog;
+			static const size_t MAX_LOGGED_CHANGES = 64;
+
+			//FindPath can be called from path worker threads, so anything
+			//that changes node types or connectivity takes this exclusively
+			mutable std::shared_timed_mutex nodeLock;
 		};
 	}
 }
@@ -11,6 +11,10 @@ namespace NCL {
 			~NavigationMap() {}
 
 			virtual bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) = 0;
+
+			//Which node (grid cell, navmesh tri) a position falls in, or -1 if
+			//it's off the map. Queries with matching nodes give the same route.
+			virtual int GetNodeIndex(const Vector3& pos) const = 0;
 		};
 	}
 }
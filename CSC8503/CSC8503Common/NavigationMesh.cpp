@@ -1,16 +1,39 @@
 #include "NavigationMesh.h"
 #include "../../Common/Assets.h"
+#include "NavigationData.h"
 #include <fstream>
+#include <map>
+#include <tuple>
+#include <queue>
+#include <unordered_map>
+#include <cfloat>
 using namespace NCL;
 using namespace CSC8503;
 using namespace std;
 
+//Twice the signed area of abc on the XZ plane - positive if c is to the left of a->b
+static float TriArea2(const Vector3& a, const Vector3& b, const Vector3& c) {
+	return ((b.x - a.x) * (c.z - a.z)) - ((b.z - a.z) * (c.x - a.x));
+}
+
+static bool SamePointXZ(const Vector3& a, const Vector3& b) {
+	const float epsilon = 0.0001f;
+	return abs(a.x - b.x) < epsilon && abs(a.z - b.z) < epsilon;
+}
+
 NavigationMesh::NavigationMesh()
 {
+	lookupCellSize	= 1.0f;
+	lookupWidth		= 0;
+	lookupHeight	= 0;
 }
 
-NavigationMesh::NavigationMesh(const std::string&filename)
+NavigationMesh::NavigationMesh(const std::string&filename) : NavigationMesh()
 {
+	if (NavigationData::Reader::IsCompiledFile(Assets::DATADIR + filename)) {
+		LoadCompiled(Assets::DATADIR + filename);
+		return;
+	}
 	ifstream file(Assets::DATADIR + filename);
 
 	int numVertices = 0;
@@ -19,6 +42,9 @@ NavigationMesh::NavigationMesh(const std::string&filename)
 	file >> numVertices;
 	file >> numIndices;
 
+	allVerts.reserve(numVertices);
+	allIndices.reserve(numIndices);
+
 	for (int i = 0; i < numVertices; ++i) {
 		Vector3 vert;
 		file >> vert.x;
@@ -33,12 +59,449 @@ NavigationMesh::NavigationMesh(const std::string&filename)
 		file >> x;
 		allIndices.emplace_back(x);
 	}
+	//The file also lists a neighbour triple per tri, but in no particular
+	//edge order, so the adjacency is rebuilt from the geometry instead
+	BuildTris();
+	BuildAdjacency();
+	BuildTriLookup();
 }
 
 NavigationMesh::~NavigationMesh()
 {
 }
 
+bool NavigationMesh::LoadCompiled(const std::string& path) {
+	using namespace NavigationData;
+	Reader file(path);
+
+	if (!file.IsValid(MapType::Mesh)) {
+		cout << __FUNCTION__ << " " << path << " isn't a compiled navmesh!" << endl;
+		return false;
+	}
+	size_t vertCount, indexCount, neighbourCount, infoCount, offsetCount, lookupCount;
+	const Vector3*			verts		= file.GetSection<Vector3>(MeshVertexSection, vertCount);
+	const int*				indices		= file.GetSection<int>(MeshIndexSection, indexCount);
+	const int*				neighbours	= file.GetSection<int>(MeshNeighbourSection, neighbourCount);
+	const MeshLookupInfo*	info		= file.GetSection<MeshLookupInfo>(MeshLookupInfoSection, infoCount);
+	const int*				offsets		= file.GetSection<int>(MeshLookupOffsetSection, offsetCount);
+	const int*				lookup		= file.GetSection<int>(MeshLookupTriSection, lookupCount);
+
+	if (infoCount != 1 || info->width < 0 || info->height < 0 || !(info->cellSize > 0.0f)) {
+		cout << __FUNCTION__ << " " << path << " has no lookup grid!" << endl;
+		return false;
+	}
+	size_t triCount = indexCount / 3;
+	if (indexCount % 3 != 0 || neighbourCount != indexCount || offsetCount != (size_t)info->width * info->height + 1) {
+		cout << __FUNCTION__ << " " << path << " has mismatched sections!" << endl;
+		return false;
+	}
+	//Every index gets used straight from the file, so any that are out of
+	//range mean the file's been cut short or damaged
+	bool valid = IndicesInRange(indices, indexCount, 0, vertCount) &&
+				 IndicesInRange(neighbours, neighbourCount, -1, triCount) &&
+				 IndicesInRange(lookup, lookupCount, 0, triCount) &&
+				 offsets[0] == 0 && offsets[offsetCount - 1] == (int)lookupCount;
+	for (size_t i = 1; valid && i < offsetCount; ++i) {
+		valid = offsets[i] >= offsets[i - 1];
+	}
+	if (!valid) {
+		cout << __FUNCTION__ << " " << path << " has out of range indices!" << endl;
+		return false;
+	}
+	//Adjacency and the tri lookup were both built offline, so they're just
+	//bulk copied across rather than being rebuilt
+	allVerts.assign(verts, verts + vertCount);
+	allIndices.assign(indices, indices + indexCount);
+	lookupOffsets.assign(offsets, offsets + offsetCount);
+	lookupTris.assign(lookup, lookup + lookupCount);
+
+	lookupMin		= Vector3(info->minX, 0, info->minZ);
+	lookupCellSize	= info->cellSize;
+	lookupWidth		= info->width;
+	lookupHeight	= info->height;
+
+	BuildTris();
+	for (size_t i = 0; i < allTris.size(); ++i) {
+		for (int j = 0; j < 3; ++j) {
+			int n = neighbours[(i * 3) + j];
+			allTris[i].neighbours[j] = n < 0 ? nullptr : &allTris[n];
+		}
+	}
+	return true;
+}
+
+bool NavigationMesh::SaveCompiled(const std::string& path) const {
+	using namespace NavigationData;
+
+	vector<int> neighbours(allTris.size() * 3);
+	for (size_t i = 0; i < allTris.size(); ++i) {
+		for (int j = 0; j < 3; ++j) {
+			const NavTri* n = allTris[i].neighbours[j];
+			neighbours[(i * 3) + j] = n ? TriIndex(n) : -1;
+		}
+	}
+	MeshLookupInfo info = { lookupMin.x, lookupMin.z, lookupCellSize, lookupWidth, lookupHeight, { 0 } };
+
+	Writer writer(MapType::Mesh);
+	writer.AddSection(MeshVertexSection, allVerts.data(), allVerts.size());
+	writer.AddSection(MeshIndexSection, allIndices.data(), allIndices.size());
+	writer.AddSection(MeshNeighbourSection, neighbours.data(), neighbours.size());
+	writer.AddSection(MeshLookupInfoSection, &info, 1);
+	writer.AddSection(MeshLookupOffsetSection, lookupOffsets.data(), lookupOffsets.size());
+	writer.AddSection(MeshLookupTriSection, lookupTris.data(), lookupTris.size());
+
+	return writer.Save(path);
+}
+
+void NavigationMesh::BuildTris() {
+	int numTris = (int)allIndices.size() / 3;
+	allTris.resize(numTris);
+
+	for (int i = 0; i < numTris; ++i) {
+		NavTri& t = allTris[i];
+		for (int j = 0; j < 3; ++j) {
+			t.indices[j] = allIndices[(i * 3) + j];
+		}
+		t.centroid = (allVerts[t.indices[0]] + allVerts[t.indices[1]] + allVerts[t.indices[2]]) / 3.0f;
+	}
+}
+
+/*
+The exporter duplicates vertices between tris, so shared edges can't be found
+by index alone. Vertices are welded by position first, and then each welded
+edge is matched up with the other tri that uses it.
+*/
+void NavigationMesh::BuildAdjacency() {
+	map<tuple<float, float, float>, int> weldMap;
+	vector<int> welded(allVerts.size());
+
+	for (size_t i = 0; i < allVerts.size(); ++i) {
+		const Vector3& v = allVerts[i];
+		auto result = weldMap.emplace(make_tuple(v.x, v.y, v.z), (int)weldMap.size());
+		welded[i] = result.first->second;
+	}
+
+	unordered_map<long long, int> openEdges; //welded edge -> (tri * 3) + edge
+	openEdges.reserve(allTris.size() * 3);
+
+	for (size_t i = 0; i < allTris.size(); ++i) {
+		NavTri& t = allTris[i];
+		for (int j = 0; j < 3; ++j) {
+			int a = welded[t.indices[j]];
+			int b = welded[t.indices[(j + 1) % 3]];
+			long long key = ((long long)std::min(a, b) << 32) | (long long)std::max(a, b);
+
+			auto found = openEdges.find(key);
+			if (found == openEdges.end()) {
+				openEdges.emplace(key, (int)(i * 3) + j);
+				continue;
+			}
+			NavTri& other = allTris[found->second / 3];
+			other.neighbours[found->second % 3] = &t;
+			t.neighbours[j] = &other;
+			openEdges.erase(found);
+		}
+	}
+}
+
+void NavigationMesh::BuildTriLookup() {
+	if (allTris.empty()) {
+		return;
+	}
+	Vector3 mins = allVerts[allTris[0].indices[0]];
+	Vector3 maxs = mins;
+
+	for (const NavTri& t : allTris) {
+		for (int i = 0; i < 3; ++i) {
+			const Vector3& v = allVerts[t.indices[i]];
+			mins.x = std::min(mins.x, v.x);
+			mins.z = std::min(mins.z, v.z);
+			maxs.x = std::max(maxs.x, v.x);
+			maxs.z = std::max(maxs.z, v.z);
+		}
+	}
+	//Aim for roughly one tri per bucket
+	float extent	= std::max(maxs.x - mins.x, maxs.z - mins.z);
+	int   cellsPerAxis = std::max(1, (int)sqrt((float)allTris.size()));
+
+	lookupMin		= mins;
+	lookupCellSize	= std::max(extent / cellsPerAxis, 0.001f);
+	lookupWidth		= (int)((maxs.x - mins.x) / lookupCellSize) + 1;
+	lookupHeight	= (int)((maxs.z - mins.z) / lookupCellSize) + 1;
+
+	auto forEachCell = [&](const NavTri& t, auto func) {
+		Vector3 a = allVerts[t.indices[0]];
+		Vector3 b = allVerts[t.indices[1]];
+		Vector3 c = allVerts[t.indices[2]];
+		int minX = (int)((std::min({ a.x, b.x, c.x }) - lookupMin.x) / lookupCellSize);
+		int maxX = (int)((std::max({ a.x, b.x, c.x }) - lookupMin.x) / lookupCellSize);
+		int minZ = (int)((std::min({ a.z, b.z, c.z }) - lookupMin.z) / lookupCellSize);
+		int maxZ = (int)((std::max({ a.z, b.z, c.z }) - lookupMin.z) / lookupCellSize);
+		for (int z = minZ; z <= maxZ; ++z) {
+			for (int x = minX; x <= maxX; ++x) {
+				func((z * lookupWidth) + x);
+			}
+		}
+	};
+	//Two passes - count, then fill - so the buckets live in one flat array
+	lookupOffsets.assign((lookupWidth * lookupHeight) + 1, 0);
+	for (const NavTri& t : allTris) {
+		forEachCell(t, [&](int cell) { lookupOffsets[cell + 1]++; });
+	}
+	for (size_t i = 1; i < lookupOffsets.size(); ++i) {
+		lookupOffsets[i] += lookupOffsets[i - 1];
+	}
+	lookupTris.resize(lookupOffsets.back());
+	vector<int> fill(lookupOffsets.begin(), lookupOffsets.end() - 1);
+	for (const NavTri& t : allTris) {
+		int triIndex = TriIndex(&t);
+		forEachCell(t, [&](int cell) { lookupTris[fill[cell]++] = triIndex; });
+	}
+}
+
+bool NavigationMesh::PointInTri(const NavTri& t, const Vector3& pos, float& height) const {
+	const Vector3& a = allVerts[t.indices[0]];
+	const Vector3& b = allVerts[t.indices[1]];
+	const Vector3& c = allVerts[t.indices[2]];
+
+	float area = TriArea2(a, b, c);
+	if (area == 0.0f) {
+		return false;
+	}
+	float u = TriArea2(b, c, pos) / area;
+	float v = TriArea2(c, a, pos) / area;
+	float w = 1.0f - u - v;
+
+	const float epsilon = -0.0001f;
+	if (u < epsilon || v < epsilon || w < epsilon) {
+		return false;
+	}
+	height = (a.y * u) + (b.y * v) + (c.y * w);
+	return true;
+}
+
+const NavigationMesh::NavTri* NavigationMesh::GetTriForPosition(const Vector3& pos) const {
+	if (lookupOffsets.empty()) {
+		return nullptr;
+	}
+	int x = (int)floor((pos.x - lookupMin.x) / lookupCellSize);
+	int z = (int)floor((pos.z - lookupMin.z) / lookupCellSize);
+
+	if (x < 0 || x >= lookupWidth || z < 0 || z >= lookupHeight) {
+		return nullptr; //outside of map region!
+	}
+	int cell = (z * lookupWidth) + x;
+
+	const NavTri*	bestTri		= nullptr;
+	float			bestHeight	= FLT_MAX;
+	//Tris can stack on top of each other (ramps, bridges), so take the one
+	//whose surface is vertically closest to the query point
+	for (int i = lookupOffsets[cell]; i < lookupOffsets[cell + 1]; ++i) {
+		const NavTri& t = allTris[lookupTris[i]];
+		float height = 0.0f;
+		if (PointInTri(t, pos, height) && abs(height - pos.y) < bestHeight) {
+			bestHeight	= abs(height - pos.y);
+			bestTri		= &t;
+		}
+	}
+	return bestTri;
+}
+
+int NavigationMesh::GetNodeIndex(const Vector3& pos) const {
+	const NavTri* t = GetTriForPosition(pos);
+	return t ? TriIndex(t) : -1;
+}
+
 bool NavigationMesh::FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) {
-	return false;
+	const NavTri* startTri	= GetTriForPosition(from);
+	const NavTri* endTri	= GetTriForPosition(to);
+
+	if (!startTri || !endTri) {
+		return false; //outside of the walkable area!
+	}
+
+	vector<const NavTri*> triPath;
+	if (!FindTriPath(startTri, endTri, from, to, triPath)) {
+		return false;
+	}
+
+	vector<Portal> portals;
+	BuildPortals(triPath, from, to, portals);
+
+	vector<Vector3> points;
+	StringPull(portals, points);
+
+	//Waypoints are popped off the back, so push them end first
+	for (auto i = points.rbegin(); i != points.rend(); ++i) {
+		outPath.PushWaypoint(*i);
+	}
+	return true;
+}
+
+/*
+Costs are measured between the points each tri is entered through - the
+start position, then the middle of each shared edge crossed - rather than
+between centroids, which badly overestimate crossing long thin tris.
+*/
+bool NavigationMesh::FindTriPath(const NavTri* startTri, const NavTri* endTri, const Vector3& from, const Vector3& to, std::vector<const NavTri*>& outTris) const {
+	struct OpenEntry {
+		float	f;
+		int		tri;
+		bool operator>(const OpenEntry& o) const {
+			return f > o.f;
+		}
+	};
+	//Per-query scratch data, kept out of NavTri so FindPath stays const-safe
+	vector<float>	g(allTris.size(), FLT_MAX);
+	vector<int>		parents(allTris.size(), -1);
+	vector<bool>	closed(allTris.size(), false);
+	vector<Vector3>	entry(allTris.size());
+
+	priority_queue<OpenEntry, vector<OpenEntry>, greater<OpenEntry>> openList;
+
+	int startIndex	= TriIndex(startTri);
+	int endIndex	= TriIndex(endTri);
+
+	g[startIndex]		= 0.0f;
+	entry[startIndex]	= from;
+	openList.push({ (to - from).Length(), startIndex });
+
+	while (!openList.empty()) {
+		int current = openList.top().tri;
+		openList.pop();
+
+		if (closed[current]) {
+			continue; //stale entry, a better route was found after it was pushed
+		}
+		if (current == endIndex) { //we've found the path!
+			for (int i = endIndex; i != -1; i = parents[i]) {
+				outTris.emplace_back(&allTris[i]);
+			}
+			std::reverse(outTris.begin(), outTris.end());
+			return true;
+		}
+		closed[current] = true;
+
+		const NavTri& t = allTris[current];
+		for (int i = 0; i < 3; ++i) {
+			const NavTri* neighbour = t.neighbours[i];
+			if (!neighbour) {
+				continue;
+			}
+			int n = TriIndex(neighbour);
+			if (closed[n]) {
+				continue;
+			}
+			Vector3 edgeMid = (allVerts[t.indices[i]] + allVerts[t.indices[(i + 1) % 3]]) * 0.5f;
+			float	newG	= g[current] + (edgeMid - entry[current]).Length();
+			if (n == endIndex) {
+				newG += (to - edgeMid).Length();
+			}
+			if (newG < g[n]) {
+				g[n]		= newG;
+				parents[n]	= current;
+				entry[n]	= edgeMid;
+				openList.push({ newG + (n == endIndex ? 0.0f : (to - edgeMid).Length()), n });
+			}
+		}
+	}
+	return false; //open list emptied out with no path!
+}
+
+void NavigationMesh::BuildPortals(const std::vector<const NavTri*>& tris, const Vector3& from, const Vector3& to, std::vector<Portal>& outPortals) const {
+	outPortals.reserve(tris.size() + 1);
+	outPortals.push_back({ from, from });
+
+	for (size_t i = 0; i + 1 < tris.size(); ++i) {
+		const NavTri* t		= tris[i];
+		const NavTri* next	= tris[i + 1];
+
+		for (int j = 0; j < 3; ++j) {
+			if (t->neighbours[j] != next) {
+				continue;
+			}
+			Vector3 a = allVerts[t->indices[j]];
+			Vector3 b = allVerts[t->indices[(j + 1) % 3]];
+			//The centroid is never on the shared edge, so a and b always fall
+			//on opposite sides of the line from it through the edge midpoint
+			Vector3 mid = (a + b) * 0.5f;
+			if (TriArea2(t->centroid, mid, a) > 0.0f) {
+				outPortals.push_back({ a, b });
+			}
+			else {
+				outPortals.push_back({ b, a });
+			}
+			break;
+		}
+	}
+	outPortals.push_back({ to, to });
+}
+
+/*
+Simple stupid funnel algorithm - the funnel is narrowed portal by portal, and
+whenever one side crosses over the other, that corner becomes a waypoint and
+the new apex of the funnel.
+*/
+void NavigationMesh::StringPull(const std::vector<Portal>& portals, std::vector<Vector3>& outPoints) const {
+	Vector3 apex	= portals[0].left;
+	Vector3 left	= portals[0].left;
+	Vector3 right	= portals[0].right;
+
+	int apexIndex	= 0;
+	int leftIndex	= 0;
+	int rightIndex	= 0;
+
+	outPoints.emplace_back(apex);
+
+	for (int i = 1; i < (int)portals.size(); ++i) {
+		const Vector3& newLeft	= portals[i].left;
+		const Vector3& newRight	= portals[i].right;
+
+		//Try to narrow the right side of the funnel
+		if (TriArea2(apex, right, newRight) >= 0.0f) {
+			if (SamePointXZ(apex, right) || TriArea2(apex, left, newRight) < 0.0f) {
+				right		= newRight;
+				rightIndex	= i;
+			}
+			else { //right crossed over left, so left is a corner of the path
+				apex		= left;
+				apexIndex	= leftIndex;
+				if (!SamePointXZ(outPoints.back(), apex)) {
+					outPoints.emplace_back(apex);
+				}
+
+				left		= apex;
+				right		= apex;
+				leftIndex	= apexIndex;
+				rightIndex	= apexIndex;
+				i			= apexIndex;
+				continue;
+			}
+		}
+		//And then the left side
+		if (TriArea2(apex, left, newLeft) <= 0.0f) {
+			if (SamePointXZ(apex, left) || TriArea2(apex, right, newLeft) > 0.0f) {
+				left		= newLeft;
+				leftIndex	= i;
+			}
+			else { //left crossed over right, so right is a corner of the path
+				apex		= right;
+				apexIndex	= rightIndex;
+				if (!SamePointXZ(outPoints.back(), apex)) {
+					outPoints.emplace_back(apex);
+				}
+
+				left		= apex;
+				right		= apex;
+				leftIndex	= apexIndex;
+				rightIndex	= apexIndex;
+				i			= apexIndex;
+				continue;
+			}
+		}
+	}
+	const Vector3& end = portals.back().left;
+	if (!SamePointXZ(outPoints.back(), end)) {
+		outPoints.emplace_back(end);
+	}
 }
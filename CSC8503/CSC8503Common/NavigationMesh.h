@@ -11,22 +11,66 @@ namespace NCL {
 			~NavigationMesh();
 
 			bool FindPath(const Vector3& from, const Vector3& to, NavigationPath& outPath) override;
-		
+			int  GetNodeIndex(const Vector3& pos) const override;
+
+			//Writes the mesh, adjacency and tri lookup out in the binary format
+			//the AssetCompiler produces
+			bool SaveCompiled(const std::string& path) const;
+
+			int GetTriCount() const {
+				return (int)allTris.size();
+			}
+
 		protected:
 
 			struct NavTri {
-				NavTri* neighbours[3];
+				NavTri* neighbours[3];	//neighbour i shares the edge indices[i] -> indices[(i+1)%3]
+				int		indices[3];
+				Vector3 centroid;
 
 				NavTri() {
-					neighbours[0] = nullptr;
-					neighbours[1] = nullptr;
-					neighbours[2] = nullptr;
+					for (int i = 0; i < 3; ++i) {
+						neighbours[i]	= nullptr;
+						indices[i]		= -1;
+					}
 				}
 			};
 
+			//A portal is the shared edge crossed when moving between two tris,
+			//described from the point of view of the agent walking through it
+			struct Portal {
+				Vector3 left;
+				Vector3 right;
+			};
+
+			bool		LoadCompiled(const std::string& path);
+			void		BuildTris();
+			void		BuildAdjacency();
+			void		BuildTriLookup();
+
+			const NavTri*	GetTriForPosition(const Vector3& pos) const;
+			bool			PointInTri(const NavTri& t, const Vector3& pos, float& height) const;
+
+			bool		FindTriPath(const NavTri* startTri, const NavTri* endTri, const Vector3& from, const Vector3& to, std::vector<const NavTri*>& outTris) const;
+			void		BuildPortals(const std::vector<const NavTri*>& tris, const Vector3& from, const Vector3& to, std::vector<Portal>& outPortals) const;
+			void		StringPull(const std::vector<Portal>& portals, std::vector<Vector3>& outPoints) const;
+
+			int			TriIndex(const NavTri* t) const {
+				return (int)(t - allTris.data());
+			}
+
 			std::vector<NavTri>		allTris;
 			std::vector<Vector3>	allVerts;
 			std::vector<int>		allIndices;
+
+			//Uniform XZ grid of buckets, each holding the tris that overlap it,
+			//stored as offsets into a single flat array
+			Vector3				lookupMin;
+			float				lookupCellSize;
+			int					lookupWidth;
+			int					lookupHeight;
+			std::vector<int>	lookupOffsets;
+			std::vector<int>	lookupTris;
 		};
 	}
-}
\ No newline at end of file
+}
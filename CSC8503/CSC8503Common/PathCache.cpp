@@ -0,0 +1,102 @@
+#include "PathCache.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PathCache::PathCache(size_t capacity) {
+	this->capacity = capacity;
+	entryLookup.reserve(capacity);
+}
+
+PathCache::~PathCache() {
+}
+
+bool PathCache::Find(int startNode, int goalNode, int mapVersion, const ChangeQuery& changes, bool& found, NavigationPath& outPath) {
+	std::lock_guard<std::mutex> lock(cacheLock);
+
+	auto i = entryLookup.find(MakeKey(startNode, goalNode));
+	if (i == entryLookup.end()) {
+		stats.misses++;
+		return false;
+	}
+	Entry& e = *i->second;
+
+	if (e.version != mapVersion) {
+		std::vector<int> changed;
+		bool stillValid = changes(e.version, changed);
+
+		for (int node : changed) {
+			if (!stillValid) {
+				break;
+			}
+			stillValid = !std::binary_search(e.nodes.begin(), e.nodes.end(), node);
+		}
+		if (!stillValid) {
+			entries.erase(i->second);
+			entryLookup.erase(i);
+			stats.invalidations++;
+			stats.misses++;
+			return false;
+		}
+		e.version = mapVersion; //none of the changes touched it
+	}
+	entries.splice(entries.begin(), entries, i->second);
+
+	for (const Vector3& wp : e.waypoints) {
+		outPath.PushWaypoint(wp);
+	}
+	found = e.found;
+	stats.hits++;
+	return true;
+}
+
+void PathCache::Store(int startNode, int goalNode, int mapVersion, bool found, const std::vector<Vector3>& waypoints, const std::vector<int>& nodes, double searchTimeMS) {
+	std::lock_guard<std::mutex> lock(cacheLock);
+
+	stats.missTimeMS += searchTimeMS;
+
+	long long key = MakeKey(startNode, goalNode);
+	auto existing = entryLookup.find(key);
+	if (existing != entryLookup.end()) {
+		entries.erase(existing->second);
+		entryLookup.erase(existing);
+	}
+	else if (entries.size() >= capacity && !entries.empty()) {
+		entryLookup.erase(entries.back().key);
+		entries.pop_back();
+		stats.evictions++;
+	}
+
+	entries.push_front(Entry());
+	Entry& e	= entries.front();
+	e.key		= key;
+	e.version	= mapVersion;
+	e.found		= found;
+	e.waypoints	= waypoints;
+	e.nodes		= nodes;
+	std::sort(e.nodes.begin(), e.nodes.end());
+
+	entryLookup.emplace(key, entries.begin());
+}
+
+void PathCache::Clear() {
+	std::lock_guard<std::mutex> lock(cacheLock);
+	entries.clear();
+	entryLookup.clear();
+}
+
+PathCacheStats PathCache::GetStats() const {
+	std::lock_guard<std::mutex> lock(cacheLock);
+	return stats;
+}
+
+void PathCache::PrintStats() const {
+	PathCacheStats s = GetStats();
+
+	std::cout << "Path cache: " << s.hits << " hits, " << s.misses << " misses ("
+		<< (s.HitRate() * 100.0f) << "% hit rate), "
+		<< s.invalidations << " invalidated, " << s.evictions << " evicted, ~"
+		<< s.TimeSavedMS() << "ms of searching saved" << std::endl;
+}
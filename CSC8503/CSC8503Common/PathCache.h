@@ -0,0 +1,72 @@
+#pragma once
+#include "NavigationPath.h"
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+namespace NCL {
+	namespace CSC8503 {
+		struct PathCacheStats {
+			size_t	hits			= 0;
+			size_t	misses			= 0;
+			size_t	invalidations	= 0;	//entries thrown out as the map changed under them
+			size_t	evictions		= 0;
+			double	missTimeMS		= 0.0;	//time spent searching on misses
+
+			float HitRate() const {
+				size_t total = hits + misses;
+				return total ? (float)hits / total : 0.0f;
+			}
+			//Estimated from the average cost of a search that missed
+			double TimeSavedMS() const {
+				return misses ? hits * (missTimeMS / misses) : 0.0;
+			}
+		};
+
+		/*
+		LRU cache of found paths, keyed on start and goal node. Each entry
+		remembers the map version it was last known to be good at, and which
+		nodes it crosses - when the map changes, only entries crossing one of
+		the changed nodes need to be thrown out.
+		*/
+		class PathCache {
+		public:
+			//Given the version an entry was stored at, fills in the nodes changed
+			//since then, or returns false if every entry should be dropped
+			typedef std::function<bool(int sinceVersion, std::vector<int>& changedNodes)> ChangeQuery;
+
+			PathCache(size_t capacity = 256);
+			~PathCache();
+
+			bool	Find(int startNode, int goalNode, int mapVersion, const ChangeQuery& changes, bool& found, NavigationPath& outPath);
+			void	Store(int startNode, int goalNode, int mapVersion, bool found, const std::vector<Vector3>& waypoints, const std::vector<int>& nodes, double searchTimeMS);
+			void	Clear();
+
+			PathCacheStats	GetStats() const;
+			void			PrintStats() const;
+
+		protected:
+			struct Entry {
+				long long				key;
+				int						version;
+				bool					found;
+				std::vector<Vector3>	waypoints;	//in the order they're pushed onto a NavigationPath
+				std::vector<int>		nodes;		//sorted
+			};
+
+			static long long MakeKey(int startNode, int goalNode) {
+				return ((long long)startNode << 32) | (unsigned int)goalNode;
+			}
+
+			size_t capacity;
+
+			std::list<Entry>	entries;	//most recently used at the front
+			std::unordered_map<long long, std::list<Entry>::iterator> entryLookup;
+
+			PathCacheStats		stats;
+			mutable std::mutex	cacheLock;
+		};
+	}
+}
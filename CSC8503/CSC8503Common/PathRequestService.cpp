@@ -0,0 +1,159 @@
+#include "PathRequestService.h"
+#include <algorithm>
+
+using namespace NCL;
+using namespace CSC8503;
+
+PathRequestService::PathRequestService(NavigationMap* map, int numWorkers, float frameBudgetMS) {
+	this->map			= map;
+	this->frameBudgetMS	= frameBudgetMS;
+
+	frameDeadline	= Clock::now();
+	inFlight		= 0;
+	shuttingDown	= false;
+	requestCount	= 0;
+	mergedCount		= 0;
+	latencyCount	= 0;
+	latencyHead		= 0;
+
+	if (numWorkers <= 0) { //leave a core for the main thread
+		numWorkers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	for (int i = 0; i < numWorkers; ++i) {
+		workers.emplace_back(&PathRequestService::WorkerThread, this);
+	}
+}
+
+PathRequestService::~PathRequestService() {
+	{
+		std::lock_guard<std::mutex> lock(jobLock);
+		shuttingDown = true;
+	}
+	jobSignal.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+	//Anything still waiting is dropped without running its callbacks, as the
+	//agents that asked for it are probably being deleted along with us
+}
+
+std::shared_future<PathResult> PathRequestService::RequestPath(const Vector3& from, const Vector3& to, PathCallback callback) {
+	int startNode	= map->GetNodeIndex(from);
+	int goalNode	= map->GetNodeIndex(to);
+
+	std::lock_guard<std::mutex> lock(jobLock);
+	requestCount++;
+
+	long long key = -1;
+	if (startNode >= 0 && goalNode >= 0) {
+		key = ((long long)startNode << 32) | (unsigned int)goalNode;
+
+		auto existing = jobsByKey.find(key);
+		if (existing != jobsByKey.end()) {
+			mergedCount++;
+			if (callback) {
+				existing->second->callbacks.emplace_back(callback);
+			}
+			return existing->second->future;
+		}
+	}
+	std::shared_ptr<PathJob> job = std::make_shared<PathJob>();
+	job->from			= from;
+	job->to				= to;
+	job->key			= key;
+	job->requestTime	= Clock::now();
+	job->future			= job->promise.get_future().share();
+	if (callback) {
+		job->callbacks.emplace_back(callback);
+	}
+	if (key >= 0) {
+		jobsByKey.emplace(key, job);
+	}
+	pendingJobs.emplace_back(job);
+	jobSignal.notify_one();
+
+	return job->future;
+}
+
+void PathRequestService::Update() {
+	std::vector<std::shared_ptr<PathJob>> finished;
+	{
+		std::lock_guard<std::mutex> lock(jobLock);
+		finished.swap(finishedJobs);
+		frameDeadline = Clock::now() + std::chrono::microseconds((long long)(frameBudgetMS * 1000.0f));
+	}
+	jobSignal.notify_all();
+
+	for (auto& job : finished) {
+		for (PathCallback& c : job->callbacks) {
+			c(job->result);
+		}
+	}
+}
+
+void PathRequestService::WorkerThread() {
+	while (true) {
+		std::shared_ptr<PathJob> job;
+		{
+			std::unique_lock<std::mutex> lock(jobLock);
+			//Out of work or out of budget for this frame - sleep until there's
+			//a new request, or the next Update opens up more time
+			jobSignal.wait(lock, [&] {
+				return shuttingDown || (!pendingJobs.empty() && Clock::now() < frameDeadline);
+			});
+			if (shuttingDown) {
+				return;
+			}
+			job = pendingJobs.front();
+			pendingJobs.pop_front();
+			inFlight++;
+		}
+
+		PathResult result;
+		result.found = map->FindPath(job->from, job->to, result.path);
+
+		float latency = std::chrono::duration<float, std::milli>(Clock::now() - job->requestTime).count();
+		{
+			std::lock_guard<std::mutex> lock(jobLock);
+			//No more merging once the result exists, later requests get a fresh search
+			if (job->key >= 0) {
+				jobsByKey.erase(job->key);
+			}
+			job->result = result;
+			finishedJobs.emplace_back(job);
+			inFlight--;
+			RecordLatency(latency);
+		}
+		job->promise.set_value(result);
+	}
+}
+
+void PathRequestService::RecordLatency(float ms) {
+	latencies[latencyHead] = ms;
+	latencyHead = (latencyHead + 1) % LATENCY_SAMPLES;
+	latencyCount = std::min(latencyCount + 1, LATENCY_SAMPLES);
+}
+
+size_t PathRequestService::GetQueueDepth() const {
+	std::lock_guard<std::mutex> lock(jobLock);
+	return pendingJobs.size();
+}
+
+size_t PathRequestService::GetInFlightCount() const {
+	std::lock_guard<std::mutex> lock(jobLock);
+	return inFlight;
+}
+
+float PathRequestService::GetLatencyPercentile(float percentile) const {
+	std::vector<float> samples;
+	{
+		std::lock_guard<std::mutex> lock(jobLock);
+		samples.assign(latencies, latencies + latencyCount);
+	}
+	if (samples.empty()) {
+		return 0.0f;
+	}
+	size_t n = std::min(samples.size() - 1, (size_t)(percentile / 100.0f * samples.size()));
+	std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+	return samples[n];
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include "NavigationMap.h"
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+
+namespace NCL {
+	namespace CSC8503 {
+		struct PathResult {
+			bool			found = false;
+			NavigationPath	path;
+		};
+
+		typedef std::function<void(const PathResult&)> PathCallback;
+
+		/*
+		Queues up path requests from the AI and runs them on worker threads,
+		so a burst of repaths gets spread out instead of landing on one frame.
+
+		Requests between the same start and goal nodes are merged while they
+		are waiting, and share one search. Workers only start new searches
+		inside the time budget opened by each Update, and callbacks are always
+		run from Update on the calling thread, so game code doesn't need to
+		be thread safe. Anyone who'd rather poll can hold on to the future.
+		*/
+		class PathRequestService {
+		public:
+			PathRequestService(NavigationMap* map, int numWorkers = 0, float frameBudgetMS = 2.0f);
+			~PathRequestService();
+
+			std::shared_future<PathResult> RequestPath(const Vector3& from, const Vector3& to, PathCallback callback = nullptr);
+
+			//Call once per frame - delivers finished paths, then opens up
+			//this frame's time budget for the workers
+			void Update();
+
+			void SetFrameBudget(float ms) {
+				frameBudgetMS = ms;
+			}
+
+			size_t	GetQueueDepth() const;
+			size_t	GetInFlightCount() const;
+			float	GetLatencyPercentile(float percentile) const;	//in ms, over recent requests
+
+			size_t	GetRequestCount() const {
+				return requestCount;
+			}
+			size_t	GetMergedRequestCount() const {
+				return mergedCount;
+			}
+
+		protected:
+			typedef std::chrono::high_resolution_clock Clock;
+
+			struct PathJob {
+				Vector3		from;
+				Vector3		to;
+				long long	key;
+				Clock::time_point			requestTime;
+				std::promise<PathResult>	promise;
+				std::shared_future<PathResult>	future;
+				std::vector<PathCallback>	callbacks;
+				PathResult					result;
+			};
+
+			void WorkerThread();
+			void RecordLatency(float ms);
+
+			NavigationMap* map;
+
+			std::vector<std::thread>	workers;
+			mutable std::mutex			jobLock;
+			std::condition_variable		jobSignal;
+
+			std::deque<std::shared_ptr<PathJob>>						pendingJobs;
+			std::unordered_map<long long, std::shared_ptr<PathJob>>	jobsByKey;	//waiting or running
+			std::vector<std::shared_ptr<PathJob>>						finishedJobs;
+
+			Clock::time_point	frameDeadline;
+			float				frameBudgetMS;
+			size_t				inFlight;
+			bool				shuttingDown;
+
+			size_t				requestCount;
+			size_t				mergedCount;
+
+			static const int	LATENCY_SAMPLES = 256;
+			float				latencies[LATENCY_SAMPLES];
+			int					latencyCount;
+			int					latencyHead;
+		};
+	}
+}
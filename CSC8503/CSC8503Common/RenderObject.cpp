@@ -1,5 +1,8 @@
 #include "RenderObject.h"
 #include "../../Common/MeshGeometry.h"
+#include "Transform.h"
+
+#include <algorithm>
 
 using namespace NCL::CSC8503;
 using namespace NCL;
@@ -10,8 +13,27 @@ RenderObject::RenderObject(Transform* parentTransform, MeshGeometry* mesh, Textu
 	this->texture	= tex;
 	this->shader	= shader;
 	this->colour	= Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+	this->lodBias	= 0;
+	this->occluder	= false;
 }
 
 RenderObject::~RenderObject() {
 
-}
\ No newline at end of file
+}
+
+int RenderObject::SelectLOD(const Vector3& cameraPos, float pixelsPerUnit, float maxPixelError) const {
+	int lodCount = mesh ? (int)mesh->GetLODCount() : 1;
+	if (lodCount <= 1) {
+		return 0;
+	}
+	Vector3 scale		= transform->GetScale();
+	float	maxScale	= std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+	float	distance	= std::max((transform->GetPosition() - cameraPos).Length(), 0.0001f);
+	float	pixelScale	= maxScale * pixelsPerUnit / distance;
+
+	int level = 0;
+	while (level + 1 < lodCount && mesh->GetLODError(level + 1) * pixelScale <= maxPixelError) {
+		level++;
+	}
+	return std::min(std::max(level + lodBias, 0), lodCount - 1);
+}
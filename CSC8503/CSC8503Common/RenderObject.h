@@ -46,12 +46,39 @@ namespace NCL {
 				return colour;
 			}
 
+			//Shifts which LOD is picked - positive values favour lower detail
+			void SetLODBias(int bias) {
+				lodBias = bias;
+			}
+
+			int GetLODBias() const {
+				return lodBias;
+			}
+
+			//Occluders hide what's behind them from the camera - only for meshes that fill their bounds
+			void SetOccluder(bool o) {
+				occluder = o;
+			}
+
+			bool IsOccluder() const {
+				return occluder;
+			}
+
+			/*
+			Picks the lowest detail level of the mesh whose error would still
+			cover less than maxPixelError pixels on screen. pixelsPerUnit is how
+			many pixels one unit covers at a distance of one unit from the camera.
+			*/
+			int SelectLOD(const Vector3& cameraPos, float pixelsPerUnit, float maxPixelError = 1.0f) const;
+
 		protected:
 			MeshGeometry*	mesh;
 			TextureBase*	texture;
 			ShaderBase*		shader;
 			Transform*		transform;
 			Vector4			colour;
+			int				lodBias;
+			bool			occluder;
 		};
 	}
 }
@@ -7,7 +7,9 @@ CourseworkGame::CourseworkGame()
 	forceMagnitude = 10.0f;
 	gravityScale = 10.0f;
 	world = new GameWorld();
-	renderer = new GameTechRenderer(*world);
+	assets = new AssetManager(new OGLAssetUploader());
+	assets->SetGenerateLODs(true);
+	renderer = new GameTechRenderer(*world, *assets);
 	physics = new PhysicsSystem(*world);
 	physics->SetGravity(Vector3(0.0f, -9.8f * gravityScale, 9.8f * 6));
 	Debug::SetRenderer(renderer);
@@ -16,16 +18,13 @@ CourseworkGame::CourseworkGame()
 
 CourseworkGame::~CourseworkGame()
 {
-	delete cubeMesh;
-	delete sphereMesh;
-	delete charMeshA;
-	delete charMeshB;
-	delete enemyMesh;
-	delete bonusMesh;
-
-	delete basicTex;
+	meshHandles.clear();
+	basicTexHandle = AssetManager::TextureHandle();
+	delete assets;
 	delete basicShader;
 
+	delete pathService;
+	delete playerFlowField;
 	delete physics;
 	delete renderer;
 	delete world;
@@ -33,6 +32,16 @@ CourseworkGame::~CourseworkGame()
 
 void CourseworkGame::InitialiseWorld()
 {
+	// Report how the path cache did over the level 2 run we're leaving
+	if (pathService && navGrid->GetPathCache())
+		navGrid->GetPathCache()->PrintStats();
+
+	// Stop any queued paths calling back into AI that's about to be deleted
+	delete pathService;
+	pathService = nullptr;
+	delete playerFlowField;
+	playerFlowField = nullptr;
+
 	world->ClearAndErase();
 	physics->Clear();
 	selectionObject = nullptr;
@@ -80,6 +89,8 @@ void CourseworkGame::UpdateGame(float dt)
 	if (!inSelectionMode) {
 		world->GetMainCamera()->UpdateCamera(dt);
 	}
+	assets->CheckForChanges(dt);
+	assets->Update();
 
 	if (selectionObject && selectionObject->canInteract)
 		ToggleSelectedObject();
@@ -104,6 +115,8 @@ void CourseworkGame::UpdateGame(float dt)
 		DrawUI_2();
 		navGrid->UpdateGrid();
 		//navGrid->PrintGrid();	// Print grid to console
+		pathService->Update();
+		playerFlowField->SetGoal(ball->GetTransform().GetPosition());
 		
 		world->UpdateBonusObjects(dt);
 		world->UpdateFreezeTimer(dt);
@@ -424,6 +437,9 @@ GameObject* CourseworkGame::AddCubeToWorld(const Vector3& position, const Vector
 	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
 	cube->GetPhysicsObject()->InitCubeInertia();
 
+	//The level's walls are solid boxes that never fall over, so can hide what's behind them
+	cube->GetRenderObject()->SetOccluder(inverseMass == 0.0f);
+
 	world->AddGameObject(cube);
 
 	return cube;
@@ -445,6 +461,9 @@ GameObject* CourseworkGame::AddOBBCubeToWorld(const Vector3& position, const Vec
 	cube->GetPhysicsObject()->SetInverseMass(inverseMass);
 	cube->GetPhysicsObject()->InitCubeInertia();
 
+	//The level's walls are solid boxes that never fall over, so can hide what's behind them
+	cube->GetRenderObject()->SetOccluder(inverseMass == 0.0f);
+
 	world->AddGameObject(cube);
 	cube->GetRenderObject()->SetColour(Debug::CYAN);
 
@@ -791,6 +810,9 @@ void CourseworkGame::CreateLevel2()
 {
 	inSelectionMode = false;
 	navGrid = new NavigationGrid();
+	navGrid->EnablePathCache();
+	pathService = new PathRequestService(navGrid);
+	playerFlowField = new FlowField(navGrid);
 	world->isLevelTwo = true;
 	physics->UseGravity(true);
 	gravityScale = 20;
@@ -1034,6 +1056,8 @@ void CourseworkGame::CreateLevel2()
 	Vector3 enemyBallSpawn = indexToCoord(12*12-27);
 	EnemyBallAI* enemy = AddEnemyBallAI(enemyBallSpawn, 5, 0);
 	enemy->setNavGrid(navGrid);
+	enemy->setPathService(pathService);
+	enemy->setPlayerFlowField(playerFlowField);
 	enemy->setGameWorld(world);
 	enemy->setBonuses(world->bonusObjects);
 
@@ -1213,10 +1237,10 @@ void CourseworkGame::ChangeOrientation_x(GameObject& obj, float change)
 
 void CourseworkGame::DrawUI_1()
 {
-	Debug::Print("Press 'E' on a selected object to activate it", Vector2(2, 95));
-	Debug::Print("Press 'P' for debug info", Vector2(2, 90));
-	Debug::Print("Press 'M' to return to menu", Vector2(2, 85));
-	Debug::Print("Press 'F1' to restart", Vector2(60, 5));
+	Debug::PrintStatic("Press 'E' on a selected object to activate it", Vector2(2, 95));
+	Debug::PrintStatic("Press 'P' for debug info", Vector2(2, 90));
+	Debug::PrintStatic("Press 'M' to return to menu", Vector2(2, 85));
+	Debug::PrintStatic("Press 'F1' to restart", Vector2(60, 5));
 	
 	if (world->isGameLost())
 	{
@@ -1248,31 +1272,56 @@ void CourseworkGame::DrawUI_2()
 
 void CourseworkGame::DrawScore()
 {
-	if (isLevelOne)
+	if (!isLevelOne && !isLevelTwo)
+		return;
+
+	int time = (int)world->GetElapsedTime();
+	int counter = isLevelOne ? world->GetBonus() : world->GetLives();
+	if (time != shownTime)
 	{
-		Debug::Print("Time : " + std::to_string((int)world->GetElapsedTime()) + " s", Vector2(2, 5));
-		Debug::Print("Bonuses : " + std::to_string((world->GetBonus())), Vector2(2, 10));
+		shownTime = time;
+		timeText = "Time : " + std::to_string(time) + " s";
 	}
-	else if (isLevelTwo)
+	if (counter != shownCounter || isLevelOne != shownLevelOne)
 	{
-		Debug::Print("Time : " + std::to_string((int)world->GetElapsedTime()) + " s", Vector2(2, 5));
-		Debug::Print("Lives : " + std::to_string(world->GetLives()), Vector2(2, 10));
+		shownCounter = counter;
+		shownLevelOne = isLevelOne;
+		counterText = (isLevelOne ? "Bonuses : " : "Lives : ") + std::to_string(counter);
 	}
+	Debug::Print(timeText, Vector2(2, 5));
+	Debug::Print(counterText, Vector2(2, 10));
 }
 
 void CourseworkGame::DrawWinScreen()
 {
-	Debug::Print("Congratulations!", Vector2(35, 50));
+	Debug::PrintStatic("Congratulations!", Vector2(35, 50));
 	Debug::Print("Your time: " + std::to_string((int)world->GetTotalTime()) + " s", Vector2(35, 60));
 	if(isLevelOne)
 		Debug::Print("Your bonuses: " + std::to_string((world->GetBonus())), Vector2(35, 65));
-	Debug::Print("Press 'M' to return to menu", Vector2(20, 75));
-	Debug::Print("Press 'F1' to restart", Vector2(20, 80));
+	Debug::PrintStatic("Press 'M' to return to menu", Vector2(20, 75));
+	Debug::PrintStatic("Press 'F1' to restart", Vector2(20, 80));
 }
 
 void CourseworkGame::DrawDebugInfo()
 {
-	Debug::Print("Debug info:", Vector2(5, 45));
+	Debug::PrintStatic("Debug info:", Vector2(5, 45));
+
+	const CullingStats& culling = renderer->GetCullingStats();
+	Debug::Print("Drawn: " + std::to_string(culling.cameraDrawn) + "/" + std::to_string(culling.objects) +
+		", shadows: " + std::to_string(culling.shadowDrawn) + "/" + std::to_string(culling.objects), Vector2(5, 40));
+
+	string cascades = "Cascade casters:";
+	for (size_t i = 0; i < culling.cascadeCount; ++i) {
+		cascades += " " + std::to_string(culling.cascadeCasters[i]);
+	}
+	Debug::Print(cascades, Vector2(5, 30));
+
+	Debug::Print("Occluded: " + std::to_string(culling.occluded) + " by " + std::to_string(culling.occluders) + " occluders, " +
+		std::to_string((int)((culling.occluderMS + culling.occlusionMS) * 1000.0f)) + "us", Vector2(5, 25));
+
+	const RenderStateStats& state = renderer->GetRenderStateStats();
+	Debug::Print("Draws: " + std::to_string(state.draws) + " (" + std::to_string(state.instances) + " uninstanced), shaders: " + std::to_string(state.shaderChanges) +
+		", textures: " + std::to_string(state.textureChanges) + ", meshes: " + std::to_string(state.meshChanges), Vector2(5, 35));
 
 	if (!selectionObject) return;
 
@@ -1457,24 +1506,24 @@ void CourseworkGame::CreateMenu()
 void CourseworkGame::DrawMenu()
 {
 	
-	Debug::Print("Level 1:", Vector2(5, 20));
-	Debug::Print("Level 2:", Vector2(5, 50));
-	Debug::Print("   Exit:", Vector2(5, 85));
+	Debug::PrintStatic("Level 1:", Vector2(5, 20));
+	Debug::PrintStatic("Level 2:", Vector2(5, 50));
+	Debug::PrintStatic("   Exit:", Vector2(5, 85));
 
-	Debug::Print("CSC 8503 Coursework", Vector2(50, 60));
-	Debug::Print("Click on menu item", Vector2(50, 70));
-	Debug::Print("and press 'E' to select", Vector2(50, 75));
+	Debug::PrintStatic("CSC 8503 Coursework", Vector2(50, 60));
+	Debug::PrintStatic("Click on menu item", Vector2(50, 70));
+	Debug::PrintStatic("and press 'E' to select", Vector2(50, 75));
 
 }
 
 void CourseworkGame::DrawLossScreen()
 {
-	Debug::Print("You lost!", Vector2(35, 50));
+	Debug::PrintStatic("You lost!", Vector2(35, 50));
 	if(isLevelOne)
-		Debug::Print("Time limit reached", Vector2(35, 60));
+		Debug::PrintStatic("Time limit reached", Vector2(35, 60));
 	else if (isLevelTwo)
-		Debug::Print("No lives left", Vector2(35, 60));
+		Debug::PrintStatic("No lives left", Vector2(35, 60));
 
-	Debug::Print("Press 'M' to return to menu", Vector2(25, 70));
-	Debug::Print("Press 'F1' to restart", Vector2(25, 75));
+	Debug::PrintStatic("Press 'M' to return to menu", Vector2(25, 70));
+	Debug::PrintStatic("Press 'F1' to restart", Vector2(25, 75));
 }
\ No newline at end of file
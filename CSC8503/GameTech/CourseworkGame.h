@@ -5,6 +5,8 @@
 #include "../CSC8503Common/GameWorld.h"
 #include "../../Plugins/OpenGLRendering/OGLMesh.h"
 #include "../../Common/TextureLoader.h"
+#include "../../Common/AssetManager.h"
+#include "../../Plugins/OpenGLRendering/OGLAssetUploader.h"
 #include "../CSC8503Common/PositionConstraint.h"
 #include "../CSC8503Common/RotationConstraint.h"
 #include "../CSC8503Common/StateGameObject.h"
@@ -12,6 +14,7 @@
 #include "../CSC8503Common/NavigationGrid.h"
 #include "../CSC8503Common/NavigationPath.h"
 #include "../CSC8503Common/EnemyBallAI.h"
+#include "../CSC8503Common/PathRequestService.h"
 using namespace NCL;
 
 class CourseworkGame
@@ -89,9 +92,12 @@ protected:
 	GameObject* ball;
 	GameObject* enemyBall;
 	GameTechRenderer* renderer;
+	AssetManager* assets;
 	PhysicsSystem* physics;
 	GameWorld* world;
-	NavigationGrid* navGrid;
+	NavigationGrid* navGrid = nullptr;
+	PathRequestService* pathService = nullptr;
+	FlowField* playerFlowField = nullptr;
 
 	Vector3 enemyBallSpawn;
 	Vector3 playerBallSpawn;
@@ -106,6 +112,13 @@ protected:
 	bool isLevelOne = false;
 	bool isLevelTwo = false;
 
+	//The score text is only formatted again when its numbers change
+	int shownTime = -1;
+	int shownCounter = -1;
+	bool shownLevelOne = false;
+	string timeText;
+	string counterText;
+
 	GameObject* menu_item_1;
 	GameObject* menu_item_2;
 	GameObject* menu_item_3;
@@ -119,7 +132,7 @@ protected:
 	GameObject* selectionObject = nullptr;
 	GameObject* lockedObject = nullptr;
 
-	// Asset meshes
+	// Asset meshes - owned by the asset manager, and kept cached across level resets by the handles below
 	OGLMesh* charMeshA = nullptr;
 	OGLMesh* charMeshB = nullptr;
 	OGLMesh* enemyMesh = nullptr;
@@ -130,6 +143,8 @@ protected:
 	// Asset Texture and Shader
 	OGLTexture* basicTex = nullptr;
 	OGLShader* basicShader = nullptr;
+	std::vector<AssetManager::MeshHandle> meshHandles;
+	AssetManager::TextureHandle basicTexHandle;
 
 	StateGameObject* stateObj;
 
@@ -137,22 +152,23 @@ protected:
 	void InitialiseGame() { InitialiseAssets(); InitialiseCamera(); InitialiseWorld(); };
 
 	void InitialiseAssets() {
-		auto loadFunc = [](const string& name, OGLMesh** into) {
-			*into = new OGLMesh(name);
-			(*into)->SetPrimitiveType(GeometryPrimitive::Triangles);
-			(*into)->UploadToGPU();
-		};
-
-		loadFunc("cube.msh", &cubeMesh);
-		loadFunc("sphere.msh", &sphereMesh);
-		loadFunc("Male1.msh", &charMeshA);
-		loadFunc("courier.msh", &charMeshB);
-		loadFunc("security.msh", &enemyMesh);
-		loadFunc("coin.msh", &bonusMesh);
-		loadFunc("capsule.msh", &capsuleMesh);
-
-		basicTex = (OGLTexture*)TextureLoader::LoadAPITexture("checkerboard.png");
+		// Everything decodes in parallel on the asset workers, while we build the shader
+		const string meshNames[] = { "cube.msh", "sphere.msh", "Male1.msh", "courier.msh", "security.msh", "coin.msh", "capsule.msh" };
+		OGLMesh** meshSlots[] = { &cubeMesh, &sphereMesh, &charMeshA, &charMeshB, &enemyMesh, &bonusMesh, &capsuleMesh };
+
+		for (const string& name : meshNames) {
+			meshHandles.emplace_back(assets->LoadMesh(name));
+		}
+		basicTexHandle = assets->LoadTexture("checkerboard.png");
+
 		basicShader = new OGLShader("GameTechVert.glsl", "GameTechFrag.glsl");
+
+		assets->WaitForAll();
+
+		for (size_t i = 0; i < meshHandles.size(); ++i) {
+			*meshSlots[i] = (OGLMesh*)meshHandles[i].Get();
+		}
+		basicTex = (OGLTexture*)basicTexHandle.Get();
 	}
 
 	void InitialiseCamera()
@@ -4,34 +4,55 @@
 #include "../../Common/Vector2.h"
 #include "../../Common/Vector3.h"
 #include "../../Common/TextureLoader.h"
+#include "../../Common/Maths.h"
+#include "../../Common/ParallelFor.h"
+
+#include <algorithm>
+#include <chrono>
 using namespace NCL;
 using namespace Rendering;
 using namespace CSC8503;
 
-#define SHADOWSIZE 4096
+#define SHADOWSIZE 2048 //per cascade
 
 Matrix4 biasMatrix = Matrix4::Translation(Vector3(0.5, 0.5, 0.5)) * Matrix4::Scale(Vector3(0.5, 0.5, 0.5));
 
-GameTechRenderer::GameTechRenderer(GameWorld& world) : OGLRenderer(*Window::GetWindow()), gameWorld(world)	{
+const string skyboxFilenames[6] = {
+	"/Cubemap/skyrender0004.png",
+	"/Cubemap/skyrender0001.png",
+	"/Cubemap/skyrender0003.png",
+	"/Cubemap/skyrender0006.png",
+	"/Cubemap/skyrender0002.png",
+	"/Cubemap/skyrender0005.png"
+};
+
+GameTechRenderer::GameTechRenderer(GameWorld& world, AssetManager& assets) : OGLRenderer(*Window::GetWindow()), gameWorld(world), shadowCascades(ShadowCascades::MaxCascades, SHADOWSIZE)	{
+	//The cubemap faces decode on the asset workers while we set up everything else
+	vector<AssetManager::TextureDataHandle> skyboxFaces;
+	for (int i = 0; i < 6; ++i) {
+		skyboxFaces.emplace_back(assets.DecodeTexture(skyboxFilenames[i]));
+	}
+
 	glEnable(GL_DEPTH_TEST);
 
 	shadowShader = new OGLShader("GameTechShadowVert.glsl", "GameTechShadowFrag.glsl");
 
 	glGenTextures(1, &shadowTex);
-	glBindTexture(GL_TEXTURE_2D, shadowTex);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-			     SHADOWSIZE, SHADOWSIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowTex);
+	glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT,
+			     SHADOWSIZE, SHADOWSIZE, shadowCascades.GetCascadeCount(), 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_R_TO_TEXTURE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	//Each shadow pass attaches its own cascade's layer
 	glGenFramebuffers(1, &shadowFBO);
 	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,GL_TEXTURE_2D, shadowTex, 0);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowTex, 0, 0);
 	glDrawBuffer(GL_NONE);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -49,34 +70,39 @@ GameTechRenderer::GameTechRenderer(GameWorld& world) : OGLRenderer(*Window::GetW
 	skyboxMesh->SetVertexIndices({ 0,1,2,2,3,0 });
 	skyboxMesh->UploadToGPU();
 
-	LoadSkybox();
+	skyboxTex = 0;
+	LoadSkybox(skyboxFaces);
+
+	lodPixelError = 1.0f;
+
+	instanceBuffer = new OGLStreamBuffer(1024 * sizeof(InstanceData));
+
+	GLint uniformAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	uniformBuffer = new OGLStreamBuffer(16 * 1024, std::max(uniformAlignment, 16));
 }
 
 GameTechRenderer::~GameTechRenderer()	{
 	glDeleteTextures(1, &shadowTex);
 	glDeleteFramebuffers(1, &shadowFBO);
-}
+	glDeleteTextures(1, &skyboxTex);
 
-void GameTechRenderer::LoadSkybox() {
-	string filenames[6] = {
-		"/Cubemap/skyrender0004.png",
-		"/Cubemap/skyrender0001.png",
-		"/Cubemap/skyrender0003.png",
-		"/Cubemap/skyrender0006.png",
-		"/Cubemap/skyrender0002.png",
-		"/Cubemap/skyrender0005.png"
-	};
-
-	int width[6]	= { 0 };
-	int height[6]	= { 0 };
-	int channels[6] = { 0 };
-	int flags[6]	= { 0 };
+	delete shadowShader;
+	delete skyboxShader;
+	delete skyboxMesh;
+	delete instanceBuffer;
+	delete uniformBuffer;
+}
 
-	vector<char*> texData(6, nullptr);
+void GameTechRenderer::LoadSkybox(const vector<AssetManager::TextureDataHandle>& faces) {
+	vector<std::shared_ptr<TextureData>> texData;
 
 	for (int i = 0; i < 6; ++i) {
-		TextureLoader::LoadTexture(filenames[i], texData[i], width[i], height[i], channels[i], flags[i]);
-		if (i > 0 && (width[i] != width[0] || height[0] != height[0])) {
+		texData.emplace_back(faces[i].get());
+		if (!texData[i]->data) {
+			return;
+		}
+		if (i > 0 && (texData[i]->width != texData[0]->width || texData[i]->height != texData[0]->height)) {
 			std::cout << __FUNCTION__ << " cubemap input textures don't match in size?\n";
 			return;
 		}
@@ -84,10 +110,10 @@ void GameTechRenderer::LoadSkybox() {
 	glGenTextures(1, &skyboxTex);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
 
-	GLenum type = channels[0] == 4 ? GL_RGBA : GL_RGB;
+	GLenum type = texData[0]->channels == 4 ? GL_RGBA : GL_RGB;
 
 	for (int i = 0; i < 6; ++i) {
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width[i], height[i], 0, type, GL_UNSIGNED_BYTE, texData[i]);
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, texData[i]->width, texData[i]->height, 0, type, GL_UNSIGNED_BYTE, texData[i]->data);
 	}
 
 	glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -100,35 +126,298 @@ void GameTechRenderer::LoadSkybox() {
 void GameTechRenderer::RenderFrame() {
 	glEnable(GL_CULL_FACE);
 	glClearColor(1, 1, 1, 1);
+	stateTracker.BeginFrame();
 	BuildObjectList();
-	SortObjectList();
-	RenderShadowMap();
-	RenderSkybox();
-	RenderCamera();
+	UpdateShadowCascades();
+	RecordCommands();
+	commandQueue.Merge(commandBuffers);
+
+	//Every command ends up as one instance, and each pass's instances start on a fresh alignment boundary
+	instanceBuffer->BeginFrame();
+	instanceBuffer->Reserve(commandQueue.GetCommandCount() * sizeof(InstanceData) + PassCount * instanceBuffer->GetAlignment());
+
+	//There's never more than one batch per command, plus each shadow pass's shared draw block
+	size_t drawBlockSize = uniformBuffer->AlignedSize(sizeof(DrawUniforms));
+	uniformBuffer->BeginFrame();
+	uniformBuffer->Reserve(uniformBuffer->AlignedSize(sizeof(FrameUniforms)) + (commandQueue.GetCommandCount() + PassCount) * drawBlockSize);
+	UpdateFrameUniforms();
+
+	Submit(commandQueue, PassCount);
+	instanceBuffer->EndFrame();
+	uniformBuffer->EndFrame();
 	glDisable(GL_CULL_FACE); //Todo - text indices are going the wrong way...
 }
 
+/*
+Every active object, its mesh bounds in world space, and the IDs its draw
+keys are built from - DrawKeyIDs can't be shared between threads, so they're
+all looked up here, before any recording starts.
+*/
 void GameTechRenderer::BuildObjectList() {
-	activeObjects.clear();
+	candidateObjects.clear();
+	candidateBounds.Clear();
+	candidateIDs.clear();
 
 	gameWorld.OperateOnContents(
 		[&](GameObject* o) {
 			if (o->IsActive()) {
 				const RenderObject* g = o->GetRenderObject();
-				if (g) {
-					activeObjects.emplace_back(g);
+				if (g && g->GetMesh()) {
+					Vector3 boundsMin;
+					Vector3 boundsMax;
+					g->GetMesh()->GetLocalBounds(boundsMin, boundsMax);
+					candidateObjects.emplace_back(g);
+					candidateBounds.AddTransformedAABB(boundsMin, boundsMax, g->GetTransform()->GetMatrix());
+					candidateIDs.push_back({ shaderIDs.Get(g->GetShader()), textureIDs.Get(g->GetDefaultTexture()), meshIDs.Get(g->GetMesh()) });
 				}
 			}
 		}
 	);
 }
 
-void GameTechRenderer::SortObjectList() {
-	//Who cares!
+/*
+The cascades split up everything the camera can see, out to its far plane.
+They need a single direction to look down, so the light is treated as the
+sun here - shining from its position towards the middle of the world.
+*/
+void GameTechRenderer::UpdateShadowCascades() {
+	float	screenAspect	= (float)currentWidth / (float)currentHeight;
+	Camera* camera			= gameWorld.GetMainCamera();
+	Vector3 lightDirection	= (-lightPosition).Normalised();
+
+	shadowCascades.Update(camera->BuildViewMatrix(), camera->GetFieldOfVision(), screenAspect,
+		camera->GetNearPlane(), camera->GetFarPlane(), lightDirection);
+}
+
+//How many pixels tall something one unit across and one unit away is
+float GameTechRenderer::LODPixelsPerUnit() const {
+	float fov = gameWorld.GetMainCamera()->GetFieldOfVision();
+	return currentHeight / (2.0f * tan(Maths::DegreesToRadians(fov) * 0.5f));
 }
 
-void GameTechRenderer::RenderShadowMap() {
+/*
+The biggest occluders the camera can see - the ones covering the most of
+the screen, by how big their bounds are for how far away - are drawn into
+the occlusion buffer, before any recording starts. Transparent objects
+can't hide anything, whether or not they're marked as occluders.
+*/
+void GameTechRenderer::UpdateOcclusion(const Frustum& cameraFrustum, const Matrix4& viewProj, const Vector3& cameraPos) {
+	occluderCandidates.clear();
+	for (size_t i = 0; i < candidateObjects.size(); ++i) {
+		const RenderObject* o = candidateObjects[i];
+		if (!o->IsOccluder() || o->GetColour().w < 1.0f) {
+			continue;
+		}
+		Vector3 centre	= candidateBounds.GetCentre(i);
+		float	radius	= candidateBounds.GetRadius(i);
+		if (cameraFrustum.SphereInside(centre, radius)) {
+			float distance = std::max((centre - cameraPos).LengthSquared(), 1.0f);
+			occluderCandidates.emplace_back(radius * radius / distance, i);
+		}
+	}
+	size_t count = std::min(occluderCandidates.size(), MaxOccluders);
+	std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + count, occluderCandidates.end(),
+		std::greater<std::pair<float, size_t>>());
+
+	occlusionBuffer.Begin(viewProj);
+	for (size_t k = 0; k < count; ++k) {
+		const RenderObject* o = candidateObjects[occluderCandidates[k].second];
+		Vector3 boundsMin;
+		Vector3 boundsMax;
+		o->GetMesh()->GetLocalBounds(boundsMin, boundsMax);
+		occlusionBuffer.AddOccluder(boundsMin, boundsMax, o->GetTransform()->GetMatrix());
+	}
+	occlusionBuffer.Rasterise();
+}
+
+/*
+The object list is split into a fixed range per thread, and each thread
+culls, picks LODs and records commands for its range into its own buffer.
+Objects are tested against the camera's frustum, then the occlusion buffer,
+and separately against each shadow cascade's frustum - things just off screen
+or hidden behind walls can still cast shadows onto what's visible, and each
+cascade only draws the casters that can land in its slice of the view.
+
+Camera commands are keyed to group by shader, then texture, then mesh, and
+go front to back within each group - transparent objects come last, back to
+front. The shadow maps only have one shader and no textures, so their
+commands are just grouped by mesh, front to back from the light.
+*/
+void GameTechRenderer::RecordCommands() {
+	const size_t objectCount = candidateObjects.size();
+	const size_t bufferCount = ParallelThreadCount(objectCount, RecordBatchSize);
+	const size_t rangeSize	 = (objectCount + bufferCount - 1) / bufferCount;
+	const int	 cascadeCount = shadowCascades.GetCascadeCount();
+
+	commandBuffers.resize(bufferCount);
+	rangeOccluded.assign(bufferCount, 0);
+	rangeOcclusionMS.assign(bufferCount, 0.0f);
+	cameraVisible.resize(objectCount);
+	for (int c = 0; c < cascadeCount; ++c) {
+		cascadeVisible[c].resize(objectCount);
+	}
+
+	float screenAspect = (float)currentWidth / (float)currentHeight;
+	Matrix4 viewMatrix = gameWorld.GetMainCamera()->BuildViewMatrix();
+	Matrix4 projMatrix = gameWorld.GetMainCamera()->BuildProjectionMatrix(screenAspect);
+
+	Frustum cameraFrustum(projMatrix * viewMatrix);
+
+	//Shadows use the same LODs as the main view, so objects don't self shadow
+	Vector3 cameraPos		= gameWorld.GetMainCamera()->GetPosition();
+	float	pixelsPerUnit	= LODPixelsPerUnit();
+
+	auto occluderStart = std::chrono::high_resolution_clock::now();
+	UpdateOcclusion(cameraFrustum, projMatrix * viewMatrix, cameraPos);
+	float occluderMS = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - occluderStart).count();
+
+	ParallelFor(bufferCount, 1, [&](size_t firstBuffer, size_t lastBuffer) {
+		for (size_t b = firstBuffer; b < lastBuffer; ++b) {
+			size_t begin	= std::min(objectCount, b * rangeSize);
+			size_t end		= std::min(objectCount, begin + rangeSize);
+
+			RenderCommandBuffer& buffer = commandBuffers[b];
+			buffer.Reset();
+
+			cameraFrustum.CullAABBs(candidateBounds, cameraVisible.data(), begin, end);
+
+			auto testStart = std::chrono::high_resolution_clock::now();
+			rangeOccluded[b]	= occlusionBuffer.CullAABBs(candidateBounds, cameraVisible.data(), begin, end);
+			rangeOcclusionMS[b]	= std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - testStart).count();
+			for (int c = 0; c < cascadeCount; ++c) {
+				shadowCascades.GetCascade(c).frustum.CullAABBs(candidateBounds, cascadeVisible[c].data(), begin, end);
+			}
+
+			for (size_t i = begin; i < end; ++i) {
+				bool castsShadow = false;
+				for (int c = 0; c < cascadeCount; ++c) {
+					castsShadow |= cascadeVisible[c][i] != 0;
+				}
+				if (!cameraVisible[i] && !castsShadow) {
+					continue;
+				}
+				const RenderObject*	o			= candidateObjects[i];
+				const CandidateIDs&	ids			= candidateIDs[i];
+				Matrix4				modelMatrix	= o->GetTransform()->GetMatrix();
+				Vector3				position	= o->GetTransform()->GetPosition();
+				int					lodLevel	= o->SelectLOD(cameraPos, pixelsPerUnit, lodPixelError);
+
+				float lightDepth = (position - lightPosition).LengthSquared();
+				for (int cascade = 0; cascade < cascadeCount; ++cascade) {
+					if (!cascadeVisible[cascade][i]) {
+						continue;
+					}
+					DrawMeshCommand& c = buffer.Record<DrawMeshCommand>(DrawKey::Make(ShadowPass + cascade, 0, 0, ids.mesh, lightDepth));
+					c.shader		= shadowShader;
+					c.texture		= nullptr;
+					c.mesh			= o->GetMesh();
+					c.lodLevel		= lodLevel;
+					c.modelMatrix	= modelMatrix;
+					c.colour		= o->GetColour();
+				}
+				if (cameraVisible[i]) {
+					bool	transparent = o->GetColour().w < 1.0f;
+					float	depth		= (position - cameraPos).LengthSquared();
+					DrawMeshCommand& c = buffer.Record<DrawMeshCommand>(DrawKey::Make(transparent ? TransparentPass : OpaquePass,
+						ids.shader, ids.texture, ids.mesh, depth, transparent));
+					c.shader		= o->GetShader();
+					c.texture		= o->GetDefaultTexture();
+					c.mesh			= o->GetMesh();
+					c.lodLevel		= lodLevel;
+					c.modelMatrix	= modelMatrix;
+					c.colour		= o->GetColour();
+				}
+			}
+		}
+	});
+
+	size_t cameraDrawn = std::count(cameraVisible.begin(), cameraVisible.end(), 1);
+	size_t shadowDrawn = 0;
+	for (size_t i = 0; i < objectCount; ++i) {
+		for (int c = 0; c < cascadeCount; ++c) {
+			if (cascadeVisible[c][i]) {
+				shadowDrawn++;
+				break;
+			}
+		}
+	}
+
+	cullingStats.objects		= objectCount;
+	cullingStats.cameraDrawn	= cameraDrawn;
+	cullingStats.cameraCulled	= objectCount - cameraDrawn;
+	cullingStats.occluders		= occlusionBuffer.GetStats().occluders;
+	cullingStats.occluded		= 0;
+	cullingStats.occluderMS		= occluderMS;
+	cullingStats.occlusionMS	= 0.0f;
+	for (size_t b = 0; b < bufferCount; ++b) {
+		cullingStats.occluded		+= rangeOccluded[b];
+		cullingStats.occlusionMS	+= rangeOcclusionMS[b];
+	}
+	cullingStats.shadowDrawn	= shadowDrawn;
+	cullingStats.shadowCulled	= objectCount - shadowDrawn;
+	cullingStats.cascadeCount	= cascadeCount;
+	for (int c = 0; c < cascadeCount; ++c) {
+		cullingStats.cascadeCasters[c] = std::count(cascadeVisible[c].begin(), cascadeVisible[c].end(), 1);
+	}
+}
+
+void GameTechRenderer::UpdateFrameUniforms() {
+	float screenAspect = (float)currentWidth / (float)currentHeight;
+	Camera* camera = gameWorld.GetMainCamera();
+
+	FrameUniforms frame;
+	frame.viewMatrix	= camera->BuildViewMatrix();
+	frame.projMatrix	= camera->BuildProjectionMatrix(screenAspect);
+	frame.cameraPos		= Vector4(camera->GetPosition(), 1.0f);
+	frame.lightPos		= Vector4(lightPosition, lightRadius);
+	frame.lightColour	= lightColour;
+	frame.cascadeCount	= shadowCascades.GetCascadeCount();
+	frame.padding[0]	= frame.padding[1] = frame.padding[2] = 0;
+
+	float splits[ShadowCascades::MaxCascades] = {};
+	for (int c = 0; c < frame.cascadeCount; ++c) {
+		const ShadowCascade& cascade = shadowCascades.GetCascade(c);
+		frame.lightViewProj[c]	= cascade.viewProj;
+		frame.shadowMatrices[c]	= biasMatrix * cascade.viewProj;
+		splits[c]				= cascade.splitFar;
+	}
+	frame.cascadeSplits = Vector4(splits[0], splits[1], splits[2], splits[3]);
+
+	size_t offset = uniformBuffer->Write(&frame, sizeof(FrameUniforms));
+	glBindBufferRange(GL_UNIFORM_BUFFER, FrameBlockBinding, uniformBuffer->GetBuffer(), offset, sizeof(FrameUniforms));
+}
+
+/*
+Commands arrive in key order, a pass at a time. Each one just adds an
+instance to the batcher, and the batches are drawn when the pass ends.
+*/
+void GameTechRenderer::BeginPass(unsigned int pass) {
+	instanceBatcher.Clear();
+	if (pass < OpaquePass) {
+		BeginShadowPass(pass - ShadowPass);
+	}
+	else if (pass == OpaquePass) {
+		RenderSkybox();
+		BeginCameraPass();
+	}
+}
+
+void GameTechRenderer::Execute(const DrawMeshCommand& command) {
+	instanceBatcher.Add(command.shader, command.texture, command.mesh, command.lodLevel, command.modelMatrix, command.colour);
+}
+
+void GameTechRenderer::EndPass(unsigned int pass) {
+	if (pass < OpaquePass) {
+		EndShadowPass();
+	}
+	else {
+		DrawCameraBatches();
+	}
+}
+
+void GameTechRenderer::BeginShadowPass(int cascade) {
 	glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowTex, 0, cascade);
 	glClear(GL_DEPTH_BUFFER_BIT);
 	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 	glViewport(0, 0, SHADOWSIZE, SHADOWSIZE);
@@ -136,23 +425,28 @@ void GameTechRenderer::RenderShadowMap() {
 	glCullFace(GL_FRONT);
 
 	BindShader(shadowShader);
-	int mvpLocation = glGetUniformLocation(shadowShader->GetProgramID(), "mvpMatrix");
-
-	Matrix4 shadowViewMatrix = Matrix4::BuildViewMatrix(lightPosition, Vector3(0, 0, 0), Vector3(0,1,0));
-	Matrix4 shadowProjMatrix = Matrix4::Perspective(100.0f, 500.0f, 1, 45.0f);
-
-	Matrix4 mvMatrix = shadowProjMatrix * shadowViewMatrix;
+	stateTracker.Invalidate();
+	stateTracker.ShaderChange(shadowShader);
+
+	//The cascades' matrices come from the frame block, and the model matrices from the instance buffer
+	DrawUniforms draw;
+	draw.objectColour		= Vector4(1, 1, 1, 1);
+	draw.hasVertexColours	= 0;
+	draw.hasTexture			= 0;
+	draw.useInstancing		= 1;
+	draw.shadowCascade		= cascade;
+
+	size_t offset = uniformBuffer->Write(&draw, sizeof(DrawUniforms));
+	glBindBufferRange(GL_UNIFORM_BUFFER, DrawBlockBinding, uniformBuffer->GetBuffer(), offset, sizeof(DrawUniforms));
+}
 
-	shadowMatrix = biasMatrix * mvMatrix; //we'll use this one later on
+void GameTechRenderer::EndShadowPass() {
+	const vector<InstanceData>& instances = instanceBatcher.GetInstances();
+	if (!instances.empty()) {
+		size_t instanceOffset = instanceBuffer->Write(instances.data(), instances.size() * sizeof(InstanceData));
 
-	for (const auto&i : activeObjects) {
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-		Matrix4 mvpMatrix	= mvMatrix * modelMatrix;
-		glUniformMatrix4fv(mvpLocation, 1, false, (float*)&mvpMatrix);
-		BindMesh((*i).GetMesh());
-		int layerCount = (*i).GetMesh()->GetSubMeshCount();
-		for (int i = 0; i < layerCount; ++i) {
-			DrawBoundMesh(i);
+		for (const InstanceBatch& b : instanceBatcher.GetBatches()) {
+			DrawInstanceBatch(b, instanceOffset);
 		}
 	}
 
@@ -163,25 +457,29 @@ void GameTechRenderer::RenderShadowMap() {
 	glCullFace(GL_BACK);
 }
 
+void GameTechRenderer::DrawInstanceBatch(const InstanceBatch& batch, size_t instanceOffset) {
+	MeshGeometry* mesh = (MeshGeometry*)batch.mesh;
+	if (stateTracker.MeshChange(mesh)) {
+		BindMesh(mesh);
+	}
+	BindInstanceBuffer(instanceBuffer->GetBuffer(), instanceOffset + batch.firstInstance * sizeof(InstanceData), sizeof(InstanceData));
+
+	int layerCount = mesh->GetSubMeshCount();
+	for (int i = 0; i < layerCount; ++i) {
+		DrawBoundMesh(i, batch.instanceCount, batch.lodLevel);
+		stateTracker.CountDraw(batch.instanceCount);
+	}
+}
+
 void GameTechRenderer::RenderSkybox() {
 	glDisable(GL_CULL_FACE);
 	glDisable(GL_BLEND);
 	glDisable(GL_DEPTH_TEST);
 
-	float screenAspect = (float)currentWidth / (float)currentHeight;
-	Matrix4 viewMatrix = gameWorld.GetMainCamera()->BuildViewMatrix();
-	Matrix4 projMatrix = gameWorld.GetMainCamera()->BuildProjectionMatrix(screenAspect);
-
+	//The camera's matrices come from the frame block
 	BindShader(skyboxShader);
 
-	int projLocation = glGetUniformLocation(skyboxShader->GetProgramID(), "projMatrix");
-	int viewLocation = glGetUniformLocation(skyboxShader->GetProgramID(), "viewMatrix");
-	int texLocation  = glGetUniformLocation(skyboxShader->GetProgramID(), "cubeTex");
-
-	glUniformMatrix4fv(projLocation, 1, false, (float*)&projMatrix);
-	glUniformMatrix4fv(viewLocation, 1, false, (float*)&viewMatrix);
-
-	glUniform1i(texLocation, 0);
+	glUniform1i(skyboxShader->GetUniformLocation("cubeTex"), 0);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTex);
 
@@ -193,81 +491,54 @@ void GameTechRenderer::RenderSkybox() {
 	glEnable(GL_DEPTH_TEST);
 }
 
-void GameTechRenderer::RenderCamera() {
-	float screenAspect = (float)currentWidth / (float)currentHeight;
-	Matrix4 viewMatrix = gameWorld.GetMainCamera()->BuildViewMatrix();
-	Matrix4 projMatrix = gameWorld.GetMainCamera()->BuildProjectionMatrix(screenAspect);
-
-	OGLShader* activeShader = nullptr;
-	int projLocation	= 0;
-	int viewLocation	= 0;
-	int modelLocation	= 0;
-	int colourLocation  = 0;
-	int hasVColLocation = 0;
-	int hasTexLocation  = 0;
-	int shadowLocation  = 0;
-
-	int lightPosLocation	= 0;
-	int lightColourLocation = 0;
-	int lightRadiusLocation = 0;
-
-	int cameraLocation = 0;
-
+void GameTechRenderer::BeginCameraPass() {
 	glActiveTexture(GL_TEXTURE0 + 1);
-	glBindTexture(GL_TEXTURE_2D, shadowTex);
-
-	for (const auto&i : activeObjects) {
-		OGLShader* shader = (OGLShader*)(*i).GetShader();
-		BindShader(shader);
-
-		BindTextureToShader((OGLTexture*)(*i).GetDefaultTexture(), "mainTex", 0);
-
-		if (activeShader != shader) {
-			projLocation	= glGetUniformLocation(shader->GetProgramID(), "projMatrix");
-			viewLocation	= glGetUniformLocation(shader->GetProgramID(), "viewMatrix");
-			modelLocation	= glGetUniformLocation(shader->GetProgramID(), "modelMatrix");
-			shadowLocation  = glGetUniformLocation(shader->GetProgramID(), "shadowMatrix");
-			colourLocation  = glGetUniformLocation(shader->GetProgramID(), "objectColour");
-			hasVColLocation = glGetUniformLocation(shader->GetProgramID(), "hasVertexColours");
-			hasTexLocation  = glGetUniformLocation(shader->GetProgramID(), "hasTexture");
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowTex);
 
-			lightPosLocation	= glGetUniformLocation(shader->GetProgramID(), "lightPos");
-			lightColourLocation = glGetUniformLocation(shader->GetProgramID(), "lightColour");
-			lightRadiusLocation = glGetUniformLocation(shader->GetProgramID(), "lightRadius");
-
-			cameraLocation = glGetUniformLocation(shader->GetProgramID(), "cameraPos");
-			glUniform3fv(cameraLocation, 1, (float*)&gameWorld.GetMainCamera()->GetPosition());
-
-			glUniformMatrix4fv(projLocation, 1, false, (float*)&projMatrix);
-			glUniformMatrix4fv(viewLocation, 1, false, (float*)&viewMatrix);
-
-			glUniform3fv(lightPosLocation	, 1, (float*)&lightPosition);
-			glUniform4fv(lightColourLocation, 1, (float*)&lightColour);
-			glUniform1f(lightRadiusLocation , lightRadius);
-
-			int shadowTexLocation = glGetUniformLocation(shader->GetProgramID(), "shadowTex");
-			glUniform1i(shadowTexLocation, 1);
+	//The skybox has been binding things since the shadow pass
+	stateTracker.Invalidate();
+}
 
-			activeShader = shader;
+void GameTechRenderer::DrawCameraBatches() {
+	const vector<InstanceData>&		instances	= instanceBatcher.GetInstances();
+	const vector<InstanceBatch>&	batches		= instanceBatcher.GetBatches();
+	if (instances.empty()) {
+		return;
+	}
+	size_t instanceOffset = instanceBuffer->Write(instances.data(), instances.size() * sizeof(InstanceData));
+
+	//Each batch gets its own draw block, all written in one go
+	drawUniforms.resize(batches.size());
+	for (size_t i = 0; i < batches.size(); ++i) {
+		DrawUniforms& d = drawUniforms[i];
+		d.objectColour		= Vector4(1, 1, 1, 1);
+		d.hasVertexColours	= !((MeshGeometry*)batches[i].mesh)->GetColourData().empty();
+		d.hasTexture		= batches[i].texture ? 1 : 0;
+		d.useInstancing		= 1;
+		d.shadowCascade		= 0;
+	}
+	size_t drawStride = uniformBuffer->AlignedSize(sizeof(DrawUniforms));
+	PackUniformArray(drawUniforms.data(), drawUniforms.size(), drawStride, packedUniforms);
+	size_t drawOffset = uniformBuffer->Write(packedUniforms.data(), packedUniforms.size());
+
+	for (size_t i = 0; i < batches.size(); ++i) {
+		const InstanceBatch& b = batches[i];
+
+		OGLShader* shader = (OGLShader*)b.shader;
+		if (stateTracker.ShaderChange(shader)) {
+			BindShader(shader);
+			glUniform1i(shader->GetUniformLocation("mainTex"), 0);
+			glUniform1i(shader->GetUniformLocation("shadowTex"), 1);
 		}
 
-		Matrix4 modelMatrix = (*i).GetTransform()->GetMatrix();
-		glUniformMatrix4fv(modelLocation, 1, false, (float*)&modelMatrix);			
-		
-		Matrix4 fullShadowMat = shadowMatrix * modelMatrix;
-		glUniformMatrix4fv(shadowLocation, 1, false, (float*)&fullShadowMat);
-
-		glUniform4fv(colourLocation, 1, (float*)&i->GetColour());
-
-		glUniform1i(hasVColLocation, !(*i).GetMesh()->GetColourData().empty());
-
-		glUniform1i(hasTexLocation, (OGLTexture*)(*i).GetDefaultTexture() ? 1:0);
-
-		BindMesh((*i).GetMesh());
-		int layerCount = (*i).GetMesh()->GetSubMeshCount();
-		for (int i = 0; i < layerCount; ++i) {
-			DrawBoundMesh(i);
+		const OGLTexture* texture = (const OGLTexture*)b.texture;
+		if (stateTracker.TextureChange(0, texture)) {
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture ? texture->GetObjectID() : 0);
 		}
+		glBindBufferRange(GL_UNIFORM_BUFFER, DrawBlockBinding, uniformBuffer->GetBuffer(), drawOffset + i * drawStride, sizeof(DrawUniforms));
+
+		DrawInstanceBatch(b, instanceOffset);
 	}
 }
 
@@ -3,6 +3,15 @@
 #include "../../Plugins/OpenGLRendering/OGLShader.h"
 #include "../../Plugins/OpenGLRendering/OGLTexture.h"
 #include "../../Plugins/OpenGLRendering/OGLMesh.h"
+#include "../../Plugins/OpenGLRendering/OGLStreamBuffer.h"
+#include "../../Common/AssetManager.h"
+#include "../../Common/Frustum.h"
+#include "../../Common/RenderSorting.h"
+#include "../../Common/InstanceBatcher.h"
+#include "../../Common/RenderCommands.h"
+#include "../../Common/UniformData.h"
+#include "../../Common/ShadowCascades.h"
+#include "../../Common/OcclusionBuffer.h"
 
 #include "../CSC8503Common/GameWorld.h"
 
@@ -12,14 +21,56 @@ namespace NCL {
 	namespace CSC8503 {
 		class RenderObject;
 
-		class GameTechRenderer : public OGLRenderer	{
+		//How many objects survived frustum and occlusion culling last frame, for the main view and the shadow maps
+		struct CullingStats {
+			size_t objects		= 0;
+			size_t cameraDrawn	= 0;
+			size_t cameraCulled	= 0;
+			size_t occluders	= 0;
+			size_t occluded		= 0;	//inside the camera's frustum, but hidden by occluders
+			float  occluderMS	= 0.0f;	//picking and drawing occluders
+			float  occlusionMS	= 0.0f;	//testing objects against them, summed over every thread
+			size_t shadowDrawn	= 0;	//cast a shadow into at least one cascade
+			size_t shadowCulled	= 0;
+			size_t cascadeCount	= 0;
+			size_t cascadeCasters[ShadowCascades::MaxCascades] = {};
+		};
+
+		class GameTechRenderer : public OGLRenderer, public RenderBackend	{
 		public:
-			GameTechRenderer(GameWorld& world);
+			GameTechRenderer(GameWorld& world, AssetManager& assets);
 			~GameTechRenderer();
 
+			const CullingStats& GetCullingStats() const {
+				return cullingStats;
+			}
+
+			//Binds and draws made last frame, by the shadow and camera passes
+			const RenderStateStats& GetRenderStateStats() const {
+				return stateTracker.GetStats();
+			}
+
 		protected:
+			//The pass bits of each command's DrawKey
+			enum RenderPass {
+				ShadowPass,		//one per cascade, starting here
+				OpaquePass = ShadowPass + ShadowCascades::MaxCascades,
+				TransparentPass,
+				PassCount
+			};
+
+			//Objects per thread before recording is worth splitting up
+			static const size_t RecordBatchSize = 256;
+
+			//The most occluders drawn into the occlusion buffer each frame
+			static const size_t MaxOccluders = 64;
+
 			void RenderFrame()	override;
 
+			void BeginPass(unsigned int pass)				override;
+			void EndPass(unsigned int pass)					override;
+			void Execute(const DrawMeshCommand& command)	override;
+
 			Matrix4 SetupDebugLineMatrix()	const override;
 			Matrix4 SetupDebugStringMatrix()const override;
 
@@ -28,24 +79,67 @@ namespace NCL {
 			GameWorld&	gameWorld;
 
 			void BuildObjectList();
-			void SortObjectList();
-			void RenderShadowMap();
-			void RenderCamera(); 
+			void RecordCommands();
+			void UpdateShadowCascades();
+			void UpdateOcclusion(const Frustum& cameraFrustum, const Matrix4& viewProj, const Vector3& cameraPos);
+			void UpdateFrameUniforms();
+			float LODPixelsPerUnit() const;
+			void BeginShadowPass(int cascade);
+			void EndShadowPass();
+			void DrawInstanceBatch(const InstanceBatch& batch, size_t instanceOffset);
+			void BeginCameraPass();
+			void DrawCameraBatches();
 			void RenderSkybox();
 
-			void LoadSkybox();
+			void LoadSkybox(const vector<AssetManager::TextureDataHandle>& faces);
+
+			struct CandidateIDs {
+				unsigned int shader;
+				unsigned int texture;
+				unsigned int mesh;
+			};
+
+			//Every active object this frame, its world space bounds, and whether each view can see it
+			vector<const RenderObject*> candidateObjects;
+			CullingBounds				candidateBounds;
+			vector<CandidateIDs>		candidateIDs;
+			vector<char>				cameraVisible;
+			vector<char>				cascadeVisible[ShadowCascades::MaxCascades];
+			CullingStats				cullingStats;
+
+			//The camera's view of the biggest occluders, drawn on the CPU
+			OcclusionBuffer				occlusionBuffer;
+			vector<std::pair<float, size_t>> occluderCandidates;
+			vector<size_t>				rangeOccluded;		//per recording thread
+			vector<float>				rangeOcclusionMS;
+
+			DrawKeyIDs					shaderIDs;
+			DrawKeyIDs					textureIDs;
+			DrawKeyIDs					meshIDs;
+			vector<RenderCommandBuffer>	commandBuffers;	//one per recording thread
+			RenderCommandQueue			commandQueue;
+			RenderStateTracker			stateTracker;
+
+			//Objects sharing a shader, texture, mesh and LOD are drawn in one go
+			InstanceBatcher				instanceBatcher;
+			OGLStreamBuffer*			instanceBuffer;
+
+			//Frame and draw blocks for the shaders, ring buffered across frames
+			OGLStreamBuffer*			uniformBuffer;
+			vector<DrawUniforms>		drawUniforms;
+			vector<char>				packedUniforms;
 
-			vector<const RenderObject*> activeObjects;
+			float		lodPixelError;	//how far a LOD may be off on screen before we switch to a better one
 
 			OGLShader*  skyboxShader;
 			OGLMesh*	skyboxMesh;
 			GLuint		skyboxTex;
 
-			//shadow mapping things
-			OGLShader*	shadowShader;
-			GLuint		shadowTex;
-			GLuint		shadowFBO;
-			Matrix4     shadowMatrix;
+			//shadow mapping things - shadowTex is an array, with a layer per cascade
+			OGLShader*		shadowShader;
+			GLuint			shadowTex;
+			GLuint			shadowFBO;
+			ShadowCascades	shadowCascades;
 
 			Vector4		lightColour;
 			float		lightRadius;
@@ -0,0 +1,518 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "AssetManager.h"
+#include "TextureLoader.h"
+#include "MeshSimplifier.h"
+#include "Assets.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <sys/stat.h>
+
+using namespace NCL;
+using namespace Rendering;
+
+namespace {
+	class NullMesh : public MeshGeometry {
+	public:
+		NullMesh(const std::string& filename) : MeshGeometry(filename) {}
+		void UploadToGPU(Rendering::RendererBase* = nullptr) override {}
+	};
+
+	class NullTexture : public TextureBase {
+	};
+
+	long long GetFileTimestamp(const std::string& path) {
+		struct stat fileInfo;
+		if (stat(path.c_str(), &fileInfo) != 0) {
+			return 0;
+		}
+		return (long long)fileInfo.st_mtime;
+	}
+
+	//FNV-1a over the whole file
+	unsigned long long HashFile(const std::string& path) {
+		std::ifstream file(path, std::ios::binary);
+		unsigned long long hash = 14695981039346656037ULL;
+
+		char buffer[64 * 1024];
+		while (file) {
+			file.read(buffer, sizeof(buffer));
+			std::streamsize count = file.gcount();
+			for (std::streamsize i = 0; i < count; ++i) {
+				hash ^= (unsigned char)buffer[i];
+				hash *= 1099511628211ULL;
+			}
+		}
+		return hash;
+	}
+
+	size_t GetMeshMemorySize(const MeshGeometry* mesh) {
+		return	mesh->GetPositionData().size()		* sizeof(Vector3) +
+				mesh->GetColourData().size()		* sizeof(Vector4) +
+				mesh->GetTextureCoordData().size()	* sizeof(Vector2) +
+				mesh->GetNormalData().size()		* sizeof(Vector3) +
+				mesh->GetTangentData().size()		* sizeof(Vector4) +
+				mesh->GetSkinWeightData().size()	* sizeof(Vector4) +
+				mesh->GetSkinIndexData().size()		* sizeof(Vector4) +
+				mesh->GetLODIndexCount()			* sizeof(unsigned int);
+	}
+
+	std::shared_ptr<TextureData> DecodeTextureFile(const std::string& filename) {
+		auto decoded = std::make_shared<TextureData>();
+		if (!TextureLoader::LoadTexture(filename, decoded->data, decoded->width, decoded->height, decoded->channels, decoded->flags)) {
+			std::cout << __FUNCTION__ << " can't load texture " << filename << std::endl;
+		}
+		return decoded;
+	}
+}
+
+MeshGeometry* NullAssetUploader::CreateMesh(const std::string& filename) {
+	return new NullMesh(filename);
+}
+
+TextureBase* NullAssetUploader::UploadTexture(const TextureData&) {
+	return new NullTexture();
+}
+
+AssetManager::AssetManager(AssetUploader* uploader, int numWorkers) {
+	this->uploader	= uploader;
+	memoryBudget	= 256 * 1024 * 1024;
+	memoryUsage		= 0;
+	requestCounter	= 0;
+	reloadInterval	= 1.0f;
+	reloadTimer		= 0.0f;
+	generateLODs	= false;
+	pendingRequests = 0;
+	shuttingDown	= false;
+
+	if (numWorkers <= 0) {
+		numWorkers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	}
+	for (int i = 0; i < numWorkers; ++i) {
+		workers.emplace_back(&AssetManager::WorkerThread, this);
+	}
+}
+
+AssetManager::~AssetManager() {
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		shuttingDown = true;
+		decodeJobs.clear();
+	}
+	decodeReady.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+	//Anything decoded but never uploaded still has to be freed
+	Update();
+
+	for (auto& i : meshes) {
+		DeleteResource(i.second.get());
+	}
+	for (auto& i : textures) {
+		DeleteResource(i.second.get());
+	}
+	delete uploader;
+}
+
+void AssetManager::WorkerThread() {
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(queueLock);
+			decodeReady.wait(lock, [&] { return shuttingDown || !decodeJobs.empty(); });
+			if (shuttingDown) {
+				return;
+			}
+			job = std::move(decodeJobs.front());
+			decodeJobs.pop_front();
+		}
+		job();
+	}
+}
+
+void AssetManager::QueueDecode(std::function<void()> job) {
+	//queueLock is already held by the caller
+	pendingRequests++;
+	decodeJobs.emplace_back(std::move(job));
+	decodeReady.notify_one();
+}
+
+void AssetManager::QueueUpload(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		uploadJobs.emplace_back(std::move(job));
+	}
+	uploadReady.notify_all();
+}
+
+void AssetManager::CompleteRequest() {
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		pendingRequests--;
+	}
+	uploadReady.notify_all();
+}
+
+AssetManager::MeshHandle AssetManager::LoadMesh(const std::string& filename) {
+	std::lock_guard<std::mutex> lock(queueLock);
+	return MeshHandle(Request(meshes, AssetEntry::Mesh, filename, Assets::MESHDIR + filename));
+}
+
+AssetManager::TextureHandle AssetManager::LoadTexture(const std::string& filename) {
+	std::lock_guard<std::mutex> lock(queueLock);
+	return TextureHandle(Request(textures, AssetEntry::Texture, filename, Assets::TEXTUREDIR + filename));
+}
+
+//queueLock is held by the caller, so the entry can't be evicted before the handle's made
+AssetEntry* AssetManager::Request(EntryMap& entries, AssetEntry::AssetType type, const std::string& filename, const std::string& fullPath) {
+	auto i = entries.find(filename);
+	if (i != entries.end()) {
+		i->second->lastRequested = ++requestCounter;
+		return i->second.get();
+	}
+	AssetEntry* entry		= new AssetEntry();
+	entry->type				= type;
+	entry->filename			= filename;
+	entry->fullPath			= fullPath;
+	entry->lastRequested	= ++requestCounter;
+	entries.emplace(filename, std::unique_ptr<AssetEntry>(entry));
+
+	auto promise	= std::make_shared<std::promise<void*>>();
+	entry->loaded	= promise->get_future().share();
+	QueueLoad(entry, promise);
+
+	return entry;
+}
+
+//Worker thread - creates the CPU side of the asset
+void* AssetManager::DecodeResource(AssetEntry* entry) {
+	if (entry->type == AssetEntry::Mesh) {
+		MeshGeometry* mesh = uploader->CreateMesh(entry->filename);
+		if (generateLODs && mesh->GetLODCount() == 1) {
+			MeshSimplifier::GenerateLODs(*mesh);
+		}
+		return mesh;
+	}
+	TextureData* decoded = new TextureData();
+	if (!TextureLoader::LoadTexture(entry->filename, decoded->data, decoded->width, decoded->height, decoded->channels, decoded->flags)) {
+		std::cout << __FUNCTION__ << " can't load texture " << entry->filename << std::endl;
+	}
+	return decoded;
+}
+
+//Upload thread - turns the output of DecodeResource into the final asset
+void* AssetManager::UploadResource(AssetEntry* entry, void* decoded, size_t& byteSize) {
+	if (entry->type == AssetEntry::Mesh) {
+		MeshGeometry* mesh = (MeshGeometry*)decoded;
+		uploader->UploadMesh(mesh);
+		byteSize = GetMeshMemorySize(mesh);
+		return mesh;
+	}
+	TextureData*	data	= (TextureData*)decoded;
+	TextureBase*	tex		= data->data ? uploader->UploadTexture(*data) : nullptr;
+	byteSize = tex ? TextureLoader::GetDataSize(data->width, data->height, data->flags) : 0;
+	delete data;
+	return tex;
+}
+
+void AssetManager::QueueLoad(AssetEntry* entry, std::shared_ptr<std::promise<void*>> promise) {
+	QueueDecode([this, entry, promise]() {
+		long long			timestamp	= GetFileTimestamp(entry->fullPath);
+		unsigned long long	hash		= HashFile(entry->fullPath);
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			entry->timestamp	= timestamp;
+			entry->contentHash	= hash;
+			if (ShareResource(entry, promise)) {
+				return;
+			}
+		}
+		void* decoded = DecodeResource(entry);
+
+		QueueUpload([this, entry, promise, decoded, timestamp, hash]() {
+			size_t	byteSize = 0;
+			void*	resource = UploadResource(entry, decoded, byteSize);
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				entry->byteSize		= byteSize;
+				entry->timestamp	= timestamp;
+				entry->contentHash	= hash;
+				entry->isReady		= true;
+				memoryUsage += byteSize;
+			}
+			promise->set_value(resource);
+			CompleteRequest();
+
+			std::vector<std::pair<AssetEntry*, std::shared_ptr<std::promise<void*>>>> sharers;
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				sharers.swap(entry->waitingSharers);
+				for (auto& s : sharers) {
+					s.first->isReady = true;
+				}
+			}
+			for (auto& s : sharers) {
+				s.second->set_value(resource);
+				CompleteRequest();
+			}
+			EvictOverBudget();
+		});
+	});
+}
+
+/*
+Worker thread, with queueLock held. Registers the entry as the owner of its
+contents, or if another path got there first, hands this entry that path's
+asset - straight away if it's uploaded, otherwise once it is. The owner is
+retained, so it can't be evicted out from under the entries sharing it.
+*/
+bool AssetManager::ShareResource(AssetEntry* entry, std::shared_ptr<std::promise<void*>> promise) {
+	ContentMap& contents = entry->type == AssetEntry::Mesh ? meshContents : textureContents;
+
+	auto found = contents.find(entry->contentHash);
+	if (found == contents.end()) {
+		contents.emplace(entry->contentHash, entry);
+		return false;
+	}
+	AssetEntry* owner = found->second;
+	owner->refCount++;
+	entry->sharedWith = owner;
+
+	if (owner->isReady) {
+		entry->isReady = true;
+		promise->set_value(owner->loaded.get());
+		pendingRequests--;
+		uploadReady.notify_all();
+	}
+	else {
+		owner->waitingSharers.emplace_back(entry, promise);
+	}
+	return true;
+}
+
+/*
+A new timestamp doesn't always mean new contents (saving without changes,
+checking out the same file), so the contents are hashed first and only
+reloaded if they differ. The new asset is swapped into the old object, so
+every pointer to it picks up the change.
+*/
+void AssetManager::QueueReload(AssetEntry* entry, long long timestamp) {
+	entry->isReloading = true;
+
+	QueueDecode([this, entry, timestamp]() {
+		unsigned long long	hash	= HashFile(entry->fullPath);
+		void*				decoded = (hash != entry->contentHash) ? DecodeResource(entry) : nullptr;
+
+		QueueUpload([this, entry, timestamp, hash, decoded]() {
+			void*	current		= entry->loaded.get();
+			size_t	byteSize	= entry->byteSize;
+			bool	swapped		= false;
+
+			if (decoded) {
+				void* fresh = UploadResource(entry, decoded, byteSize);
+				if (entry->type == AssetEntry::Mesh) {
+					MeshGeometry* mesh = (MeshGeometry*)fresh;
+					//A half written file comes out empty, keep what we have and try again later
+					if (mesh->GetVertexCount() > 0 && current) {
+						((MeshGeometry*)current)->SwapWith(*mesh);
+						swapped = true;
+					}
+					delete mesh;
+				}
+				else {
+					TextureBase* tex = (TextureBase*)fresh;
+					if (tex && current) {
+						((TextureBase*)current)->SwapWith(*tex);
+						swapped = true;
+					}
+					delete tex;
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				if (swapped) {
+					ContentMap& contents = entry->type == AssetEntry::Mesh ? meshContents : textureContents;
+					auto owned = contents.find(entry->contentHash);
+					if (owned != contents.end() && owned->second == entry) {
+						contents.erase(owned);
+					}
+					contents.emplace(hash, entry);
+				}
+				if (!decoded || swapped) {
+					entry->timestamp	= timestamp;
+					entry->contentHash	= hash;
+				}
+				if (swapped) {
+					memoryUsage			= memoryUsage - entry->byteSize + byteSize;
+					entry->byteSize		= byteSize;
+				}
+				entry->isReloading = false;
+			}
+			if (swapped) {
+				std::cout << "Reloaded " << entry->filename << std::endl;
+			}
+			CompleteRequest();
+		});
+	});
+}
+
+void AssetManager::CheckForChanges(float dt) {
+	reloadTimer += dt;
+	if (reloadTimer < reloadInterval) {
+		return;
+	}
+	reloadTimer = 0.0f;
+
+	std::lock_guard<std::mutex> lock(queueLock);
+	for (EntryMap* entries : { &meshes, &textures }) {
+		for (auto& i : *entries) {
+			AssetEntry* entry = i.second.get();
+			if (!entry->isReady || entry->isReloading || entry->sharedWith) {
+				continue;
+			}
+			long long timestamp = GetFileTimestamp(entry->fullPath);
+			if (timestamp != 0 && timestamp != entry->timestamp) {
+				QueueReload(entry, timestamp);
+			}
+		}
+	}
+}
+
+void AssetManager::DeleteResource(AssetEntry* entry) {
+	if (!entry->isReady) {
+		return;
+	}
+	if (entry->sharedWith) {
+		entry->sharedWith->refCount--;
+		return;
+	}
+	ContentMap& contents = entry->type == AssetEntry::Mesh ? meshContents : textureContents;
+	auto owned = contents.find(entry->contentHash);
+	if (owned != contents.end() && owned->second == entry) {
+		contents.erase(owned);
+	}
+	void* resource = entry->loaded.get();
+	if (entry->type == AssetEntry::Mesh) {
+		delete (MeshGeometry*)resource;
+	}
+	else {
+		delete (TextureBase*)resource;
+	}
+}
+
+//Throws out the least recently requested assets that nobody holds a handle to
+void AssetManager::EvictOverBudget() {
+	std::lock_guard<std::mutex> lock(queueLock);
+
+	while (memoryUsage > memoryBudget) {
+		EntryMap*			victimMap	= nullptr;
+		EntryMap::iterator	victim;
+
+		for (EntryMap* entries : { &meshes, &textures }) {
+			for (auto i = entries->begin(); i != entries->end(); ++i) {
+				const AssetEntry* e = i->second.get();
+				if (!e->isReady || e->isReloading || e->refCount > 0) {
+					continue;
+				}
+				if (!victimMap || e->lastRequested < victim->second->lastRequested) {
+					victimMap	= entries;
+					victim		= i;
+				}
+			}
+		}
+		if (!victimMap) {
+			return; //everything left is in use
+		}
+		memoryUsage -= victim->second->byteSize;
+		DeleteResource(victim->second.get());
+		victimMap->erase(victim);
+	}
+}
+
+void AssetManager::SetMemoryBudget(size_t bytes) {
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		memoryBudget = bytes;
+	}
+	EvictOverBudget();
+}
+
+AssetManager::TextureDataHandle AssetManager::DecodeTexture(const std::string& filename) {
+	std::lock_guard<std::mutex> lock(queueLock);
+
+	//Only merged while in flight - we don't want to hang on to the pixels
+	auto i = decodingTextures.find(filename);
+	if (i != decodingTextures.end()) {
+		return i->second;
+	}
+	auto promise				= std::make_shared<std::promise<std::shared_ptr<TextureData>>>();
+	TextureDataHandle handle	= promise->get_future().share();
+	decodingTextures.emplace(filename, handle);
+
+	QueueDecode([this, filename, promise]() {
+		promise->set_value(DecodeTextureFile(filename));
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			decodingTextures.erase(filename);
+		}
+		CompleteRequest();
+	});
+	return handle;
+}
+
+void AssetManager::Update() {
+	std::deque<std::function<void()>> readyJobs;
+	{
+		std::lock_guard<std::mutex> lock(queueLock);
+		readyJobs.swap(uploadJobs);
+	}
+	for (auto& job : readyJobs) {
+		job();
+	}
+}
+
+void AssetManager::WaitForAll() {
+	while (true) {
+		Update();
+
+		std::unique_lock<std::mutex> lock(queueLock);
+		if (pendingRequests == 0) {
+			return;
+		}
+		uploadReady.wait(lock, [&] { return !uploadJobs.empty() || pendingRequests == 0; });
+	}
+}
+
+size_t AssetManager::GetPendingCount() const {
+	std::lock_guard<std::mutex> lock(queueLock);
+	return pendingRequests;
+}
+
+size_t AssetManager::GetMemoryUsage() const {
+	std::lock_guard<std::mutex> lock(queueLock);
+	return memoryUsage;
+}
+
+size_t AssetManager::GetCachedCount() const {
+	std::lock_guard<std::mutex> lock(queueLock);
+	return meshes.size() + textures.size();
+}
+
+size_t AssetManager::GetSharedCount() const {
+	std::lock_guard<std::mutex> lock(queueLock);
+	size_t shared = 0;
+	for (const EntryMap* entries : { &meshes, &textures }) {
+		for (auto& i : *entries) {
+			shared += i.second->sharedWith != nullptr;
+		}
+	}
+	return shared;
+}
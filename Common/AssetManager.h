@@ -0,0 +1,238 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "MeshGeometry.h"
+#include "TextureBase.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+namespace NCL {
+	//A decoded image, still in CPU memory
+	struct TextureData {
+		char*	data		= nullptr;
+		int		width		= 0;
+		int		height		= 0;
+		int		channels	= 0;
+		int		flags		= 0;
+
+		TextureData() {}
+		~TextureData() {
+			free(data);
+		}
+		TextureData(const TextureData&) = delete;
+		TextureData& operator=(const TextureData&) = delete;
+	};
+
+	/*
+	The API specific half of loading - creating the CPU side of a mesh is
+	done on a worker thread, while uploads happen on whichever thread calls
+	AssetManager::Update, which should be the one that owns the API context.
+	*/
+	class AssetUploader {
+	public:
+		virtual ~AssetUploader() {}
+
+		virtual MeshGeometry*			CreateMesh(const std::string& filename) = 0;
+		virtual void					UploadMesh(MeshGeometry* mesh) = 0;
+		virtual Rendering::TextureBase* UploadTexture(const TextureData& data) = 0;
+	};
+
+	//Does the decoding but never touches a GPU, for headless runs and tools
+	class NullAssetUploader : public AssetUploader {
+	public:
+		MeshGeometry*			CreateMesh(const std::string& filename) override;
+		void					UploadMesh(MeshGeometry*) override {}
+		Rendering::TextureBase* UploadTexture(const TextureData& data) override;
+	};
+
+	//One cached file. Handles keep it alive, the manager owns it
+	struct AssetEntry {
+		enum AssetType {
+			Mesh,
+			Texture
+		};
+		AssetType					type;
+		std::string					filename;
+		std::string					fullPath;
+		std::shared_future<void*>	loaded;
+
+		//Set if another path with the same contents was cached first - that
+		//entry owns the asset, and this one holds a reference to it
+		AssetEntry*			sharedWith		= nullptr;
+
+		unsigned long long	contentHash		= 0;
+		long long			timestamp		= 0;
+		size_t				byteSize		= 0;
+		unsigned long long	lastRequested	= 0;
+		bool				isReady			= false; //uploaded and safe to use
+		bool				isReloading		= false;
+		std::atomic<int>	refCount		{ 0 };
+
+		//Entries sharing this one's asset, waiting on it to be uploaded
+		std::vector<std::pair<AssetEntry*, std::shared_ptr<std::promise<void*>>>> waitingSharers;
+	};
+
+	//Reference counted handle to a cached asset
+	template<class T>
+	class AssetHandle {
+	public:
+		AssetHandle() : entry(nullptr) {}
+		explicit AssetHandle(AssetEntry* e) : entry(e) {
+			Retain();
+		}
+		AssetHandle(const AssetHandle& other) : entry(other.entry) {
+			Retain();
+		}
+		AssetHandle(AssetHandle&& other) : entry(other.entry) {
+			other.entry = nullptr;
+		}
+		~AssetHandle() {
+			Release();
+		}
+		AssetHandle& operator=(AssetHandle other) {
+			std::swap(entry, other.entry);
+			return *this;
+		}
+
+		bool IsValid() const {
+			return entry != nullptr;
+		}
+		bool IsReady() const {
+			return entry && entry->loaded.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+		//Blocks until the asset has been uploaded - see AssetManager
+		T* Get() const {
+			return entry ? (T*)entry->loaded.get() : nullptr;
+		}
+
+	protected:
+		void Retain() {
+			if (entry) {
+				entry->refCount++;
+			}
+		}
+		void Release() {
+			if (entry) {
+				entry->refCount--;
+			}
+			entry = nullptr;
+		}
+		AssetEntry* entry;
+	};
+
+	/*
+	Loads meshes and textures on a pool of worker threads, and caches them
+	by path and by a hash of their file contents. Every request returns a
+	handle straight away, and asking for the same file again gives back the
+	cached asset. A new path is hashed before it's decoded, and if the same
+	contents are already cached under another path, the two share one asset
+	rather than it being loaded twice. Decoded assets wait in a queue until
+	Update is called to upload them, at which point their handles become
+	ready - so don't block on a handle from the thread that's meant to be
+	calling Update; use WaitForAll instead.
+
+	Assets nobody holds a handle to are kept around until the cache goes
+	over its memory budget, then evicted least recently requested first.
+	CheckForChanges looks for files that have changed on disk and reloads
+	them in place, so pointers already handed out stay valid. A shared
+	asset is only watched through the path it was first loaded from.
+	*/
+	class AssetManager	{
+	public:
+		typedef AssetHandle<MeshGeometry>							MeshHandle;
+		typedef AssetHandle<Rendering::TextureBase>					TextureHandle;
+		typedef std::shared_future<std::shared_ptr<TextureData>>	TextureDataHandle;
+
+		AssetManager(AssetUploader* uploader, int numWorkers = 0); //takes ownership of the uploader
+		~AssetManager();
+
+		MeshHandle		LoadMesh(const std::string& filename);
+		TextureHandle	LoadTexture(const std::string& filename);
+
+		//Decode only, with no upload stage or caching - safe to wait on from any thread
+		TextureDataHandle DecodeTexture(const std::string& filename);
+
+		//Runs any uploads that are ready, on the calling thread
+		void Update();
+		//Keeps calling Update until every request so far is complete
+		void WaitForAll();
+
+		//Checks file timestamps at most once every reloadInterval seconds
+		void CheckForChanges(float dt);
+
+		void SetMemoryBudget(size_t bytes);
+		void SetReloadInterval(float seconds) {
+			reloadInterval = seconds;
+		}
+		//Builds a LOD chain on the workers for meshes that don't come with one
+		void SetGenerateLODs(bool generate) {
+			generateLODs = generate;
+		}
+
+		size_t GetPendingCount() const;
+		size_t GetMemoryUsage() const;
+		size_t GetCachedCount() const;
+		size_t GetSharedCount() const; //paths using another path's asset
+
+	protected:
+		typedef std::map<std::string, std::unique_ptr<AssetEntry>>	EntryMap;
+		typedef std::map<unsigned long long, AssetEntry*>			ContentMap;
+
+		AssetEntry* Request(EntryMap& entries, AssetEntry::AssetType type, const std::string& filename, const std::string& fullPath);
+
+		void* DecodeResource(AssetEntry* entry);
+		void* UploadResource(AssetEntry* entry, void* decoded, size_t& byteSize);
+		void QueueLoad(AssetEntry* entry, std::shared_ptr<std::promise<void*>> promise);
+		void QueueReload(AssetEntry* entry, long long timestamp);
+		bool ShareResource(AssetEntry* entry, std::shared_ptr<std::promise<void*>> promise);
+		void DeleteResource(AssetEntry* entry);
+		void EvictOverBudget();
+
+		void WorkerThread();
+		void QueueDecode(std::function<void()> job);
+		void QueueUpload(std::function<void()> job);
+		void CompleteRequest();
+
+		AssetUploader* uploader;
+
+		std::vector<std::thread>			workers;
+		std::deque<std::function<void()>>	decodeJobs;
+		std::deque<std::function<void()>>	uploadJobs;
+
+		EntryMap	meshes;
+		EntryMap	textures;
+		ContentMap	meshContents;	//the entry that owns each hash's asset
+		ContentMap	textureContents;
+		std::map<std::string, TextureDataHandle> decodingTextures;
+
+		size_t				memoryBudget;
+		size_t				memoryUsage;
+		unsigned long long	requestCounter;
+		float				reloadInterval;
+		float				reloadTimer;
+		bool				generateLODs;
+
+		size_t	pendingRequests;
+		bool	shuttingDown;
+
+		mutable std::mutex		queueLock;
+		std::condition_variable	decodeReady;
+		std::condition_variable	uploadReady;
+	};
+}
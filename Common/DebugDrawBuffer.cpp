@@ -0,0 +1,310 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "DebugDrawBuffer.h"
+#include "Maths.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Maths;
+
+DebugDrawBuffer::DebugDrawBuffer(size_t maxLineVertices, size_t maxTextChars) {
+	lineVertices.resize(maxLineVertices & ~(size_t)1); //whole lines only
+	lineVertexCount = 0;
+	droppedVertices = 0;
+
+	textChars.resize(maxTextChars);
+	textCharCount = 0;
+	texts.reserve(1024);
+
+	timedShapes.reserve(1024);
+	currentTime = 0.0f;
+
+	for (int i = 0; i <= CircleSegments; ++i) {
+		float angle = (2.0f * PI * (i % CircleSegments)) / CircleSegments;
+		circle[i] = Vector2(cos(angle), sin(angle));
+	}
+}
+
+DebugLineVertex* DebugDrawBuffer::AllocateLines(size_t count) {
+	if (count > lineVertices.size() - lineVertexCount) {
+		droppedVertices += count;
+		return nullptr;
+	}
+	DebugLineVertex* v = lineVertices.data() + lineVertexCount;
+	lineVertexCount += count;
+	return v;
+}
+
+void DebugDrawBuffer::AddTimed(ShapeType type, float time, unsigned int colour, const Vector3& a, const Vector3& b, float size, const Matrix4& transform) {
+	TimedShape s;
+	s.expiry	= currentTime + time;
+	s.type		= type;
+	s.colour	= colour;
+	s.a			= a;
+	s.b			= b;
+	s.size		= size;
+	s.transform = transform;
+
+	timedShapes.emplace_back(s);
+	std::push_heap(timedShapes.begin(), timedShapes.end(), ExpiresLater);
+}
+
+void DebugDrawBuffer::AddLine(const Vector3& start, const Vector3& end, const Vector4& colour, float time) {
+	if (time > 0.0f) {
+		AddTimed(ShapeType::Line, time, PackDebugColour(colour), start, end);
+	}
+	else {
+		WriteLine(start, end, PackDebugColour(colour));
+	}
+}
+
+void DebugDrawBuffer::AddBox(const Vector3& centre, const Vector3& halfSize, const Vector4& colour, float time) {
+	if (time > 0.0f) {
+		AddTimed(ShapeType::Box, time, PackDebugColour(colour), centre, halfSize, 0.0f, Matrix4::Translation(centre) * Matrix4::Scale(halfSize));
+	}
+	else {
+		WriteAABB(centre, halfSize, PackDebugColour(colour));
+	}
+}
+
+void DebugDrawBuffer::AddBox(const Matrix4& transform, const Vector4& colour, float time) {
+	if (time > 0.0f) {
+		AddTimed(ShapeType::Box, time, PackDebugColour(colour), Vector3(), Vector3(), 0.0f, transform);
+	}
+	else {
+		WriteBox(transform, PackDebugColour(colour));
+	}
+}
+
+void DebugDrawBuffer::AddSphere(const Vector3& centre, float radius, const Vector4& colour, float time) {
+	if (time > 0.0f) {
+		AddTimed(ShapeType::Sphere, time, PackDebugColour(colour), centre, Vector3(), radius);
+	}
+	else {
+		WriteSphere(centre, radius, PackDebugColour(colour));
+	}
+}
+
+void DebugDrawBuffer::AddCapsule(const Vector3& start, const Vector3& end, float radius, const Vector4& colour, float time) {
+	if (time > 0.0f) {
+		AddTimed(ShapeType::Capsule, time, PackDebugColour(colour), start, end, radius);
+	}
+	else {
+		WriteCapsule(start, end, radius, PackDebugColour(colour));
+	}
+}
+
+void DebugDrawBuffer::AddArrow(const Vector3& start, const Vector3& end, const Vector4& colour, float time) {
+	if (time > 0.0f) {
+		AddTimed(ShapeType::Arrow, time, PackDebugColour(colour), start, end);
+	}
+	else {
+		WriteArrow(start, end, PackDebugColour(colour));
+	}
+}
+
+void DebugDrawBuffer::AddCross(const Vector3& position, float size, const Vector4& colour, float time) {
+	if (time > 0.0f) {
+		AddTimed(ShapeType::Cross, time, PackDebugColour(colour), position, Vector3(), size);
+	}
+	else {
+		WriteCross(position, size, PackDebugColour(colour));
+	}
+}
+
+void DebugDrawBuffer::AddBoxes(const Vector3* centres, const Vector3* halfSizes, size_t count, const Vector4& colour) {
+	unsigned int packed = PackDebugColour(colour);
+	for (size_t i = 0; i < count; ++i) {
+		WriteAABB(centres[i], halfSizes[i], packed);
+	}
+}
+
+void DebugDrawBuffer::AddText(const std::string& text, const Vector3& position, const Vector4& colour, float size, bool worldSpace, TextUsage usage) {
+	if (text.length() > textChars.size() - textCharCount) {
+		return;
+	}
+	DebugText t;
+	t.position		= position;
+	t.colour		= colour;
+	t.size			= size;
+	t.firstChar		= textCharCount;
+	t.length		= text.length();
+	t.worldSpace	= worldSpace;
+	t.usage			= usage;
+	texts.emplace_back(t);
+
+	memcpy(textChars.data() + textCharCount, text.data(), text.length());
+	textCharCount += text.length();
+}
+
+void DebugDrawBuffer::Update(float dt) {
+	for (const TimedShape& s : timedShapes) {
+		WriteShape(s);
+	}
+	currentTime += dt;
+
+	while (!timedShapes.empty() && timedShapes.front().expiry < currentTime) {
+		std::pop_heap(timedShapes.begin(), timedShapes.end(), ExpiresLater);
+		timedShapes.pop_back();
+	}
+}
+
+void DebugDrawBuffer::Clear() {
+	lastFrameStats.lineVertices		= lineVertexCount;
+	lastFrameStats.textCharacters	= textCharCount;
+	lastFrameStats.timedShapes		= timedShapes.size();
+	lastFrameStats.droppedVertices	= droppedVertices;
+
+	lineVertexCount = 0;
+	droppedVertices = 0;
+	textCharCount	= 0;
+	texts.clear();
+}
+
+void DebugDrawBuffer::WriteShape(const TimedShape& s) {
+	switch (s.type) {
+		case ShapeType::Line:		WriteLine(s.a, s.b, s.colour);				break;
+		case ShapeType::Box:		WriteBox(s.transform, s.colour);			break;
+		case ShapeType::Sphere:		WriteSphere(s.a, s.size, s.colour);			break;
+		case ShapeType::Capsule:	WriteCapsule(s.a, s.b, s.size, s.colour);	break;
+		case ShapeType::Arrow:		WriteArrow(s.a, s.b, s.colour);				break;
+		case ShapeType::Cross:		WriteCross(s.a, s.size, s.colour);			break;
+	}
+}
+
+void DebugDrawBuffer::WriteLine(const Vector3& start, const Vector3& end, unsigned int colour) {
+	if (DebugLineVertex* v = AllocateLines(2)) {
+		v[0] = { start, colour };
+		v[1] = { end,	colour };
+	}
+}
+
+//Corners are numbered so that bit 0 is x, bit 1 is y and bit 2 is z
+void DebugDrawBuffer::WriteBox(const Vector3* corners, unsigned int colour) {
+	static const int edges[24] = {
+		0, 1,	2, 3,	4, 5,	6, 7,	//along x
+		0, 2,	1, 3,	4, 6,	5, 7,	//along y
+		0, 4,	1, 5,	2, 6,	3, 7	//along z
+	};
+	if (DebugLineVertex* v = AllocateLines(24)) {
+		for (int i = 0; i < 24; ++i) {
+			v[i] = { corners[edges[i]], colour };
+		}
+	}
+}
+
+void DebugDrawBuffer::WriteAABB(const Vector3& centre, const Vector3& halfSize, unsigned int colour) {
+	Vector3 corners[8];
+	for (int i = 0; i < 8; ++i) {
+		corners[i] = Vector3(
+			centre.x + (i & 1 ? halfSize.x : -halfSize.x),
+			centre.y + (i & 2 ? halfSize.y : -halfSize.y),
+			centre.z + (i & 4 ? halfSize.z : -halfSize.z));
+	}
+	WriteBox(corners, colour);
+}
+
+void DebugDrawBuffer::WriteBox(const Matrix4& transform, unsigned int colour) {
+	Vector3 centre	= transform.GetPositionVector();
+	Vector3 axisX	= Vector3(transform.array[0], transform.array[1], transform.array[2]);
+	Vector3 axisY	= Vector3(transform.array[4], transform.array[5], transform.array[6]);
+	Vector3 axisZ	= Vector3(transform.array[8], transform.array[9], transform.array[10]);
+
+	Vector3 corners[8];
+	for (int i = 0; i < 8; ++i) {
+		corners[i] = centre + (i & 1 ? axisX : -axisX) + (i & 2 ? axisY : -axisY) + (i & 4 ? axisZ : -axisZ);
+	}
+	WriteBox(corners, colour);
+}
+
+//Part of a circle, in the plane of u and v, a segment at a time
+void DebugDrawBuffer::WriteCircle(const Vector3& centre, const Vector3& u, const Vector3& v, float radius, int firstSegment, int segmentCount, unsigned int colour) {
+	DebugLineVertex* out = AllocateLines(segmentCount * 2);
+	if (!out) {
+		return;
+	}
+	Vector3 ru = u * radius;
+	Vector3 rv = v * radius;
+	Vector3 previous = centre + ru * circle[firstSegment].x + rv * circle[firstSegment].y;
+	for (int i = 1; i <= segmentCount; ++i) {
+		const Vector2& p = circle[firstSegment + i];
+		Vector3 next = centre + ru * p.x + rv * p.y;
+		*out++ = { previous,	colour };
+		*out++ = { next,		colour };
+		previous = next;
+	}
+}
+
+void DebugDrawBuffer::WriteSphere(const Vector3& centre, float radius, unsigned int colour) {
+	WriteCircle(centre, Vector3(1, 0, 0), Vector3(0, 1, 0), radius, 0, CircleSegments, colour);
+	WriteCircle(centre, Vector3(0, 1, 0), Vector3(0, 0, 1), radius, 0, CircleSegments, colour);
+	WriteCircle(centre, Vector3(0, 0, 1), Vector3(1, 0, 0), radius, 0, CircleSegments, colour);
+}
+
+//Any two directions at right angles to axis, and to each other
+static void PerpendicularAxes(const Vector3& axis, Vector3& u, Vector3& v) {
+	Vector3 helper = std::abs(axis.x) < 0.9f ? Vector3(1, 0, 0) : Vector3(0, 1, 0);
+	u = Vector3::Cross(axis, helper).Normalised();
+	v = Vector3::Cross(axis, u);
+}
+
+void DebugDrawBuffer::WriteCapsule(const Vector3& start, const Vector3& end, float radius, unsigned int colour) {
+	Vector3 axis	= end - start;
+	float	length	= axis.Length();
+	if (length < 0.0001f) {
+		WriteSphere(start, radius, colour);
+		return;
+	}
+	axis = axis / length;
+	Vector3 u, v;
+	PerpendicularAxes(axis, u, v);
+
+	WriteCircle(start, u, v, radius, 0, CircleSegments, colour);
+	WriteCircle(end, u, v, radius, 0, CircleSegments, colour);
+
+	//Half circles capping each end - the table's first half runs from +u, over +v, to -u
+	const int half = CircleSegments / 2;
+	WriteCircle(end, u, axis, radius, 0, half, colour);
+	WriteCircle(end, v, axis, radius, 0, half, colour);
+	WriteCircle(start, u, -axis, radius, 0, half, colour);
+	WriteCircle(start, v, -axis, radius, 0, half, colour);
+
+	WriteLine(start + u * radius, end + u * radius, colour);
+	WriteLine(start - u * radius, end - u * radius, colour);
+	WriteLine(start + v * radius, end + v * radius, colour);
+	WriteLine(start - v * radius, end - v * radius, colour);
+}
+
+void DebugDrawBuffer::WriteArrow(const Vector3& start, const Vector3& end, unsigned int colour) {
+	Vector3 axis	= end - start;
+	float	length	= axis.Length();
+	WriteLine(start, end, colour);
+	if (length < 0.0001f) {
+		return;
+	}
+	axis = axis / length;
+	Vector3 u, v;
+	PerpendicularAxes(axis, u, v);
+
+	Vector3 headBase	= end - axis * (length * 0.2f);
+	float	headWidth	= length * 0.1f;
+	WriteLine(end, headBase + u * headWidth, colour);
+	WriteLine(end, headBase - u * headWidth, colour);
+	WriteLine(end, headBase + v * headWidth, colour);
+	WriteLine(end, headBase - v * headWidth, colour);
+}
+
+void DebugDrawBuffer::WriteCross(const Vector3& position, float size, unsigned int colour) {
+	WriteLine(position - Vector3(size, 0, 0), position + Vector3(size, 0, 0), colour);
+	WriteLine(position - Vector3(0, size, 0), position + Vector3(0, size, 0), colour);
+	WriteLine(position - Vector3(0, 0, size), position + Vector3(0, 0, size), colour);
+}
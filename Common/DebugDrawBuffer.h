@@ -0,0 +1,183 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Vector2.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include "Matrix4.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace NCL {
+	namespace Rendering {
+		//Colours are packed down to RGBA8, read back as normalised bytes
+		struct DebugLineVertex {
+			Maths::Vector3	position;
+			unsigned int	colour;
+		};
+
+		struct DebugTextVertex {
+			Maths::Vector3	position;
+			unsigned int	colour;
+			Maths::Vector2	texCoord;
+		};
+
+		inline unsigned int PackDebugColour(const Maths::Vector4& colour) {
+			auto channel = [](float f) {
+				return (unsigned int)(std::min(std::max(f, 0.0f), 1.0f) * 255.0f + 0.5f);
+			};
+			return channel(colour.x) | (channel(colour.y) << 8) | (channel(colour.z) << 16) | (channel(colour.w) << 24);
+		}
+
+		//Static text keeps its layout between frames even when it isn't drawn - dynamic text only while it's in use
+		enum class TextUsage {
+			Static,
+			Dynamic
+		};
+
+		struct DebugText {
+			Maths::Vector3	position;	//in screen space, or world space if worldSpace is set
+			Maths::Vector4	colour;
+			float			size;
+			size_t			firstChar;
+			size_t			length;
+			bool			worldSpace;
+			TextUsage		usage;
+		};
+
+		struct DebugDrawStats {
+			size_t lineVertices		= 0;
+			size_t textCharacters	= 0;
+			size_t timedShapes		= 0;
+			size_t droppedVertices	= 0;	//didn't fit, and weren't drawn
+		};
+
+		/*
+		Collects debug lines and text over a frame, for the renderer to draw
+		in one go. Lines are written straight out as packed vertices into
+		storage that's allocated up front - when it's full, further shapes
+		are dropped rather than it growing. Shapes given a time to live are
+		kept in a heap ordered by when they expire, and are written out again
+		every frame until they do. Call Update once a frame, before drawing,
+		and Clear once the frame's been drawn.
+		*/
+		class DebugDrawBuffer {
+		public:
+			DebugDrawBuffer(size_t maxLineVertices = 512 * 1024, size_t maxTextChars = 16 * 1024);
+
+			void AddLine(const Maths::Vector3& start, const Maths::Vector3& end, const Maths::Vector4& colour, float time = 0.0f);
+			void AddBox(const Maths::Vector3& centre, const Maths::Vector3& halfSize, const Maths::Vector4& colour, float time = 0.0f);
+			//The -1 to 1 cube, transformed - for oriented boxes
+			void AddBox(const Maths::Matrix4& transform, const Maths::Vector4& colour, float time = 0.0f);
+			void AddSphere(const Maths::Vector3& centre, float radius, const Maths::Vector4& colour, float time = 0.0f);
+			void AddCapsule(const Maths::Vector3& start, const Maths::Vector3& end, float radius, const Maths::Vector4& colour, float time = 0.0f);
+			void AddArrow(const Maths::Vector3& start, const Maths::Vector3& end, const Maths::Vector4& colour, float time = 0.0f);
+			void AddCross(const Maths::Vector3& position, float size, const Maths::Vector4& colour, float time = 0.0f);
+
+			//Lots of axis aligned boxes at once, for this frame only
+			void AddBoxes(const Maths::Vector3* centres, const Maths::Vector3* halfSizes, size_t count, const Maths::Vector4& colour);
+
+			void AddText(const std::string& text, const Maths::Vector3& position, const Maths::Vector4& colour, float size, bool worldSpace, TextUsage usage = TextUsage::Dynamic);
+
+			//Writes out every timed shape, then moves time on by dt and drops the ones that have expired
+			void Update(float dt);
+
+			//Empties this frame's vertices and text, keeping the timed shapes
+			void Clear();
+
+			const DebugLineVertex* GetLineVertices() const {
+				return lineVertices.data();
+			}
+
+			size_t GetLineVertexCount() const {
+				return lineVertexCount;
+			}
+
+			const std::vector<DebugText>& GetTexts() const {
+				return texts;
+			}
+
+			const char* GetTextChars(const DebugText& text) const {
+				return textChars.data() + text.firstChar;
+			}
+
+			size_t GetTextCharCount() const {
+				return textCharCount;
+			}
+
+			size_t GetTimedShapeCount() const {
+				return timedShapes.size();
+			}
+
+			//What the last cleared frame held
+			const DebugDrawStats& GetLastFrameStats() const {
+				return lastFrameStats;
+			}
+
+			size_t GetLineVertexCapacity() const {
+				return lineVertices.size();
+			}
+
+		protected:
+			enum class ShapeType {
+				Line, Box, Sphere, Capsule, Arrow, Cross
+			};
+
+			struct TimedShape {
+				float			expiry;
+				ShapeType		type;
+				unsigned int	colour;
+				Maths::Vector3	a;
+				Maths::Vector3	b;
+				float			size;
+				Maths::Matrix4	transform;
+			};
+
+			static const int CircleSegments = 24;
+
+			//Puts the soonest expiry at the front of the heap
+			static bool ExpiresLater(const TimedShape& a, const TimedShape& b) {
+				return a.expiry > b.expiry;
+			}
+
+			//Space for count more vertices, or nullptr if they don't fit
+			DebugLineVertex* AllocateLines(size_t count);
+
+			void AddTimed(ShapeType type, float time, unsigned int colour, const Maths::Vector3& a, const Maths::Vector3& b = Maths::Vector3(), float size = 0.0f, const Maths::Matrix4& transform = Maths::Matrix4());
+			void WriteShape(const TimedShape& s);
+
+			void WriteLine(const Maths::Vector3& start, const Maths::Vector3& end, unsigned int colour);
+			void WriteBox(const Maths::Vector3* corners, unsigned int colour);
+			void WriteAABB(const Maths::Vector3& centre, const Maths::Vector3& halfSize, unsigned int colour);
+			void WriteBox(const Maths::Matrix4& transform, unsigned int colour);
+			void WriteCircle(const Maths::Vector3& centre, const Maths::Vector3& u, const Maths::Vector3& v, float radius, int firstSegment, int segmentCount, unsigned int colour);
+			void WriteSphere(const Maths::Vector3& centre, float radius, unsigned int colour);
+			void WriteCapsule(const Maths::Vector3& start, const Maths::Vector3& end, float radius, unsigned int colour);
+			void WriteArrow(const Maths::Vector3& start, const Maths::Vector3& end, unsigned int colour);
+			void WriteCross(const Maths::Vector3& position, float size, unsigned int colour);
+
+			std::vector<DebugLineVertex>	lineVertices;	//sized once, never grows
+			size_t							lineVertexCount;
+			size_t							droppedVertices;
+
+			std::vector<DebugText>			texts;
+			std::vector<char>				textChars;		//every string's characters, back to back
+			size_t							textCharCount;
+
+			std::vector<TimedShape>			timedShapes;	//a min heap on expiry
+			float							currentTime;
+
+			Maths::Vector2					circle[CircleSegments + 1];	//unit circle, first point repeated at the end
+
+			DebugDrawStats					lastFrameStats;
+		};
+	}
+}
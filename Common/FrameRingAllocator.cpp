@@ -0,0 +1,41 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "FrameRingAllocator.h"
+
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+
+FrameRingAllocator::FrameRingAllocator(size_t bytesPerFrame, int framesInFlight, size_t alignment) {
+	this->alignment			= std::max((size_t)1, alignment);
+	this->framesInFlight	= std::max(1, framesInFlight);
+	this->currentFrame		= 0;
+	this->frameOffset		= 0;
+	this->frameSize			= AlignedSize(bytesPerFrame);
+}
+
+void FrameRingAllocator::BeginFrame() {
+	currentFrame	= (currentFrame + 1) % framesInFlight;
+	frameOffset		= 0;
+}
+
+void FrameRingAllocator::Resize(size_t bytesPerFrame) {
+	frameSize	= AlignedSize(bytesPerFrame);
+	frameOffset = 0;
+}
+
+bool FrameRingAllocator::Allocate(size_t bytes, size_t& offset) {
+	if (bytes > frameSize - frameOffset) {
+		return false;
+	}
+	offset		= frameSize * currentFrame + frameOffset;
+	frameOffset = std::min(frameSize, frameOffset + AlignedSize(bytes));
+	return true;
+}
@@ -0,0 +1,75 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include <cstddef>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		Hands out offsets into a buffer that's split into one region per frame
+		in flight, so each frame writes into memory the GPU is done with. Only
+		does the arithmetic - whoever owns the buffer makes sure the GPU has
+		finished with a region (with a fence, say) before calling BeginFrame.
+		Every allocation starts on a multiple of alignment, which needn't be a
+		power of two.
+		*/
+		class FrameRingAllocator {
+		public:
+			FrameRingAllocator(size_t bytesPerFrame, int framesInFlight, size_t alignment);
+
+			static size_t AlignUp(size_t value, size_t alignment) {
+				return ((value + alignment - 1) / alignment) * alignment;
+			}
+
+			size_t AlignedSize(size_t bytes) const {
+				return AlignUp(bytes, alignment);
+			}
+
+			//Moves on to the next frame's region, which starts out empty
+			void BeginFrame();
+
+			//Changes how big each region is - everything allocated so far is lost
+			void Resize(size_t bytesPerFrame);
+
+			//Fails, leaving offset alone, if the current region hasn't got room
+			bool Allocate(size_t bytes, size_t& offset);
+
+			int GetCurrentFrame() const {
+				return currentFrame;
+			}
+
+			int GetFramesInFlight() const {
+				return framesInFlight;
+			}
+
+			size_t GetFrameSize() const {
+				return frameSize;
+			}
+
+			size_t GetTotalSize() const {
+				return frameSize * framesInFlight;
+			}
+
+			size_t GetAlignment() const {
+				return alignment;
+			}
+
+			size_t GetBytesUsed() const {
+				return frameOffset;
+			}
+
+		protected:
+			size_t	frameSize;
+			size_t	frameOffset;
+			size_t	alignment;
+			int		framesInFlight;
+			int		currentFrame;
+		};
+	}
+}
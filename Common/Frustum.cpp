@@ -0,0 +1,196 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "Frustum.h"
+#include "Matrix4.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#define FRUSTUM_USE_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace NCL;
+using namespace Maths;
+
+void CullingBounds::Clear() {
+	centreX.clear();
+	centreY.clear();
+	centreZ.clear();
+	halfX.clear();
+	halfY.clear();
+	halfZ.clear();
+	radius.clear();
+}
+
+void CullingBounds::Reserve(size_t count) {
+	centreX.reserve(count);
+	centreY.reserve(count);
+	centreZ.reserve(count);
+	halfX.reserve(count);
+	halfY.reserve(count);
+	halfZ.reserve(count);
+	radius.reserve(count);
+}
+
+void CullingBounds::AddAABB(const Vector3& centre, const Vector3& halfSize) {
+	centreX.emplace_back(centre.x);
+	centreY.emplace_back(centre.y);
+	centreZ.emplace_back(centre.z);
+	halfX.emplace_back(halfSize.x);
+	halfY.emplace_back(halfSize.y);
+	halfZ.emplace_back(halfSize.z);
+	radius.emplace_back(halfSize.Length());
+}
+
+void CullingBounds::AddTransformedAABB(const Vector3& localMin, const Vector3& localMax, const Matrix4& transform) {
+	Vector3 localCentre	= (localMin + localMax) * 0.5f;
+	Vector3 localHalf	= (localMax - localMin) * 0.5f;
+
+	//Each world axis' half size is how far the box's 3 rotated and scaled axes reach along it
+	const float* m = transform.array;
+	Vector3 centre = transform * localCentre;
+	Vector3 half(
+		std::abs(m[0]) * localHalf.x + std::abs(m[4]) * localHalf.y + std::abs(m[8])  * localHalf.z,
+		std::abs(m[1]) * localHalf.x + std::abs(m[5]) * localHalf.y + std::abs(m[9])  * localHalf.z,
+		std::abs(m[2]) * localHalf.x + std::abs(m[6]) * localHalf.y + std::abs(m[10]) * localHalf.z);
+
+	AddAABB(centre, half);
+}
+
+Frustum::Frustum() {
+}
+
+Frustum::Frustum(const Matrix4& viewProj) {
+	FromMatrix(viewProj);
+}
+
+//Each plane is the sum or difference of the matrix's last row and one of the others
+void Frustum::FromMatrix(const Matrix4& m) {
+	const float* a = m.array;
+	Vector3 row0(a[0], a[4], a[8]);
+	Vector3 row1(a[1], a[5], a[9]);
+	Vector3 row2(a[2], a[6], a[10]);
+	Vector3 row3(a[3], a[7], a[11]);
+
+	planes[0] = Plane(row3 + row0, a[15] + a[12], true);	//left
+	planes[1] = Plane(row3 - row0, a[15] - a[12], true);	//right
+	planes[2] = Plane(row3 + row1, a[15] + a[13], true);	//bottom
+	planes[3] = Plane(row3 - row1, a[15] - a[13], true);	//top
+	planes[4] = Plane(row3 + row2, a[15] + a[14], true);	//near
+	planes[5] = Plane(row3 - row2, a[15] - a[14], true);	//far
+}
+
+bool Frustum::SphereInside(const Vector3& position, float radius) const {
+	for (int p = 0; p < 6; ++p) {
+		if (!planes[p].SphereInPlane(position, radius)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Frustum::AABBInside(const Vector3& centre, const Vector3& halfSize) const {
+	for (int p = 0; p < 6; ++p) {
+		Vector3 n = planes[p].GetNormal();
+		float reach = std::abs(n.x) * halfSize.x + std::abs(n.y) * halfSize.y + std::abs(n.z) * halfSize.z;
+		if (planes[p].DistanceFromPlane(centre) <= -reach) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t Frustum::CullSpheres(const CullingBounds& b, std::vector<char>& visible) const {
+	size_t count = b.Size();
+	visible.resize(count);
+	size_t inside	= 0;
+	size_t i		= 0;
+#ifdef FRUSTUM_USE_SSE
+	__m128 nx[6], ny[6], nz[6], d[6];
+	for (int p = 0; p < 6; ++p) {
+		Vector3 n = planes[p].GetNormal();
+		nx[p] = _mm_set1_ps(n.x);
+		ny[p] = _mm_set1_ps(n.y);
+		nz[p] = _mm_set1_ps(n.z);
+		d[p]  = _mm_set1_ps(planes[p].GetDistance());
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(&b.centreX[i]);
+		__m128 y = _mm_loadu_ps(&b.centreY[i]);
+		__m128 z = _mm_loadu_ps(&b.centreZ[i]);
+		__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&b.radius[i]));
+
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, nx[p]), _mm_mul_ps(y, ny[p])), _mm_add_ps(_mm_mul_ps(z, nz[p]), d[p]));
+			in = _mm_and_ps(in, _mm_cmpgt_ps(dist, negRadius));
+		}
+		int mask = _mm_movemask_ps(in);
+		for (int j = 0; j < 4; ++j) {
+			visible[i + j] = (mask >> j) & 1;
+		}
+		inside += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+	}
+#endif
+	for (; i < count; ++i) {
+		visible[i] = SphereInside(b.GetCentre(i), b.radius[i]) ? 1 : 0;
+		inside += visible[i];
+	}
+	return inside;
+}
+
+size_t Frustum::CullAABBs(const CullingBounds& b, std::vector<char>& visible) const {
+	visible.resize(b.Size());
+	return CullAABBs(b, visible.data(), 0, b.Size());
+}
+
+size_t Frustum::CullAABBs(const CullingBounds& b, char* visible, size_t begin, size_t end) const {
+	size_t inside	= 0;
+	size_t i		= begin;
+#ifdef FRUSTUM_USE_SSE
+	__m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+	for (int p = 0; p < 6; ++p) {
+		Vector3 n = planes[p].GetNormal();
+		nx[p] = _mm_set1_ps(n.x);
+		ny[p] = _mm_set1_ps(n.y);
+		nz[p] = _mm_set1_ps(n.z);
+		ax[p] = _mm_set1_ps(std::abs(n.x));
+		ay[p] = _mm_set1_ps(std::abs(n.y));
+		az[p] = _mm_set1_ps(std::abs(n.z));
+		d[p]  = _mm_set1_ps(planes[p].GetDistance());
+	}
+	for (; i + 4 <= end; i += 4) {
+		__m128 x  = _mm_loadu_ps(&b.centreX[i]);
+		__m128 y  = _mm_loadu_ps(&b.centreY[i]);
+		__m128 z  = _mm_loadu_ps(&b.centreZ[i]);
+		__m128 hx = _mm_loadu_ps(&b.halfX[i]);
+		__m128 hy = _mm_loadu_ps(&b.halfY[i]);
+		__m128 hz = _mm_loadu_ps(&b.halfZ[i]);
+
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p) {
+			__m128 dist  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, nx[p]), _mm_mul_ps(y, ny[p])), _mm_add_ps(_mm_mul_ps(z, nz[p]), d[p]));
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, ax[p]), _mm_mul_ps(hy, ay[p])), _mm_mul_ps(hz, az[p]));
+			in = _mm_and_ps(in, _mm_cmpgt_ps(_mm_add_ps(dist, reach), _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(in);
+		for (int j = 0; j < 4; ++j) {
+			visible[i + j] = (mask >> j) & 1;
+		}
+		inside += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+	}
+#endif
+	for (; i < end; ++i) {
+		visible[i] = AABBInside(b.GetCentre(i), b.GetHalfSize(i)) ? 1 : 0;
+		inside += visible[i];
+	}
+	return inside;
+}
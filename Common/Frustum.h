@@ -0,0 +1,92 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Plane.h"
+#include "Vector3.h"
+#include <vector>
+
+namespace NCL {
+	namespace Maths {
+		class Matrix4;
+
+		/*
+		A list of bounding volumes stored as separate arrays of each component,
+		so that a Frustum can test 4 of them at once. Each entry has both an
+		axis aligned box (centre and half size) and a sphere around that box.
+		*/
+		class CullingBounds {
+		public:
+			void Clear();
+			void Reserve(size_t count);
+
+			void AddAABB(const Vector3& centre, const Vector3& halfSize);
+
+			//Takes a box in an object's own space into world space, and adds the box around it
+			void AddTransformedAABB(const Vector3& localMin, const Vector3& localMax, const Matrix4& transform);
+
+			size_t Size() const {
+				return centreX.size();
+			}
+
+			Vector3 GetCentre(size_t i) const {
+				return Vector3(centreX[i], centreY[i], centreZ[i]);
+			}
+
+			Vector3 GetHalfSize(size_t i) const {
+				return Vector3(halfX[i], halfY[i], halfZ[i]);
+			}
+
+			float GetRadius(size_t i) const {
+				return radius[i];
+			}
+
+		protected:
+			friend class Frustum;
+
+			std::vector<float> centreX;
+			std::vector<float> centreY;
+			std::vector<float> centreZ;
+			std::vector<float> halfX;
+			std::vector<float> halfY;
+			std::vector<float> halfZ;
+			std::vector<float> radius;
+		};
+
+		/*
+		The 6 planes around everything a view projection matrix can see, all
+		facing inwards. Tests are conservative - something reported as inside
+		might still be just off screen, near a corner of the frustum, but
+		nothing visible is ever reported as outside.
+		*/
+		class Frustum {
+		public:
+			Frustum();
+			Frustum(const Matrix4& viewProj);
+
+			void FromMatrix(const Matrix4& viewProj);
+
+			bool SphereInside(const Vector3& position, float radius) const;
+			bool AABBInside(const Vector3& centre, const Vector3& halfSize) const;
+
+			//Writes 1 into visible for every entry at least partly inside, 0 for the
+			//rest, and returns how many were inside
+			size_t CullSpheres(const CullingBounds& bounds, std::vector<char>& visible) const;
+			size_t CullAABBs(const CullingBounds& bounds, std::vector<char>& visible) const;
+			//Just the entries in [begin, end), so separate threads can each take a range
+			size_t CullAABBs(const CullingBounds& bounds, char* visible, size_t begin, size_t end) const;
+
+			const Plane& GetPlane(int i) const {
+				return planes[i];
+			}
+
+		protected:
+			Plane planes[6];
+		};
+	}
+}
@@ -0,0 +1,37 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "InstanceBatcher.h"
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Maths;
+
+InstanceBatcher::InstanceBatcher(unsigned int maxInstances) {
+	this->maxInstances = maxInstances;
+}
+
+void InstanceBatcher::Clear() {
+	batches.clear();
+	instances.clear();
+}
+
+void InstanceBatcher::Add(const void* shader, const void* texture, const void* mesh, int lodLevel,
+	const Matrix4& modelMatrix, const Vector4& colour) {
+	bool startBatch = batches.empty();
+	if (!startBatch) {
+		const InstanceBatch& b = batches.back();
+		startBatch =	b.shader != shader || b.texture != texture || b.mesh != mesh || b.lodLevel != lodLevel ||
+						(maxInstances > 0 && b.instanceCount >= maxInstances);
+	}
+	if (startBatch) {
+		batches.push_back({ shader, texture, mesh, lodLevel, (unsigned int)instances.size(), 0 });
+	}
+	batches.back().instanceCount++;
+	instances.push_back({ modelMatrix, colour });
+}
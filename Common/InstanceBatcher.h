@@ -0,0 +1,63 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Matrix4.h"
+#include "Vector4.h"
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		//What each instance of a batch gets, laid out to go straight into a vertex buffer
+		struct InstanceData {
+			Maths::Matrix4	modelMatrix;
+			Maths::Vector4	colour;
+		};
+
+		struct InstanceBatch {
+			const void*		shader;
+			const void*		texture;
+			const void*		mesh;
+			int				lodLevel;
+			unsigned int	firstInstance;	//into InstanceBatcher::GetInstances
+			unsigned int	instanceCount;
+		};
+
+		/*
+		Turns a list of draws into as few instanced draws as possible. Draws
+		are merged when they follow on from one with the same shader, texture,
+		mesh and LOD, so the list should already be sorted to bring those
+		together - and anything whose order matters, like transparent objects,
+		stays in the order it was added. Has no API calls of its own, so the
+		instance data can be copied into whatever buffer a renderer uses.
+		*/
+		class InstanceBatcher {
+		public:
+			//maxInstances caps how big a single batch can get, 0 for no limit
+			InstanceBatcher(unsigned int maxInstances = 0);
+
+			void Clear();
+
+			void Add(const void* shader, const void* texture, const void* mesh, int lodLevel,
+				const Maths::Matrix4& modelMatrix, const Maths::Vector4& colour);
+
+			const std::vector<InstanceBatch>& GetBatches() const {
+				return batches;
+			}
+
+			const std::vector<InstanceData>& GetInstances() const {
+				return instances;
+			}
+
+		protected:
+			std::vector<InstanceBatch>	batches;
+			std::vector<InstanceData>	instances;
+			unsigned int				maxInstances;
+		};
+	}
+}
@@ -0,0 +1,91 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "MappedFile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace NCL;
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& filename) {
+	data			= nullptr;
+	size			= 0;
+	mappingHandle	= nullptr;
+	fileHandle		= CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		std::cout << __FUNCTION__ << " can't open file " << filename << std::endl;
+		return;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+		return;
+	}
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mappingHandle) {
+		return;
+	}
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	size = data ? (size_t)fileSize.QuadPart : 0;
+}
+
+MappedFile::~MappedFile() {
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+	}
+}
+#else
+MappedFile::MappedFile(const std::string& filename) {
+	data		= nullptr;
+	size		= 0;
+	fileHandle	= open(filename.c_str(), O_RDONLY);
+
+	if (fileHandle < 0) {
+		std::cout << __FUNCTION__ << " can't open file " << filename << std::endl;
+		return;
+	}
+	struct stat fileInfo;
+	if (fstat(fileHandle, &fileInfo) != 0 || fileInfo.st_size == 0) {
+		return;
+	}
+	void* mapped = mmap(nullptr, (size_t)fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileHandle, 0);
+	if (mapped == MAP_FAILED) {
+		return;
+	}
+	data = (const char*)mapped;
+	size = (size_t)fileInfo.st_size;
+}
+
+MappedFile::~MappedFile() {
+	if (data) {
+		munmap((void*)data, size);
+	}
+	if (fileHandle >= 0) {
+		close(fileHandle);
+	}
+}
+#endif
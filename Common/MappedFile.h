@@ -0,0 +1,48 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include <string>
+
+namespace NCL {
+	/*
+	Read-only view of a whole file, mapped straight into memory by the OS
+	rather than read into a buffer. Pages are only brought in when touched,
+	so large binary assets can be used where they sit.
+	*/
+	class MappedFile	{
+	public:
+		MappedFile(const std::string& filename);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool IsValid() const {
+			return data != nullptr;
+		}
+
+		const char* GetData() const {
+			return data;
+		}
+
+		size_t GetSize() const {
+			return size;
+		}
+
+	protected:
+		const char*	data;
+		size_t		size;
+#ifdef _WIN32
+		void*		fileHandle;
+		void*		mappingHandle;
+#else
+		int			fileHandle;
+#endif
+	};
+}
@@ -43,6 +43,18 @@ MeshAnimation::MeshAnimation(const std::string& filename) : MeshAnimation() {
 	}
 }
 
+MeshAnimation::MeshAnimation(unsigned int jointCount, unsigned int frameCount, float frameRate, const std::vector<Matrix4>& allFrames) {
+	this->jointCount	= jointCount;
+	this->frameCount	= frameCount;
+	this->frameRate		= frameRate;
+	allJoints			= allFrames;
+
+	if (allJoints.size() != (size_t)frameCount * jointCount) {
+		std::cout << __FUNCTION__ << " expected " << (size_t)frameCount * jointCount << " matrices, got " << allJoints.size() << std::endl;
+		allJoints.resize((size_t)frameCount * jointCount);
+	}
+}
+
 MeshAnimation::~MeshAnimation() {
 
 }
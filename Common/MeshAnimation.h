@@ -14,6 +14,8 @@ class MeshAnimation
 public:
 	MeshAnimation();
 	MeshAnimation(const std::string& filename);
+	//allFrames holds jointCount model space matrices for each frame in turn
+	MeshAnimation(unsigned int jointCount, unsigned int frameCount, float frameRate, const std::vector<Matrix4>& allFrames);
 	virtual ~MeshAnimation();
 
 	unsigned int GetJointCount() const {
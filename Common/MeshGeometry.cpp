@@ -5,8 +5,19 @@
 #include "Vector4.h"
 #include "Matrix4.h"
 
+#include "MappedFile.h"
+#include "ParallelFor.h"
+
 #include <fstream>
 #include <string>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#define MESH_USE_SSE
+#include <xmmintrin.h>
+#endif
 
 using namespace NCL;
 using namespace Maths;
@@ -32,7 +43,8 @@ enum class GeometryChunkTypes {
 	BindPoseInv		= 1 << 12,
 	Material		= 1 << 13,
 	SubMeshes		= 1 << 14,
-	SubMeshNames	= 1 << 15
+	SubMeshNames	= 1 << 15,
+	LODs			= 1 << 16
 };
 
 enum class GeometryChunkData {
@@ -41,32 +53,252 @@ enum class GeometryChunkData {
 	dByte,	//Translate from -128 to 127 to a float
 };
 
-void* ReadVertexData(GeometryChunkData dataType, GeometryChunkTypes chunkType, int numVertices) {
-	int numElements = 3;
+/*
+Binary meshes are a header, a table of chunks, and then each chunk's data,
+16 byte aligned. Vertex streams can be stored as shorts or bytes - these
+are expanded back out to floats using the chunk's scale as they're read.
+*/
+const unsigned int BINARY_MESH_MAGIC		= 0x4248534D; //"MSHB"
+const unsigned int BINARY_MESH_VERSION		= 1;
+const unsigned int BINARY_MESH_ALIGNMENT	= 16;
+
+struct BinaryMeshHeader {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int numMeshes;
+	unsigned int numVertices;
+	unsigned int numIndices;
+	unsigned int numChunks;
+};
+
+struct BinaryChunkHeader {
+	unsigned int		chunkType;		//GeometryChunkTypes
+	unsigned int		dataType;		//GeometryChunkData
+	unsigned int		elementCount;
+	unsigned int		componentCount; //per element
+	float				scale;			//quantised values are in the range -scale to scale
+	unsigned int		padding;
+	unsigned long long	offset;
+	unsigned long long	size;
+};
+
+struct BinaryChunk {
+	BinaryChunkHeader	header;
+	vector<char>		data;
+};
+
+static unsigned long long AlignChunk(unsigned long long value) {
+	return (value + (BINARY_MESH_ALIGNMENT - 1)) & ~(unsigned long long)(BINARY_MESH_ALIGNMENT - 1);
+}
+
+static int BytesPerComponent(GeometryChunkData dataType) {
+	switch (dataType) {
+		case GeometryChunkData::dShort: return 2;
+		case GeometryChunkData::dByte:	return 1;
+		default:						return 4;
+	}
+}
+
+template<class T>
+void WriteBinaryFloats(vector<BinaryChunk>& chunks, GeometryChunkTypes chunkType, const vector<T>& element, GeometryChunkData dataType) {
+	if (element.empty()) {
+		return;
+	}
+	const int		components	= sizeof(T) / sizeof(float);
+	const size_t	count		= element.size() * components;
+	const float*	values		= (const float*)element.data();
+
+	float scale = 1.0f;
+	if (dataType != GeometryChunkData::dFloat) {
+		scale = 0.0f;
+		for (size_t i = 0; i < count; ++i) {
+			scale = std::max(scale, std::abs(values[i]));
+		}
+		scale = scale > 0.0f ? scale : 1.0f;
+	}
+
+	BinaryChunk c;
+	c.header.chunkType		= (unsigned int)chunkType;
+	c.header.dataType		= (unsigned int)dataType;
+	c.header.elementCount	= (unsigned int)element.size();
+	c.header.componentCount = components;
+	c.header.scale			= scale;
+	c.header.padding		= 0;
+	c.data.resize(count * BytesPerComponent(dataType));
+
+	if (dataType == GeometryChunkData::dFloat) {
+		memcpy(c.data.data(), values, c.data.size());
+	}
+	else if (dataType == GeometryChunkData::dShort) {
+		short* out = (short*)c.data.data();
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = (short)std::lround(std::min(1.0f, std::max(-1.0f, values[i] / scale)) * 32767.0f);
+		}
+	}
+	else {
+		char* out = c.data.data();
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = (char)std::lround(std::min(1.0f, std::max(-1.0f, values[i] / scale)) * 127.0f);
+		}
+	}
+	chunks.emplace_back(std::move(c));
+}
+
+template<class T>
+void WriteBinaryRaw(vector<BinaryChunk>& chunks, GeometryChunkTypes chunkType, const T* data, size_t elementCount, int components) {
+	if (elementCount == 0) {
+		return;
+	}
+	BinaryChunk c;
+	c.header.chunkType		= (unsigned int)chunkType;
+	c.header.dataType		= (unsigned int)GeometryChunkData::dFloat;
+	c.header.elementCount	= (unsigned int)elementCount;
+	c.header.componentCount = components;
+	c.header.scale			= 1.0f;
+	c.header.padding		= 0;
+	c.data.resize(elementCount * sizeof(T));
+	memcpy(c.data.data(), data, c.data.size());
+	chunks.emplace_back(std::move(c));
+}
+
+//Strings are stored back to back, each with a null terminator
+void WriteBinaryStrings(vector<BinaryChunk>& chunks, GeometryChunkTypes chunkType, const vector<std::string>& strings) {
+	if (strings.empty()) {
+		return;
+	}
+	BinaryChunk c;
+	c.header.chunkType		= (unsigned int)chunkType;
+	c.header.dataType		= (unsigned int)GeometryChunkData::dByte;
+	c.header.elementCount	= (unsigned int)strings.size();
+	c.header.componentCount = 1;
+	c.header.scale			= 1.0f;
+	c.header.padding		= 0;
+	for (const std::string& s : strings) {
+		c.data.insert(c.data.end(), s.begin(), s.end());
+		c.data.push_back('\0');
+	}
+	chunks.emplace_back(std::move(c));
+}
+
+template<class T>
+bool ReadBinaryFloats(const BinaryChunkHeader& chunk, const char* data, vector<T>& element) {
+	const int components = sizeof(T) / sizeof(float);
+	if (chunk.componentCount != components ||
+		chunk.size < (unsigned long long)chunk.elementCount * components * BytesPerComponent((GeometryChunkData)chunk.dataType)) {
+		return false;
+	}
+	const size_t count = chunk.elementCount * components;
+	element.resize(chunk.elementCount);
+	float* out = (float*)element.data();
+
+	switch ((GeometryChunkData)chunk.dataType) {
+		case GeometryChunkData::dFloat: {
+			memcpy(out, data, count * sizeof(float));
+		}break;
+		case GeometryChunkData::dShort: {
+			const short* in		= (const short*)data;
+			const float	scale	= chunk.scale / 32767.0f;
+			for (size_t i = 0; i < count; ++i) {
+				out[i] = in[i] * scale;
+			}
+		}break;
+		case GeometryChunkData::dByte: {
+			const signed char*	in		= (const signed char*)data;
+			const float			scale	= chunk.scale / 127.0f;
+			for (size_t i = 0; i < count; ++i) {
+				out[i] = in[i] * scale;
+			}
+		}break;
+		default: return false;
+	}
+	return true;
+}
+
+template<class T>
+bool ReadBinaryRaw(const BinaryChunkHeader& chunk, const char* data, T* into, size_t maxElements) {
+	if (chunk.elementCount > maxElements || chunk.size < chunk.elementCount * sizeof(T)) {
+		return false;
+	}
+	memcpy(into, data, chunk.elementCount * sizeof(T));
+	return true;
+}
 
-	if (chunkType == GeometryChunkTypes::VTex0 ||
-		chunkType == GeometryChunkTypes::VTex1) {
-		numElements = 2;
+//Matrix4 isn't trivially copyable, so each one is copied into its float array
+bool ReadBinaryRaw(const BinaryChunkHeader& chunk, const char* data, Matrix4* into, size_t maxElements) {
+	if (chunk.elementCount > maxElements || chunk.size < chunk.elementCount * sizeof(Matrix4::array)) {
+		return false;
 	}
-	else if (chunkType == GeometryChunkTypes::VColors) {
-		numElements = 4;
+	for (unsigned int i = 0; i < chunk.elementCount; ++i) {
+		memcpy(into[i].array, data + i * sizeof(Matrix4::array), sizeof(Matrix4::array));
 	}
+	return true;
+}
 
-	int bytesPerElement = 4;
+bool ReadBinaryStrings(const BinaryChunkHeader& chunk, const char* data, vector<std::string>& strings) {
+	const char* end = data + chunk.size;
+	strings.reserve(chunk.elementCount);
+	for (unsigned int i = 0; i < chunk.elementCount; ++i) {
+		const char* terminator = (const char*)memchr(data, '\0', end - data);
+		if (!terminator) {
+			return false;
+		}
+		strings.emplace_back(data, terminator);
+		data = terminator + 1;
+	}
+	return true;
+}
 
-	if (dataType == GeometryChunkData::dShort) {
-		bytesPerElement = 2;
+//Each LOD is its error, index count and sub mesh count, then its sub mesh ranges and indices
+void WriteBinaryLODs(vector<BinaryChunk>& chunks, const vector<MeshLOD>& lods) {
+	if (lods.empty()) {
+		return;
 	}
-	else if (dataType == GeometryChunkData::dByte) {
-		bytesPerElement = 1;
+	BinaryChunk c;
+	c.header.chunkType		= (unsigned int)GeometryChunkTypes::LODs;
+	c.header.dataType		= (unsigned int)GeometryChunkData::dFloat;
+	c.header.elementCount	= (unsigned int)lods.size();
+	c.header.componentCount = 1;
+	c.header.scale			= 1.0f;
+	c.header.padding		= 0;
+	for (const MeshLOD& lod : lods) {
+		unsigned int header[3] = { 0, (unsigned int)lod.indices.size(), (unsigned int)lod.subMeshes.size() };
+		memcpy(&header[0], &lod.error, sizeof(float));
+
+		c.data.insert(c.data.end(), (const char*)header, (const char*)(header + 3));
+		c.data.insert(c.data.end(), (const char*)lod.subMeshes.data(), (const char*)(lod.subMeshes.data() + lod.subMeshes.size()));
+		c.data.insert(c.data.end(), (const char*)lod.indices.data(), (const char*)(lod.indices.data() + lod.indices.size()));
 	}
+	chunks.emplace_back(std::move(c));
+}
 
-	char* data = new char[numElements * bytesPerElement];
+bool ReadBinaryLODs(const BinaryChunkHeader& chunk, const char* data, vector<MeshLOD>& lods) {
+	const char* end = data + chunk.size;
+	lods.resize(chunk.elementCount);
+	for (MeshLOD& lod : lods) {
+		unsigned int header[3];
+		if ((size_t)(end - data) < sizeof(header)) {
+			return false;
+		}
+		memcpy(header, data, sizeof(header));
+		data += sizeof(header);
 
-	return data;
+		const size_t subMeshBytes	= header[2] * sizeof(SubMesh);
+		const size_t indexBytes		= header[1] * sizeof(unsigned int);
+		if ((size_t)(end - data) < subMeshBytes + indexBytes) {
+			return false;
+		}
+		memcpy(&lod.error, &header[0], sizeof(float));
+		lod.subMeshes.resize(header[2]);
+		lod.indices.resize(header[1]);
+		memcpy(lod.subMeshes.data(), data, subMeshBytes);
+		memcpy(lod.indices.data(), data + subMeshBytes, indexBytes);
+		data += subMeshBytes + indexBytes;
+	}
+	return true;
 }
 
 void ReadTextFloats(std::ifstream& file, vector<Vector2>& element, int numVertices) {
+	element.reserve(numVertices);
 	for (int i = 0; i < numVertices; ++i) {
 		Vector2 temp;
 		file >> temp.x;
@@ -76,6 +308,7 @@ void ReadTextFloats(std::ifstream& file, vector<Vector2>& element, int numVertic
 }
 
 void ReadTextFloats(std::ifstream& file, vector<Vector3>& element, int numVertices) {
+	element.reserve(numVertices);
 	for (int i = 0; i < numVertices; ++i) {
 		Vector3 temp;
 		file >> temp.x;
@@ -86,6 +319,7 @@ void ReadTextFloats(std::ifstream& file, vector<Vector3>& element, int numVertic
 }
 
 void ReadTextFloats(std::ifstream& file, vector<Vector4>& element, int numVertices) {
+	element.reserve(numVertices);
 	for (int i = 0; i < numVertices; ++i) {
 		Vector4 temp;
 		file >> temp.x;
@@ -97,6 +331,7 @@ void ReadTextFloats(std::ifstream& file, vector<Vector4>& element, int numVertic
 }
 
 void ReadIndices(std::ifstream& file, vector<unsigned int>& elements, int numIndices) {
+	elements.reserve(numIndices);
 	for (int i = 0; i < numIndices; ++i) {
 		unsigned int temp;
 		file >> temp;
@@ -106,6 +341,11 @@ void ReadIndices(std::ifstream& file, vector<unsigned int>& elements, int numInd
 
 MeshGeometry::MeshGeometry(const std::string&filename) {
 	primType = GeometryPrimitive::Triangles;
+
+	if (IsBinaryMeshFile(Assets::MESHDIR + filename)) {
+		LoadBinaryMesh(Assets::MESHDIR + filename);
+		return;
+	}
 	std::ifstream file(Assets::MESHDIR + filename);
 
 	std::string filetype;
@@ -156,6 +396,7 @@ MeshGeometry::MeshGeometry(const std::string&filename) {
 			case GeometryChunkTypes::BindPoseInv:		ReadRigPose(file, inverseBindPose);  break;
 			case GeometryChunkTypes::SubMeshes: 		ReadSubMeshes(file, numMeshes); break;
 			case GeometryChunkTypes::SubMeshNames: 		ReadSubMeshNames(file, numMeshes); break;
+			default: break;
 		}
 	}
 }
@@ -164,6 +405,144 @@ MeshGeometry::~MeshGeometry()
 {
 }
 
+bool MeshGeometry::IsBinaryMeshFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	unsigned int magic = 0;
+	file.read((char*)&magic, sizeof(magic));
+	return file && magic == BINARY_MESH_MAGIC;
+}
+
+/*
+The whole file is mapped, and each chunk is decoded straight out of the
+mapping into its attribute vector - those vectors are then what gets
+handed to the GPU, so there's no other staging copy.
+*/
+bool MeshGeometry::LoadBinaryMesh(const std::string& filename) {
+	MappedFile file(filename);
+
+	if (!file.IsValid() || file.GetSize() < sizeof(BinaryMeshHeader)) {
+		std::cout << __FUNCTION__ << " can't load binary mesh " << filename << std::endl;
+		return false;
+	}
+	const BinaryMeshHeader* header = (const BinaryMeshHeader*)file.GetData();
+
+	if (header->magic != BINARY_MESH_MAGIC || header->version != BINARY_MESH_VERSION) {
+		std::cout << "Binary MeshGeometry file has incompatible version!" << std::endl;
+		return false;
+	}
+	if (file.GetSize() < sizeof(BinaryMeshHeader) + header->numChunks * sizeof(BinaryChunkHeader)) {
+		std::cout << __FUNCTION__ << " binary mesh " << filename << " is truncated!" << std::endl;
+		return false;
+	}
+	const BinaryChunkHeader* chunks = (const BinaryChunkHeader*)(file.GetData() + sizeof(BinaryMeshHeader));
+	boundsDirty = true; //the position stream is about to be replaced
+
+	for (unsigned int i = 0; i < header->numChunks; ++i) {
+		const BinaryChunkHeader& chunk = chunks[i];
+		if (chunk.offset + chunk.size > file.GetSize()) {
+			std::cout << __FUNCTION__ << " binary mesh " << filename << " has a malformed chunk!" << std::endl;
+			return false;
+		}
+		const char* data = file.GetData() + chunk.offset;
+		bool		read = true;
+
+		switch ((GeometryChunkTypes)chunk.chunkType) {
+			case GeometryChunkTypes::VPositions:		read = ReadBinaryFloats(chunk, data, positions);	break;
+			case GeometryChunkTypes::VColors:			read = ReadBinaryFloats(chunk, data, colours);		break;
+			case GeometryChunkTypes::VNormals:			read = ReadBinaryFloats(chunk, data, normals);		break;
+			case GeometryChunkTypes::VTangents:			read = ReadBinaryFloats(chunk, data, tangents);		break;
+			case GeometryChunkTypes::VTex0:				read = ReadBinaryFloats(chunk, data, texCoords);	break;
+			case GeometryChunkTypes::VWeightValues:		read = ReadBinaryFloats(chunk, data, skinWeights);	break;
+			case GeometryChunkTypes::VWeightIndices:	read = ReadBinaryFloats(chunk, data, skinIndices);	break;
+			case GeometryChunkTypes::Indices: {
+				indices.resize(chunk.elementCount);
+				read = ReadBinaryRaw(chunk, data, indices.data(), indices.size());
+			}break;
+			case GeometryChunkTypes::JointParents: {
+				jointParents.resize(chunk.elementCount);
+				read = ReadBinaryRaw(chunk, data, jointParents.data(), jointParents.size());
+			}break;
+			case GeometryChunkTypes::BindPose: {
+				bindPose.resize(chunk.elementCount);
+				read = ReadBinaryRaw(chunk, data, bindPose.data(), bindPose.size());
+			}break;
+			case GeometryChunkTypes::BindPoseInv: {
+				inverseBindPose.resize(chunk.elementCount);
+				read = ReadBinaryRaw(chunk, data, inverseBindPose.data(), inverseBindPose.size());
+			}break;
+			case GeometryChunkTypes::SubMeshes: {
+				subMeshes.resize(chunk.elementCount);
+				read = ReadBinaryRaw(chunk, data, subMeshes.data(), subMeshes.size());
+			}break;
+			case GeometryChunkTypes::JointNames:	read = ReadBinaryStrings(chunk, data, jointNames);		break;
+			case GeometryChunkTypes::SubMeshNames:	read = ReadBinaryStrings(chunk, data, subMeshNames);	break;
+			case GeometryChunkTypes::LODs:			read = ReadBinaryLODs(chunk, data, lods);				break;
+			default: break;
+		}
+		if (!read) {
+			std::cout << __FUNCTION__ << " binary mesh " << filename << " has a malformed chunk!" << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MeshGeometry::SaveBinaryMesh(const std::string& filename, bool quantise) const {
+	//Positions and joint indices need to stay exact, but the rest of the
+	//vertex streams are either unit length or small ranges
+	const GeometryChunkData unitData	= quantise ? GeometryChunkData::dShort	: GeometryChunkData::dFloat;
+	const GeometryChunkData byteData	= quantise ? GeometryChunkData::dByte	: GeometryChunkData::dFloat;
+
+	vector<BinaryChunk> chunks;
+	WriteBinaryFloats(chunks, GeometryChunkTypes::VPositions,		positions,		GeometryChunkData::dFloat);
+	WriteBinaryFloats(chunks, GeometryChunkTypes::VNormals,			normals,		unitData);
+	WriteBinaryFloats(chunks, GeometryChunkTypes::VTangents,		tangents,		unitData);
+	WriteBinaryFloats(chunks, GeometryChunkTypes::VColors,			colours,		byteData);
+	WriteBinaryFloats(chunks, GeometryChunkTypes::VTex0,			texCoords,		unitData);
+	WriteBinaryFloats(chunks, GeometryChunkTypes::VWeightValues,	skinWeights,	unitData);
+	WriteBinaryFloats(chunks, GeometryChunkTypes::VWeightIndices,	skinIndices,	GeometryChunkData::dFloat);
+
+	WriteBinaryRaw(chunks, GeometryChunkTypes::Indices,		indices.data(),			indices.size(),			1);
+	WriteBinaryRaw(chunks, GeometryChunkTypes::JointParents,jointParents.data(),	jointParents.size(),	1);
+	WriteBinaryRaw(chunks, GeometryChunkTypes::BindPose,	bindPose.data(),		bindPose.size(),		16);
+	WriteBinaryRaw(chunks, GeometryChunkTypes::BindPoseInv,	inverseBindPose.data(), inverseBindPose.size(), 16);
+	WriteBinaryRaw(chunks, GeometryChunkTypes::SubMeshes,	subMeshes.data(),		subMeshes.size(),		2);
+	WriteBinaryStrings(chunks, GeometryChunkTypes::JointNames,		jointNames);
+	WriteBinaryStrings(chunks, GeometryChunkTypes::SubMeshNames,	subMeshNames);
+	WriteBinaryLODs(chunks, lods);
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cout << __FUNCTION__ << " can't write file " << filename << std::endl;
+		return false;
+	}
+	BinaryMeshHeader header;
+	header.magic		= BINARY_MESH_MAGIC;
+	header.version		= BINARY_MESH_VERSION;
+	header.numMeshes	= (unsigned int)subMeshes.size();
+	header.numVertices	= GetVertexCount();
+	header.numIndices	= GetIndexCount();
+	header.numChunks	= (unsigned int)chunks.size();
+
+	unsigned long long offset = AlignChunk(sizeof(BinaryMeshHeader) + sizeof(BinaryChunkHeader) * chunks.size());
+	for (BinaryChunk& c : chunks) {
+		c.header.offset = offset;
+		c.header.size	= c.data.size();
+		offset = AlignChunk(offset + c.header.size);
+	}
+
+	file.write((const char*)&header, sizeof(BinaryMeshHeader));
+	for (const BinaryChunk& c : chunks) {
+		file.write((const char*)&c.header, sizeof(BinaryChunkHeader));
+	}
+	const char padding[BINARY_MESH_ALIGNMENT] = { 0 };
+	for (const BinaryChunk& c : chunks) {
+		file.write(padding, c.header.offset - file.tellp());
+		file.write(c.data.data(), c.data.size());
+	}
+	return (bool)file;
+}
+
 bool MeshGeometry::HasTriangle(unsigned int i) const {
 	int triCount = 0;
 	if (GetIndexCount() > 0) {
@@ -222,20 +601,401 @@ bool MeshGeometry::GetNormalForTri(unsigned int i, Vector3& n) const {
 	return true;
 }
 
-void	MeshGeometry::TransformVertices(const Matrix4& byMatrix) {
+namespace {
+	//Big enough that each thread gets a worthwhile amount of work
+	const size_t VertexBatchSize	= 16384;
+	const size_t TriangleBatchSize	= 8192;
+
+	/*
+	Which index buffer corners use each vertex, so that per corner values can
+	be summed per vertex in parallel, without threads sharing any outputs
+	*/
+	struct VertexCorners {
+		vector<unsigned int> start;	//vertex i's corners are [start[i], start[i+1])
+		vector<unsigned int> corners;
+
+		VertexCorners(const vector<unsigned int>& indices, size_t vertexCount) {
+			start.assign(vertexCount + 1, 0);
+			for (unsigned int i : indices) {
+				start[i + 1]++;
+			}
+			for (size_t i = 0; i < vertexCount; ++i) {
+				start[i + 1] += start[i];
+			}
+			corners.resize(indices.size());
+			vector<unsigned int> next(start.begin(), start.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i) {
+				corners[next[indices[i]]++] = (unsigned int)i;
+			}
+		}
+	};
+
+	bool IndicesInRange(const vector<unsigned int>& indices, size_t vertexCount) {
+		for (unsigned int i : indices) {
+			if (i >= vertexCount) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	float CornerAngle(const Vector3& corner, const Vector3& b, const Vector3& c) {
+		Vector3 toB = b - corner;
+		Vector3 toC = c - corner;
+		float lengths = std::sqrt(toB.LengthSquared() * toC.LengthSquared());
+		if (lengths <= 0.0f) {
+			return 0.0f;
+		}
+		float cosAngle = Vector3::Dot(toB, toC) / lengths;
+		return std::acos(std::min(1.0f, std::max(-1.0f, cosAngle)));
+	}
+
+	//Each corner's share of the face normal. Area weighting leaves the cross
+	//product unnormalised, as its length is already twice the triangle's area
+	void CornerNormals(const vector<Vector3>& positions, const unsigned int* tri, NormalWeighting weighting, Vector3* out) {
+		const Vector3& a = positions[tri[0]];
+		const Vector3& b = positions[tri[1]];
+		const Vector3& c = positions[tri[2]];
+
+		Vector3 n = Vector3::Cross(b - a, c - a);
+		if (weighting == NormalWeighting::Area) {
+			out[0] = n;
+			out[1] = n;
+			out[2] = n;
+			return;
+		}
+		n.Normalise();
+		out[0] = n * CornerAngle(a, b, c);
+		out[1] = n * CornerAngle(b, c, a);
+		out[2] = n * CornerAngle(c, a, b);
+	}
+
+	void FaceTangent(const vector<Vector3>& positions, const vector<Vector2>& texCoords, const unsigned int* tri, Vector3& tangent, Vector3& binormal) {
+		Vector3 ba = positions[tri[1]] - positions[tri[0]];
+		Vector3 ca = positions[tri[2]] - positions[tri[0]];
+		Vector2 tba = texCoords[tri[1]] - texCoords[tri[0]];
+		Vector2 tca = texCoords[tri[2]] - texCoords[tri[0]];
+
+		float texArea = tba.x * tca.y - tca.x * tba.y;
+		if (texArea == 0.0f) { //degenerate mapping, so it has nothing to add
+			tangent		= Vector3();
+			binormal	= Vector3();
+			return;
+		}
+		float invArea = 1.0f / texArea;
+		tangent		= (ba * tca.y - ca * tba.y) * invArea;
+		binormal	= (ca * tba.x - ba * tca.x) * invArea;
+	}
+
+	void TransformPoints(Vector3* points, size_t count, const Matrix4& m) {
+#ifdef MESH_USE_SSE
+		const __m128 c0 = _mm_loadu_ps(&m.array[0]);
+		const __m128 c1 = _mm_loadu_ps(&m.array[4]);
+		const __m128 c2 = _mm_loadu_ps(&m.array[8]);
+		const __m128 c3 = _mm_loadu_ps(&m.array[12]);
+		for (size_t i = 0; i < count; ++i) {
+			Vector3& p = points[i];
+			__m128 r = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), c0), _mm_mul_ps(_mm_set1_ps(p.y), c1)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), c2), c3));
+			alignas(16) float out[4];
+			_mm_store_ps(out, r);
+			p = Vector3(out[0], out[1], out[2]);
+		}
+#else
+		const float* a = m.array;
+		for (size_t i = 0; i < count; ++i) {
+			Vector3 p = points[i];
+			points[i] = Vector3(
+				a[0] * p.x + a[4] * p.y + a[8]  * p.z + a[12],
+				a[1] * p.x + a[5] * p.y + a[9]  * p.z + a[13],
+				a[2] * p.x + a[6] * p.y + a[10] * p.z + a[14]);
+		}
+#endif
+	}
+
+	//Transforms xyz by the upper 3x3 of m (given as a Matrix4, so its columns are
+	//4 floats apart) then normalises it - anything past xyz is left alone
+	template<class T>
+	void TransformDirections(T* directions, size_t count, const Matrix4& m) {
+#ifdef MESH_USE_SSE
+		const __m128 c0 = _mm_loadu_ps(&m.array[0]);
+		const __m128 c1 = _mm_loadu_ps(&m.array[4]);
+		const __m128 c2 = _mm_loadu_ps(&m.array[8]);
+		for (size_t i = 0; i < count; ++i) {
+			T& d = directions[i];
+			__m128 r = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(d.x), c0), _mm_mul_ps(_mm_set1_ps(d.y), c1)),
+				_mm_mul_ps(_mm_set1_ps(d.z), c2));
+			alignas(16) float out[4];
+			_mm_store_ps(out, r);
+			Vector3 v = Vector3(out[0], out[1], out[2]).Normalised();
+			d.x = v.x;
+			d.y = v.y;
+			d.z = v.z;
+		}
+#else
+		const float* a = m.array;
+		for (size_t i = 0; i < count; ++i) {
+			T& d = directions[i];
+			Vector3 v = Vector3(
+				a[0] * d.x + a[4] * d.y + a[8]  * d.z,
+				a[1] * d.x + a[5] * d.y + a[9]  * d.z,
+				a[2] * d.x + a[6] * d.y + a[10] * d.z).Normalised();
+			d.x = v.x;
+			d.y = v.y;
+			d.z = v.z;
+		}
+#endif
+	}
 
+	template<class T>
+	void SwapTriangleCorners(vector<T>& data, size_t triCount) {
+		for (size_t t = 0; t < triCount && t * 3 + 2 < data.size(); ++t) {
+			std::swap(data[t * 3 + 1], data[t * 3 + 2]);
+		}
+	}
 }
 
-void	MeshGeometry::RecalculateNormals() {
+void	MeshGeometry::TransformVertices(const Matrix4& byMatrix) {
+	Matrix4 inverse = byMatrix.Inverse();
+	Matrix4 normalMatrix;
+	for (int c = 0; c < 3; ++c) { //only the upper 3x3 is used, transposed
+		for (int r = 0; r < 3; ++r) {
+			normalMatrix.array[c * 4 + r] = inverse.array[r * 4 + c];
+		}
+	}
 
+	ParallelFor(positions.size(), VertexBatchSize, [&](size_t begin, size_t end) {
+		TransformPoints(&positions[begin], end - begin, byMatrix);
+	});
+	boundsDirty = true;
+	ParallelFor(normals.size(), VertexBatchSize, [&](size_t begin, size_t end) {
+		TransformDirections(&normals[begin], end - begin, normalMatrix);
+	});
+	ParallelFor(tangents.size(), VertexBatchSize, [&](size_t begin, size_t end) {
+		TransformDirections(&tangents[begin], end - begin, byMatrix);
+	});
+
+	const float* a = byMatrix.array;
+	float determinant =
+		a[0] * (a[5] * a[10] - a[9] * a[6]) -
+		a[4] * (a[1] * a[10] - a[9] * a[2]) +
+		a[8] * (a[1] * a[6]  - a[5] * a[2]);
+
+	if (determinant >= 0.0f || primType != GeometryPrimitive::Triangles) {
+		return;
+	}
+	//Mirrored, so the triangles now face the wrong way, and the bitangents
+	//worked out from the tangents and normals point backwards
+	if (!indices.empty()) {
+		SwapTriangleCorners(indices, indices.size() / 3);
+		for (MeshLOD& lod : lods) {
+			SwapTriangleCorners(lod.indices, lod.indices.size() / 3);
+		}
+	}
+	else {
+		size_t triCount = positions.size() / 3;
+		SwapTriangleCorners(positions,		triCount);
+		SwapTriangleCorners(colours,		triCount);
+		SwapTriangleCorners(texCoords,		triCount);
+		SwapTriangleCorners(normals,		triCount);
+		SwapTriangleCorners(tangents,		triCount);
+		SwapTriangleCorners(skinWeights,	triCount);
+		SwapTriangleCorners(skinIndices,	triCount);
+	}
+	for (Vector4& t : tangents) {
+		t.w = -t.w;
+	}
 }
 
-void	MeshGeometry::RecalculateTangents() {
+void	MeshGeometry::RecalculateNormals(NormalWeighting weighting) {
+	if (primType != GeometryPrimitive::Triangles) {
+		std::cout << __FUNCTION__ << " can only recalculate normals for triangle lists" << std::endl;
+		return;
+	}
+	const size_t vertexCount = positions.size();
+
+	if (indices.empty()) { //Nothing is shared, so each vertex just takes its face's normal
+		normals.resize(vertexCount);
+		ParallelFor(vertexCount / 3, TriangleBatchSize, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t) {
+				const Vector3* tri = &positions[t * 3];
+				Vector3 n = Vector3::Cross(tri[1] - tri[0], tri[2] - tri[0]).Normalised();
+				normals[t * 3 + 0] = n;
+				normals[t * 3 + 1] = n;
+				normals[t * 3 + 2] = n;
+			}
+		});
+		return;
+	}
+	if (!IndicesInRange(indices, vertexCount)) {
+		std::cout << __FUNCTION__ << " found indices past the end of the vertices" << std::endl;
+		return;
+	}
+	const size_t triCount = indices.size() / 3;
+
+	if (ParallelThreadCount(triCount, TriangleBatchSize) <= 1) {
+		//Summing straight into the vertices beats any parallel setup on one thread
+		normals.assign(vertexCount, Vector3());
+		for (size_t t = 0; t < triCount; ++t) {
+			const unsigned int* tri = &indices[t * 3];
+			if (weighting == NormalWeighting::Area) {
+				Vector3 n = Vector3::Cross(positions[tri[1]] - positions[tri[0]], positions[tri[2]] - positions[tri[0]]);
+				normals[tri[0]] += n;
+				normals[tri[1]] += n;
+				normals[tri[2]] += n;
+				continue;
+			}
+			Vector3 corners[3];
+			CornerNormals(positions, tri, weighting, corners);
+			normals[tri[0]] += corners[0];
+			normals[tri[1]] += corners[1];
+			normals[tri[2]] += corners[2];
+		}
+	}
+	else {
+		vector<Vector3> cornerNormals(triCount * 3);
+		ParallelFor(triCount, TriangleBatchSize, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t) {
+				CornerNormals(positions, &indices[t * 3], weighting, &cornerNormals[t * 3]);
+			}
+		});
+		VertexCorners vertexCorners(indices, vertexCount);
+		normals.resize(vertexCount);
+
+		ParallelFor(vertexCount, VertexBatchSize, [&](size_t begin, size_t end) {
+			for (size_t v = begin; v < end; ++v) {
+				Vector3 sum;
+				for (unsigned int i = vertexCorners.start[v]; i < vertexCorners.start[v + 1]; ++i) {
+					sum += cornerNormals[vertexCorners.corners[i]];
+				}
+				normals[v] = sum;
+			}
+		});
+	}
+	ParallelFor(vertexCount, VertexBatchSize, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v) {
+			normals[v].Normalise();
+		}
+	});
+}
 
+/*
+Lengyel's method - each triangle's tangent and bitangent follow its texture
+u and v directions, and are summed per vertex before being made orthogonal
+to the normal. The handedness of the result goes in the tangent's w
+*/
+void	MeshGeometry::RecalculateTangents() {
+	if (primType != GeometryPrimitive::Triangles) {
+		std::cout << __FUNCTION__ << " can only recalculate tangents for triangle lists" << std::endl;
+		return;
+	}
+	const size_t vertexCount = positions.size();
+	if (texCoords.size() != vertexCount) {
+		std::cout << __FUNCTION__ << " needs texture coordinates to build tangents from" << std::endl;
+		return;
+	}
+	if (!IndicesInRange(indices, vertexCount)) {
+		std::cout << __FUNCTION__ << " found indices past the end of the vertices" << std::endl;
+		return;
+	}
+	if (normals.size() != vertexCount) {
+		RecalculateNormals();
+	}
+	const bool		indexed		= !indices.empty();
+	const size_t	triCount	= (indexed ? indices.size() : vertexCount) / 3;
+
+	vector<Vector3> vertexTangents;
+	vector<Vector3> vertexBinormals;
+
+	if (!indexed) {
+		vertexTangents.resize(vertexCount);
+		vertexBinormals.resize(vertexCount);
+		ParallelFor(triCount, TriangleBatchSize, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t) {
+				unsigned int tri[3] = { (unsigned int)t * 3, (unsigned int)t * 3 + 1, (unsigned int)t * 3 + 2 };
+				Vector3 tangent;
+				Vector3 binormal;
+				FaceTangent(positions, texCoords, tri, tangent, binormal);
+				for (unsigned int v : tri) {
+					vertexTangents[v]	= tangent;
+					vertexBinormals[v]	= binormal;
+				}
+			}
+		});
+	}
+	else if (ParallelThreadCount(triCount, TriangleBatchSize) <= 1) {
+		vertexTangents.assign(vertexCount, Vector3());
+		vertexBinormals.assign(vertexCount, Vector3());
+		for (size_t t = 0; t < triCount; ++t) {
+			const unsigned int* tri = &indices[t * 3];
+			Vector3 tangent;
+			Vector3 binormal;
+			FaceTangent(positions, texCoords, tri, tangent, binormal);
+			for (int i = 0; i < 3; ++i) {
+				vertexTangents[tri[i]]	+= tangent;
+				vertexBinormals[tri[i]]	+= binormal;
+			}
+		}
+	}
+	else {
+		vector<Vector3> faceTangents(triCount);
+		vector<Vector3> faceBinormals(triCount);
+		ParallelFor(triCount, TriangleBatchSize, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; ++t) {
+				FaceTangent(positions, texCoords, &indices[t * 3], faceTangents[t], faceBinormals[t]);
+			}
+		});
+		VertexCorners vertexCorners(indices, vertexCount);
+		vertexTangents.resize(vertexCount);
+		vertexBinormals.resize(vertexCount);
+
+		ParallelFor(vertexCount, VertexBatchSize, [&](size_t begin, size_t end) {
+			for (size_t v = begin; v < end; ++v) {
+				Vector3 tangent;
+				Vector3 binormal;
+				for (unsigned int i = vertexCorners.start[v]; i < vertexCorners.start[v + 1]; ++i) {
+					unsigned int t = vertexCorners.corners[i] / 3;
+					if (t < triCount) { //skips any trailing partial triangle
+						tangent		+= faceTangents[t];
+						binormal	+= faceBinormals[t];
+					}
+				}
+				vertexTangents[v]	= tangent;
+				vertexBinormals[v]	= binormal;
+			}
+		});
+	}
+	tangents.resize(vertexCount);
+
+	ParallelFor(vertexCount, VertexBatchSize, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; ++v) {
+			const Vector3& n = normals[v];
+			Vector3 t = (vertexTangents[v] - n * Vector3::Dot(n, vertexTangents[v])).Normalised();
+			float handedness = Vector3::Dot(Vector3::Cross(n, t), vertexBinormals[v]) < 0.0f ? -1.0f : 1.0f;
+			tangents[v] = Vector4(t, handedness);
+		}
+	});
 }
 
 void MeshGeometry::SetVertexPositions(const vector<Vector3>& newVerts) {
-	positions = newVerts;
+	positions	= newVerts;
+	boundsDirty	= true;
+}
+
+void MeshGeometry::GetLocalBounds(Vector3& boundsMin, Vector3& boundsMax) const {
+	if (boundsDirty) {
+		localBoundsMin = positions.empty() ? Vector3() : positions[0];
+		localBoundsMax = localBoundsMin;
+		for (const Vector3& p : positions) {
+			localBoundsMin = Vector3(std::min(localBoundsMin.x, p.x), std::min(localBoundsMin.y, p.y), std::min(localBoundsMin.z, p.z));
+			localBoundsMax = Vector3(std::max(localBoundsMax.x, p.x), std::max(localBoundsMax.y, p.y), std::max(localBoundsMax.z, p.z));
+		}
+		boundsDirty = false;
+	}
+	boundsMin = localBoundsMin;
+	boundsMax = localBoundsMax;
 }
 
 void MeshGeometry::SetVertexTextureCoords(const vector<Vector2>& newTex) {
@@ -258,6 +1018,43 @@ void MeshGeometry::SetVertexIndices(const vector<unsigned int>& newIndices) {
 	indices = newIndices;
 }
 
+void MeshGeometry::SetLODs(const vector<MeshLOD>& newLods) {
+	lods		= newLods;
+	boundsDirty	= true;
+}
+
+bool MeshGeometry::GetLODSubMesh(unsigned int level, unsigned int subMesh, SubMesh& range) const {
+	if (level == 0) {
+		if (subMeshes.empty()) {
+			range = { 0, (int)indices.size() };
+			return subMesh == 0;
+		}
+		if (subMesh >= subMeshes.size()) {
+			return false;
+		}
+		range = subMeshes[subMesh];
+		return true;
+	}
+	if (level > lods.size() || subMesh >= lods[level - 1].subMeshes.size()) {
+		return false;
+	}
+	int start = (int)indices.size();
+	for (unsigned int i = 0; i < level - 1; ++i) {
+		start += (int)lods[i].indices.size();
+	}
+	range		= lods[level - 1].subMeshes[subMesh];
+	range.start += start;
+	return true;
+}
+
+unsigned int MeshGeometry::GetLODIndexCount() const {
+	size_t count = indices.size();
+	for (const MeshLOD& lod : lods) {
+		count += lod.indices.size();
+	}
+	return (unsigned int)count;
+}
+
 void MeshGeometry::SetVertexSkinWeights(const vector<Vector4>& newSkinWeights) {
 	skinWeights = newSkinWeights;
 }
@@ -275,6 +1072,28 @@ MeshGeometry* MeshGeometry::GenerateTriangle(MeshGeometry* input) {
 	return input;
 }
 
+void MeshGeometry::SwapWith(MeshGeometry& other) {
+	std::swap(debugName,		other.debugName);
+	std::swap(primType,			other.primType);
+	std::swap(positions,		other.positions);
+	std::swap(texCoords,		other.texCoords);
+	std::swap(colours,			other.colours);
+	std::swap(normals,			other.normals);
+	std::swap(tangents,			other.tangents);
+	std::swap(indices,			other.indices);
+	std::swap(subMeshes,		other.subMeshes);
+	std::swap(subMeshNames,		other.subMeshNames);
+	std::swap(lods,				other.lods);
+	std::swap(skinWeights,		other.skinWeights);
+	std::swap(skinIndices,		other.skinIndices);
+	std::swap(jointNames,		other.jointNames);
+	std::swap(jointParents,		other.jointParents);
+	std::swap(bindPose,			other.bindPose);
+	std::swap(inverseBindPose,	other.inverseBindPose);
+	boundsDirty			= true;
+	other.boundsDirty	= true;
+}
+
 void MeshGeometry::SetDebugName(const std::string& newName) {
 	debugName = newName;
 }
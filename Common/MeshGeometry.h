@@ -37,11 +37,23 @@ namespace NCL {
 		MAX_ATTRIBUTES
 	};
 
+	enum class NormalWeighting {
+		Area,	//faces count towards a vertex's normal in proportion to their size
+		Angle	//faces count by the angle they make at the vertex, so tessellation doesn't skew it
+	};
+
 	struct SubMesh {
 		int start;
 		int count;
 	};
 
+	//A simplified index list over the same vertices as the full detail mesh
+	struct MeshLOD {
+		vector<unsigned int>	indices;
+		vector<SubMesh>			subMeshes;	//one range of indices per sub mesh of the full mesh
+		float					error;		//furthest this level strays from the full mesh, in model space
+	};
+
 	class MeshGeometry
 	{
 	public:		
@@ -78,6 +90,23 @@ namespace NCL {
 			return &subMeshes[i];
 		}
 
+		//Level 0 is the full detail mesh
+		unsigned int GetLODCount() const {
+			return 1 + (unsigned int)lods.size();
+		}
+		float GetLODError(unsigned int level) const {
+			return (level == 0 || level > lods.size()) ? 0.0f : lods[level - 1].error;
+		}
+		const vector<MeshLOD>& GetLODData() const {
+			return lods;
+		}
+		void SetLODs(const vector<MeshLOD>& newLods);
+
+		//Every LOD's indices are placed after the full mesh's when uploaded,
+		//this gives a sub mesh's range within that combined index buffer
+		bool GetLODSubMesh(unsigned int level, unsigned int subMesh, SubMesh& range) const;
+		unsigned int GetLODIndexCount() const;
+
 		int GetIndexForJoint(const std::string &name) const;
 
 		const vector<Matrix4>& GetBindPose() const {
@@ -93,6 +122,9 @@ namespace NCL {
 		bool GetNormalForTri(unsigned int i, Vector3& n) const;
 		bool HasTriangle(unsigned int i) const;
 
+		//Axis aligned box around every vertex position, in the mesh's own space
+		void GetLocalBounds(Vector3& boundsMin, Vector3& boundsMax) const;
+
 		const vector<Vector3>&		GetPositionData()		const { return positions;	}
 		const vector<Vector2>&		GetTextureCoordData()	const { return texCoords;	}
 		const vector<Vector4>&		GetColourData()			const { return colours;		}
@@ -123,15 +155,29 @@ namespace NCL {
 		void SetVertexSkinIndices(const vector<Vector4>& newSkinIndices);
 
 
+		//Bakes an affine transform into the positions, normals and tangents,
+		//flipping the winding if the transform mirrors the mesh
 		void	TransformVertices(const Matrix4& byMatrix);
 
-		void RecalculateNormals();
+		//Smooth normals for indexed meshes, flat normals for non-indexed ones
+		void RecalculateNormals(NormalWeighting weighting = NormalWeighting::Area);
+		//Needs texture coordinates - normals are recalculated first if missing
 		void RecalculateTangents();
 
 		void SetDebugName(const std::string& debugName);
 
+		//Writes a chunked binary mesh, which the filename constructor picks
+		//up in place of a text .msh. Quantising stores normals, tangents,
+		//texture coordinates and skin weights as shorts, and colours as bytes
+		bool SaveBinaryMesh(const std::string& filename, bool quantise = false) const;
+		static bool IsBinaryMeshFile(const std::string& filename);
+
 		virtual void UploadToGPU(Rendering::RendererBase* renderer = nullptr) = 0;
 
+		//Exchanges contents with another mesh of the same type, so a reloaded
+		//mesh can take the place of one that's already being pointed to
+		virtual void SwapWith(MeshGeometry& other);
+
 		static MeshGeometry* GenerateTriangle(MeshGeometry* input);
 
 	protected:
@@ -144,6 +190,8 @@ namespace NCL {
 		void ReadSubMeshes(std::ifstream& file, int count);
 		void ReadSubMeshNames(std::ifstream& file, int count);
 
+		bool LoadBinaryMesh(const std::string& filename);
+
 		bool	GetVertexIndicesForTri(unsigned int i, unsigned int& a, unsigned int& b, unsigned int& c) const;
 
 		virtual bool ValidateMeshData();
@@ -160,6 +208,7 @@ namespace NCL {
 
 		vector<SubMesh>			subMeshes;
 		vector<std::string>		subMeshNames;
+		vector<MeshLOD>			lods;
 
 		//Allows us to have 4 weight skinning 
 		vector<Vector4>		skinWeights;
@@ -169,5 +218,10 @@ namespace NCL {
 
 		vector<Matrix4>		bindPose;
 		vector<Matrix4>		inverseBindPose;
+
+		//Worked out on first use after the positions change
+		mutable Vector3		localBoundsMin;
+		mutable Vector3		localBoundsMax;
+		mutable bool		boundsDirty = true;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,452 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "MeshOptimiser.h"
+#include "Vector2.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+
+namespace {
+	struct IndexRange {
+		unsigned int start;
+		unsigned int count;
+	};
+
+	//Each sub mesh is a range of the index buffer, and triangles mustn't leave it
+	vector<IndexRange> GetIndexRanges(const MeshGeometry& mesh) {
+		vector<IndexRange> ranges;
+		unsigned int indexCount = mesh.GetIndexCount();
+
+		for (unsigned int i = 0; i < mesh.GetSubMeshCount(); ++i) {
+			const SubMesh* m = mesh.GetSubMesh(i);
+			if (m->start >= 0 && m->count > 0 && (unsigned int)(m->start + m->count) <= indexCount) {
+				ranges.push_back({ (unsigned int)m->start, (unsigned int)(m->count - (m->count % 3)) });
+			}
+		}
+		if (ranges.empty()) {
+			ranges.push_back({ 0, indexCount - (indexCount % 3) });
+		}
+		return ranges;
+	}
+
+	template<class T>
+	bool StreamMatches(const vector<T>& stream, size_t vertexCount) {
+		return stream.empty() || stream.size() == vertexCount;
+	}
+
+	//Vertices can only be moved about if every attribute stream lines up
+	bool CanRemapVertices(const MeshGeometry& mesh) {
+		size_t count = mesh.GetVertexCount();
+		return	count > 0 &&
+				StreamMatches(mesh.GetColourData(),			count) &&
+				StreamMatches(mesh.GetTextureCoordData(),	count) &&
+				StreamMatches(mesh.GetNormalData(),			count) &&
+				StreamMatches(mesh.GetTangentData(),		count) &&
+				StreamMatches(mesh.GetSkinWeightData(),		count) &&
+				StreamMatches(mesh.GetSkinIndexData(),		count);
+	}
+
+	void MakeIndexed(MeshGeometry& mesh) {
+		if (mesh.GetIndexCount() > 0) {
+			return;
+		}
+		vector<unsigned int> indices(mesh.GetVertexCount());
+		std::iota(indices.begin(), indices.end(), 0);
+		mesh.SetVertexIndices(indices);
+	}
+
+	template<class T>
+	vector<T> RemapStream(const vector<T>& in, const vector<unsigned int>& newToOld) {
+		if (in.empty()) {
+			return in;
+		}
+		vector<T> out(newToOld.size());
+		for (size_t i = 0; i < newToOld.size(); ++i) {
+			out[i] = in[newToOld[i]];
+		}
+		return out;
+	}
+
+	void RemapVertices(MeshGeometry& mesh, const vector<unsigned int>& newToOld) {
+		mesh.SetVertexPositions(RemapStream(mesh.GetPositionData(), newToOld));
+		mesh.SetVertexColours(RemapStream(mesh.GetColourData(), newToOld));
+		mesh.SetVertexTextureCoords(RemapStream(mesh.GetTextureCoordData(), newToOld));
+		mesh.SetVertexNormals(RemapStream(mesh.GetNormalData(), newToOld));
+		mesh.SetVertexTangents(RemapStream(mesh.GetTangentData(), newToOld));
+		mesh.SetVertexSkinWeights(RemapStream(mesh.GetSkinWeightData(), newToOld));
+		mesh.SetVertexSkinIndices(RemapStream(mesh.GetSkinIndexData(), newToOld));
+	}
+
+	template<class T>
+	void AppendAttribute(std::string& key, const vector<T>& stream, unsigned int v) {
+		if (!stream.empty()) {
+			key.append((const char*)&stream[v], sizeof(T));
+		}
+	}
+
+	/*
+	Forsyth's linear-speed vertex cache optimisation. Vertices score higher
+	the more recently they were used, and the fewer triangles they have left
+	to go, and we greedily emit whichever triangle has the best total score.
+	*/
+	namespace Forsyth {
+		const float CacheDecayPower		= 1.5f;
+		const float LastTriScore		= 0.75f;
+		const float ValenceBoostScale	= 2.0f;
+		const float ValenceBoostPower	= 0.5f;
+
+		float VertexScore(int cachePosition, int remainingTris, int cacheSize) {
+			if (remainingTris == 0) {
+				return -1.0f;
+			}
+			float score = 0.0f;
+			if (cachePosition >= 0) {
+				if (cachePosition < 3) {
+					score = LastTriScore; //used by the last triangle, so no extra benefit
+				}
+				else {
+					score = std::pow(1.0f - (cachePosition - 3) / (float)(cacheSize - 3), CacheDecayPower);
+				}
+			}
+			return score + ValenceBoostScale * std::pow((float)remainingTris, -ValenceBoostPower);
+		}
+
+		void OptimiseRange(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, int cacheSize) {
+			unsigned int numTris = indexCount / 3;
+			if (numTris < 2) {
+				return;
+			}
+			vector<int> remaining(vertexCount, 0);
+			for (unsigned int i = 0; i < indexCount; ++i) {
+				remaining[indices[i]]++;
+			}
+			//Which triangles use each vertex, packed into one list
+			vector<int> triStart(vertexCount + 1, 0);
+			for (unsigned int v = 0; v < vertexCount; ++v) {
+				triStart[v + 1] = triStart[v] + remaining[v];
+			}
+			vector<int> triList(indexCount);
+			vector<int> fill(triStart.begin(), triStart.end() - 1);
+			for (unsigned int i = 0; i < indexCount; ++i) {
+				triList[fill[indices[i]]++] = i / 3;
+			}
+
+			vector<int>		cachePos(vertexCount, -1);
+			vector<float>	vertexScore(vertexCount, 0.0f);
+			for (unsigned int v = 0; v < vertexCount; ++v) {
+				vertexScore[v] = VertexScore(-1, remaining[v], cacheSize);
+			}
+			vector<float>	triScore(numTris);
+			vector<bool>	emitted(numTris, false);
+			for (unsigned int t = 0; t < numTris; ++t) {
+				triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+			}
+
+			vector<unsigned int> output;
+			output.reserve(indexCount);
+
+			vector<unsigned int> cache;
+			vector<unsigned int> newCache;
+			cache.reserve(cacheSize + 3);
+			newCache.reserve(cacheSize + 3);
+
+			int bestTri		= (int)(std::max_element(triScore.begin(), triScore.end()) - triScore.begin());
+			unsigned int scanPos = 0;
+
+			for (unsigned int n = 0; n < numTris; ++n) {
+				if (bestTri < 0) {
+					//Nothing in the cache has triangles left, so start somewhere new
+					while (emitted[scanPos]) {
+						scanPos++;
+					}
+					bestTri = scanPos;
+				}
+				emitted[bestTri] = true;
+				const unsigned int* tri = &indices[bestTri * 3];
+
+				newCache.clear();
+				for (int i = 0; i < 3; ++i) {
+					unsigned int v = tri[i];
+					output.push_back(v);
+
+					int* list = &triList[triStart[v]];
+					for (int j = 0; j < remaining[v]; ++j) {
+						if (list[j] == bestTri) {
+							std::swap(list[j], list[remaining[v] - 1]);
+							break;
+						}
+					}
+					remaining[v]--;
+					newCache.push_back(v);
+				}
+				for (unsigned int v : cache) {
+					if (v != tri[0] && v != tri[1] && v != tri[2]) {
+						newCache.push_back(v);
+					}
+				}
+				for (size_t i = 0; i < newCache.size(); ++i) {
+					unsigned int v	= newCache[i];
+					cachePos[v]		= i < (size_t)cacheSize ? (int)i : -1;
+					vertexScore[v]	= VertexScore(cachePos[v], remaining[v], cacheSize);
+				}
+				bestTri			= -1;
+				float bestScore = -1.0f;
+				for (unsigned int v : newCache) {
+					const int* list = &triList[triStart[v]];
+					for (int j = 0; j < remaining[v]; ++j) {
+						int t = list[j];
+						triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+						if (triScore[t] > bestScore) {
+							bestScore	= triScore[t];
+							bestTri		= t;
+						}
+					}
+				}
+				if (newCache.size() > (size_t)cacheSize) {
+					newCache.resize(cacheSize);
+				}
+				std::swap(cache, newCache);
+			}
+			std::copy(output.begin(), output.end(), indices);
+		}
+	}
+
+	//Counts misses in a FIFO cache, using the time each vertex went in
+	struct FIFOCache {
+		FIFOCache(unsigned int vertexCount, int size) : entryTime(vertexCount, 0), cacheSize(size), time((unsigned int)size + 1) {
+		}
+		bool Touch(unsigned int v) {
+			if (time - entryTime[v] > (unsigned int)cacheSize) {
+				entryTime[v] = time++;
+				return true;
+			}
+			return false;
+		}
+		vector<unsigned int>	entryTime;
+		int						cacheSize;
+		unsigned int			time;
+	};
+
+	/*
+	Splits the (already cache ordered) triangles into clusters wherever the
+	vertex cache would have been flushed anyway, then sorts the clusters so
+	those facing away from the mesh centre are drawn first - they're the
+	ones most likely to hide the rest. Only whole clusters move, so the
+	cache ordering within each one is kept.
+	*/
+	void OptimiseOverdrawRange(unsigned int* indices, unsigned int indexCount, const vector<Vector3>& positions) {
+		unsigned int numTris = indexCount / 3;
+		if (numTris < 2) {
+			return;
+		}
+		vector<unsigned int> clusterStarts;
+		FIFOCache cache((unsigned int)positions.size(), 16);
+		for (unsigned int t = 0; t < numTris; ++t) {
+			int misses = 0;
+			for (int i = 0; i < 3; ++i) {
+				misses += cache.Touch(indices[t * 3 + i]) ? 1 : 0;
+			}
+			if (misses == 3) {
+				clusterStarts.push_back(t);
+			}
+		}
+		if (clusterStarts.empty() || clusterStarts[0] != 0) {
+			clusterStarts.insert(clusterStarts.begin(), 0);
+		}
+		clusterStarts.push_back(numTris);
+		size_t numClusters = clusterStarts.size() - 1;
+		if (numClusters < 2) {
+			return;
+		}
+
+		vector<Vector3> clusterCentre(numClusters);
+		vector<Vector3> clusterNormal(numClusters);
+		Vector3 meshCentre;
+		float	meshArea = 0.0f;
+
+		for (size_t c = 0; c < numClusters; ++c) {
+			float area = 0.0f;
+			for (unsigned int t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t) {
+				const Vector3& a = positions[indices[t * 3]];
+				const Vector3& b = positions[indices[t * 3 + 1]];
+				const Vector3& d = positions[indices[t * 3 + 2]];
+
+				Vector3 normal	= Vector3::Cross(b - a, d - a);
+				float	triArea = normal.Length();
+
+				clusterCentre[c] += (a + b + d) * (triArea / 3.0f);
+				clusterNormal[c] += normal;
+				area += triArea;
+			}
+			meshCentre	+= clusterCentre[c];
+			meshArea	+= area;
+			clusterCentre[c] = area > 0.0f ? clusterCentre[c] / area : positions[indices[clusterStarts[c] * 3]];
+			clusterNormal[c].Normalise();
+		}
+		if (meshArea > 0.0f) {
+			meshCentre = meshCentre / meshArea;
+		}
+
+		vector<float>	sortKey(numClusters);
+		vector<size_t>	order(numClusters);
+		for (size_t c = 0; c < numClusters; ++c) {
+			sortKey[c]	= Vector3::Dot(clusterCentre[c] - meshCentre, clusterNormal[c]);
+			order[c]	= c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+		vector<unsigned int> output;
+		output.reserve(indexCount);
+		for (size_t c : order) {
+			output.insert(output.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+		}
+		std::copy(output.begin(), output.end(), indices);
+	}
+}
+
+void MeshOptimiser::Optimise(MeshGeometry& mesh, const MeshOptimiseOptions& options) {
+	if (mesh.GetPrimitiveType() != GeometryPrimitive::Triangles || mesh.GetVertexCount() == 0) {
+		return;
+	}
+	if (options.deduplicate) {
+		DeduplicateVertices(mesh);
+	}
+	if (options.vertexCacheOrder) {
+		OptimiseVertexCache(mesh, options.cacheSize);
+	}
+	if (options.overdrawOrder) {
+		OptimiseOverdraw(mesh);
+	}
+	if (options.vertexFetchOrder) {
+		OptimiseVertexFetch(mesh);
+	}
+}
+
+void MeshOptimiser::DeduplicateVertices(MeshGeometry& mesh) {
+	if (!CanRemapVertices(mesh)) {
+		return;
+	}
+	MakeIndexed(mesh);
+
+	unsigned int numVertices = mesh.GetVertexCount();
+
+	std::unordered_map<std::string, unsigned int> uniqueVertices;
+	uniqueVertices.reserve(numVertices);
+
+	vector<unsigned int> oldToNew(numVertices);
+	vector<unsigned int> newToOld;
+	newToOld.reserve(numVertices);
+
+	std::string key;
+	for (unsigned int v = 0; v < numVertices; ++v) {
+		key.clear();
+		AppendAttribute(key, mesh.GetPositionData(),		v);
+		AppendAttribute(key, mesh.GetColourData(),			v);
+		AppendAttribute(key, mesh.GetTextureCoordData(),	v);
+		AppendAttribute(key, mesh.GetNormalData(),			v);
+		AppendAttribute(key, mesh.GetTangentData(),			v);
+		AppendAttribute(key, mesh.GetSkinWeightData(),		v);
+		AppendAttribute(key, mesh.GetSkinIndexData(),		v);
+
+		auto result = uniqueVertices.emplace(key, (unsigned int)newToOld.size());
+		if (result.second) {
+			newToOld.push_back(v);
+		}
+		oldToNew[v] = result.first->second;
+	}
+	if (newToOld.size() == numVertices) {
+		return;
+	}
+	vector<unsigned int> indices = mesh.GetIndexData();
+	for (unsigned int& i : indices) {
+		i = oldToNew[i];
+	}
+	RemapVertices(mesh, newToOld);
+	mesh.SetVertexIndices(indices);
+}
+
+void MeshOptimiser::OptimiseVertexCache(MeshGeometry& mesh, int cacheSize) {
+	MakeIndexed(mesh);
+
+	vector<unsigned int> indices = mesh.GetIndexData();
+	for (const IndexRange& r : GetIndexRanges(mesh)) {
+		Forsyth::OptimiseRange(&indices[r.start], r.count, mesh.GetVertexCount(), cacheSize);
+	}
+	mesh.SetVertexIndices(indices);
+}
+
+void MeshOptimiser::OptimiseOverdraw(MeshGeometry& mesh) {
+	MakeIndexed(mesh);
+
+	vector<unsigned int> indices = mesh.GetIndexData();
+	for (const IndexRange& r : GetIndexRanges(mesh)) {
+		OptimiseOverdrawRange(&indices[r.start], r.count, mesh.GetPositionData());
+	}
+	mesh.SetVertexIndices(indices);
+}
+
+//Lays vertices out in the order the index buffer first uses them. Unused vertices are dropped
+void MeshOptimiser::OptimiseVertexFetch(MeshGeometry& mesh) {
+	if (!CanRemapVertices(mesh)) {
+		return;
+	}
+	MakeIndexed(mesh);
+
+	vector<unsigned int>	indices = mesh.GetIndexData();
+	vector<int>				oldToNew(mesh.GetVertexCount(), -1);
+	vector<unsigned int>	newToOld;
+	newToOld.reserve(mesh.GetVertexCount());
+
+	for (unsigned int& i : indices) {
+		if (oldToNew[i] < 0) {
+			oldToNew[i] = (int)newToOld.size();
+			newToOld.push_back(i);
+		}
+		i = oldToNew[i];
+	}
+	RemapVertices(mesh, newToOld);
+	mesh.SetVertexIndices(indices);
+}
+
+MeshCacheStats MeshOptimiser::AnalyseVertexCache(const MeshGeometry& mesh, int cacheSize) {
+	MeshCacheStats stats;
+
+	unsigned int numVertices	= mesh.GetVertexCount();
+	unsigned int numIndices		= mesh.GetIndexCount() > 0 ? mesh.GetIndexCount() : numVertices;
+	unsigned int numTris		= numIndices / 3;
+	if (numTris == 0) {
+		return stats;
+	}
+	const vector<unsigned int>& indices = mesh.GetIndexData();
+
+	FIFOCache		cache(numVertices, cacheSize);
+	vector<bool>	used(numVertices, false);
+	unsigned int	misses		= 0;
+	unsigned int	usedCount	= 0;
+
+	for (unsigned int i = 0; i < numTris * 3; ++i) {
+		unsigned int v = indices.empty() ? i : indices[i];
+		misses += cache.Touch(v) ? 1 : 0;
+		if (!used[v]) {
+			used[v] = true;
+			usedCount++;
+		}
+	}
+	stats.acmr = misses / (float)numTris;
+	stats.atvr = misses / (float)usedCount;
+	return stats;
+}
@@ -0,0 +1,50 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "MeshGeometry.h"
+
+namespace NCL {
+	struct MeshCacheStats {
+		float acmr = 0.0f;	//average cache miss ratio - transformed vertices per triangle, 0.5 at best
+		float atvr = 0.0f;	//average transform to vertex ratio - 1.0 at best
+	};
+
+	struct MeshOptimiseOptions {
+		bool	deduplicate			= true;
+		bool	vertexCacheOrder	= true;
+		bool	overdrawOrder		= true;
+		bool	vertexFetchOrder	= true;
+		int		cacheSize			= 32;
+	};
+
+	/*
+	Reorders a triangle mesh's index and vertex data to suit the GPU, without
+	changing what it looks like. Each stage can be run on its own, but they're
+	meant to be run in the order Optimise uses: merge duplicate vertices, sort
+	triangles for the post-transform cache (Forsyth's algorithm), regroup them
+	so outward facing parts of the mesh tend to be drawn first, then lay the
+	vertices out in the order they're first used.
+
+	Triangles are only ever reordered within their own sub mesh, and meshes
+	whose attribute streams don't all match the vertex count only get their
+	triangles reordered, as their vertices can't safely be moved.
+	*/
+	class MeshOptimiser	{
+	public:
+		static void Optimise(MeshGeometry& mesh, const MeshOptimiseOptions& options = MeshOptimiseOptions());
+
+		static void DeduplicateVertices(MeshGeometry& mesh);
+		static void OptimiseVertexCache(MeshGeometry& mesh, int cacheSize = 32);
+		static void OptimiseOverdraw(MeshGeometry& mesh);
+		static void OptimiseVertexFetch(MeshGeometry& mesh);
+
+		//Simulates a FIFO post-transform cache of the given size
+		static MeshCacheStats AnalyseVertexCache(const MeshGeometry& mesh, int cacheSize = 32);
+	};
+}
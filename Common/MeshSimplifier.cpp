@@ -0,0 +1,630 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "MeshSimplifier.h"
+#include "Vector2.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <climits>
+
+using namespace NCL;
+using namespace Maths;
+
+namespace {
+	//Sum of squared distances to a set of planes, as a symmetric 4x4 matrix
+	struct Quadric {
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0; //total area of the faces that went into it
+
+		void AddPlane(const Vector3& n, float d, double w) {
+			a00 += w * n.x * n.x;	a01 += w * n.x * n.y;	a02 += w * n.x * n.z;
+			a11 += w * n.y * n.y;	a12 += w * n.y * n.z;	a22 += w * n.z * n.z;
+			b0	+= w * n.x * d;		b1	+= w * n.y * d;		b2	+= w * n.z * d;
+			c	+= w * d * d;
+		}
+
+		void Add(const Quadric& o) {
+			a00 += o.a00;	a01 += o.a01;	a02 += o.a02;
+			a11 += o.a11;	a12 += o.a12;	a22 += o.a22;
+			b0	+= o.b0;	b1	+= o.b1;	b2	+= o.b2;
+			c	+= o.c;
+			weight += o.weight;
+		}
+
+		double Evaluate(const Vector3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double r =	a00 * x * x + a11 * y * y + a22 * z * z +
+						2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+						2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return std::max(r, 0.0);
+		}
+	};
+
+	//Collapses are scored by the RMS distance to the planes they've absorbed
+	float QuadricError(const Quadric& a, const Quadric& b, const Vector3& p) {
+		double error	= a.Evaluate(p) + b.Evaluate(p);
+		double weight	= a.weight + b.weight;
+		return (float)std::sqrt(weight > 0.0 ? error / weight : error);
+	}
+
+	template<class T>
+	bool StreamMatches(const vector<T>& stream, size_t vertexCount) {
+		return stream.empty() || stream.size() == vertexCount;
+	}
+
+	//Exported meshes often split vertices whose attributes only differ by
+	//rounding - anything this close is treated as the same vertex, rather
+	//than as a seam that has to be kept
+	const float WeldNormalDot	= 0.999f;
+	const float WeldTexCoord	= 1.0f / 4096.0f;
+	const float WeldOther		= 1.0f / 512.0f;
+
+	bool SameAttributes(const MeshGeometry& mesh, unsigned int a, unsigned int b) {
+		const vector<Vector3>& normals		= mesh.GetNormalData();
+		const vector<Vector4>& tangents		= mesh.GetTangentData();
+		const vector<Vector2>& texCoords	= mesh.GetTextureCoordData();
+		const vector<Vector4>& colours		= mesh.GetColourData();
+		const vector<Vector4>& weights		= mesh.GetSkinWeightData();
+		const vector<Vector4>& joints		= mesh.GetSkinIndexData();
+
+		if (!normals.empty() && Vector3::Dot(normals[a], normals[b]) < WeldNormalDot) {
+			return false;
+		}
+		if (!tangents.empty() && (tangents[a].w != tangents[b].w ||
+			Vector3::Dot(Vector3(tangents[a].x, tangents[a].y, tangents[a].z), Vector3(tangents[b].x, tangents[b].y, tangents[b].z)) < WeldNormalDot)) {
+			return false;
+		}
+		if (!texCoords.empty() && (std::abs(texCoords[a].x - texCoords[b].x) > WeldTexCoord || std::abs(texCoords[a].y - texCoords[b].y) > WeldTexCoord)) {
+			return false;
+		}
+		for (int i = 0; i < 4; ++i) {
+			if (!colours.empty() && std::abs(colours[a][i] - colours[b][i]) > WeldOther) {
+				return false;
+			}
+			if (!weights.empty() && std::abs(weights[a][i] - weights[b][i]) > WeldOther) {
+				return false;
+			}
+			if (!joints.empty() && joints[a][i] != joints[b][i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+	Maps each vertex onto the first vertex that has exactly the same position,
+	and onto the first vertex at that position with near enough the same
+	attributes - the simplifier works on the latter.
+	*/
+	void WeldVertices(const MeshGeometry& mesh, vector<unsigned int>& positionOf, vector<unsigned int>& vertexOf) {
+		const vector<Vector3>& positions = mesh.GetPositionData();
+
+		vector<unsigned int> order(positions.size());
+		for (unsigned int i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+			int c = memcmp(&positions[a], &positions[b], sizeof(Vector3));
+			return c < 0 || (c == 0 && a < b);
+		});
+		bool canWeld =	StreamMatches(mesh.GetNormalData(),			positions.size()) &&
+						StreamMatches(mesh.GetTangentData(),		positions.size()) &&
+						StreamMatches(mesh.GetTextureCoordData(),	positions.size()) &&
+						StreamMatches(mesh.GetColourData(),			positions.size()) &&
+						StreamMatches(mesh.GetSkinWeightData(),		positions.size()) &&
+						StreamMatches(mesh.GetSkinIndexData(),		positions.size());
+
+		positionOf.resize(positions.size());
+		vertexOf.resize(positions.size());
+		size_t groupStart = 0;
+		for (size_t i = 0; i < order.size(); ++i) {
+			unsigned int v = order[i];
+			if (i == 0 || memcmp(&positions[v], &positions[order[i - 1]], sizeof(Vector3)) != 0) {
+				groupStart = i;
+			}
+			positionOf[v]	= order[groupStart];
+			vertexOf[v]		= v;
+			for (size_t j = groupStart; j < i && canWeld; ++j) {
+				if (vertexOf[order[j]] == order[j] && SameAttributes(mesh, order[j], v)) {
+					vertexOf[v] = order[j];
+					break;
+				}
+			}
+		}
+	}
+
+	float BoundingRadius(const vector<Vector3>& positions) {
+		if (positions.empty()) {
+			return 0.0f;
+		}
+		Vector3 minBounds = positions[0];
+		Vector3 maxBounds = positions[0];
+		for (const Vector3& p : positions) {
+			minBounds = Vector3(std::min(minBounds.x, p.x), std::min(minBounds.y, p.y), std::min(minBounds.z, p.z));
+			maxBounds = Vector3(std::max(maxBounds.x, p.x), std::max(maxBounds.y, p.y), std::max(maxBounds.z, p.z));
+		}
+		return (maxBounds - minBounds).Length() * 0.5f;
+	}
+
+	struct DirectedEdge {
+		unsigned long long	key;	//from position, to position
+		unsigned int		from;	//vertices
+		unsigned int		to;
+	};
+
+	unsigned long long EdgeKey(unsigned int a, unsigned int b) {
+		return ((unsigned long long)a << 32) | b;
+	}
+
+	struct Collapse {
+		unsigned int	from;
+		unsigned int	to;
+		float			cost;
+		float			reverseCost; //cost of going the other way, FLT_MAX if that isn't allowed
+	};
+
+	/*
+	A triangle list being collapsed down over a fixed set of vertices. The
+	work happens in passes - each pass finds the cheapest collapse for every
+	edge, then performs as many as it can in cost order, locking everything
+	around a collapse so that later ones in the same pass are still valid.
+	It can be run again with a lower target to carry on where it left off.
+	*/
+	class Simplification {
+	public:
+		Simplification(const MeshGeometry& mesh, const vector<unsigned int>& positionOf, const vector<unsigned int>& vertexOf,
+			const vector<unsigned int>& input, const MeshSimplifyOptions& options, float radius)
+			: positions(mesh.GetPositionData()), positionOf(positionOf), indices(input) {
+			skinWeights = mesh.GetSkinWeightData().size() == positions.size() ? &mesh.GetSkinWeightData() : nullptr;
+			skinIndices = mesh.GetSkinIndexData().size() == positions.size() ? &mesh.GetSkinIndexData() : nullptr;
+			skinPenalty = options.skinWeight * radius;
+			error		= 0.0f;
+
+			indices.resize(indices.size() - (indices.size() % 3));
+			for (unsigned int& i : indices) {
+				i = vertexOf[i];
+			}
+			quadrics.resize(positions.size());
+			remap.resize(positions.size());
+			for (unsigned int i = 0; i < remap.size(); ++i) {
+				remap[i] = i;
+			}
+			BuildQuadrics(options.borderWeight);
+		}
+
+		void Run(size_t targetIndexCount, float maxError) {
+			while (indices.size() > targetIndexCount) {
+				if (!Pass(targetIndexCount, maxError)) {
+					break;
+				}
+			}
+		}
+
+		const vector<unsigned int>& GetIndices() const {
+			return indices;
+		}
+
+		float GetError() const {
+			return error;
+		}
+
+	protected:
+		unsigned int PositionOf(unsigned int v) const {
+			return positionOf[v];
+		}
+
+		void BuildQuadrics(float borderWeight) {
+			vector<Vector3> faceNormals(indices.size() / 3);
+
+			for (size_t t = 0; t < indices.size() / 3; ++t) {
+				unsigned int a = PositionOf(indices[t * 3]);
+				unsigned int b = PositionOf(indices[t * 3 + 1]);
+				unsigned int c = PositionOf(indices[t * 3 + 2]);
+
+				Vector3 n		= Vector3::Cross(positions[b] - positions[a], positions[c] - positions[a]);
+				float	length	= n.Length();
+				if (length <= 0.0f) {
+					continue;
+				}
+				n = n / length;
+				faceNormals[t] = n;
+
+				Quadric q;
+				q.AddPlane(n, -Vector3::Dot(n, positions[a]), length * 0.5);
+				q.weight = length * 0.5;
+				quadrics[a].Add(q);
+				quadrics[b].Add(q);
+				quadrics[c].Add(q);
+			}
+			//Open edges, and seams where either side uses different vertices,
+			//get a plane at right angles to the face to hold them in place
+			BuildEdges();
+			for (size_t i = 0; i < edges.size(); ++i) {
+				const DirectedEdge& e = edges[i];
+				const DirectedEdge* opposite = FindEdge(PositionOf(e.to), PositionOf(e.from));
+				if (opposite && opposite->from == e.to && opposite->to == e.from) {
+					continue;
+				}
+				unsigned int a = PositionOf(e.from);
+				unsigned int b = PositionOf(e.to);
+				Vector3 edge	= positions[b] - positions[a];
+				Vector3 n		= Vector3::Cross(faceNormals[edgeTris[i]], edge);
+				float	length	= n.Length();
+				if (length <= 0.0f) {
+					continue;
+				}
+				n = n / length;
+
+				Quadric q;
+				q.AddPlane(n, -Vector3::Dot(n, positions[a]), edge.LengthSquared() * borderWeight);
+				quadrics[a].Add(q);
+				quadrics[b].Add(q);
+			}
+		}
+
+		void BuildEdges() {
+			edges.clear();
+			edges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); ++i) {
+				unsigned int from	= indices[i];
+				unsigned int to		= indices[(i % 3 == 2) ? i - 2 : i + 1];
+				edges.push_back({ EdgeKey(PositionOf(from), PositionOf(to)), from, to });
+			}
+			vector<unsigned int> order(edges.size());
+			for (unsigned int i = 0; i < order.size(); ++i) {
+				order[i] = i;
+			}
+			std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+				return edges[a].key < edges[b].key;
+			});
+			vector<DirectedEdge> sorted(edges.size());
+			edgeTris.resize(edges.size());
+			for (size_t i = 0; i < order.size(); ++i) {
+				sorted[i]	= edges[order[i]];
+				edgeTris[i] = order[i] / 3;
+			}
+			edges.swap(sorted);
+		}
+
+		const DirectedEdge* FindEdge(unsigned int from, unsigned int to) const {
+			unsigned long long key = EdgeKey(from, to);
+			auto i = std::lower_bound(edges.begin(), edges.end(), key, [](const DirectedEdge& e, unsigned long long k) {
+				return e.key < k;
+			});
+			return (i != edges.end() && i->key == key) ? &(*i) : nullptr;
+		}
+
+		void BuildAdjacency() {
+			triStart.assign(positions.size() + 1, 0);
+			for (unsigned int i : indices) {
+				triStart[PositionOf(i) + 1]++;
+			}
+			for (size_t i = 1; i < triStart.size(); ++i) {
+				triStart[i] += triStart[i - 1];
+			}
+			triList.resize(indices.size());
+			vector<unsigned int> fill(triStart.begin(), triStart.end() - 1);
+			for (size_t i = 0; i < indices.size(); ++i) {
+				triList[fill[PositionOf(indices[i])]++] = (unsigned int)(i / 3);
+			}
+			//Border vertices may only slide along their border
+			border.assign(positions.size(), 0);
+			for (size_t i = 0; i < edges.size(); ++i) {
+				const DirectedEdge& e = edges[i];
+				bool duplicated = (i > 0 && edges[i - 1].key == e.key) || (i + 1 < edges.size() && edges[i + 1].key == e.key);
+				if (duplicated || !FindEdge(PositionOf(e.to), PositionOf(e.from))) {
+					border[PositionOf(e.from)]	= 1;
+					border[PositionOf(e.to)]	= 1;
+				}
+			}
+		}
+
+		float SkinDifference(unsigned int a, unsigned int b) const {
+			if (!skinWeights || !skinIndices) {
+				return 0.0f;
+			}
+			const float* wa = (const float*)&(*skinWeights)[a];
+			const float* wb = (const float*)&(*skinWeights)[b];
+			const float* ja = (const float*)&(*skinIndices)[a];
+			const float* jb = (const float*)&(*skinIndices)[b];
+
+			float difference = 0.0f;
+			for (int i = 0; i < 4; ++i) {
+				float other = 0.0f;
+				for (int j = 0; j < 4; ++j) {
+					other += (jb[j] == ja[i]) ? wb[j] : 0.0f;
+				}
+				difference += std::abs(wa[i] - other);
+				float mine = 0.0f;
+				for (int j = 0; j < 4; ++j) {
+					mine += (ja[j] == jb[i]) ? wa[j] : 0.0f;
+				}
+				difference += (mine == 0.0f) ? wb[i] : 0.0f;
+			}
+			return difference * 0.5f;
+		}
+
+		float CollapseCost(unsigned int from, unsigned int to, bool borderEdge) const {
+			if (border[from] && !borderEdge) {
+				return FLT_MAX;
+			}
+			return QuadricError(quadrics[from], quadrics[to], positions[to]) + SkinDifference(from, to) * skinPenalty;
+		}
+
+		/*
+		Every triangle around 'from' that also uses 'to' tells us which vertex
+		each of from's vertices becomes. If any of from's vertices can't be
+		mapped that way, the collapse would drag a seam off its edge.
+		*/
+		bool CanCollapse(unsigned int from, unsigned int to, vector<std::pair<unsigned int, unsigned int>>& mapping) const {
+			mapping.clear();
+			for (unsigned int i = triStart[from]; i < triStart[from + 1]; ++i) {
+				const unsigned int* tri = &indices[triList[i] * 3];
+				unsigned int fromVertex = 0;
+				unsigned int toVertex	= UINT_MAX;
+				for (int j = 0; j < 3; ++j) {
+					unsigned int p = PositionOf(tri[j]);
+					if (p == from) {
+						fromVertex = tri[j];
+					}
+					else if (p == to) {
+						toVertex = tri[j];
+					}
+				}
+				if (toVertex == UINT_MAX) {
+					continue;
+				}
+				auto existing = std::find_if(mapping.begin(), mapping.end(), [&](const std::pair<unsigned int, unsigned int>& m) {
+					return m.first == fromVertex;
+				});
+				if (existing == mapping.end()) {
+					mapping.emplace_back(fromVertex, toVertex);
+				}
+				else if (existing->second != toVertex) {
+					return false;
+				}
+			}
+			for (unsigned int i = triStart[from]; i < triStart[from + 1]; ++i) {
+				const unsigned int* tri = &indices[triList[i] * 3];
+				Vector3 oldPos[3];
+				Vector3 newPos[3];
+				bool	usesTo = false;
+				for (int j = 0; j < 3; ++j) {
+					unsigned int p = PositionOf(tri[j]);
+					usesTo |= (p == to);
+					oldPos[j] = positions[p];
+					newPos[j] = (p == from) ? positions[to] : oldPos[j];
+					if (p == from && std::find_if(mapping.begin(), mapping.end(), [&](const std::pair<unsigned int, unsigned int>& m) {
+							return m.first == tri[j];
+						}) == mapping.end()) {
+						return false;
+					}
+				}
+				if (usesTo) {
+					continue; //this one disappears
+				}
+				Vector3 oldNormal = Vector3::Cross(oldPos[1] - oldPos[0], oldPos[2] - oldPos[0]);
+				Vector3 newNormal = Vector3::Cross(newPos[1] - newPos[0], newPos[2] - newPos[0]);
+				if (Vector3::Dot(oldNormal, newNormal) <= 0.0f) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool Pass(size_t targetIndexCount, float maxError) {
+			BuildEdges();
+			BuildAdjacency();
+
+			vector<Collapse> collapses;
+			collapses.reserve(edges.size() / 2);
+			for (size_t i = 0; i < edges.size(); ++i) {
+				const DirectedEdge& e = edges[i];
+				if (i > 0 && edges[i - 1].key == e.key) {
+					continue;
+				}
+				unsigned int a = PositionOf(e.from);
+				unsigned int b = PositionOf(e.to);
+				bool borderEdge = !FindEdge(b, a);
+				if (!borderEdge && a > b) {
+					continue; //the opposite edge covers this one
+				}
+				float forward	= CollapseCost(a, b, borderEdge);
+				float backward	= CollapseCost(b, a, borderEdge);
+				if (forward == FLT_MAX && backward == FLT_MAX) {
+					continue;
+				}
+				if (forward <= backward) {
+					collapses.push_back({ a, b, forward, backward });
+				}
+				else {
+					collapses.push_back({ b, a, backward, forward });
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+				return a.cost < b.cost;
+			});
+
+			vector<char> locked(positions.size(), 0);
+			vector<std::pair<unsigned int, unsigned int>> mapping;
+			vector<unsigned int> remapped;
+
+			size_t	triCount		= indices.size() / 3;
+			size_t	targetTriCount	= targetIndexCount / 3;
+			int		performed		= 0;
+
+			for (const Collapse& c : collapses) {
+				if (triCount <= targetTriCount || c.cost > maxError) {
+					break;
+				}
+				unsigned int from	= c.from;
+				unsigned int to		= c.to;
+				float		 cost	= c.cost;
+				if (locked[from] || locked[to]) {
+					continue;
+				}
+				if (!CanCollapse(from, to, mapping)) {
+					if (c.reverseCost > maxError || !CanCollapse(to, from, mapping)) {
+						continue;
+					}
+					std::swap(from, to);
+					cost = c.reverseCost;
+				}
+				for (unsigned int i = triStart[from]; i < triStart[from + 1]; ++i) {
+					const unsigned int* tri = &indices[triList[i] * 3];
+					bool usesTo = false;
+					for (int j = 0; j < 3; ++j) {
+						locked[PositionOf(tri[j])] = 1;
+						usesTo |= PositionOf(tri[j]) == to;
+					}
+					triCount -= usesTo ? 1 : 0;
+				}
+				for (const auto& m : mapping) {
+					remap[m.first] = m.second;
+					remapped.push_back(m.first);
+				}
+				quadrics[to].Add(quadrics[from]);
+				error = std::max(error, cost);
+				performed++;
+			}
+			if (performed == 0) {
+				return false;
+			}
+			size_t out = 0;
+			for (size_t t = 0; t < indices.size(); t += 3) {
+				unsigned int a = remap[indices[t]];
+				unsigned int b = remap[indices[t + 1]];
+				unsigned int c = remap[indices[t + 2]];
+				unsigned int pa = PositionOf(a);
+				unsigned int pb = PositionOf(b);
+				unsigned int pc = PositionOf(c);
+				if (pa == pb || pb == pc || pa == pc) {
+					continue;
+				}
+				indices[out++] = a;
+				indices[out++] = b;
+				indices[out++] = c;
+			}
+			indices.resize(out);
+			for (unsigned int v : remapped) {
+				remap[v] = v;
+			}
+			return true;
+		}
+
+		const vector<Vector3>&		positions;
+		const vector<unsigned int>& positionOf;
+		const vector<Vector4>*		skinWeights;
+		const vector<Vector4>*		skinIndices;
+		float						skinPenalty;
+
+		vector<unsigned int>	indices;
+		vector<Quadric>			quadrics;	//indexed by position
+		vector<unsigned int>	remap;		//where each vertex goes in the current pass
+		float					error;
+
+		vector<DirectedEdge>	edges;		//sorted by key
+		vector<unsigned int>	edgeTris;
+		vector<unsigned int>	triStart;	//triangles around each position
+		vector<unsigned int>	triList;
+		vector<char>			border;
+	};
+
+	bool CanSimplify(const MeshGeometry& mesh) {
+		return mesh.GetPrimitiveType() == GeometryPrimitive::Triangles && mesh.GetIndexCount() >= 3;
+	}
+}
+
+float MeshSimplifier::Simplify(const MeshGeometry& mesh, const vector<unsigned int>& input, vector<unsigned int>& output,
+	size_t targetIndexCount, float maxError, const MeshSimplifyOptions& options) {
+	if (mesh.GetPrimitiveType() != GeometryPrimitive::Triangles) {
+		output = input;
+		return 0.0f;
+	}
+	vector<unsigned int> positionOf;
+	vector<unsigned int> vertexOf;
+	WeldVertices(mesh, positionOf, vertexOf);
+
+	Simplification s(mesh, positionOf, vertexOf, input, options, BoundingRadius(mesh.GetPositionData()));
+	s.Run(targetIndexCount, maxError);
+	output = s.GetIndices();
+	return s.GetError();
+}
+
+/*
+Each sub mesh is simplified on its own, so the edges between them act as
+borders, and each level carries on from the one before - the quadrics still
+measure against the full detail surface, so the errors are absolute.
+A level that barely removes anything ends the chain.
+*/
+int MeshSimplifier::GenerateLODs(MeshGeometry& mesh, const MeshSimplifyOptions& options) {
+	mesh.SetLODs({});
+	if (!CanSimplify(mesh)) {
+		return 0;
+	}
+	const vector<unsigned int>& indices = mesh.GetIndexData();
+
+	vector<SubMesh> ranges;
+	for (unsigned int i = 0; i < mesh.GetSubMeshCount(); ++i) {
+		SubMesh range;
+		mesh.GetLODSubMesh(0, i, range);
+		ranges.push_back(range);
+	}
+	if (ranges.empty()) {
+		ranges.push_back({ 0, (int)indices.size() });
+	}
+
+	const float radius = BoundingRadius(mesh.GetPositionData());
+	vector<unsigned int> positionOf;
+	vector<unsigned int> vertexOf;
+	WeldVertices(mesh, positionOf, vertexOf);
+
+	vector<Simplification> parts;
+	parts.reserve(ranges.size());
+	for (const SubMesh& r : ranges) {
+		vector<unsigned int> input;
+		if (r.start >= 0 && r.count > 0 && (size_t)(r.start + r.count) <= indices.size()) {
+			input.assign(indices.begin() + r.start, indices.begin() + r.start + r.count);
+		}
+		parts.emplace_back(mesh, positionOf, vertexOf, input, options, radius);
+	}
+
+	vector<MeshLOD>	lods;
+	size_t			previousCount	= indices.size();
+	float			target			= 1.0f;
+
+	for (int level = 1; level < options.levelCount; ++level) {
+		target *= options.levelRatio;
+
+		MeshLOD lod;
+		lod.error = 0.0f;
+		for (size_t i = 0; i < parts.size(); ++i) {
+			size_t targetCount = (size_t)(ranges[i].count * target);
+			parts[i].Run(targetCount - (targetCount % 3), options.maxError * radius);
+
+			const vector<unsigned int>& partIndices = parts[i].GetIndices();
+			lod.subMeshes.push_back({ (int)lod.indices.size(), (int)partIndices.size() });
+			lod.indices.insert(lod.indices.end(), partIndices.begin(), partIndices.end());
+			lod.error = std::max(lod.error, parts[i].GetError());
+		}
+		if (lod.indices.empty() || lod.indices.size() > previousCount * 0.9f) {
+			break;
+		}
+		previousCount = lod.indices.size();
+		lods.emplace_back(std::move(lod));
+	}
+	mesh.SetLODs(lods);
+	return (int)lods.size();
+}
@@ -0,0 +1,42 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "MeshGeometry.h"
+
+namespace NCL {
+	struct MeshSimplifyOptions {
+		int		levelCount		= 4;	//including the full detail mesh
+		float	levelRatio		= 0.5f;	//triangles kept by each level, relative to the one before
+		float	maxError		= 0.05f;//as a fraction of the mesh's bounding radius
+		float	borderWeight	= 10.0f;//how firmly open edges and attribute seams hold their shape
+		float	skinWeight		= 0.1f;	//added error, as a fraction of the radius, for merging differently skinned vertices
+	};
+
+	/*
+	Quadric error metric simplification (Garland & Heckbert), restricted to
+	collapsing vertices onto their existing neighbours. No new vertices are
+	made, so every LOD can share the full detail vertex buffer, and normals,
+	texture coordinates and skin weights are carried over exactly.
+
+	Vertices that share a position but not attributes (UV or hard normal
+	seams) are only ever moved along the seam, together, so the seam stays
+	where it was. Open edges and the edges between sub meshes get an extra
+	quadric to keep their outline.
+	*/
+	class MeshSimplifier	{
+	public:
+		//Fills the mesh's LOD chain - returns how many levels were added
+		static int GenerateLODs(MeshGeometry& mesh, const MeshSimplifyOptions& options = MeshSimplifyOptions());
+
+		//Simplifies a triangle list over the mesh's vertices, towards the given
+		//index count without going over maxError. Both errors are in model space
+		static float Simplify(const MeshGeometry& mesh, const vector<unsigned int>& input, vector<unsigned int>& output,
+			size_t targetIndexCount, float maxError, const MeshSimplifyOptions& options = MeshSimplifyOptions());
+	};
+}
@@ -0,0 +1,306 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "OcclusionBuffer.h"
+#include "Vector4.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#define OCCLUSION_USE_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Maths;
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) {
+	this->width		= (std::max(width, 4) + 3) & ~3;
+	this->height	= std::max(height, 1);
+
+	int levelWidth	= this->width;
+	int levelHeight	= this->height;
+	while (true) {
+		levels.push_back({ levelWidth, levelHeight, std::vector<float>(levelWidth * levelHeight, 1.0f) });
+		if (levelWidth == 1 && levelHeight == 1) {
+			break;
+		}
+		levelWidth	= (levelWidth + 1) / 2;
+		levelHeight	= (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionBuffer::Begin(const Matrix4& viewProj) {
+	this->viewProj = viewProj;
+	triangles.clear();
+	stats = OcclusionStats();
+}
+
+void OcclusionBuffer::AddOccluder(const Vector3& localMin, const Vector3& localMax, const Matrix4& transform) {
+	//Each face's corners go anticlockwise, seen from outside the box
+	static const int faces[6][4] = {
+		{ 0, 4, 6, 2 }, { 1, 3, 7, 5 },
+		{ 0, 1, 5, 4 }, { 2, 6, 7, 3 },
+		{ 0, 2, 3, 1 }, { 4, 5, 7, 6 }
+	};
+	Matrix4 toClip = viewProj * transform;
+	Vector4 corners[8];
+	for (int i = 0; i < 8; ++i) {
+		Vector3 p((i & 1) ? localMax.x : localMin.x, (i & 2) ? localMax.y : localMin.y, (i & 4) ? localMax.z : localMin.z);
+		corners[i] = toClip * Vector4(p, 1.0f);
+	}
+	//A mirroring transform turns every face around
+	const float* m = transform.array;
+	float det = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+
+	for (const auto& f : faces) {
+		if (det < 0.0f) {
+			AddTriangle(corners[f[0]], corners[f[2]], corners[f[1]]);
+			AddTriangle(corners[f[0]], corners[f[3]], corners[f[2]]);
+		}
+		else {
+			AddTriangle(corners[f[0]], corners[f[1]], corners[f[2]]);
+			AddTriangle(corners[f[0]], corners[f[2]], corners[f[3]]);
+		}
+	}
+	stats.occluders++;
+}
+
+//Clipped against the near plane, z >= -w, which can leave a quad to split in two
+void OcclusionBuffer::AddTriangle(const Vector4& a, const Vector4& b, const Vector4& c) {
+	const Vector4 in[3] = { a, b, c };
+	int inside = 0;
+	for (const Vector4& v : in) {
+		inside += v.z + v.w >= 0.0f;
+	}
+	if (inside == 3) {
+		AddScreenTriangle(a, b, c);
+		return;
+	}
+	if (inside == 0) {
+		return;
+	}
+	Vector4 out[4];
+	int		count = 0;
+	for (int i = 0; i < 3; ++i) {
+		const Vector4& p = in[i];
+		const Vector4& q = in[(i + 1) % 3];
+		float pDist = p.z + p.w;
+		float qDist = q.z + q.w;
+		if (pDist >= 0.0f) {
+			out[count++] = p;
+		}
+		if ((pDist >= 0.0f) != (qDist >= 0.0f)) {
+			out[count++] = p + (q - p) * (pDist / (pDist - qDist));
+		}
+	}
+	for (int i = 1; i + 1 < count; ++i) {
+		AddScreenTriangle(out[0], out[i], out[i + 1]);
+	}
+}
+
+void OcclusionBuffer::AddScreenTriangle(const Vector4& a, const Vector4& b, const Vector4& c) {
+	ScreenTriangle t;
+	const Vector4* v[3] = { &a, &b, &c };
+	for (int i = 0; i < 3; ++i) {
+		float invW = 1.0f / v[i]->w;
+		t.x[i] = (v[i]->x * invW * 0.5f + 0.5f) * width;
+		t.y[i] = (v[i]->y * invW * 0.5f + 0.5f) * height;
+		t.z[i] = v[i]->z * invW * 0.5f + 0.5f;
+	}
+	//Back facing, or edge on
+	float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+	if (area <= 0.0f) {
+		return;
+	}
+	float minX = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+	float maxX = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+	float minY = std::min(t.y[0], std::min(t.y[1], t.y[2]));
+	float maxY = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+	if (maxX < 0.0f || minX > width || maxY < 0.0f || minY > height) {
+		return;
+	}
+	t.minY = std::max(0, (int)floor(minY));
+	t.maxY = std::min(height - 1, (int)ceil(maxY));
+	triangles.emplace_back(t);
+	stats.triangles++;
+}
+
+void OcclusionBuffer::Rasterise() {
+	int bandCount = (height + BandRows - 1) / BandRows;
+	ParallelFor(bandCount, 2, [&](size_t firstBand, size_t lastBand) {
+		RasteriseBand((int)firstBand * BandRows, std::min(height, (int)lastBand * BandRows) - 1);
+	});
+	BuildPyramid();
+}
+
+//Every thread has its own rows, so nothing's shared while drawing
+void OcclusionBuffer::RasteriseBand(int firstRow, int lastRow) {
+	std::vector<float>& depths = levels[0].depths;
+	std::fill(depths.begin() + firstRow * width, depths.begin() + (lastRow + 1) * width, 1.0f);
+
+	for (const ScreenTriangle& t : triangles) {
+		if (t.maxY >= firstRow && t.minY <= lastRow) {
+			RasteriseTriangle(t, firstRow, lastRow);
+		}
+	}
+}
+
+/*
+Pixels are covered if their centre is inside all three edges. The edges
+and depth are planes in x and y, so each run of 4 pixels along a row is
+tested and written in one go, keeping the nearest depth.
+*/
+void OcclusionBuffer::RasteriseTriangle(const ScreenTriangle& t, int firstRow, int lastRow) {
+	int y0 = std::max(t.minY, firstRow);
+	int y1 = std::min(t.maxY, lastRow);
+
+	float minX = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+	float maxX = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+	int x0 = std::max(0, (int)floor(minX)) & ~3;
+	int x1 = std::min(width - 1, (int)ceil(maxX));
+
+	//Positive inside each edge, for an anticlockwise triangle
+	float edgeX[3];
+	float edgeY[3];
+	float edgeC[3];
+	for (int i = 0; i < 3; ++i) {
+		int j = (i + 1) % 3;
+		edgeX[i] = t.y[i] - t.y[j];
+		edgeY[i] = t.x[j] - t.x[i];
+		edgeC[i] = -(edgeX[i] * t.x[i] + edgeY[i] * t.y[i]);
+	}
+	float area	= (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+	float zX	= ((t.z[1] - t.z[0]) * (t.y[2] - t.y[0]) - (t.z[2] - t.z[0]) * (t.y[1] - t.y[0])) / area;
+	float zY	= ((t.x[1] - t.x[0]) * (t.z[2] - t.z[0]) - (t.x[2] - t.x[0]) * (t.z[1] - t.z[0])) / area;
+	float zC	= t.z[0] - zX * t.x[0] - zY * t.y[0];
+
+	float* depths = levels[0].depths.data();
+	for (int y = y0; y <= y1; ++y) {
+		float	py	= y + 0.5f;
+		float*	row	= depths + y * width;
+#ifdef OCCLUSION_USE_SSE
+		__m128 e0X = _mm_set1_ps(edgeX[0]);
+		__m128 e1X = _mm_set1_ps(edgeX[1]);
+		__m128 e2X = _mm_set1_ps(edgeX[2]);
+		__m128 e0Row = _mm_set1_ps(edgeY[0] * py + edgeC[0]);
+		__m128 e1Row = _mm_set1_ps(edgeY[1] * py + edgeC[1]);
+		__m128 e2Row = _mm_set1_ps(edgeY[2] * py + edgeC[2]);
+		__m128 zStep = _mm_set1_ps(zX);
+		__m128 zRow	 = _mm_set1_ps(zY * py + zC);
+		__m128 zero	 = _mm_setzero_ps();
+		__m128 px	 = _mm_add_ps(_mm_set1_ps((float)x0), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+		__m128 four	 = _mm_set1_ps(4.0f);
+		for (int x = x0; x <= x1; x += 4) {
+			__m128 in = _mm_and_ps(_mm_and_ps(
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e0X, px), e0Row), zero),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e1X, px), e1Row), zero)),
+				_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e2X, px), e2Row), zero));
+			if (_mm_movemask_ps(in)) {
+				__m128 z		= _mm_add_ps(_mm_mul_ps(zStep, px), zRow);
+				__m128 current	= _mm_loadu_ps(row + x);
+				__m128 nearest	= _mm_min_ps(current, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(in, nearest), _mm_andnot_ps(in, current)));
+			}
+			px = _mm_add_ps(px, four);
+		}
+#else
+		for (int x = x0; x <= x1; ++x) {
+			float px = x + 0.5f;
+			if (edgeX[0] * px + edgeY[0] * py + edgeC[0] >= 0.0f &&
+				edgeX[1] * px + edgeY[1] * py + edgeC[1] >= 0.0f &&
+				edgeX[2] * px + edgeY[2] * py + edgeC[2] >= 0.0f) {
+				row[x] = std::min(row[x], zX * px + zY * py + zC);
+			}
+		}
+#endif
+	}
+}
+
+//Each texel keeps the furthest of the (up to) 4 below it
+void OcclusionBuffer::BuildPyramid() {
+	for (size_t l = 1; l < levels.size(); ++l) {
+		const Level&	below = levels[l - 1];
+		Level&			level = levels[l];
+		for (int y = 0; y < level.height; ++y) {
+			int y0 = y * 2;
+			int y1 = std::min(y0 + 1, below.height - 1);
+			const float* row0 = below.depths.data() + y0 * below.width;
+			const float* row1 = below.depths.data() + y1 * below.width;
+			for (int x = 0; x < level.width; ++x) {
+				int x0 = x * 2;
+				int x1 = std::min(x0 + 1, below.width - 1);
+				level.depths[y * level.width + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::AABBVisible(const Vector3& centre, const Vector3& halfSize) const {
+	float minX = FLT_MAX;
+	float minY = FLT_MAX;
+	float minZ = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float maxY = -FLT_MAX;
+	for (int i = 0; i < 8; ++i) {
+		Vector3 corner(	centre.x + ((i & 1) ? halfSize.x : -halfSize.x),
+						centre.y + ((i & 2) ? halfSize.y : -halfSize.y),
+						centre.z + ((i & 4) ? halfSize.z : -halfSize.z));
+		Vector4 clip = viewProj * Vector4(corner, 1.0f);
+		if (clip.z + clip.w < 0.0f || clip.w <= 0.0f) {
+			return true; //crosses the near plane, so could be covering the whole screen
+		}
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * width;
+		float y = (clip.y * invW * 0.5f + 0.5f) * height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z * invW * 0.5f + 0.5f);
+	}
+	//Whether it's on screen at all is up to the frustum
+	if (maxX < 0.0f || minX >= width || maxY < 0.0f || minY >= height) {
+		return true;
+	}
+	//Occluders cover any texel whose centre they reach, so can overhang their
+	//edges by up to half a texel - a texel's margin all round makes up for it
+	int x0 = std::max(0, (int)floor(minX) - 1);
+	int x1 = std::min(width - 1, (int)floor(maxX) + 1);
+	int y0 = std::max(0, (int)floor(minY) - 1);
+	int y1 = std::min(height - 1, (int)floor(maxY) + 1);
+
+	//The first level the rectangle spans no more than 2x2 texels of
+	size_t l = 0;
+	while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1)) {
+		++l;
+	}
+	const Level& level = levels[l];
+	float furthest = 0.0f;
+	for (int y = y0 >> l; y <= (y1 >> l); ++y) {
+		for (int x = x0 >> l; x <= (x1 >> l); ++x) {
+			furthest = std::max(furthest, level.depths[y * level.width + x]);
+		}
+	}
+	return minZ <= furthest;
+}
+
+size_t OcclusionBuffer::CullAABBs(const CullingBounds& bounds, char* visible, size_t begin, size_t end) const {
+	size_t hidden = 0;
+	for (size_t i = begin; i < end; ++i) {
+		if (visible[i] && !AABBVisible(bounds.GetCentre(i), bounds.GetHalfSize(i))) {
+			visible[i] = 0;
+			hidden++;
+		}
+	}
+	return hidden;
+}
@@ -0,0 +1,107 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Matrix4.h"
+#include "Vector3.h"
+#include "Frustum.h"
+
+#include <vector>
+
+namespace NCL {
+	namespace Rendering {
+		struct OcclusionStats {
+			size_t occluders	= 0;
+			size_t triangles	= 0;	//drawn, after clipping and back face culling
+		};
+
+		/*
+		A small depth buffer that the biggest occluders in view are drawn
+		into on the CPU, so that objects hidden behind them can be skipped
+		before any commands are recorded for them. Occluders are boxes,
+		which must be solid right out to their bounds. The screen is split
+		into bands of rows, which are drawn on separate threads 4 pixels at
+		a time. Each pyramid level above the buffer keeps the furthest depth
+		of the 2x2 texels below it, so an object's bounds are tested against
+		just a few texels, from whichever level its screen rectangle fits.
+		Tests are conservative - anything crossing the near plane, or not
+		wholly behind what's been drawn, is visible.
+		*/
+		class OcclusionBuffer {
+		public:
+			//width is rounded up to a multiple of 4
+			OcclusionBuffer(int width = 256, int height = 128);
+
+			//Starts a frame seen through viewProj, with nothing drawn yet
+			void Begin(const Maths::Matrix4& viewProj);
+
+			//A box in an object's own space, placed in the world by transform
+			void AddOccluder(const Maths::Vector3& localMin, const Maths::Vector3& localMax, const Maths::Matrix4& transform);
+
+			//Draws every occluder added since Begin, then builds the pyramid
+			void Rasterise();
+
+			bool AABBVisible(const Maths::Vector3& centre, const Maths::Vector3& halfSize) const;
+
+			//Clears visible for every entry in [begin, end) the occluders hide, and returns
+			//how many that was - entries already marked invisible aren't tested
+			size_t CullAABBs(const Maths::CullingBounds& bounds, char* visible, size_t begin, size_t end) const;
+
+			int GetWidth() const {
+				return width;
+			}
+
+			int GetHeight() const {
+				return height;
+			}
+
+			size_t GetLevelCount() const {
+				return levels.size();
+			}
+
+			//Depths run from 0 at the near plane to 1 at the far plane, bottom row first
+			const float* GetDepths(size_t level = 0) const {
+				return levels[level].depths.data();
+			}
+
+			const OcclusionStats& GetStats() const {
+				return stats;
+			}
+
+		protected:
+			static const int BandRows = 8;
+
+			struct ScreenTriangle {
+				float	x[3];
+				float	y[3];
+				float	z[3];
+				int		minY;
+				int		maxY;
+			};
+
+			struct Level {
+				int					width;
+				int					height;
+				std::vector<float>	depths;
+			};
+
+			void AddTriangle(const Maths::Vector4& a, const Maths::Vector4& b, const Maths::Vector4& c);
+			void AddScreenTriangle(const Maths::Vector4& a, const Maths::Vector4& b, const Maths::Vector4& c);
+			void RasteriseBand(int firstRow, int lastRow);
+			void RasteriseTriangle(const ScreenTriangle& t, int firstRow, int lastRow);
+			void BuildPyramid();
+
+			int								width;
+			int								height;
+			Maths::Matrix4					viewProj;
+			std::vector<ScreenTriangle>		triangles;
+			std::vector<Level>				levels;	//levels[0] is the full size buffer
+			OcclusionStats					stats;
+		};
+	}
+}
@@ -0,0 +1,103 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "ParallelFor.h"
+
+using namespace NCL;
+
+ParallelForPool& ParallelForPool::Get() {
+	static ParallelForPool pool;
+	return pool;
+}
+
+ParallelForPool::ParallelForPool() {
+	quit = false;
+	size_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	workers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; ++i) {
+		workers.emplace_back(&ParallelForPool::WorkerThread, this);
+	}
+}
+
+ParallelForPool::~ParallelForPool() {
+	{
+		std::lock_guard<std::mutex> lock(jobLock);
+		quit = true;
+	}
+	jobAdded.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+}
+
+bool ParallelForPool::TakeBatch(Job& job, size_t& index) {
+	std::lock_guard<std::mutex> lock(jobLock);
+	if (job.nextBatch >= job.batchCount) {
+		return false;
+	}
+	index = job.nextBatch++;
+	return true;
+}
+
+void ParallelForPool::Run(size_t batchCount, const std::function<void(size_t)>& batch) {
+	if (batchCount == 0) {
+		return;
+	}
+	Job job = { &batch, batchCount, 0, 0 };
+	if (batchCount > 1 && !workers.empty()) {
+		{
+			std::lock_guard<std::mutex> lock(jobLock);
+			jobs.push_back(&job);
+		}
+		if (batchCount - 1 < workers.size()) {
+			for (size_t i = 1; i < batchCount; ++i) {
+				jobAdded.notify_one();
+			}
+		}
+		else {
+			jobAdded.notify_all();
+		}
+	}
+	size_t index;
+	while (TakeBatch(job, index)) {
+		batch(index);
+	}
+	//Every batch has been handed out, so once no worker holds the job it's done
+	std::unique_lock<std::mutex> lock(jobLock);
+	auto queued = std::find(jobs.begin(), jobs.end(), &job);
+	if (queued != jobs.end()) {
+		jobs.erase(queued);
+	}
+	jobReleased.wait(lock, [&job]() { return job.users == 0; });
+}
+
+void ParallelForPool::WorkerThread() {
+	std::unique_lock<std::mutex> lock(jobLock);
+	while (true) {
+		jobAdded.wait(lock, [this]() { return quit || !jobs.empty(); });
+		if (quit) {
+			return;
+		}
+		Job* job = jobs.front();
+		if (job->nextBatch >= job->batchCount) {
+			jobs.pop_front();
+			continue;
+		}
+		job->users++;
+		while (job->nextBatch < job->batchCount) {
+			size_t index = job->nextBatch++;
+			lock.unlock();
+			(*job->batch)(index);
+			lock.lock();
+		}
+		job->users--;
+		if (job->users == 0) {
+			jobReleased.notify_all();
+		}
+	}
+}
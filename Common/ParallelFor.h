@@ -0,0 +1,93 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+namespace NCL {
+	/*
+	One worker per hardware thread beyond the first, started the first time
+	it's used and kept asleep on a condition variable between jobs, so work
+	that's shared out every frame doesn't pay for starting threads each time.
+	The thread running a job takes batches from it too, and only waits on
+	batches the workers have already started - so jobs can be run from any
+	thread, including from inside another job's batches.
+	*/
+	class ParallelForPool {
+	public:
+		static ParallelForPool& Get();
+
+		size_t GetWorkerCount() const {
+			return workers.size();
+		}
+
+		//Calls batch(i) for every i in [0, batchCount), returning once all have finished
+		void Run(size_t batchCount, const std::function<void(size_t)>& batch);
+
+	protected:
+		struct Job {
+			const std::function<void(size_t)>*	batch;
+			size_t								batchCount;
+			size_t								nextBatch;
+			size_t								users;	//workers still holding this job
+		};
+
+		ParallelForPool();
+		~ParallelForPool();
+
+		void WorkerThread();
+		bool TakeBatch(Job& job, size_t& index);
+
+		std::vector<std::thread>	workers;
+		std::deque<Job*>			jobs;
+		std::mutex					jobLock;
+		std::condition_variable		jobAdded;
+		std::condition_variable		jobReleased;
+		bool						quit;
+	};
+
+	//How many threads ParallelFor would split a range between - callers can
+	//use this to skip setup that only pays off when the work is shared
+	inline size_t ParallelThreadCount(size_t count, size_t minBatchSize) {
+		size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+		return std::min(threadCount, std::max((size_t)1, count / std::max((size_t)1, minBatchSize)));
+	}
+
+	/*
+	Splits the range [0, count) into one contiguous batch per hardware
+	thread, and calls func(begin, end) on each, using the shared worker
+	pool. Ranges too small to be worth sharing just run on the calling
+	thread. func must be safe to run concurrently on separate batches.
+	*/
+	template<class F>
+	void ParallelFor(size_t count, size_t minBatchSize, F func) {
+		size_t threadCount = ParallelThreadCount(count, minBatchSize);
+
+		if (threadCount <= 1) {
+			if (count > 0) {
+				func((size_t)0, count);
+			}
+			return;
+		}
+		size_t batchSize = (count + threadCount - 1) / threadCount;
+
+		ParallelForPool::Get().Run(threadCount, [&](size_t i) {
+			size_t begin	= i * batchSize;
+			size_t end		= std::min(count, begin + batchSize);
+			if (begin < end) {
+				func(begin, end);
+			}
+		});
+	}
+}
@@ -0,0 +1,140 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "RenderCommands.h"
+#include "MeshGeometry.h"
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Maths;
+
+CommandArena::CommandArena(size_t blockSize) {
+	this->blockSize		= blockSize;
+	this->currentBlock	= 0;
+}
+
+void* CommandArena::Allocate(size_t bytes, size_t alignment) {
+	while (true) {
+		if (currentBlock < blocks.size()) {
+			Block&	b		= blocks[currentBlock];
+			size_t	start	= (b.used + alignment - 1) & ~(alignment - 1);
+			if (start + bytes <= b.size) {
+				b.used = start + bytes;
+				return b.data.get() + start;
+			}
+			if (currentBlock + 1 < blocks.size()) {
+				currentBlock++;
+				continue;
+			}
+		}
+		//new[] hands back memory aligned for anything, so a block's start never needs padding
+		Block b;
+		b.size	= std::max(blockSize, bytes);
+		b.used	= 0;
+		b.data.reset(new char[b.size]);
+		blocks.push_back(std::move(b));
+		currentBlock = blocks.size() - 1;
+	}
+}
+
+void CommandArena::Reset() {
+	for (Block& b : blocks) {
+		b.used = 0;
+	}
+	currentBlock = 0;
+}
+
+size_t CommandArena::GetBytesUsed() const {
+	size_t used = 0;
+	for (const Block& b : blocks) {
+		used += b.used;
+	}
+	return used;
+}
+
+void RenderCommandBuffer::Reset() {
+	arena.Reset();
+	packets.clear();
+}
+
+void RenderCommandQueue::Merge(const std::vector<RenderCommandBuffer>& buffers) {
+	commands.clear();
+	order.clear();
+	for (const RenderCommandBuffer& b : buffers) {
+		for (const RenderPacket& p : b.GetPackets()) {
+			order.push_back({ p.key, (uint32_t)commands.size() });
+			commands.push_back(p.command);
+		}
+	}
+	RadixSortDraws(order, scratch);
+}
+
+void RenderBackend::Submit(const RenderCommandQueue& queue, unsigned int passCount) {
+	size_t count	= queue.GetCommandCount();
+	size_t i		= 0;
+	for (unsigned int pass = 0; pass < passCount; ++pass) {
+		BeginPass(pass);
+		for (; i < count && DrawKey::GetPass(queue.GetKey(i)) == pass; ++i) {
+			const RenderCommandHeader& command = queue.GetCommand(i);
+			switch (command.type) {
+				case RenderCommandType::DrawMesh: {
+					if (command.size == sizeof(DrawMeshCommand)) {
+						Execute((const DrawMeshCommand&)command);
+						continue;
+					}
+				}break;
+				default: break;
+			}
+			InvalidCommand(command, queue.GetKey(i));
+		}
+		EndPass(pass);
+	}
+	for (; i < count; ++i) {
+		InvalidCommand(queue.GetCommand(i), queue.GetKey(i));
+	}
+}
+
+void RenderBackend::InvalidCommand(const RenderCommandHeader& command, uint64_t key) {
+	std::cout << __FUNCTION__ << " can't run command type " << (int)command.type << " of size " << command.size
+		<< " in pass " << DrawKey::GetPass(key) << "!" << std::endl;
+}
+
+void NullRenderBackend::BeginPass(unsigned int /*pass*/) {
+	stats.passes++;
+}
+
+void NullRenderBackend::Execute(const DrawMeshCommand& command) {
+	stats.commands++;
+
+	bool valid = command.shader && command.mesh;
+	if (valid) {
+		int lodCount = std::max(1, (int)command.mesh->GetLODCount());
+		valid = command.lodLevel >= 0 && command.lodLevel < lodCount;
+	}
+	for (int i = 0; i < 16; ++i) {
+		valid &= std::isfinite(command.modelMatrix.array[i]);
+	}
+	valid &= std::isfinite(command.colour.x) && std::isfinite(command.colour.y) &&
+			 std::isfinite(command.colour.z) && std::isfinite(command.colour.w);
+
+	if (valid) {
+		stats.draws++;
+	}
+	else {
+		stats.invalidCommands++;
+	}
+}
+
+void NullRenderBackend::InvalidCommand(const RenderCommandHeader& /*command*/, uint64_t /*key*/) {
+	stats.commands++;
+	stats.invalidCommands++;
+}
@@ -0,0 +1,193 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Matrix4.h"
+#include "Vector4.h"
+#include "RenderSorting.h"
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <cstdint>
+
+namespace NCL {
+	class MeshGeometry;
+
+	namespace Rendering {
+		class ShaderBase;
+		class TextureBase;
+
+		enum class RenderCommandType : uint16_t {
+			DrawMesh,
+			MaxCommands
+		};
+
+		//Every command starts with one of these, so a backend can tell what it's been given
+		struct RenderCommandHeader {
+			RenderCommandType	type;
+			uint16_t			size;
+		};
+
+		/*
+		Commands are copied into an arena and never destructed, so they're
+		fixed size and only point at things that outlive the frame - shaders,
+		textures and meshes are owned by the game, not the command.
+		*/
+		struct DrawMeshCommand {
+			static const RenderCommandType Type = RenderCommandType::DrawMesh;
+
+			RenderCommandHeader	header;
+			ShaderBase*			shader;
+			TextureBase*		texture;
+			MeshGeometry*		mesh;
+			int					lodLevel;
+			Maths::Matrix4		modelMatrix;
+			Maths::Vector4		colour;
+		};
+
+		/*
+		Hands out memory from large blocks, one allocation after another,
+		and gets it all back at once on Reset. Blocks are kept between
+		frames, and never move, so anything allocated stays put until then.
+		*/
+		class CommandArena {
+		public:
+			CommandArena(size_t blockSize = 64 * 1024);
+
+			void* Allocate(size_t bytes, size_t alignment);
+			void Reset();
+
+			size_t GetBytesUsed() const;
+
+		protected:
+			struct Block {
+				std::unique_ptr<char[]>	data;
+				size_t					size;
+				size_t					used;
+			};
+			std::vector<Block>	blocks;
+			size_t				currentBlock;
+			size_t				blockSize;
+		};
+
+		//A command, and the DrawKey that decides when it runs
+		struct RenderPacket {
+			uint64_t					key;
+			const RenderCommandHeader*	command;
+		};
+
+		/*
+		Somewhere for one thread to record commands into - nothing here is
+		shared, so each recording thread gets its own buffer, and they're
+		merged into a RenderCommandQueue once they've all finished.
+		*/
+		class RenderCommandBuffer {
+		public:
+			void Reset();
+
+			template<typename T>
+			T& Record(uint64_t key) {
+				T* command = new (arena.Allocate(sizeof(T), alignof(T))) T();
+				command->header.type = T::Type;
+				command->header.size = (uint16_t)sizeof(T);
+				packets.push_back({ key, &command->header });
+				return *command;
+			}
+
+			const std::vector<RenderPacket>& GetPackets() const {
+				return packets;
+			}
+
+			size_t GetBytesUsed() const {
+				return arena.GetBytesUsed();
+			}
+
+		protected:
+			CommandArena				arena;
+			std::vector<RenderPacket>	packets;
+		};
+
+		/*
+		Every buffer's commands in DrawKey order. Commands with the same key
+		keep the order of the buffers they came from, so the result doesn't
+		depend on which thread finished recording first.
+		*/
+		class RenderCommandQueue {
+		public:
+			void Merge(const std::vector<RenderCommandBuffer>& buffers);
+
+			size_t GetCommandCount() const {
+				return order.size();
+			}
+
+			uint64_t GetKey(size_t i) const {
+				return order[i].key;
+			}
+
+			const RenderCommandHeader& GetCommand(size_t i) const {
+				return *commands[order[i].index];
+			}
+
+		protected:
+			std::vector<const RenderCommandHeader*>	commands;
+			std::vector<DrawItem>					order;
+			std::vector<DrawItem>					scratch;
+		};
+
+		/*
+		Turns a queue of commands into API calls. Every pass up to passCount
+		is begun and ended, even ones without any commands, so a backend can
+		clear targets and draw anything that doesn't come from a command.
+		*/
+		class RenderBackend {
+		public:
+			virtual ~RenderBackend() {}
+
+			void Submit(const RenderCommandQueue& queue, unsigned int passCount);
+
+		protected:
+			virtual void BeginPass(unsigned int /*pass*/) {}
+			virtual void EndPass(unsigned int /*pass*/) {}
+
+			virtual void Execute(const DrawMeshCommand& command) = 0;
+
+			//A command for a pass outside of passCount, or one of an unknown type or size
+			virtual void InvalidCommand(const RenderCommandHeader& command, uint64_t key);
+		};
+
+		struct NullBackendStats {
+			size_t passes			= 0;
+			size_t commands			= 0;
+			size_t draws			= 0;
+			size_t invalidCommands	= 0;
+		};
+
+		/*
+		Runs a queue without an API - every command is checked and counted,
+		so recording and sorting can be tested and timed on the CPU alone.
+		*/
+		class NullRenderBackend : public RenderBackend {
+		public:
+			void ResetStats() {
+				stats = NullBackendStats();
+			}
+
+			const NullBackendStats& GetStats() const {
+				return stats;
+			}
+
+		protected:
+			void BeginPass(unsigned int pass) override;
+			void Execute(const DrawMeshCommand& command) override;
+			void InvalidCommand(const RenderCommandHeader& command, uint64_t key) override;
+
+			NullBackendStats stats;
+		};
+	}
+}
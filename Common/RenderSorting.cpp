@@ -0,0 +1,130 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "RenderSorting.h"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace NCL;
+using namespace Rendering;
+
+namespace {
+	//Bound state after an Invalidate - never equal to anything a caller passes in
+	const char unknownState = 0;
+
+	inline uint64_t FieldBits(unsigned int value, int bits) {
+		return (uint64_t)(value & ((1u << bits) - 1));
+	}
+}
+
+uint64_t DrawKey::Make(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int mesh, float depth, bool backToFront) {
+	uint32_t depthBits = 0;
+	if (depth > 0.0f) {
+		memcpy(&depthBits, &depth, sizeof(float));
+		depthBits >>= (31 - DepthBits); //drops the sign bit, and the low mantissa bits
+	}
+	if (backToFront) {
+		depthBits	= ((1u << DepthBits) - 1) - depthBits;
+		shader		= 0;
+		texture		= 0;
+		mesh		= 0;
+	}
+	uint64_t key = FieldBits(pass, PassBits);
+	key = (key << ShaderBits)	| FieldBits(shader, ShaderBits);
+	key = (key << TextureBits)	| FieldBits(texture, TextureBits);
+	key = (key << MeshBits)		| FieldBits(mesh, MeshBits);
+	key = (key << DepthBits)	| depthBits;
+	return key;
+}
+
+void Rendering::RadixSortDraws(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch) {
+	const size_t count = items.size();
+	if (count < 2) {
+		return;
+	}
+	scratch.resize(count);
+
+	//Every byte's histogram is built in one pass over the keys
+	size_t histograms[8][256] = {};
+	for (const DrawItem& d : items) {
+		for (int b = 0; b < 8; ++b) {
+			histograms[b][(d.key >> (b * 8)) & 0xFF]++;
+		}
+	}
+
+	DrawItem* from	= items.data();
+	DrawItem* to	= scratch.data();
+	for (int b = 0; b < 8; ++b) {
+		size_t* histogram = histograms[b];
+		if (histogram[(from[0].key >> (b * 8)) & 0xFF] == count) {
+			continue; //every key has the same value for this byte
+		}
+		size_t offset = 0;
+		for (int i = 0; i < 256; ++i) {
+			size_t c = histogram[i];
+			histogram[i] = offset;
+			offset += c;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			to[histogram[(from[i].key >> (b * 8)) & 0xFF]++] = from[i];
+		}
+		std::swap(from, to);
+	}
+	if (from != items.data()) {
+		items.swap(scratch);
+	}
+}
+
+RenderStateTracker::RenderStateTracker() {
+	BeginFrame();
+}
+
+void RenderStateTracker::BeginFrame() {
+	stats = RenderStateStats();
+	Invalidate();
+}
+
+void RenderStateTracker::Invalidate() {
+	shader	= &unknownState;
+	mesh	= &unknownState;
+	for (int i = 0; i < MaxTextureUnits; ++i) {
+		textures[i] = &unknownState;
+	}
+}
+
+bool RenderStateTracker::ShaderChange(const void* newShader) {
+	if (newShader == shader) {
+		return false;
+	}
+	shader = newShader;
+	stats.shaderChanges++;
+	return true;
+}
+
+bool RenderStateTracker::TextureChange(int unit, const void* newTexture) {
+	if (unit < 0 || unit >= MaxTextureUnits) {
+		stats.textureChanges++;
+		return true;
+	}
+	if (newTexture == textures[unit]) {
+		return false;
+	}
+	textures[unit] = newTexture;
+	stats.textureChanges++;
+	return true;
+}
+
+bool RenderStateTracker::MeshChange(const void* newMesh) {
+	if (newMesh == mesh) {
+		return false;
+	}
+	mesh = newMesh;
+	stats.meshChanges++;
+	return true;
+}
@@ -0,0 +1,120 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		Draws are ordered by a single 64 bit key, built from (high bits to low):
+
+			pass	 4 bits - opaque before transparent etc
+			shader	10 bits
+			texture	14 bits
+			mesh	14 bits
+			depth	22 bits - the top bits of the float, which sort the same way
+							  as the value for anything positive
+
+		so sorting by key groups draws by their most expensive state changes
+		first, and front to back within those. Passes that need back to front
+		order (anything transparent) flip the depth bits, and leave out the
+		state, so that only depth decides.
+		*/
+		namespace DrawKey {
+			const int PassBits		= 4;
+			const int ShaderBits	= 10;
+			const int TextureBits	= 14;
+			const int MeshBits		= 14;
+			const int DepthBits		= 22;
+
+			uint64_t Make(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int mesh, float depth, bool backToFront = false);
+
+			inline unsigned int GetPass(uint64_t key) {
+				return (unsigned int)(key >> (64 - PassBits));
+			}
+		}
+
+		struct DrawItem {
+			uint64_t key;
+			uint32_t index; //into whatever list the keys were built from
+		};
+
+		//Least significant byte first, skipping any byte every key shares. scratch
+		//is only there to save an allocation each frame.
+		void RadixSortDraws(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+
+		/*
+		Hands out small, stable IDs for the things a DrawKey is built from.
+		IDs are never reused, so once they pass the limit of their bits they
+		just wrap round - that only costs a little sorting accuracy.
+		*/
+		class DrawKeyIDs {
+		public:
+			unsigned int Get(const void* object) {
+				auto i = ids.find(object);
+				if (i != ids.end()) {
+					return i->second;
+				}
+				unsigned int id = (unsigned int)ids.size();
+				ids.insert({ object, id });
+				return id;
+			}
+
+		protected:
+			std::unordered_map<const void*, unsigned int> ids;
+		};
+
+		struct RenderStateStats {
+			size_t draws			= 0;
+			size_t instances		= 0;	//what draws would be without instancing
+			size_t shaderChanges	= 0;
+			size_t textureChanges	= 0;
+			size_t meshChanges		= 0;
+		};
+
+		/*
+		Remembers what's bound, so a renderer only has to talk to the API
+		when something actually changes - each Change function records the
+		new state, and returns whether the caller needs to bind it. Counts
+		every change made, so a draw order can be judged without a GPU.
+		*/
+		class RenderStateTracker {
+		public:
+			static const int MaxTextureUnits = 8;
+
+			RenderStateTracker();
+
+			//Clears the stats as well as the bound state
+			void BeginFrame();
+			//Something else has been binding things, so nothing can be skipped next time
+			void Invalidate();
+
+			bool ShaderChange(const void* shader);
+			bool TextureChange(int unit, const void* texture);
+			bool MeshChange(const void* mesh);
+
+			void CountDraw(size_t instances = 1) {
+				stats.draws++;
+				stats.instances += instances;
+			}
+
+			const RenderStateStats& GetStats() const {
+				return stats;
+			}
+
+		protected:
+			const void*			shader;
+			const void*			textures[MaxTextureUnits];
+			const void*			mesh;
+			RenderStateStats	stats;
+		};
+	}
+}
@@ -0,0 +1,97 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "ShadowCascades.h"
+#include "Vector4.h"
+#include "Maths.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Maths;
+
+ShadowCascades::ShadowCascades(int cascadeCount, int resolution) {
+	this->cascadeCount		= std::min(std::max(cascadeCount, 1), MaxCascades);
+	this->resolution		= std::max(resolution, 2) & ~1; //texel snapping needs an even number of texels
+	this->splitLambda		= 0.75f;
+	this->casterDistance	= 200.0f;
+
+	for (ShadowCascade& c : cascades) {
+		c.splitNear = 0.0f;
+		c.splitFar	= 0.0f;
+		c.radius	= 0.0f;
+	}
+}
+
+void ShadowCascades::ComputeSplits(float nearPlane, float farPlane, int count, float lambda, float* splits) {
+	nearPlane = std::max(nearPlane, 0.0001f);
+	for (int i = 0; i <= count; ++i) {
+		float t			= (float)i / count;
+		float logSplit	= nearPlane * powf(farPlane / nearPlane, t);
+		float evenSplit	= nearPlane + (farPlane - nearPlane) * t;
+		splits[i] = lambda * logSplit + (1.0f - lambda) * evenSplit;
+	}
+	splits[0]		= nearPlane;
+	splits[count]	= farPlane;
+}
+
+void ShadowCascades::Update(const Matrix4& cameraView, float fov, float aspect, float nearPlane, float farPlane, const Vector3& lightDirection) {
+	float splits[MaxCascades + 1];
+	ComputeSplits(nearPlane, farPlane, cascadeCount, splitLambda, splits);
+
+	Matrix4 cameraMatrix	= cameraView.Inverse();
+	float	tanY			= tan(DegreesToRadians(fov) * 0.5f);
+	float	tanX			= tanY * aspect;
+	float	cornerSlope		= tanX * tanX + tanY * tanY; //squared distance from the view axis to a corner, per unit of depth
+
+	//The light's view is fixed in place, so snapping to its texels is snapping to the same grid every frame
+	Vector3 up			= std::abs(lightDirection.y) > 0.99f ? Vector3(0, 0, 1) : Vector3(0, 1, 0);
+	Matrix4 lightView	= Matrix4::BuildViewMatrix(Vector3(0, 0, 0), lightDirection, up);
+
+	for (int i = 0; i < cascadeCount; ++i) {
+		ShadowCascade& c = cascades[i];
+		float n = splits[i];
+		float f = splits[i + 1];
+
+		//The point along the view axis that's the same distance from the slice's near and far corners
+		float centreDepth	= std::min(f, (f + n) * (1.0f + cornerSlope) * 0.5f);
+		float radius		= sqrt(f * f * cornerSlope + (f - centreDepth) * (f - centreDepth));
+		radius = ceil(radius * 16.0f) / 16.0f; //so floating point noise can't change the map's size
+
+		Vector4 worldCentre = cameraMatrix * Vector4(0, 0, -centreDepth, 1);
+		Vector4 lightCentre = lightView * worldCentre;
+
+		float texelSize = (2.0f * radius) / resolution;
+		float x = floor(lightCentre.x / texelSize) * texelSize;
+		float y = floor(lightCentre.y / texelSize) * texelSize;
+
+		//The light looks down -z, so distances in front of it are -z
+		float zNear = -lightCentre.z - radius - casterDistance;
+		float zFar	= -lightCentre.z + radius;
+
+		Matrix4 lightProj = Matrix4::Orthographic(zNear, zFar, x + radius, x - radius, y + radius, y - radius);
+
+		c.splitNear = n;
+		c.splitFar	= f;
+		c.radius	= radius;
+		c.centre	= Vector3(worldCentre.x, worldCentre.y, worldCentre.z);
+		c.viewProj	= lightProj * lightView;
+		c.frustum.FromMatrix(c.viewProj);
+	}
+}
+
+int ShadowCascades::SelectCascade(float viewDepth) const {
+	for (int i = 0; i < cascadeCount; ++i) {
+		if (viewDepth < cascades[i].splitFar) {
+			return i;
+		}
+	}
+	return cascadeCount;
+}
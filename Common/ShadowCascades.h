@@ -0,0 +1,78 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Matrix4.h"
+#include "Vector3.h"
+#include "Frustum.h"
+
+namespace NCL {
+	namespace Rendering {
+		struct ShadowCascade {
+			float			splitNear;	//distances from the camera this cascade covers
+			float			splitFar;
+			float			radius;		//of the sphere around its slice of the view frustum
+			Maths::Vector3	centre;
+			Maths::Matrix4	viewProj;	//world space to the light's clip space
+			Maths::Frustum	frustum;	//for culling casters
+		};
+
+		/*
+		Splits the camera's view frustum into slices along its length, and
+		fits an orthographic shadow map around each, looking down a single
+		light direction. Each slice is wrapped in a sphere rather than a box,
+		so the map's size doesn't change as the camera turns, and the map is
+		moved in whole texels, so shadow edges don't shimmer as it moves.
+		Cascades reach back towards the light by casterDistance, so objects
+		outside the view can still cast shadows into it.
+		*/
+		class ShadowCascades {
+		public:
+			static const int MaxCascades = 4;
+
+			ShadowCascades(int cascadeCount = MaxCascades, int resolution = 2048);
+
+			//Blends between logarithmic (1) and evenly spaced (0) splits
+			void SetSplitLambda(float lambda) {
+				splitLambda = lambda;
+			}
+
+			void SetCasterDistance(float distance) {
+				casterDistance = distance;
+			}
+
+			//Fills splits with count + 1 distances, from nearPlane to farPlane
+			static void ComputeSplits(float nearPlane, float farPlane, int count, float lambda, float* splits);
+
+			//fov is the camera's vertical field of vision in degrees, as Camera uses
+			void Update(const Maths::Matrix4& cameraView, float fov, float aspect, float nearPlane, float farPlane, const Maths::Vector3& lightDirection);
+
+			//The first cascade covering something this far from the camera, or the cascade count if none do
+			int SelectCascade(float viewDepth) const;
+
+			int GetCascadeCount() const {
+				return cascadeCount;
+			}
+
+			int GetResolution() const {
+				return resolution;
+			}
+
+			const ShadowCascade& GetCascade(int i) const {
+				return cascades[i];
+			}
+
+		protected:
+			ShadowCascade	cascades[MaxCascades];
+			int				cascadeCount;
+			int				resolution;
+			float			splitLambda;
+			float			casterDistance;
+		};
+	}
+}
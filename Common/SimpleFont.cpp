@@ -24,6 +24,8 @@ SimpleFont::SimpleFont(const std::string&filename, const std::string&texName)
 	startChar	= 0;
 	numChars	= 0;
 	allCharData	= nullptr;
+	glyphs		= nullptr;
+	distanceSpread	= 0.0f;
 
 	texture		= TextureLoader::LoadAPITexture(texName);
 
@@ -48,74 +50,86 @@ SimpleFont::SimpleFont(const std::string&filename, const std::string&texName)
 	}
 	texWidthRecip	= 1.0f / texWidth;
 	texHeightRecip	= 1.0f / texHeight;
+
+	//Distance field fonts end with how far their fields reach, and how to
+	//scale their metrics so text comes out the size the bitmap font gives
+	float xScale	= texWidthRecip;
+	float yScale	= texHeightRecip;
+	std::string type;
+	if (fontFile >> type && type == "sdf") {
+		float layoutScale;
+		fontFile >> distanceSpread;
+		fontFile >> layoutScale;
+		xScale = layoutScale;
+		yScale = layoutScale;
+	}
+
+	glyphs = new FontGlyph[numChars];
+	for (int i = 0; i < numChars; ++i) {
+		const FontChar& c = allCharData[i];
+		float height = (float)(c.y1 - c.y0);
+		FontGlyph&	g = glyphs[i];
+		g.left		= c.xOff * xScale;
+		g.right		= g.left + (c.x1 - c.x0) * xScale;
+		g.top		= (height + c.yOff) * yScale;
+		g.bottom	= g.top - height * yScale;
+		g.u0		= c.x0 * texWidthRecip;
+		g.v0		= c.y0 * texHeightRecip;
+		g.u1		= c.x1 * texWidthRecip;
+		g.v1		= c.y1 * texHeightRecip;
+		g.advance	= c.xAdvance * xScale;
+	}
 }
 
 
 SimpleFont::~SimpleFont()
 {
 	delete[]	allCharData;
+	delete[]	glyphs;
 	delete		texture;
 }
 
 int SimpleFont::BuildVerticesForString(std::string &text, Vector2&startPos, Vector4&colour, float size, std::vector<Vector3>&positions, std::vector<Vector2>&texCoords, std::vector<Vector4>&colours) {
 	int vertsWritten = 0;
 
-	int endChar = startChar + numChars;
-
-	float currentX = 0.0f;
-
-	positions.reserve(positions.size() + (text.length() * 6));
-	colours.reserve(colours.size() + (text.length() * 6));
-	texCoords.reserve(texCoords.size() + (text.length() * 6));
+	float currentX = startPos.x;
 
+	//No reserve here - reserving exactly what each string needs stops the
+	//vectors growing geometrically, and reallocates them on every call
 	for (size_t i = 0; i < text.length(); ++i) {
-		int charIndex = (int)text[i];
-
-		if (charIndex < startChar) {
+		const FontGlyph* g = GetGlyph(text[i]);
+		if (!g) {
 			continue;
 		}
-		if (charIndex > endChar) {
-			continue;
-		}
-		FontChar& charData = allCharData[charIndex - startChar];
-
-		float scale = size;
 		//For basic vertex buffers, we're assuming we should add 6 vertices
+		float left		= currentX + g->left * size;
+		float right		= currentX + g->right * size;
+		float top		= startPos.y + g->top * size;
+		float bottom	= startPos.y + g->bottom * size;
 
-		float charWidth  = (float)((charData.x1 - charData.x0)/ texWidth) * scale;
-		float charHeight = (float)(charData.y1 - charData.y0);
-
-		float xStart	= ((charData.xOff + currentX) * texWidthRecip) * scale;
-		float yStart	= startPos.y;
-		float yHeight	= (charHeight * texHeightRecip) * scale;
-		float yOff		= ((charHeight + charData.yOff) * texHeightRecip) * scale;
+		positions.emplace_back(Vector3(left, top, 0));
+		positions.emplace_back(Vector3(left, bottom, 0));
+		positions.emplace_back(Vector3(right, bottom, 0));
 
-		positions.emplace_back(Vector3(startPos.x + xStart, yStart + yOff, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart, yStart + yOff - yHeight, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart + charWidth, yStart + yOff - yHeight, 0));
+		positions.emplace_back(Vector3(right, bottom, 0));
+		positions.emplace_back(Vector3(right, top, 0));
+		positions.emplace_back(Vector3(left, top, 0));
 
-		positions.emplace_back(Vector3(startPos.x + xStart + charWidth, yStart + yOff - yHeight, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart + charWidth, yStart + yOff, 0));
-		positions.emplace_back(Vector3(startPos.x + xStart, yStart + yOff, 0));
-
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
-
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
-		colours.emplace_back(colour);
+		for (int j = 0; j < 6; ++j) {
+			colours.emplace_back(colour);
+		}
 
-		texCoords.emplace_back(Vector2(charData.x0 * texWidthRecip, charData.y1 * texHeightRecip));
-		texCoords.emplace_back(Vector2(charData.x0 * texWidthRecip, charData.y0 * texHeightRecip));
-		texCoords.emplace_back(Vector2(charData.x1 * texWidthRecip, charData.y0 * texHeightRecip));
+		texCoords.emplace_back(Vector2(g->u0, g->v1));
+		texCoords.emplace_back(Vector2(g->u0, g->v0));
+		texCoords.emplace_back(Vector2(g->u1, g->v0));
 
-		texCoords.emplace_back(Vector2(charData.x1 * texWidthRecip, charData.y0 * texHeightRecip));
-		texCoords.emplace_back(Vector2(charData.x1 * texWidthRecip, charData.y1 * texHeightRecip));
-		texCoords.emplace_back(Vector2(charData.x0 * texWidthRecip, charData.y1 * texHeightRecip));
+		texCoords.emplace_back(Vector2(g->u1, g->v0));
+		texCoords.emplace_back(Vector2(g->u1, g->v1));
+		texCoords.emplace_back(Vector2(g->u0, g->v1));
 
-		currentX += charData.xAdvance;
+		currentX += g->advance * size;
+		vertsWritten += 6;
 	}
 
 	return vertsWritten;
-}
\ No newline at end of file
+}
@@ -18,6 +18,23 @@ namespace NCL {
 		class Vector4;
 	}
 	namespace Rendering {
+		/*
+		Where a character's quad goes, relative to the pen and at a size of
+		1, and where it comes from in the font texture. Worked out once when
+		the font loads, so laying out text is just scaling and adding these.
+		*/
+		struct FontGlyph {
+			float left;
+			float right;
+			float top;
+			float bottom;
+			float u0;
+			float v0;
+			float u1;
+			float v1;
+			float advance;
+		};
+
 		class SimpleFont
 		{
 		public:
@@ -30,6 +47,22 @@ namespace NCL {
 				return texture;
 			}
 
+			//Whether the texture holds distances to each glyph's edge, rather than coverage
+			bool IsDistanceField() const {
+				return distanceSpread > 0.0f;
+			}
+
+			//How many texels either side of an edge a distance field font's distances reach
+			float GetDistanceSpread() const {
+				return distanceSpread;
+			}
+
+			//nullptr for characters the font doesn't have
+			const FontGlyph* GetGlyph(char c) const {
+				int index = (unsigned char)c - startChar;
+				return (index >= 0 && index < numChars) ? &glyphs[index] : nullptr;
+			}
+
 		protected:
 			//matches stbtt_bakedchar
 			struct FontChar {
@@ -43,6 +76,7 @@ namespace NCL {
 			};
 
 			FontChar*		allCharData;
+			FontGlyph*		glyphs;
 			TextureBase*	texture;
 
 			int startChar;
@@ -52,6 +86,7 @@ namespace NCL {
 			float texHeight;
 			float texWidthRecip;
 			float texHeightRecip;
+			float distanceSpread;	//0 for bitmap fonts
 		};
 	}
 }
@@ -0,0 +1,435 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "SkeletalAnimation.h"
+#include "MeshGeometry.h"
+#include "MeshAnimation.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace NCL;
+using namespace Maths;
+
+namespace {
+	//Tracks that stay within these of their first key are stored as a single key
+	const float ConstantRotationTolerance		= 2e-7f;	//1 - |dot|, roughly a twentieth of a degree
+	const float ConstantTranslationTolerance	= 1e-4f;
+
+	const float QuatComponentRange	= 0.70710678f;	//the smallest 3 components are all within +/- 1/sqrt(2)
+	const float QuatComponentMax	= 32767.0f;
+
+	//Each row of 3 quantised values holds the 3 smallest components, and the top bits
+	//of the first two say which component was left out
+	void PackQuaternion(Quaternion q, uint16_t* out) {
+		int largest = 0;
+		for (int i = 1; i < 4; ++i) {
+			if (std::abs(q.array[i]) > std::abs(q.array[largest])) {
+				largest = i;
+			}
+		}
+		float sign = q.array[largest] < 0.0f ? -1.0f : 1.0f;
+
+		int o = 0;
+		for (int i = 0; i < 4; ++i) {
+			if (i == largest) {
+				continue;
+			}
+			float v = std::min(1.0f, std::max(-1.0f, q.array[i] * sign / QuatComponentRange));
+			out[o++] = (uint16_t)std::lround((v * 0.5f + 0.5f) * QuatComponentMax);
+		}
+		out[0] |= (uint16_t)((largest & 1) << 15);
+		out[1] |= (uint16_t)((largest >> 1) << 15);
+	}
+
+	inline Quaternion UnpackQuaternion(const uint16_t* in) {
+		const float scale = 2.0f * QuatComponentRange / QuatComponentMax;
+		int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+
+		float a = (in[0] & 0x7FFF) * scale - QuatComponentRange;
+		float b = (in[1] & 0x7FFF) * scale - QuatComponentRange;
+		float c = (in[2] & 0x7FFF) * scale - QuatComponentRange;
+		float d = std::sqrt(std::max(0.0f, 1.0f - a * a - b * b - c * c));
+
+		switch (largest) {
+			case 0: return Quaternion(d, a, b, c);
+			case 1: return Quaternion(a, d, b, c);
+			case 2: return Quaternion(a, b, d, c);
+			default:return Quaternion(a, b, c, d);
+		}
+	}
+
+	//The Quaternion(Matrix4) constructor struggles with rotations near 180 degrees,
+	//so this picks whichever component is largest to divide through by. Any scale
+	//in the matrix is removed first.
+	Quaternion RotationFromMatrix(const Matrix4& m) {
+		float c[3][3];
+		for (int col = 0; col < 3; ++col) {
+			float len = std::sqrt(m.array[col * 4 + 0] * m.array[col * 4 + 0] + m.array[col * 4 + 1] * m.array[col * 4 + 1] + m.array[col * 4 + 2] * m.array[col * 4 + 2]);
+			float inv = len > 0.0f ? 1.0f / len : 0.0f;
+			for (int row = 0; row < 3; ++row) {
+				c[col][row] = m.array[col * 4 + row] * inv;
+			}
+		}
+		float trace = c[0][0] + c[1][1] + c[2][2];
+		Quaternion q;
+		if (trace > 0.0f) {
+			float s = std::sqrt(trace + 1.0f) * 2.0f;
+			q = Quaternion((c[1][2] - c[2][1]) / s, (c[2][0] - c[0][2]) / s, (c[0][1] - c[1][0]) / s, 0.25f * s);
+		}
+		else if (c[0][0] > c[1][1] && c[0][0] > c[2][2]) {
+			float s = std::sqrt(1.0f + c[0][0] - c[1][1] - c[2][2]) * 2.0f;
+			q = Quaternion(0.25f * s, (c[1][0] + c[0][1]) / s, (c[2][0] + c[0][2]) / s, (c[1][2] - c[2][1]) / s);
+		}
+		else if (c[1][1] > c[2][2]) {
+			float s = std::sqrt(1.0f + c[1][1] - c[0][0] - c[2][2]) * 2.0f;
+			q = Quaternion((c[1][0] + c[0][1]) / s, 0.25f * s, (c[2][1] + c[1][2]) / s, (c[2][0] - c[0][2]) / s);
+		}
+		else {
+			float s = std::sqrt(1.0f + c[2][2] - c[0][0] - c[1][1]) * 2.0f;
+			q = Quaternion((c[2][0] + c[0][2]) / s, (c[2][1] + c[1][2]) / s, 0.25f * s, (c[0][1] - c[1][0]) / s);
+		}
+		q.Normalise();
+		return q;
+	}
+
+	//Both matrices are assumed to be affine, so the bottom row is never read
+	inline void MultiplyAffine(const float* a, const float* b, float* out) {
+		for (int c = 0; c < 4; ++c) {
+			float b0 = b[c * 4 + 0];
+			float b1 = b[c * 4 + 1];
+			float b2 = b[c * 4 + 2];
+			for (int r = 0; r < 3; ++r) {
+				out[c * 4 + r] = a[r] * b0 + a[4 + r] * b1 + a[8 + r] * b2;
+			}
+			out[c * 4 + 3] = 0.0f;
+		}
+		out[12] += a[12];
+		out[13] += a[13];
+		out[14] += a[14];
+		out[15] = 1.0f;
+	}
+
+	inline void PoseToMatrix(const JointPose& p, float* out) {
+		const Quaternion& q = p.rotation;
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float xw = q.x * q.w, yw = q.y * q.w, zw = q.z * q.w;
+
+		out[0]  = 1.0f - 2.0f * (yy + zz);
+		out[1]  = 2.0f * (xy + zw);
+		out[2]  = 2.0f * (xz - yw);
+		out[3]  = 0.0f;
+		out[4]  = 2.0f * (xy - zw);
+		out[5]  = 1.0f - 2.0f * (xx + zz);
+		out[6]  = 2.0f * (yz + xw);
+		out[7]  = 0.0f;
+		out[8]  = 2.0f * (xz + yw);
+		out[9]  = 2.0f * (yz - xw);
+		out[10] = 1.0f - 2.0f * (xx + yy);
+		out[11] = 0.0f;
+		out[12] = p.position.x;
+		out[13] = p.position.y;
+		out[14] = p.position.z;
+		out[15] = 1.0f;
+	}
+}
+
+Skeleton::Skeleton(const MeshGeometry& mesh) : Skeleton(mesh.GetJointParents(), mesh.GetInverseBindPose()) {
+}
+
+Skeleton::Skeleton(const std::vector<int>& inParents, const std::vector<Matrix4>& inInverseBindPose) {
+	parents			= inParents;
+	inverseBindPose	= inInverseBindPose;
+
+	size_t jointCount = parents.size();
+	if (inverseBindPose.size() != jointCount) {
+		std::cout << __FUNCTION__ << " inverse bind pose has " << inverseBindPose.size() << " joints, expected " << jointCount << std::endl;
+		inverseBindPose.resize(jointCount);
+	}
+	//Anything without a valid parent, or part of a loop, is treated as a root
+	std::vector<char> state(jointCount, 0); //0 = unvisited, 1 = being visited, 2 = placed
+	std::vector<unsigned int> chain;
+	evaluationOrder.reserve(jointCount);
+
+	for (size_t i = 0; i < jointCount; ++i) {
+		int j = (int)i;
+		while (j >= 0 && j < (int)jointCount && state[j] == 0) {
+			state[j] = 1;
+			chain.emplace_back(j);
+			j = parents[j];
+		}
+		if (j >= 0 && j < (int)jointCount && state[j] == 1) {
+			parents[chain.back()] = -1;
+		}
+		for (auto k = chain.rbegin(); k != chain.rend(); ++k) {
+			if (parents[*k] >= (int)jointCount) {
+				parents[*k] = -1;
+			}
+			state[*k] = 2;
+			evaluationOrder.emplace_back(*k);
+		}
+		chain.clear();
+	}
+}
+
+void Skeleton::BuildMatrices(const JointPose* pose, Matrix4* modelSpace, Matrix4* skinning) const {
+	for (unsigned int j : evaluationOrder) {
+		int p = parents[j];
+		if (p < 0) {
+			PoseToMatrix(pose[j], modelSpace[j].array);
+		}
+		else {
+			float local[16];
+			PoseToMatrix(pose[j], local);
+			MultiplyAffine(modelSpace[p].array, local, modelSpace[j].array);
+		}
+		MultiplyAffine(modelSpace[j].array, inverseBindPose[j].array, skinning[j].array);
+	}
+}
+
+AnimationClip::AnimationClip(const MeshAnimation& anim, const Skeleton& skeleton) {
+	frameCount	= anim.GetFrameCount();
+	frameRate	= anim.GetFrameRate();
+	animatedRotationCount		= 0;
+	animatedTranslationCount	= 0;
+
+	unsigned int jointCount = anim.GetJointCount();
+	if (jointCount != skeleton.GetJointCount()) {
+		std::cout << __FUNCTION__ << " animation has " << jointCount << " joints, but the skeleton has " << skeleton.GetJointCount() << std::endl;
+		frameCount = 0;
+		return;
+	}
+	if (frameCount == 0) {
+		return;
+	}
+	const std::vector<int>& parents = skeleton.GetJointParents();
+
+	//The baked frames are in model space, so each joint is taken back into its parent's space
+	std::vector<Quaternion>	rotations((size_t)frameCount * jointCount);
+	std::vector<Vector3>	positions((size_t)frameCount * jointCount);
+
+	for (unsigned int f = 0; f < frameCount; ++f) {
+		const Matrix4* frame = anim.GetJointData(f);
+		for (unsigned int j = 0; j < jointCount; ++j) {
+			Matrix4 local = parents[j] < 0 ? frame[j] : frame[parents[j]].Inverse() * frame[j];
+			rotations[(size_t)f * jointCount + j] = RotationFromMatrix(local);
+			positions[(size_t)f * jointCount + j] = local.GetPositionVector();
+		}
+	}
+
+	tracks.resize(jointCount);
+	for (unsigned int j = 0; j < jointCount; ++j) {
+		JointTrack& t = tracks[j];
+
+		const Quaternion& firstRot = rotations[j];
+		t.constantRotation = true;
+		Vector3 minPos = positions[j];
+		Vector3 maxPos = positions[j];
+		for (unsigned int f = 1; f < frameCount; ++f) {
+			const Quaternion&	q = rotations[(size_t)f * jointCount + j];
+			const Vector3&		p = positions[(size_t)f * jointCount + j];
+			if (1.0f - std::abs(Quaternion::Dot(q, firstRot)) > ConstantRotationTolerance) {
+				t.constantRotation = false;
+			}
+			for (int i = 0; i < 3; ++i) {
+				minPos.array[i] = std::min(minPos.array[i], p.array[i]);
+				maxPos.array[i] = std::max(maxPos.array[i], p.array[i]);
+			}
+		}
+		Vector3 extent = maxPos - minPos;
+		t.constantTranslation = std::max(extent.x, std::max(extent.y, extent.z)) < ConstantTranslationTolerance;
+
+		t.translationMin = minPos;
+		for (int i = 0; i < 3; ++i) {
+			t.translationScale.array[i] = (t.constantTranslation || extent.array[i] <= 0.0f) ? 0.0f : extent.array[i] / 65535.0f;
+		}
+		t.rotationIndex		= t.constantRotation	? (uint32_t)(constantRotations.size() / 3)		: animatedRotationCount++;
+		t.translationIndex	= t.constantTranslation	? (uint32_t)(constantTranslations.size() / 3)	: animatedTranslationCount++;
+
+		if (t.constantRotation) {
+			constantRotations.resize(constantRotations.size() + 3);
+			PackQuaternion(firstRot, &constantRotations[constantRotations.size() - 3]);
+		}
+		if (t.constantTranslation) {
+			constantTranslations.resize(constantTranslations.size() + 3, 0);
+		}
+	}
+
+	animatedRotations.resize((size_t)frameCount * animatedRotationCount * 3);
+	animatedTranslations.resize((size_t)frameCount * animatedTranslationCount * 3);
+
+	for (unsigned int f = 0; f < frameCount; ++f) {
+		for (unsigned int j = 0; j < jointCount; ++j) {
+			const JointTrack& t = tracks[j];
+			size_t source = (size_t)f * jointCount + j;
+			if (!t.constantRotation) {
+				PackQuaternion(rotations[source], &animatedRotations[((size_t)f * animatedRotationCount + t.rotationIndex) * 3]);
+			}
+			if (!t.constantTranslation) {
+				uint16_t* out = &animatedTranslations[((size_t)f * animatedTranslationCount + t.translationIndex) * 3];
+				for (int i = 0; i < 3; ++i) {
+					float range = t.translationScale.array[i];
+					out[i] = range > 0.0f ? (uint16_t)std::lround((positions[source].array[i] - t.translationMin.array[i]) / range) : 0;
+				}
+			}
+		}
+	}
+}
+
+void AnimationClip::SamplePose(float time, JointPose* pose, bool looping) const {
+	AccumulatePose(time, 1.0f, pose, true, looping);
+}
+
+void AnimationClip::AccumulatePose(float time, float weight, JointPose* pose, bool first, bool looping) const {
+	if (frameCount == 0) {
+		return;
+	}
+	float frame = time * frameRate;
+	unsigned int frameA;
+	unsigned int frameB;
+	if (looping) {
+		frame = std::fmod(frame, (float)frameCount);
+		if (frame < 0.0f) {
+			frame += frameCount;
+		}
+		frameA = std::min((unsigned int)frame, frameCount - 1);
+		frameB = frameA + 1 == frameCount ? 0 : frameA + 1;
+	}
+	else {
+		frame = std::min((float)(frameCount - 1), std::max(0.0f, frame));
+		frameA = (unsigned int)frame;
+		frameB = std::min(frameA + 1, frameCount - 1);
+	}
+	float t = frame - frameA;
+
+	const uint16_t* rotationsA		= animatedRotations.data() + (size_t)frameA * animatedRotationCount * 3;
+	const uint16_t* rotationsB		= animatedRotations.data() + (size_t)frameB * animatedRotationCount * 3;
+	const uint16_t* translationsA	= animatedTranslations.data() + (size_t)frameA * animatedTranslationCount * 3;
+	const uint16_t* translationsB	= animatedTranslations.data() + (size_t)frameB * animatedTranslationCount * 3;
+
+	for (size_t j = 0; j < tracks.size(); ++j) {
+		const JointTrack& track = tracks[j];
+		Quaternion	rotation;
+		Vector3		position;
+
+		if (track.constantRotation) {
+			rotation = UnpackQuaternion(&constantRotations[track.rotationIndex * 3]);
+		}
+		else {
+			Quaternion a = UnpackQuaternion(rotationsA + track.rotationIndex * 3);
+			Quaternion b = UnpackQuaternion(rotationsB + track.rotationIndex * 3);
+			float bWeight = Quaternion::Dot(a, b) < 0.0f ? -t : t;
+			rotation = a * (1.0f - t) + b * bWeight;
+			rotation.Normalise();
+		}
+
+		const uint16_t* keyA = track.constantTranslation ? &constantTranslations[track.translationIndex * 3] : translationsA + track.translationIndex * 3;
+		const uint16_t* keyB = track.constantTranslation ? keyA : translationsB + track.translationIndex * 3;
+		for (int i = 0; i < 3; ++i) {
+			float key = keyA[i] + (keyB[i] - keyA[i]) * t;
+			position.array[i] = track.translationMin.array[i] + key * track.translationScale.array[i];
+		}
+
+		JointPose& out = pose[j];
+		if (first) {
+			out.rotation = rotation * weight;
+			out.position = position * weight;
+		}
+		else {
+			//Rotations are blended along the shortest path to what's been accumulated so far
+			float rotationWeight = Quaternion::Dot(out.rotation, rotation) < 0.0f ? -weight : weight;
+			out.rotation = out.rotation + rotation * rotationWeight;
+			out.position = out.position + position * weight;
+		}
+	}
+}
+
+size_t AnimationClip::GetCompressedSize() const {
+	return sizeof(AnimationClip) + tracks.size() * sizeof(JointTrack) +
+		(constantRotations.size() + constantTranslations.size() + animatedRotations.size() + animatedTranslations.size()) * sizeof(uint16_t);
+}
+
+AnimationInstance::AnimationInstance(const Skeleton& inSkeleton) {
+	skeleton = &inSkeleton;
+	pose.resize(skeleton->GetJointCount());
+	modelMatrices.resize(skeleton->GetJointCount());
+	skinningMatrices.resize(skeleton->GetJointCount());
+}
+
+int AnimationInstance::AddLayer(const AnimationClip* clip, float weight, float speed, bool looping) {
+	if (!clip || clip->GetJointCount() != skeleton->GetJointCount()) {
+		std::cout << __FUNCTION__ << " clip doesn't match this instance's skeleton!" << std::endl;
+		return -1;
+	}
+	layers.push_back({ clip, 0.0f, speed, weight, looping });
+	return (int)layers.size() - 1;
+}
+
+void AnimationInstance::SetLayerWeight(int layer, float weight) {
+	if (layer >= 0 && layer < (int)layers.size()) {
+		layers[layer].weight = weight;
+	}
+}
+
+void AnimationInstance::SetLayerTime(int layer, float time) {
+	if (layer >= 0 && layer < (int)layers.size()) {
+		layers[layer].time = time;
+	}
+}
+
+void AnimationInstance::SetLayerSpeed(int layer, float speed) {
+	if (layer >= 0 && layer < (int)layers.size()) {
+		layers[layer].speed = speed;
+	}
+}
+
+void AnimationInstance::Update(float dt) {
+	for (AnimationLayer& l : layers) {
+		l.time += dt * l.speed;
+		float duration = l.clip->GetDuration();
+		if (l.looping && duration > 0.0f) {
+			//Keeps time small, so that it doesn't lose precision over a long session
+			l.time = std::fmod(l.time, duration);
+			if (l.time < 0.0f) {
+				l.time += duration;
+			}
+		}
+	}
+}
+
+void AnimationInstance::Evaluate() {
+	float totalWeight = 0.0f;
+	for (const AnimationLayer& l : layers) {
+		if (l.weight > 0.0f) {
+			l.clip->AccumulatePose(l.time, l.weight, pose.data(), totalWeight == 0.0f, l.looping);
+			totalWeight += l.weight;
+		}
+	}
+	if (totalWeight == 0.0f) { //Nothing playing, so just sit in the bind pose
+		std::fill(skinningMatrices.begin(), skinningMatrices.end(), Matrix4());
+		return;
+	}
+	float invWeight = 1.0f / totalWeight;
+	for (JointPose& p : pose) {
+		p.rotation.Normalise();
+		p.position = p.position * invWeight;
+	}
+	skeleton->BuildMatrices(pose.data(), modelMatrices.data(), skinningMatrices.data());
+}
+
+void AnimationInstance::EvaluateAll(const std::vector<AnimationInstance*>& instances, float dt) {
+	ParallelFor(instances.size(), 16, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			instances[i]->Update(dt);
+			instances[i]->Evaluate();
+		}
+	});
+}
@@ -0,0 +1,177 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Quaternion.h"
+#include "Vector3.h"
+#include "Matrix4.h"
+#include <vector>
+#include <cstdint>
+
+namespace NCL {
+	class MeshGeometry;
+	class MeshAnimation;
+	using namespace Maths;
+
+	//A joint's transform relative to its parent
+	struct JointPose {
+		Quaternion	rotation;
+		Vector3		position;
+	};
+
+	/*
+	The parts of a mesh that animation needs - the joint hierarchy, and the
+	inverse bind pose that takes a vertex into each joint's space. Joints
+	are evaluated in an order that puts every parent before its children,
+	so a mesh's joints can come in any order.
+	*/
+	class Skeleton {
+	public:
+		Skeleton(const MeshGeometry& mesh);
+		Skeleton(const std::vector<int>& parents, const std::vector<Matrix4>& inverseBindPose);
+
+		unsigned int GetJointCount() const {
+			return (unsigned int)parents.size();
+		}
+
+		const std::vector<int>& GetJointParents() const {
+			return parents;
+		}
+
+		const std::vector<Matrix4>& GetInverseBindPose() const {
+			return inverseBindPose;
+		}
+
+		//Turns a set of local joint poses into model space joint matrices, and the skinning matrices
+		//(model space * inverse bind pose) a shader needs
+		void BuildMatrices(const JointPose* pose, Matrix4* modelSpace, Matrix4* skinning) const;
+
+	protected:
+		std::vector<int>				parents;
+		std::vector<Matrix4>			inverseBindPose;
+		std::vector<unsigned int>		evaluationOrder;
+	};
+
+	/*
+	A MeshAnimation, converted to local joint poses and compressed. Each
+	joint gets a rotation and a translation track - tracks that never
+	change are stored as a single key, the rest get a key per frame.
+	Rotations are stored as the 3 smallest quaternion components in 15
+	bits each, and translations as 16 bits per axis within the track's
+	bounds, so a key is 6 bytes rather than a 64 byte matrix.
+
+	Keys are stored frame by frame, so sampling between two frames only
+	touches two small runs of memory.
+	*/
+	class AnimationClip {
+	public:
+		AnimationClip(const MeshAnimation& anim, const Skeleton& skeleton);
+
+		unsigned int GetJointCount() const {
+			return (unsigned int)tracks.size();
+		}
+
+		unsigned int GetFrameCount() const {
+			return frameCount;
+		}
+
+		float GetFrameRate() const {
+			return frameRate;
+		}
+
+		//Looping clips interpolate from the last frame back round to the first
+		float GetDuration() const {
+			return frameRate > 0.0f ? frameCount / frameRate : 0.0f;
+		}
+
+		void SamplePose(float time, JointPose* pose, bool looping = true) const;
+
+		//Adds this clip's pose at time, scaled by weight - see AnimationInstance::Evaluate
+		void AccumulatePose(float time, float weight, JointPose* pose, bool first, bool looping = true) const;
+
+		size_t GetCompressedSize() const;
+
+	protected:
+		struct JointTrack {
+			uint32_t		rotationIndex;		//into constantRotations, or a frame's animatedRotations
+			uint32_t		translationIndex;
+			bool			constantRotation;
+			bool			constantTranslation;
+			Vector3			translationMin;
+			Vector3			translationScale;
+		};
+
+		std::vector<JointTrack>	tracks;
+
+		std::vector<uint16_t>	constantRotations;		//3 values per joint
+		std::vector<uint16_t>	constantTranslations;
+		std::vector<uint16_t>	animatedRotations;		//frameCount * animatedRotationCount * 3
+		std::vector<uint16_t>	animatedTranslations;
+
+		uint32_t		animatedRotationCount;
+		uint32_t		animatedTranslationCount;
+		unsigned int	frameCount;
+		float			frameRate;
+	};
+
+	struct AnimationLayer {
+		const AnimationClip*	clip;
+		float					time;
+		float					speed;
+		float					weight;
+		bool					looping;
+	};
+
+	/*
+	One animated character - any number of clips blended together by
+	weight, and the skinning matrices they produce. EvaluateAll updates a
+	whole crowd at once, spread across every core.
+	*/
+	class AnimationInstance {
+	public:
+		AnimationInstance(const Skeleton& skeleton);
+
+		//Returns the layer's index, for use with SetLayerWeight etc
+		int AddLayer(const AnimationClip* clip, float weight = 1.0f, float speed = 1.0f, bool looping = true);
+
+		void SetLayerWeight(int layer, float weight);
+		void SetLayerTime(int layer, float time);
+		void SetLayerSpeed(int layer, float speed);
+
+		const std::vector<AnimationLayer>& GetLayers() const {
+			return layers;
+		}
+
+		//Moves every layer along by dt seconds
+		void Update(float dt);
+
+		//Blends the layers together, and builds the skinning matrices
+		void Evaluate();
+
+		const std::vector<JointPose>& GetPose() const {
+			return pose;
+		}
+
+		const std::vector<Matrix4>& GetModelMatrices() const {
+			return modelMatrices;
+		}
+
+		const std::vector<Matrix4>& GetSkinningMatrices() const {
+			return skinningMatrices;
+		}
+
+		static void EvaluateAll(const std::vector<AnimationInstance*>& instances, float dt);
+
+	protected:
+		const Skeleton*				skeleton;
+		std::vector<AnimationLayer>	layers;
+		std::vector<JointPose>		pose;
+		std::vector<Matrix4>		modelMatrices;
+		std::vector<Matrix4>		skinningMatrices;
+	};
+}
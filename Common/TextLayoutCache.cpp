@@ -0,0 +1,138 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "TextLayoutCache.h"
+
+#include <cstring>
+
+using namespace NCL;
+using namespace Rendering;
+using namespace Maths;
+
+TextLayoutCache::TextLayoutCache(const SimpleFont& font, size_t maxRuns) : font(font) {
+	this->maxRuns	= maxRuns;
+	this->frame		= 0;
+	runs.reserve(maxRuns);
+}
+
+//FNV-1a, over the characters and then the size and colour's bits
+uint64_t TextLayoutCache::HashKey(const char* text, size_t length, float size, unsigned int colour) {
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](unsigned char byte) {
+		hash ^= byte;
+		hash *= 1099511628211ull;
+	};
+	for (size_t i = 0; i < length; ++i) {
+		add((unsigned char)text[i]);
+	}
+	unsigned int sizeBits;
+	memcpy(&sizeBits, &size, sizeof(float));
+	for (int i = 0; i < 4; ++i) {
+		add((unsigned char)(sizeBits >> (i * 8)));
+		add((unsigned char)(colour >> (i * 8)));
+	}
+	return hash;
+}
+
+void TextLayoutCache::LayoutString(const char* text, size_t length, float size, unsigned int colour, std::vector<DebugTextVertex>& output) const {
+	size_t	first	= output.size();
+	size_t	count	= 0;
+	float	penX	= 0.0f;
+
+	output.resize(first + length * 6);
+	DebugTextVertex* v = output.data() + first;
+	for (size_t i = 0; i < length; ++i) {
+		const FontGlyph* g = font.GetGlyph(text[i]);
+		if (!g) {
+			continue;
+		}
+		float left		= penX + g->left * size;
+		float right		= penX + g->right * size;
+		float top		= g->top * size;
+		float bottom	= g->bottom * size;
+
+		*v++ = { Vector3(left,	top,	0), colour, Vector2(g->u0, g->v1) };
+		*v++ = { Vector3(left,	bottom, 0), colour, Vector2(g->u0, g->v0) };
+		*v++ = { Vector3(right, bottom, 0), colour, Vector2(g->u1, g->v0) };
+
+		*v++ = { Vector3(right, bottom, 0), colour, Vector2(g->u1, g->v0) };
+		*v++ = { Vector3(right, top,	0), colour, Vector2(g->u1, g->v1) };
+		*v++ = { Vector3(left,	top,	0), colour, Vector2(g->u0, g->v1) };
+
+		penX	+= g->advance * size;
+		count	+= 6;
+	}
+	output.resize(first + count);
+}
+
+void TextLayoutCache::AppendString(const char* text, size_t length, const Vector2& position, float size,
+	const Vector4& colour, TextUsage usage, std::vector<DebugTextVertex>& output) {
+	unsigned int	packedColour	= PackDebugColour(colour);
+	uint64_t		key				= HashKey(text, length, size, packedColour);
+	size_t			first			= output.size();
+	frameStats.strings++;
+
+	auto i = runs.find(key);
+	if (i == runs.end()) {
+		TextRun& run = runs[key];
+		run.text.assign(text, length);
+		run.size	= size;
+		run.colour	= packedColour;
+		run.usage	= usage;
+		LayoutString(text, length, size, packedColour, run.vertices);
+		frameStats.layouts++;
+		i = runs.find(key);
+	}
+	else if (i->second.size != size || i->second.colour != packedColour ||
+		i->second.text.length() != length || memcmp(i->second.text.data(), text, length) != 0) {
+		//Two strings with the same hash - this one just doesn't get cached
+		LayoutString(text, length, size, packedColour, output);
+		frameStats.layouts++;
+		for (size_t v = first; v < output.size(); ++v) {
+			output[v].position += Vector3(position.x, position.y, 0);
+		}
+		return;
+	}
+	TextRun& run = i->second;
+	run.lastUsed = frame;
+	if (usage == TextUsage::Static) {
+		run.usage = TextUsage::Static;
+	}
+	output.resize(first + run.vertices.size());
+	DebugTextVertex* out = output.data() + first;
+	for (const DebugTextVertex& v : run.vertices) {
+		*out = v;
+		out->position.x += position.x;
+		out->position.y += position.y;
+		out++;
+	}
+}
+
+void TextLayoutCache::EndFrame() {
+	//Past the limit, even static text goes if it wasn't drawn this frame
+	bool overFull = runs.size() > maxRuns;
+
+	evictions.clear();
+	for (const auto& i : runs) {
+		if (i.second.lastUsed != frame && (overFull || i.second.usage == TextUsage::Dynamic)) {
+			evictions.emplace_back(i.first);
+		}
+	}
+	for (uint64_t key : evictions) {
+		runs.erase(key);
+	}
+	frameStats.cachedRuns	= runs.size();
+	frameStats.evictedRuns	= evictions.size();
+	lastFrameStats			= frameStats;
+	frameStats				= TextLayoutStats();
+	frame++;
+}
+
+void TextLayoutCache::Clear() {
+	runs.clear();
+}
@@ -0,0 +1,77 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "SimpleFont.h"
+#include "DebugDrawBuffer.h"
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace NCL {
+	namespace Rendering {
+		struct TextLayoutStats {
+			size_t strings		= 0;
+			size_t layouts		= 0;	//strings that weren't cached, and had to be laid out
+			size_t cachedRuns	= 0;
+			size_t evictedRuns	= 0;
+		};
+
+		/*
+		Keeps the vertices of strings laid out in earlier frames, keyed on
+		their text, size and colour, so a string that hasn't changed is just
+		copied out again, moved to wherever it's drawn this time. Only new or
+		changed strings go through the font. Call EndFrame once a frame's
+		text has all been added, to let go of dynamic text that's gone.
+		*/
+		class TextLayoutCache {
+		public:
+			TextLayoutCache(const SimpleFont& font, size_t maxRuns = 4096);
+
+			//Appends a string's vertices to output, with its pen starting at position
+			void AppendString(const char* text, size_t length, const Maths::Vector2& position, float size,
+				const Maths::Vector4& colour, TextUsage usage, std::vector<DebugTextVertex>& output);
+
+			void EndFrame();
+
+			//Forgets every run, static or not
+			void Clear();
+
+			//For the frame EndFrame was last called on
+			const TextLayoutStats& GetLastFrameStats() const {
+				return lastFrameStats;
+			}
+
+		protected:
+			struct TextRun {
+				std::string						text;
+				float							size;
+				unsigned int					colour;
+				TextUsage						usage;
+				uint64_t						lastUsed;	//frame number
+				std::vector<DebugTextVertex>	vertices;	//relative to the start of the pen
+			};
+
+			static uint64_t HashKey(const char* text, size_t length, float size, unsigned int colour);
+
+			//Lays out from the origin, straight into output
+			void LayoutString(const char* text, size_t length, float size, unsigned int colour, std::vector<DebugTextVertex>& output) const;
+
+			const SimpleFont&						font;
+			std::unordered_map<uint64_t, TextRun>	runs;
+			size_t									maxRuns;
+			uint64_t								frame;
+
+			TextLayoutStats							frameStats;
+			TextLayoutStats							lastFrameStats;
+			std::vector<uint64_t>					evictions;	//scratch space for EndFrame
+		};
+	}
+}
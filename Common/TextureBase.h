@@ -6,6 +6,9 @@ namespace NCL {
 		{
 		public:
 			virtual ~TextureBase();
+
+			//Exchanges the underlying API texture with another of the same type
+			virtual void SwapWith(TextureBase& other) {}
 		protected:
 			TextureBase();
 
@@ -0,0 +1,653 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "TextureCooker.h"
+#include "Assets.h"
+#include "MappedFile.h"
+#include "ParallelFor.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+
+using namespace NCL;
+using std::vector;
+
+namespace {
+	const char			CookedTextureID[4]		= { 'N', 'C', 'L', 'T' };
+	const unsigned int	CookedTextureVersion	= 1;
+	const unsigned int	MaxMipCount				= 32;
+
+	struct CookedTextureHeader {
+		char			id[4];
+		unsigned int	version;
+		unsigned int	format;
+		unsigned int	width;
+		unsigned int	height;
+		unsigned int	mipCount;
+	};
+
+	enum class MipSpace {
+		Stored,	//average the bytes as they are
+		Linear,	//sRGB colours, averaged in linear light
+		Normal	//xyz directions, renormalised after averaging
+	};
+
+	//4 floats per texel, in whichever space the mip chain is being built in
+	struct FloatImage {
+		int				width	= 0;
+		int				height	= 0;
+		vector<float>	texels;
+	};
+
+	float SRGBToLinear(float c) {
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSRGB(float c) {
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	unsigned char ToByte(float v) {
+		return (unsigned char)std::lround(std::min(1.0f, std::max(0.0f, v)) * 255.0f);
+	}
+
+	FloatImage ToFloat(const unsigned char* rgba, int width, int height, MipSpace space) {
+		FloatImage image;
+		image.width		= width;
+		image.height	= height;
+		image.texels.resize((size_t)width * height * 4);
+
+		for (size_t i = 0; i < image.texels.size(); ++i) {
+			float v = rgba[i] / 255.0f;
+			bool isAlpha = (i & 3) == 3;
+			if (space == MipSpace::Linear && !isAlpha) {
+				v = SRGBToLinear(v);
+			}
+			else if (space == MipSpace::Normal && !isAlpha) {
+				v = v * 2.0f - 1.0f;
+			}
+			image.texels[i] = v;
+		}
+		return image;
+	}
+
+	void ToBytes(const FloatImage& image, MipSpace space, vector<unsigned char>& rgba) {
+		rgba.resize(image.texels.size());
+		for (size_t i = 0; i < image.texels.size(); ++i) {
+			float v = image.texels[i];
+			bool isAlpha = (i & 3) == 3;
+			if (space == MipSpace::Linear && !isAlpha) {
+				v = LinearToSRGB(v);
+			}
+			else if (space == MipSpace::Normal && !isAlpha) {
+				v = v * 0.5f + 0.5f;
+			}
+			rgba[i] = ToByte(v);
+		}
+	}
+
+	//2x2 box filter - odd edges just lose their last row or column, as the GPU's own mips would
+	FloatImage Downsample(const FloatImage& source, MipSpace space) {
+		FloatImage image;
+		image.width		= std::max(1, source.width  / 2);
+		image.height	= std::max(1, source.height / 2);
+		image.texels.resize((size_t)image.width * image.height * 4);
+
+		for (int y = 0; y < image.height; ++y) {
+			for (int x = 0; x < image.width; ++x) {
+				float* out = &image.texels[((size_t)y * image.width + x) * 4];
+				for (int i = 0; i < 4; ++i) {
+					int sx = std::min(x * 2 + (i & 1),	source.width  - 1);
+					int sy = std::min(y * 2 + (i >> 1), source.height - 1);
+					const float* in = &source.texels[((size_t)sy * source.width + sx) * 4];
+					for (int c = 0; c < 4; ++c) {
+						out[c] += in[c] * 0.25f;
+					}
+				}
+				if (space == MipSpace::Normal) {
+					float length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+					if (length > 0.0f) {
+						out[0] /= length;
+						out[1] /= length;
+						out[2] /= length;
+					}
+				}
+			}
+		}
+		return image;
+	}
+
+	//Blocks that hang off the edge of the image repeat its last row and column
+	void FetchBlock(const unsigned char* rgba, int width, int height, int blockX, int blockY, unsigned char* block) {
+		for (int y = 0; y < 4; ++y) {
+			for (int x = 0; x < 4; ++x) {
+				int sx = std::min(blockX * 4 + x, width  - 1);
+				int sy = std::min(blockY * 4 + y, height - 1);
+				memcpy(block + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+			}
+		}
+	}
+
+	unsigned short To565(const float* c) {
+		int r = (int)std::lround(std::min(255.0f, std::max(0.0f, c[0])) * 31.0f / 255.0f);
+		int g = (int)std::lround(std::min(255.0f, std::max(0.0f, c[1])) * 63.0f / 255.0f);
+		int b = (int)std::lround(std::min(255.0f, std::max(0.0f, c[2])) * 31.0f / 255.0f);
+		return (unsigned short)((r << 11) | (g << 5) | b);
+	}
+
+	void From565(unsigned short c, float* out) {
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		out[0] = (float)((r << 3) | (r >> 2));
+		out[1] = (float)((g << 2) | (g >> 4));
+		out[2] = (float)((b << 3) | (b >> 2));
+	}
+
+	//Index 3 of the three colour palette is transparent black
+	void ColourPalette(unsigned short c0, unsigned short c1, bool fourColour, float palette[4][3]) {
+		From565(c0, palette[0]);
+		From565(c1, palette[1]);
+		for (int c = 0; c < 3; ++c) {
+			if (fourColour) {
+				palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+				palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+			}
+			else {
+				palette[2][c] = (palette[0][c] + palette[1][c]) * 0.5f;
+				palette[3][c] = 0.0f;
+			}
+		}
+	}
+
+	struct ColourBlock {
+		float	texels[16][3];
+		bool	transparent[16];
+		bool	threeColour;
+	};
+
+	struct ColourFit {
+		unsigned short	c0;
+		unsigned short	c1;
+		unsigned char	indices[16];
+		float			error;
+	};
+
+	/*
+	Orders the endpoints for the block's mode (c0 > c1 means four colours,
+	c0 <= c1 three and transparent), then picks the nearest palette entry
+	for every texel
+	*/
+	ColourFit FitColours(const ColourBlock& block, unsigned short a, unsigned short b) {
+		ColourFit fit;
+		bool fourColour = !block.threeColour;
+		fit.c0		= fourColour ? std::max(a, b) : std::min(a, b);
+		fit.c1		= fourColour ? std::min(a, b) : std::max(a, b);
+		fit.error	= 0.0f;
+
+		float palette[4][3];
+		ColourPalette(fit.c0, fit.c1, fourColour, palette);
+		int choices = fourColour ? 4 : 3;
+
+		for (int i = 0; i < 16; ++i) {
+			if (block.transparent[i]) {
+				fit.indices[i] = 3;
+				continue;
+			}
+			float bestError = FLT_MAX;
+			for (int p = 0; p < choices; ++p) {
+				float dr = block.texels[i][0] - palette[p][0];
+				float dg = block.texels[i][1] - palette[p][1];
+				float db = block.texels[i][2] - palette[p][2];
+				float error = dr * dr + dg * dg + db * db;
+				if (error < bestError) {
+					bestError		= error;
+					fit.indices[i]	= (unsigned char)p;
+				}
+			}
+			fit.error += bestError;
+		}
+		return fit;
+	}
+
+	//Least squares endpoints for a given set of indices
+	bool RefineEndpoints(const ColourBlock& block, const ColourFit& fit, float* end0, float* end1) {
+		static const float fourWeights[4]	= { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		static const float threeWeights[3]	= { 1.0f, 0.0f, 0.5f };
+
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = { 0, 0, 0 };
+		float bx[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; ++i) {
+			if (block.transparent[i]) {
+				continue;
+			}
+			float w0 = block.threeColour ? threeWeights[fit.indices[i]] : fourWeights[fit.indices[i]];
+			float w1 = 1.0f - w0;
+			aa += w0 * w0;
+			ab += w0 * w1;
+			bb += w1 * w1;
+			for (int c = 0; c < 3; ++c) {
+				ax[c] += w0 * block.texels[i][c];
+				bx[c] += w1 * block.texels[i][c];
+			}
+		}
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f) {
+			return false;
+		}
+		for (int c = 0; c < 3; ++c) {
+			end0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+			end1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+		}
+		return true;
+	}
+
+	void EncodeColourBlock(const unsigned char* rgba, bool allowTransparent, unsigned char* out) {
+		ColourBlock block;
+		block.threeColour = false;
+		int used = 0;
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 3; ++c) {
+				block.texels[i][c] = rgba[i * 4 + c];
+			}
+			block.transparent[i] = allowTransparent && rgba[i * 4 + 3] < 128;
+			block.threeColour |= block.transparent[i];
+			used += block.transparent[i] ? 0 : 1;
+		}
+
+		float mean[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 3 && !block.transparent[i]; ++c) {
+				mean[c] += block.texels[i][c] / std::max(used, 1);
+			}
+		}
+		//Principal axis of the colours, by power iteration on their covariance
+		float covariance[6] = { 0, 0, 0, 0, 0, 0 };
+		for (int i = 0; i < 16; ++i) {
+			if (block.transparent[i]) {
+				continue;
+			}
+			float d[3] = { block.texels[i][0] - mean[0], block.texels[i][1] - mean[1], block.texels[i][2] - mean[2] };
+			covariance[0] += d[0] * d[0];
+			covariance[1] += d[0] * d[1];
+			covariance[2] += d[0] * d[2];
+			covariance[3] += d[1] * d[1];
+			covariance[4] += d[1] * d[2];
+			covariance[5] += d[2] * d[2];
+		}
+		float axis[3] = { 1.0f, 1.0f, 1.0f };
+		for (int iteration = 0; iteration < 8; ++iteration) {
+			float next[3] = {
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+			};
+			float length = std::max(std::abs(next[0]), std::max(std::abs(next[1]), std::abs(next[2])));
+			if (length <= 0.0f) {
+				break;
+			}
+			for (int c = 0; c < 3; ++c) {
+				axis[c] = next[c] / length;
+			}
+		}
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		for (int i = 0; i < 16; ++i) {
+			if (block.transparent[i]) {
+				continue;
+			}
+			float t = 0.0f;
+			for (int c = 0; c < 3; ++c) {
+				t += (block.texels[i][c] - mean[c]) * axis[c];
+			}
+			t /= axisLength;
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+		if (used == 0) {
+			minT = 0.0f;
+			maxT = 0.0f;
+		}
+		//Pulling the ends in a little lets the interpolated colours land nearer the middle of the block
+		float inset = (maxT - minT) / 16.0f;
+		float end0[3];
+		float end1[3];
+		for (int c = 0; c < 3; ++c) {
+			end0[c] = mean[c] + axis[c] * (maxT - inset);
+			end1[c] = mean[c] + axis[c] * (minT + inset);
+		}
+		ColourFit best = FitColours(block, To565(end0), To565(end1));
+
+		for (int iteration = 0; iteration < 2 && best.error > 0.0f; ++iteration) {
+			//The refined ends are in c0/c1 order, so this is only valid while they're distinct
+			if (best.c0 == best.c1 || !RefineEndpoints(block, best, end0, end1)) {
+				break;
+			}
+			ColourFit refined = FitColours(block, To565(end0), To565(end1));
+			if (refined.error >= best.error) {
+				break;
+			}
+			best = refined;
+		}
+
+		unsigned int indices = 0;
+		for (int i = 0; i < 16; ++i) {
+			indices |= (unsigned int)best.indices[i] << (i * 2);
+		}
+		out[0] = (unsigned char)(best.c0 & 0xFF);
+		out[1] = (unsigned char)(best.c0 >> 8);
+		out[2] = (unsigned char)(best.c1 & 0xFF);
+		out[3] = (unsigned char)(best.c1 >> 8);
+		for (int i = 0; i < 4; ++i) {
+			out[4 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	//a0 > a1, so always the eight value mode
+	void AlphaPalette(int a0, int a1, int palette[8]) {
+		palette[0] = a0;
+		palette[1] = a1;
+		for (int i = 1; i < 7; ++i) {
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+	}
+
+	//Used for BC3's alpha, and each of BC5's two channels
+	void EncodeAlphaBlock(const unsigned char* values, int stride, unsigned char* out) {
+		int minValue = 255;
+		int maxValue = 0;
+		for (int i = 0; i < 16; ++i) {
+			minValue = std::min(minValue, (int)values[i * stride]);
+			maxValue = std::max(maxValue, (int)values[i * stride]);
+		}
+		memset(out, 0, 8);
+		out[0] = (unsigned char)maxValue;
+		out[1] = (unsigned char)minValue;
+		if (maxValue == minValue) {
+			return;
+		}
+		int palette[8];
+		AlphaPalette(maxValue, minValue, palette);
+
+		unsigned long long indices = 0;
+		for (int i = 0; i < 16; ++i) {
+			int value	= values[i * stride];
+			int best	= 0;
+			for (int p = 1; p < 8; ++p) {
+				if (std::abs(palette[p] - value) < std::abs(palette[best] - value)) {
+					best = p;
+				}
+			}
+			indices |= (unsigned long long)best << (i * 3);
+		}
+		for (int i = 0; i < 6; ++i) {
+			out[2 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	void DecodeColourBlock(const unsigned char* in, bool alwaysFourColour, unsigned char* rgba) {
+		unsigned short	c0		= (unsigned short)(in[0] | (in[1] << 8));
+		unsigned short	c1		= (unsigned short)(in[2] | (in[3] << 8));
+		unsigned int	indices = in[4] | (in[5] << 8) | (in[6] << 16) | ((unsigned int)in[7] << 24);
+		bool fourColour = alwaysFourColour || c0 > c1;
+
+		float palette[4][3];
+		ColourPalette(c0, c1, fourColour, palette);
+		for (int i = 0; i < 16; ++i) {
+			int index = (indices >> (i * 2)) & 3;
+			for (int c = 0; c < 3; ++c) {
+				rgba[i * 4 + c] = (unsigned char)std::lround(palette[index][c]);
+			}
+			rgba[i * 4 + 3] = (!fourColour && index == 3) ? 0 : 255;
+		}
+	}
+
+	void DecodeAlphaBlock(const unsigned char* in, unsigned char* values, int stride) {
+		int palette[8];
+		int a0 = in[0];
+		int a1 = in[1];
+		if (a0 > a1) {
+			AlphaPalette(a0, a1, palette);
+		}
+		else { //the six value mode, which the encoder never makes but the format allows
+			palette[0] = a0;
+			palette[1] = a1;
+			for (int i = 1; i < 5; ++i) {
+				palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		unsigned long long indices = 0;
+		for (int i = 0; i < 6; ++i) {
+			indices |= (unsigned long long)in[2 + i] << (i * 8);
+		}
+		for (int i = 0; i < 16; ++i) {
+			values[i * stride] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	void EncodeLevel(const unsigned char* rgba, int width, int height, TextureFormat format, vector<char>& output) {
+		size_t start = output.size();
+		if (format == TextureFormat::RGBA8) {
+			output.insert(output.end(), (const char*)rgba, (const char*)rgba + (size_t)width * height * 4);
+			return;
+		}
+		int		blocksX		= (width  + 3) / 4;
+		int		blocksY		= (height + 3) / 4;
+		size_t	blockSize	= format == TextureFormat::BC1 ? 8 : 16;
+		output.resize(start + (size_t)blocksX * blocksY * blockSize);
+
+		ParallelFor(blocksY, 16, [&](size_t begin, size_t end) {
+			unsigned char block[64];
+			for (size_t by = begin; by < end; ++by) {
+				for (int bx = 0; bx < blocksX; ++bx) {
+					FetchBlock(rgba, width, height, bx, (int)by, block);
+					unsigned char* out = (unsigned char*)&output[start + (by * blocksX + bx) * blockSize];
+					switch (format) {
+						case TextureFormat::BC1: {
+							EncodeColourBlock(block, true, out);
+						}break;
+						case TextureFormat::BC3: {
+							EncodeAlphaBlock(block + 3, 4, out);
+							EncodeColourBlock(block, false, out + 8);
+						}break;
+						case TextureFormat::BC5: {
+							EncodeAlphaBlock(block + 0, 4, out);
+							EncodeAlphaBlock(block + 1, 4, out + 8);
+						}break;
+						default: break;
+					}
+				}
+			}
+		});
+	}
+}
+
+TextureFormat TextureCooker::ChooseFormat(const unsigned char* rgba, int width, int height, bool normalMap) {
+	if (normalMap) {
+		return TextureFormat::BC5;
+	}
+	for (size_t i = 0; i < (size_t)width * height; ++i) {
+		if (rgba[i * 4 + 3] < 255) {
+			return TextureFormat::BC3;
+		}
+	}
+	return TextureFormat::BC1;
+}
+
+TextureFormat TextureCooker::Cook(const unsigned char* rgba, int width, int height, const TextureCookOptions& options,
+	vector<char>& output, int& mipCount) {
+	TextureFormat format = options.chooseFormat ? ChooseFormat(rgba, width, height, options.normalMap) : options.format;
+
+	MipSpace space = options.normalMap ? MipSpace::Normal : (options.srgb ? MipSpace::Linear : MipSpace::Stored);
+
+	mipCount = 1;
+	while (options.generateMips && ((width >> mipCount) > 0 || (height >> mipCount) > 0)) {
+		mipCount++;
+	}
+	output.clear();
+	output.reserve(TextureLoader::GetDataSize(width, height, TextureLoader::MakeFlags(format, mipCount)));
+
+	vector<unsigned char> level;
+	FloatImage image;
+	if (mipCount > 1) {
+		image = ToFloat(rgba, width, height, space);
+	}
+	for (int i = 0; i < mipCount; ++i) {
+		if (i == 0) {
+			//normal maps still get renormalised, as BC5 drops z and the shader rebuilds it
+			if (options.normalMap) {
+				ToBytes(mipCount > 1 ? image : ToFloat(rgba, width, height, space), space, level);
+			}
+			else {
+				level.assign(rgba, rgba + (size_t)width * height * 4);
+			}
+		}
+		else {
+			image = Downsample(image, space);
+			ToBytes(image, space, level);
+		}
+		EncodeLevel(level.data(), std::max(width >> i, 1), std::max(height >> i, 1), format, output);
+	}
+	return format;
+}
+
+bool TextureCooker::SaveCooked(const std::string& filename, TextureFormat format, int width, int height, int mipCount, const vector<char>& data) {
+	if (data.size() != TextureLoader::GetDataSize(width, height, TextureLoader::MakeFlags(format, mipCount))) {
+		std::cout << __FUNCTION__ << " data doesn't match the texture's size and format!" << std::endl;
+		return false;
+	}
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cout << __FUNCTION__ << " can't open " << filename << " for writing!" << std::endl;
+		return false;
+	}
+	CookedTextureHeader header;
+	memcpy(header.id, CookedTextureID, sizeof(header.id));
+	header.version	= CookedTextureVersion;
+	header.format	= (unsigned int)format;
+	header.width	= (unsigned int)width;
+	header.height	= (unsigned int)height;
+	header.mipCount = (unsigned int)mipCount;
+
+	file.write((const char*)&header, sizeof(header));
+	file.write(data.data(), data.size());
+	return (bool)file;
+}
+
+bool TextureCooker::CookFile(const std::string& input, const std::string& output, const TextureCookOptions& options) {
+	char*	data		= nullptr;
+	int		width		= 0;
+	int		height		= 0;
+	int		channels	= 0;
+	int		flags		= 0;
+	if (!TextureLoader::LoadTexture(input, data, width, height, channels, flags)) {
+		std::cout << __FUNCTION__ << " can't load texture " << input << std::endl;
+		return false;
+	}
+	if (flags != TextureLoader::MakeFlags(TextureFormat::RGBA8, 1)) {
+		std::cout << __FUNCTION__ << " " << input << " has already been cooked!" << std::endl;
+		free(data);
+		return false;
+	}
+	vector<char>	cooked;
+	int				mipCount	= 1;
+	TextureFormat	format		= Cook((const unsigned char*)data, width, height, options, cooked, mipCount);
+	free(data);
+
+	return SaveCooked(Assets::TEXTUREDIR + output, format, width, height, mipCount, cooked);
+}
+
+//Nothing to decode, the levels are copied out just as they were written
+bool TextureCooker::LoadCooked(const std::string& filename, char*& outData, int& width, int &height, int &channels, int&flags) {
+	MappedFile file(filename);
+	if (!file.IsValid() || file.GetSize() < sizeof(CookedTextureHeader)) {
+		std::cout << __FUNCTION__ << " can't load cooked texture " << filename << std::endl;
+		return false;
+	}
+	CookedTextureHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+
+	if (memcmp(header.id, CookedTextureID, sizeof(header.id)) != 0 || header.version != CookedTextureVersion) {
+		std::cout << __FUNCTION__ << " " << filename << " is not a cooked texture, or is an old version!" << std::endl;
+		return false;
+	}
+	if (header.format > (unsigned int)TextureFormat::BC5 || header.mipCount == 0 || header.mipCount > MaxMipCount ||
+		header.width == 0 || header.height == 0) {
+		std::cout << __FUNCTION__ << " " << filename << " has an invalid header!" << std::endl;
+		return false;
+	}
+	TextureFormat	format		= (TextureFormat)header.format;
+	int				newFlags	= TextureLoader::MakeFlags(format, header.mipCount);
+	size_t			dataSize	= TextureLoader::GetDataSize(header.width, header.height, newFlags);
+
+	if (file.GetSize() - sizeof(header) < dataSize) {
+		std::cout << __FUNCTION__ << " " << filename << " is truncated!" << std::endl;
+		return false;
+	}
+	outData = (char*)malloc(dataSize);
+	memcpy(outData, file.GetData() + sizeof(header), dataSize);
+
+	width		= (int)header.width;
+	height		= (int)header.height;
+	channels	= format == TextureFormat::BC5 ? 2 : 4;
+	flags		= newFlags;
+	return true;
+}
+
+void TextureCooker::RegisterLoadFunction() {
+	TextureLoader::RegisterTextureLoadFunction(LoadCooked, ".tex");
+}
+
+void TextureCooker::DecodeLevel(const char* data, TextureFormat format, int width, int height, vector<unsigned char>& rgba) {
+	rgba.resize((size_t)width * height * 4);
+	if (format == TextureFormat::RGBA8) {
+		memcpy(rgba.data(), data, rgba.size());
+		return;
+	}
+	int		blocksX		= (width + 3) / 4;
+	int		blocksY		= (height + 3) / 4;
+	size_t	blockSize	= format == TextureFormat::BC1 ? 8 : 16;
+
+	for (int by = 0; by < blocksY; ++by) {
+		for (int bx = 0; bx < blocksX; ++bx) {
+			const unsigned char* in = (const unsigned char*)data + ((size_t)by * blocksX + bx) * blockSize;
+			unsigned char block[64];
+			switch (format) {
+				case TextureFormat::BC1: {
+					DecodeColourBlock(in, false, block);
+				}break;
+				case TextureFormat::BC3: {
+					DecodeColourBlock(in + 8, true, block);
+					DecodeAlphaBlock(in, block + 3, 4);
+				}break;
+				default: { //BC5 samples as red and green, with no blue and opaque alpha
+					DecodeAlphaBlock(in,		block + 0, 4);
+					DecodeAlphaBlock(in + 8,	block + 1, 4);
+					for (int i = 0; i < 16; ++i) {
+						block[i * 4 + 2] = 0;
+						block[i * 4 + 3] = 255;
+					}
+				}break;
+			}
+			for (int y = 0; y < 4 && by * 4 + y < height; ++y) {
+				for (int x = 0; x < 4 && bx * 4 + x < width; ++x) {
+					memcpy(&rgba[(((size_t)by * 4 + y) * width + bx * 4 + x) * 4], block + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+}
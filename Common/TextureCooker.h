@@ -0,0 +1,56 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "TextureLoader.h"
+#include <string>
+#include <vector>
+
+namespace NCL {
+	struct TextureCookOptions {
+		TextureFormat	format			= TextureFormat::BC1;
+		bool			chooseFormat	= true;	//ignore format, and pick BC5, BC3 or BC1 from the image
+		bool			generateMips	= true;
+		bool			srgb			= true;	//average mip texels in linear light, rather than as stored
+		bool			normalMap		= false;//renormalise mip texels, and store just x and y
+	};
+
+	/*
+	Offline half of the texture pipeline. Images are loaded once, given a
+	full mip chain and block compressed on the CPU, then written out as a
+	.tex file: a small header followed by every mip level, ready to go
+	straight to the GPU. Loading a .tex at runtime is just a copy, with no
+	decoding at all.
+
+	The encoders fit each block's endpoints along its principal colour axis,
+	then refine them with a least squares pass over the chosen indices -
+	not as good as an exhaustive search, but fast enough for a whole game's
+	textures in a couple of seconds.
+	*/
+	class TextureCooker	{
+	public:
+		//Both filenames are relative to Assets::TEXTUREDIR
+		static bool CookFile(const std::string& input, const std::string& output, const TextureCookOptions& options = TextureCookOptions());
+
+		//rgba holds 4 bytes per texel - output gets every mip level, in the returned format
+		static TextureFormat Cook(const unsigned char* rgba, int width, int height, const TextureCookOptions& options,
+			std::vector<char>& output, int& mipCount);
+
+		static TextureFormat ChooseFormat(const unsigned char* rgba, int width, int height, bool normalMap);
+
+		static bool SaveCooked(const std::string& filename, TextureFormat format, int width, int height, int mipCount, const std::vector<char>& data);
+
+		//A TextureLoadFunction for .tex files
+		static bool LoadCooked(const std::string& filename, char*& outData, int& width, int &height, int &channels, int&flags);
+
+		static void RegisterLoadFunction();
+
+		//Expands one level back out to RGBA8, the same way the GPU would sample it
+		static void DecodeLevel(const char* data, TextureFormat format, int width, int height, std::vector<unsigned char>& rgba);
+	};
+}
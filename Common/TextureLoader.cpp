@@ -14,10 +14,7 @@ https://research.ncl.ac.uk/game/
 
 #include "Assets.h"
 
-#ifdef WIN32
-#include <filesystem>
-using namespace std::experimental::filesystem::v1;
-#endif
+#include <algorithm>
 
 using namespace NCL;
 using namespace Rendering;
@@ -43,7 +40,9 @@ bool TextureLoader::LoadTexture(const std::string& filename, char*& outData, int
 	stbi_uc *texData = stbi_load(realPath.c_str(), &width, &height, &channels, 4); //4 forces this to always be rgba!
 
 	if (texData) {
-		outData = (char*)texData;
+		outData		= (char*)texData;
+		channels	= 4; //stb reports the file's channel count, not what it gave back
+		flags		= MakeFlags(TextureFormat::RGBA8, 1);
 		return true;
 	}
 
@@ -54,16 +53,15 @@ void TextureLoader::RegisterTextureLoadFunction(TextureLoadFunction f, const std
 	fileHandlers.insert(std::make_pair(fileExtension, f));
 }
 
+//Includes the dot, as the handlers are registered with it
 std::string TextureLoader::GetFileExtension(const std::string& fileExtension) {
-#ifdef WIN32
-	path p = path(fileExtension);
+	size_t nameStart	= fileExtension.find_last_of("/\\");
+	size_t dot			= fileExtension.find_last_of('.');
 
-	path ext = p.extension();
-
-	return ext.string();
-#else
-	return std::string();
-#endif
+	if (dot == std::string::npos || (nameStart != std::string::npos && dot < nameStart)) {
+		return std::string();
+	}
+	return fileExtension.substr(dot);
 }
 
 void TextureLoader::RegisterAPILoadFunction(APILoadFunction f) {
@@ -79,4 +77,35 @@ TextureBase* TextureLoader::LoadAPITexture(const std::string&filename) {
 		return nullptr;
 	}
 	return apiFunction(filename);
+}
+
+int TextureLoader::MakeFlags(TextureFormat format, int mipCount) {
+	return (int)format | ((std::max(mipCount, 1) - 1) << 8);
+}
+
+TextureFormat TextureLoader::GetFormat(int flags) {
+	return (TextureFormat)(flags & 0xFF);
+}
+
+int TextureLoader::GetMipCount(int flags) {
+	return ((flags >> 8) & 0xFF) + 1;
+}
+
+size_t TextureLoader::GetMipSize(TextureFormat format, int width, int height, int level) {
+	size_t levelWidth	= std::max(width  >> level, 1);
+	size_t levelHeight	= std::max(height >> level, 1);
+
+	if (format == TextureFormat::RGBA8) {
+		return levelWidth * levelHeight * 4;
+	}
+	size_t blocks = ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4);
+	return blocks * (format == TextureFormat::BC1 ? 8 : 16);
+}
+
+size_t TextureLoader::GetDataSize(int width, int height, int flags) {
+	size_t size = 0;
+	for (int i = 0; i < GetMipCount(flags); ++i) {
+		size += GetMipSize(GetFormat(flags), width, height, i);
+	}
+	return size;
 }
\ No newline at end of file
@@ -15,6 +15,17 @@ using std::map;
 #include "TextureBase.h"
 
 namespace NCL {
+	/*
+	How the data from a TextureLoadFunction is laid out. Block compressed
+	formats store each 4x4 group of texels together, and any mip levels
+	follow straight on from the level before, largest first.
+	*/
+	enum class TextureFormat {
+		RGBA8,	//4 bytes per texel
+		BC1,	//RGB, 8 bytes per block
+		BC3,	//RGBA, 16 bytes per block
+		BC5		//two channels, 16 bytes per block - for normal maps
+	};
 
 	typedef std::function<bool(const std::string& filename, char*& outData, int& width, int &height, int &channels, int&flags)> TextureLoadFunction;
 
@@ -29,6 +40,15 @@ namespace NCL {
 		static void RegisterAPILoadFunction(APILoadFunction f);
 
 		static Rendering::TextureBase* LoadAPITexture(const std::string&filename);
+
+		//Load functions describe their data through the flags - plain decoded
+		//images leave them at 0, meaning a single level of RGBA8
+		static int				MakeFlags(TextureFormat format, int mipCount);
+		static TextureFormat	GetFormat(int flags);
+		static int				GetMipCount(int flags);
+
+		static size_t GetMipSize(TextureFormat format, int width, int height, int level);
+		static size_t GetDataSize(int width, int height, int flags);
 	protected:
 
 		static std::string GetFileExtension(const std::string& fileExtension);
@@ -11,8 +11,575 @@ https://research.ncl.ac.uk/game/
 
 #include "./stb/stb_image_write.h"
 #include "Assets.h"
+#include "ParallelFor.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
 using namespace NCL;
+using std::vector;
+
+namespace {
+	//Roughly how much of the image goes in each independently compressed strip
+	const size_t StripBytes		= 256 * 1024;
+	const size_t WindowSize		= 32768;
+	const size_t MaxMatch		= 258;
+	const int	 HashBits		= 15;
+
+	const unsigned int AdlerBase = 65521;
+
+	const unsigned short LengthBase[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const unsigned char LengthExtra[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const unsigned short DistanceBase[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+		1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	const unsigned char DistanceExtra[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	//Slice by 8 tables - table[0] is the usual byte at a time one
+	const unsigned int* CRCTables() {
+		static const vector<unsigned int> tables = [] {
+			vector<unsigned int> t(256 * 8);
+			for (unsigned int i = 0; i < 256; ++i) {
+				unsigned int c = i;
+				for (int k = 0; k < 8; ++k) {
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				t[i] = c;
+			}
+			for (unsigned int i = 0; i < 256; ++i) {
+				for (int slice = 1; slice < 8; ++slice) {
+					unsigned int previous = t[(slice - 1) * 256 + i];
+					t[slice * 256 + i] = (previous >> 8) ^ t[previous & 0xFF];
+				}
+			}
+			return t;
+		}();
+		return tables.data();
+	}
+
+	unsigned int UpdateCRC(unsigned int crc, const unsigned char* data, size_t length) {
+		const unsigned int* t = CRCTables();
+		crc = ~crc;
+		while (length >= 8) {
+			unsigned int low	= crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24));
+			unsigned int high	= data[4] | (data[5] << 8) | (data[6] << 16) | ((unsigned int)data[7] << 24);
+			crc =	t[7 * 256 + (low & 0xFF)]	^ t[6 * 256 + ((low >> 8) & 0xFF)] ^
+					t[5 * 256 + ((low >> 16) & 0xFF)] ^ t[4 * 256 + (low >> 24)] ^
+					t[3 * 256 + (high & 0xFF)]	^ t[2 * 256 + ((high >> 8) & 0xFF)] ^
+					t[1 * 256 + ((high >> 16) & 0xFF)] ^ t[high >> 24];
+			data	+= 8;
+			length	-= 8;
+		}
+		for (size_t i = 0; i < length; ++i) {
+			crc = t[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	unsigned int Adler32(const unsigned char* data, size_t length) {
+		unsigned int a = 1;
+		unsigned int b = 0;
+		while (length > 0) {
+			size_t block = std::min(length, (size_t)5552); //the most that can be summed before overflowing
+			for (size_t i = 0; i < block; ++i) {
+				a += data[i];
+				b += a;
+			}
+			a %= AdlerBase;
+			b %= AdlerBase;
+			data	+= block;
+			length	-= block;
+		}
+		return (b << 16) | a;
+	}
+
+	//The Adler-32 of two buffers one after the other, from each one's own checksum
+	unsigned int CombineAdler32(unsigned int first, unsigned int second, size_t secondLength) {
+		unsigned int remainder	= (unsigned int)(secondLength % AdlerBase);
+		unsigned int a			= first & 0xFFFF;
+		unsigned int b			= (unsigned int)(((unsigned long long)remainder * a) % AdlerBase);
+		a += (second & 0xFFFF) + AdlerBase - 1;
+		b += (first >> 16) + (second >> 16) + AdlerBase - remainder;
+		a %= AdlerBase;
+		b %= AdlerBase;
+		return (b << 16) | a;
+	}
+
+	class BitWriter {
+	public:
+		BitWriter(vector<unsigned char>& output) : output(output), bits(0), count(0) {}
+
+		void Write(unsigned int value, int length) {
+			bits	|= value << count;
+			count	+= length;
+			while (count >= 8) {
+				output.push_back((unsigned char)(bits & 0xFF));
+				bits	>>= 8;
+				count	-= 8;
+			}
+		}
+
+		void Align() {
+			if (count > 0) {
+				output.push_back((unsigned char)(bits & 0xFF));
+			}
+			bits	= 0;
+			count	= 0;
+		}
+
+	protected:
+		vector<unsigned char>&	output;
+		unsigned int			bits;
+		int						count;
+	};
+
+	struct FixedCode {
+		unsigned short	bits;	//already reversed, ready for the LSB first bit stream
+		unsigned char	length;
+	};
+
+	unsigned short ReverseBits(unsigned int code, int length) {
+		unsigned int reversed = 0;
+		for (int i = 0; i < length; ++i) {
+			reversed |= ((code >> i) & 1) << (length - 1 - i);
+		}
+		return (unsigned short)reversed;
+	}
+
+	//The fixed Huffman code from the deflate spec, for all 288 literal/length symbols
+	const FixedCode* FixedLiteralCodes() {
+		static const vector<FixedCode> codes = [] {
+			vector<FixedCode> c(288);
+			for (int i = 0; i < 288; ++i) {
+				unsigned int code;
+				int length;
+				if		(i < 144)	{ code = 0x30 + i;			length = 8; }
+				else if (i < 256)	{ code = 0x190 + i - 144;	length = 9; }
+				else if (i < 280)	{ code = i - 256;			length = 7; }
+				else				{ code = 0xC0 + i - 280;	length = 8; }
+				c[i].bits	= ReverseBits(code, length);
+				c[i].length = (unsigned char)length;
+			}
+			return c;
+		}();
+		return codes.data();
+	}
+
+	void WriteLiteral(BitWriter& writer, const FixedCode* codes, int literal) {
+		writer.Write(codes[literal].bits, codes[literal].length);
+	}
+
+	void WriteMatch(BitWriter& writer, const FixedCode* codes, size_t length, size_t distance) {
+		int lengthCode = 28;
+		while (LengthBase[lengthCode] > length) {
+			lengthCode--;
+		}
+		WriteLiteral(writer, codes, 257 + lengthCode);
+		writer.Write((unsigned int)(length - LengthBase[lengthCode]), LengthExtra[lengthCode]);
+
+		int distanceCode = 29;
+		while (DistanceBase[distanceCode] > distance) {
+			distanceCode--;
+		}
+		writer.Write(ReverseBits(distanceCode, 5), 5);
+		writer.Write((unsigned int)(distance - DistanceBase[distanceCode]), DistanceExtra[distanceCode]);
+	}
+
+	unsigned int Hash4(const unsigned char* p) {
+		unsigned int v;
+		memcpy(&v, p, sizeof(v));
+		return (v * 2654435761u) >> (32 - HashBits);
+	}
+
+	/*
+	One non-final fixed Huffman block, then an empty stored block to byte
+	align the end (a sync flush), so strips can simply be joined together
+	*/
+	void DeflateStrip(const unsigned char* data, size_t size, vector<unsigned char>& output) {
+		const FixedCode* codes = FixedLiteralCodes();
+		output.reserve(output.size() + size / 2);
+
+		BitWriter writer(output);
+		writer.Write(0, 1); //not the final block
+		writer.Write(1, 2); //fixed Huffman codes
+
+		vector<int> head((size_t)1 << HashBits, -1);
+		size_t i = 0;
+		while (i < size) {
+			size_t bestLength = 0;
+			if (i + 4 <= size) {
+				unsigned int hash		= Hash4(data + i);
+				int			 candidate	= head[hash];
+				head[hash] = (int)i;
+
+				if (candidate >= 0 && i - candidate <= WindowSize && memcmp(data + candidate, data + i, 4) == 0) {
+					size_t maxLength = std::min(MaxMatch, size - i);
+					bestLength = 4;
+					while (bestLength < maxLength && data[candidate + bestLength] == data[i + bestLength]) {
+						bestLength++;
+					}
+					WriteMatch(writer, codes, bestLength, i - candidate);
+					//Only the start of a match is hashed, trading a little ratio for speed
+					i += bestLength;
+					continue;
+				}
+			}
+			WriteLiteral(writer, codes, data[i]);
+			i++;
+		}
+		WriteLiteral(writer, codes, 256); //end of block
+
+		writer.Write(0, 3);
+		writer.Align();
+		const unsigned char flush[4] = { 0x00, 0x00, 0xFF, 0xFF };
+		output.insert(output.end(), flush, flush + 4);
+	}
+
+	void StoreStrip(const unsigned char* data, size_t size, vector<unsigned char>& output) {
+		while (size > 0) {
+			size_t block = std::min(size, (size_t)65535);
+			unsigned char header[5] = {
+				0x00, //not final, stored - the rest of the byte is padding
+				(unsigned char)(block & 0xFF), (unsigned char)(block >> 8),
+				(unsigned char)(~block & 0xFF), (unsigned char)((~block >> 8) & 0xFF)
+			};
+			output.insert(output.end(), header, header + 5);
+			output.insert(output.end(), data, data + block);
+			data += block;
+			size -= block;
+		}
+	}
+
+	//p - a, p - b and p - c, with p = a + b - c expanded out
+	inline unsigned char Paeth(int a, int b, int c) {
+		int pa = std::abs(b - c);
+		int pb = std::abs(a - c);
+		int pc = std::abs(a + b - 2 * c);
+		int bc = pb <= pc ? b : c;
+		return (unsigned char)((pa <= pb && pa <= pc) ? a : bc);
+	}
+
+	void FilterRow(const unsigned char* row, const unsigned char* above, size_t rowBytes, int bpp, int filter, unsigned char* out) {
+		size_t first = std::min((size_t)bpp, rowBytes);
+		if (!above) { //a decoder treats the row above the first as zeroes, making Up None and Paeth Sub
+			filter = filter == 2 ? 0 : (filter == 4 ? 1 : filter);
+		}
+		switch (filter) {
+			case 0: {
+				memcpy(out, row, rowBytes);
+			}break;
+			case 1: {
+				memcpy(out, row, first);
+				for (size_t x = first; x < rowBytes; ++x) {
+					out[x] = (unsigned char)(row[x] - row[x - bpp]);
+				}
+			}break;
+			case 2: {
+				for (size_t x = 0; x < rowBytes; ++x) {
+					out[x] = (unsigned char)(row[x] - above[x]);
+				}
+			}break;
+			case 3: {
+				for (size_t x = 0; x < first; ++x) {
+					out[x] = (unsigned char)(row[x] - ((above ? above[x] : 0) >> 1));
+				}
+				for (size_t x = first; x < rowBytes; ++x) {
+					out[x] = (unsigned char)(row[x] - ((row[x - bpp] + (above ? above[x] : 0)) >> 1));
+				}
+			}break;
+			case 4: {
+				for (size_t x = 0; x < first; ++x) {
+					out[x] = (unsigned char)(row[x] - above[x]);
+				}
+				for (size_t x = first; x < rowBytes; ++x) {
+					out[x] = (unsigned char)(row[x] - Paeth(row[x - bpp], above[x], above[x - bpp]));
+				}
+			}break;
+		}
+	}
+
+	/*
+	Picks whichever filter leaves the smallest values, the usual PNG
+	heuristic. None and Average almost never win on rendered frames, so
+	only Sub, Up and Paeth are tried
+	*/
+	void FilterRowAdaptive(const unsigned char* row, const unsigned char* above, size_t rowBytes, int bpp, unsigned char* out, vector<unsigned char>& scratch) {
+		static const int filters[3] = { 1, 2, 4 };
+		scratch.resize(rowBytes);
+		unsigned long long bestSum = ~0ULL;
+		for (int filter : filters) {
+			FilterRow(row, above, rowBytes, bpp, filter, scratch.data());
+			unsigned long long sum = 0;
+			for (size_t x = 0; x < rowBytes; ++x) {
+				sum += std::abs((int)(signed char)scratch[x]);
+			}
+			if (sum < bestSum) {
+				bestSum = sum;
+				out[-1] = (unsigned char)filter;
+				memcpy(out, scratch.data(), rowBytes);
+			}
+		}
+	}
+
+	void AppendChunk(vector<char>& output, const char* type, const unsigned char* data, size_t length) {
+		unsigned char lengthBytes[4] = {
+			(unsigned char)(length >> 24), (unsigned char)(length >> 16), (unsigned char)(length >> 8), (unsigned char)length
+		};
+		output.insert(output.end(), (const char*)lengthBytes, (const char*)lengthBytes + 4);
+		output.insert(output.end(), type, type + 4);
+		output.insert(output.end(), (const char*)data, (const char*)data + length);
+
+		unsigned int crc = UpdateCRC(0, (const unsigned char*)type, 4);
+		crc = UpdateCRC(crc, data, length);
+		unsigned char crcBytes[4] = {
+			(unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc
+		};
+		output.insert(output.end(), (const char*)crcBytes, (const char*)crcBytes + 4);
+	}
+
+	void WriteBigEndian(unsigned char* out, unsigned int value) {
+		out[0] = (unsigned char)(value >> 24);
+		out[1] = (unsigned char)(value >> 16);
+		out[2] = (unsigned char)(value >> 8);
+		out[3] = (unsigned char)value;
+	}
+}
 
 void TextureWriter::WritePNG(const std::string& filename, char* data, int width, int height, int channels) {
 	stbi_write_png(filename.c_str(), width, height, channels, data, width * channels);
 }
+
+bool TextureWriter::WritePNG(const std::string& filename, const char* data, int width, int height, int channels,
+	PNGCompression compression, bool flipVertically) {
+	vector<char> png;
+	EncodePNG(data, width, height, channels, compression, png, flipVertically);
+	if (png.empty()) {
+		return false;
+	}
+	std::ofstream file(filename, std::ios::binary);
+	file.write(png.data(), png.size());
+	if (!file) {
+		std::cout << __FUNCTION__ << " can't write " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void TextureWriter::EncodePNG(const char* data, int width, int height, int channels, PNGCompression compression,
+	vector<char>& output, bool flipVertically) {
+	output.clear();
+	if (!data || width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+		std::cout << __FUNCTION__ << " can't encode a " << width << "x" << height << "x" << channels << " image" << std::endl;
+		return;
+	}
+	const size_t		rowBytes	= (size_t)width * channels;
+	const unsigned char* pixels		= (const unsigned char*)data;
+
+	if (compression == PNGCompression::Default) {
+		//A negative stride from the last row flips without touching stb's global flip flag
+		const unsigned char* start	= flipVertically ? pixels + rowBytes * (height - 1) : pixels;
+		int					 stride = flipVertically ? -(int)rowBytes : (int)rowBytes;
+		int length = 0;
+		unsigned char* png = stbi_write_png_to_mem((unsigned char*)start, stride, width, height, channels, &length);
+		if (png) {
+			output.assign((char*)png, (char*)png + length);
+			STBIW_FREE(png);
+		}
+		return;
+	}
+	auto sourceRow = [&](size_t y) -> const unsigned char* {
+		return pixels + rowBytes * (flipVertically ? height - 1 - y : y);
+	};
+	const size_t rowsPerStrip	= std::max((size_t)1, StripBytes / rowBytes);
+	const size_t stripCount		= (height + rowsPerStrip - 1) / rowsPerStrip;
+
+	vector<vector<unsigned char>>	strips(stripCount);
+	vector<unsigned int>			stripAdler(stripCount);
+	vector<size_t>					stripLength(stripCount);
+
+	ParallelFor(stripCount, 1, [&](size_t begin, size_t end) {
+		vector<unsigned char> filtered;
+		vector<unsigned char> scratch;
+		for (size_t s = begin; s < end; ++s) {
+			size_t firstRow = s * rowsPerStrip;
+			size_t lastRow	= std::min((size_t)height, firstRow + rowsPerStrip);
+
+			filtered.resize((lastRow - firstRow) * (rowBytes + 1));
+			for (size_t y = firstRow; y < lastRow; ++y) {
+				unsigned char* out = &filtered[(y - firstRow) * (rowBytes + 1)];
+				const unsigned char* above = y > 0 ? sourceRow(y - 1) : nullptr;
+				if (compression == PNGCompression::Stored) {
+					out[0] = 0;
+					memcpy(out + 1, sourceRow(y), rowBytes);
+				}
+				else {
+					FilterRowAdaptive(sourceRow(y), above, rowBytes, channels, out + 1, scratch);
+				}
+			}
+			stripAdler[s]	= Adler32(filtered.data(), filtered.size());
+			stripLength[s]	= filtered.size();
+
+			if (compression == PNGCompression::Stored) {
+				StoreStrip(filtered.data(), filtered.size(), strips[s]);
+			}
+			else {
+				DeflateStrip(filtered.data(), filtered.size(), strips[s]);
+			}
+		}
+	});
+
+	vector<unsigned char> zlib = { 0x78, 0x01 };
+	unsigned int adler = 1;
+	for (size_t s = 0; s < stripCount; ++s) {
+		zlib.insert(zlib.end(), strips[s].begin(), strips[s].end());
+		adler = CombineAdler32(adler, stripAdler[s], stripLength[s]);
+	}
+	const unsigned char finalBlock[5] = { 0x01, 0x00, 0x00, 0xFF, 0xFF }; //empty, final, stored
+	zlib.insert(zlib.end(), finalBlock, finalBlock + 5);
+	unsigned char adlerBytes[4];
+	WriteBigEndian(adlerBytes, adler);
+	zlib.insert(zlib.end(), adlerBytes, adlerBytes + 4);
+
+	static const unsigned char colourTypes[5] = { 0, 0, 4, 2, 6 };
+	unsigned char header[13];
+	WriteBigEndian(header,		(unsigned int)width);
+	WriteBigEndian(header + 4,	(unsigned int)height);
+	header[8]	= 8;	//bits per channel
+	header[9]	= colourTypes[channels];
+	header[10]	= 0;	//deflate
+	header[11]	= 0;	//adaptive filtering
+	header[12]	= 0;	//not interlaced
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	output.reserve(zlib.size() + 64);
+	output.insert(output.end(), (const char*)signature, (const char*)signature + 8);
+	AppendChunk(output, "IHDR", header, sizeof(header));
+	AppendChunk(output, "IDAT", zlib.data(), zlib.size());
+	AppendChunk(output, "IEND", nullptr, 0);
+}
+
+CaptureWriter::CaptureWriter(PNGCompression compression, int numWorkers, size_t maxQueuedFrames) {
+	this->compression		= compression;
+	this->maxQueuedFrames	= std::max((size_t)1, maxQueuedFrames);
+	framesInFlight	= 0;
+	framesWritten	= 0;
+	framesDropped	= 0;
+	dropWhenFull	= false;
+	shuttingDown	= false;
+
+	for (int i = 0; i < std::max(1, numWorkers); ++i) {
+		workers.emplace_back(&CaptureWriter::WorkerThread, this);
+	}
+}
+
+CaptureWriter::~CaptureWriter() {
+	WaitForAll();
+	{
+		std::lock_guard<std::mutex> lock(frameLock);
+		shuttingDown = true;
+	}
+	frameReady.notify_all();
+	for (std::thread& t : workers) {
+		t.join();
+	}
+}
+
+bool CaptureWriter::Submit(const std::string& filename, const char* data, int width, int height, int channels, bool flipVertically) {
+	size_t size = (size_t)width * height * channels;
+	Frame frame;
+	{
+		std::unique_lock<std::mutex> lock(frameLock);
+		if (framesInFlight >= maxQueuedFrames) {
+			if (dropWhenFull) {
+				framesDropped++;
+				return false;
+			}
+			frameDone.wait(lock, [&] { return framesInFlight < maxQueuedFrames; });
+		}
+		framesInFlight++;
+		if (!spareBuffers.empty()) {
+			frame.data = std::move(spareBuffers.back());
+			spareBuffers.pop_back();
+		}
+	}
+	//The copy happens outside the lock, so workers can carry on meanwhile
+	frame.data.assign(data, data + size);
+	frame.filename			= filename;
+	frame.width				= width;
+	frame.height			= height;
+	frame.channels			= channels;
+	frame.flipVertically	= flipVertically;
+	{
+		std::lock_guard<std::mutex> lock(frameLock);
+		frames.emplace_back(std::move(frame));
+	}
+	frameReady.notify_one();
+	return true;
+}
+
+void CaptureWriter::WorkerThread() {
+	vector<char> png;
+	while (true) {
+		Frame			frame;
+		PNGCompression	frameCompression;
+		{
+			std::unique_lock<std::mutex> lock(frameLock);
+			frameReady.wait(lock, [&] { return shuttingDown || !frames.empty(); });
+			if (frames.empty()) {
+				return;
+			}
+			frame = std::move(frames.front());
+			frames.pop_front();
+			frameCompression = compression;
+		}
+		TextureWriter::EncodePNG(frame.data.data(), frame.width, frame.height, frame.channels, frameCompression, png, frame.flipVertically);
+
+		std::ofstream file(frame.filename, std::ios::binary);
+		file.write(png.data(), png.size());
+		if (!file) {
+			std::cout << __FUNCTION__ << " can't write " << frame.filename << std::endl;
+		}
+		{
+			std::lock_guard<std::mutex> lock(frameLock);
+			framesInFlight--;
+			framesWritten++;
+			spareBuffers.emplace_back(std::move(frame.data));
+		}
+		frameDone.notify_all();
+	}
+}
+
+void CaptureWriter::WaitForAll() {
+	std::unique_lock<std::mutex> lock(frameLock);
+	frameDone.wait(lock, [&] { return framesInFlight == 0; });
+}
+
+void CaptureWriter::SetCompression(PNGCompression c) {
+	std::lock_guard<std::mutex> lock(frameLock);
+	compression = c;
+}
+
+void CaptureWriter::SetDropWhenFull(bool drop) {
+	std::lock_guard<std::mutex> lock(frameLock);
+	dropWhenFull = drop;
+}
+
+size_t CaptureWriter::GetFramesWritten() const {
+	std::lock_guard<std::mutex> lock(frameLock);
+	return framesWritten;
+}
+
+size_t CaptureWriter::GetFramesDropped() const {
+	std::lock_guard<std::mutex> lock(frameLock);
+	return framesDropped;
+}
@@ -8,12 +8,86 @@ https://research.ncl.ac.uk/game/
 */
 #pragma once
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace NCL {
+	enum class PNGCompression {
+		Stored,	//no compression at all - large files, but almost no encoding time
+		Fast,	//fixed Huffman codes and a single probe match finder
+		Default	//stb_image_write's encoder - smallest files, but slowest by far
+	};
+
 	class TextureWriter
 	{
 	public:
 		static void WritePNG(const std::string& filename, char* data, int width, int height, int channels);
+
+		static bool WritePNG(const std::string& filename, const char* data, int width, int height, int channels,
+			PNGCompression compression, bool flipVertically = false);
+
+		/*
+		Stored and Fast split the image into strips of rows that are filtered
+		and compressed independently, so they can be spread over every core,
+		then joined into a single zlib stream. flipVertically is for data read
+		back from a framebuffer, which starts at the bottom row.
+		*/
+		static void EncodePNG(const char* data, int width, int height, int channels, PNGCompression compression,
+			std::vector<char>& output, bool flipVertically = false);
 	};
-}
 
+	/*
+	Writes PNGs on a background thread, so that capturing frames doesn't hold
+	up the game. Submit copies the frame into a recycled buffer and returns
+	straight away - unless maxQueuedFrames are already waiting, in which case
+	it either waits for space or drops the frame, depending on SetDropWhenFull.
+	Each frame's strips are encoded in parallel, so one worker is normally
+	enough; more workers help if frames are small.
+	*/
+	class CaptureWriter	{
+	public:
+		CaptureWriter(PNGCompression compression = PNGCompression::Fast, int numWorkers = 1, size_t maxQueuedFrames = 8);
+		~CaptureWriter(); //finishes writing everything already submitted
+
+		bool Submit(const std::string& filename, const char* data, int width, int height, int channels, bool flipVertically = false);
+
+		void WaitForAll();
+
+		void SetCompression(PNGCompression c);
+		void SetDropWhenFull(bool drop);
+
+		size_t GetFramesWritten() const;
+		size_t GetFramesDropped() const;
+
+	protected:
+		struct Frame {
+			std::string			filename;
+			std::vector<char>	data;
+			int					width;
+			int					height;
+			int					channels;
+			bool				flipVertically;
+		};
+
+		void WorkerThread();
+
+		std::vector<std::thread>		workers;
+		std::deque<Frame>				frames;
+		std::vector<std::vector<char>>	spareBuffers;
+
+		PNGCompression	compression;
+		size_t			maxQueuedFrames;
+		size_t			framesInFlight;
+		size_t			framesWritten;
+		size_t			framesDropped;
+		bool			dropWhenFull;
+		bool			shuttingDown;
+
+		mutable std::mutex		frameLock;
+		std::condition_variable frameReady;
+		std::condition_variable frameDone;
+	};
+}
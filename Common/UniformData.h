@@ -0,0 +1,79 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "Matrix4.h"
+#include "Vector4.h"
+#include "ShadowCascades.h"
+
+#include <vector>
+#include <cstring>
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		The CPU side of the GameTech shaders' uniform blocks. They're only
+		made of mat4s, vec4s and groups of 4 ints, which std140 lays out with
+		no padding, so these match the GLSL blocks member for member - keep
+		them that way, or the layouts will drift apart.
+		*/
+		enum UniformBlockBinding {
+			FrameBlockBinding,
+			DrawBlockBinding,
+			MaxBlockBindings
+		};
+
+		//What each block is called in GLSL - shaders have them bound to the points above when linked
+		inline const char* UniformBlockName(int binding) {
+			static const char* names[MaxBlockBindings] = { "FrameData", "DrawData" };
+			return names[binding];
+		}
+
+		//Set once per frame
+		struct FrameUniforms {
+			Maths::Matrix4	viewMatrix;
+			Maths::Matrix4	projMatrix;
+			Maths::Matrix4	shadowMatrices[ShadowCascades::MaxCascades];	//world space to each cascade's texture space
+			Maths::Matrix4	lightViewProj[ShadowCascades::MaxCascades];
+			Maths::Vector4	cameraPos;
+			Maths::Vector4	lightPos;		//w is the light's radius
+			Maths::Vector4	lightColour;
+			Maths::Vector4	cascadeSplits;	//how far from the camera each cascade reaches
+			int				cascadeCount;
+			int				padding[3];
+		};
+
+		//Set for every draw, or once for a batch of instances
+		struct DrawUniforms {
+			Maths::Matrix4	modelMatrix;	//ignored when instancing
+			Maths::Vector4	objectColour;	//ignored when instancing
+			int				hasVertexColours;
+			int				hasTexture;
+			int				useInstancing;
+			int				shadowCascade;	//which cascade a shadow pass is drawing
+		};
+
+		static_assert(sizeof(FrameUniforms) == (2 + 2 * ShadowCascades::MaxCascades) * 64 + 5 * 16, "FrameUniforms doesn't match its std140 layout");
+		static_assert(sizeof(DrawUniforms) == 64 + 16 + 16, "DrawUniforms doesn't match its std140 layout");
+
+		/*
+		Lays blocks out one after another, each starting on a multiple of
+		stride - a buffer range can then be bound at any one of them. stride
+		must be at least sizeof(T), and a multiple of the API's offset
+		alignment.
+		*/
+		template<typename T>
+		void PackUniformArray(const T* blocks, size_t count, size_t stride, std::vector<char>& output) {
+			output.resize(count * stride);
+			char* dest = output.data();
+			for (size_t i = 0; i < count; ++i) {
+				memcpy(dest + i * stride, &blocks[i], sizeof(T));
+			}
+		}
+	}
+}
@@ -0,0 +1,296 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "VertexLayout.h"
+#include "Vector2.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace NCL;
+using namespace Maths;
+
+namespace {
+	//Past this, halves can't step finely enough between texels
+	const float MaxHalfTexCoord = 2.0f;
+
+	struct Stream {
+		const float*	data		= nullptr;
+		size_t			count		= 0;
+		int				components	= 0;
+	};
+
+	template<class T>
+	Stream MakeStream(const vector<T>& v) {
+		Stream s;
+		s.data			= v.empty() ? nullptr : (const float*)v.data();
+		s.count			= v.size();
+		s.components	= sizeof(T) / sizeof(float);
+		return s;
+	}
+
+	Stream GetStream(const MeshGeometry& mesh, VertexAttribute attribute) {
+		switch (attribute) {
+			case VertexAttribute::Positions:		return MakeStream(mesh.GetPositionData());
+			case VertexAttribute::Colours:			return MakeStream(mesh.GetColourData());
+			case VertexAttribute::TextureCoords:	return MakeStream(mesh.GetTextureCoordData());
+			case VertexAttribute::Normals:			return MakeStream(mesh.GetNormalData());
+			case VertexAttribute::Tangents:			return MakeStream(mesh.GetTangentData());
+			case VertexAttribute::JointWeights:		return MakeStream(mesh.GetSkinWeightData());
+			case VertexAttribute::JointIndices:		return MakeStream(mesh.GetSkinIndexData());
+			default:								return Stream();
+		}
+	}
+
+	float MaxAbsolute(const Stream& s) {
+		float result = 0.0f;
+		for (size_t i = 0; i < s.count * s.components; ++i) {
+			result = std::max(result, std::abs(s.data[i]));
+		}
+		return result;
+	}
+
+	float Clamp(float v, float minValue, float maxValue) {
+		return std::min(maxValue, std::max(minValue, v));
+	}
+
+	unsigned short FloatToHalf(float f) {
+		unsigned int bits;
+		memcpy(&bits, &f, sizeof(float));
+
+		unsigned int	sign		= (bits >> 16) & 0x8000;
+		int				exponent	= (int)((bits >> 23) & 0xFF) - 127 + 15;
+		unsigned int	mantissa	= bits & 0x007FFFFF;
+
+		if (exponent <= 0) { //too small for a normal half, so flush or denormalise
+			if (exponent < -10) {
+				return (unsigned short)sign;
+			}
+			mantissa |= 0x00800000;
+			unsigned int shift = 14 - exponent;
+			return (unsigned short)(sign | ((mantissa + (1 << (shift - 1))) >> shift));
+		}
+		if (exponent >= 31) {
+			return (unsigned short)(sign | 0x7C00); //infinity
+		}
+		unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+		half += (mantissa >> 12) & 1; //round to nearest - carrying into the exponent is fine
+		return (unsigned short)half;
+	}
+
+	float HalfToFloat(unsigned short h) {
+		unsigned int sign		= (h & 0x8000) << 16;
+		unsigned int exponent	= (h >> 10) & 0x1F;
+		unsigned int mantissa	= h & 0x3FF;
+		float result;
+		if (exponent == 0) {
+			result = std::ldexp((float)mantissa, -24);
+		}
+		else if (exponent == 31) {
+			result = INFINITY;
+		}
+		else {
+			result = std::ldexp((float)(mantissa | 0x400), (int)exponent - 25);
+		}
+		return sign ? -result : result;
+	}
+
+	/*
+	x, y and z get 10 bits each, w gets the top 2, all as signed normalised
+	values. Only directions go in here, so xyz is normalised on the way in
+	*/
+	unsigned int PackSNorm10_10_10_2(const float* v, int components) {
+		Vector3 direction(v[0], components > 1 ? v[1] : 0.0f, components > 2 ? v[2] : 0.0f);
+		if (direction.LengthSquared() > 0.0f) {
+			direction.Normalise();
+		}
+		unsigned int packed = 0;
+		for (int i = 0; i < 3; ++i) {
+			int value = (int)std::lround(Clamp(direction[i], -1.0f, 1.0f) * 511.0f);
+			packed |= (value & 0x3FF) << (i * 10);
+		}
+		int w = (int)std::lround(Clamp(components > 3 ? v[3] : 0.0f, -1.0f, 1.0f));
+		packed |= (unsigned int)(w & 0x3) << 30;
+		return packed;
+	}
+
+	//Weights are rescaled so that the bytes still sum to exactly 255
+	void PackWeights(const float* w, unsigned char* out) {
+		float sum = w[0] + w[1] + w[2] + w[3];
+		float scale = sum > 0.0f ? 255.0f / sum : 0.0f;
+		int total	= 0;
+		int largest = 0;
+		for (int i = 0; i < 4; ++i) {
+			int value = (int)std::lround(Clamp(w[i] * scale, 0.0f, 255.0f));
+			out[i] = (unsigned char)value;
+			total += value;
+			largest = w[i] > w[largest] ? i : largest;
+		}
+		if (sum > 0.0f) {
+			out[largest] = (unsigned char)Clamp((float)(out[largest] + 255 - total), 0.0f, 255.0f);
+		}
+	}
+}
+
+VertexLayout::VertexLayout() {
+	stride = 0;
+}
+
+int VertexLayout::FormatSize(VertexFormat format, int components) {
+	switch (format) {
+		case VertexFormat::HalfFloat:		return 2 * components;
+		case VertexFormat::UNorm8:			return components;
+		case VertexFormat::UInt8:			return components;
+		case VertexFormat::SNorm10_10_10_2: return 4;
+		default:							return 4 * components;
+	}
+}
+
+void VertexLayout::AddElement(VertexAttribute attribute, VertexFormat format, int components) {
+	VertexElement e;
+	e.attribute		= attribute;
+	e.format		= format;
+	e.components	= components;
+	e.offset		= stride;
+	elements.emplace_back(e);
+	stride += (FormatSize(format, components) + 3) & ~3; //keep every element 4 byte aligned
+}
+
+VertexLayout VertexLayout::FloatLayout(const MeshGeometry& mesh) {
+	VertexLayout layout;
+	for (int i = 0; i < VertexAttribute::MAX_ATTRIBUTES; ++i) {
+		Stream s = GetStream(mesh, (VertexAttribute)i);
+		if (s.count > 0) {
+			layout.AddElement((VertexAttribute)i, VertexFormat::Float, s.components);
+		}
+	}
+	return layout;
+}
+
+VertexLayout VertexLayout::PackedLayout(const MeshGeometry& mesh) {
+	VertexLayout layout;
+	for (int i = 0; i < VertexAttribute::MAX_ATTRIBUTES; ++i) {
+		VertexAttribute attribute = (VertexAttribute)i;
+		Stream s = GetStream(mesh, attribute);
+		if (s.count == 0) {
+			continue;
+		}
+		switch (attribute) {
+			case VertexAttribute::Normals:
+			case VertexAttribute::Tangents:
+				layout.AddElement(attribute, VertexFormat::SNorm10_10_10_2, 4);
+				break;
+			case VertexAttribute::Colours:
+			case VertexAttribute::JointWeights:
+				layout.AddElement(attribute, VertexFormat::UNorm8, 4);
+				break;
+			case VertexAttribute::TextureCoords:
+				layout.AddElement(attribute, MaxAbsolute(s) <= MaxHalfTexCoord ? VertexFormat::HalfFloat : VertexFormat::Float, 2);
+				break;
+			case VertexAttribute::JointIndices:
+				layout.AddElement(attribute, MaxAbsolute(s) < 256.0f ? VertexFormat::UInt8 : VertexFormat::Float, 4);
+				break;
+			default:
+				layout.AddElement(attribute, VertexFormat::Float, s.components);
+		}
+	}
+	return layout;
+}
+
+size_t VertexLayout::StreamSize(const MeshGeometry& mesh) {
+	return (size_t)FloatLayout(mesh).GetStride() * mesh.GetVertexCount();
+}
+
+//Streams shorter than the position stream are padded out with zeroes
+void VertexLayout::Pack(const MeshGeometry& mesh, vector<char>& output) const {
+	const size_t vertexCount = mesh.GetVertexCount();
+	output.assign(vertexCount * stride, 0);
+
+	for (const VertexElement& e : elements) {
+		Stream s = GetStream(mesh, e.attribute);
+		size_t count = std::min(s.count, vertexCount);
+
+		for (size_t v = 0; v < count; ++v) {
+			const float*	in	= s.data + v * s.components;
+			char*			out = output.data() + v * stride + e.offset;
+
+			switch (e.format) {
+				case VertexFormat::Float: {
+					memcpy(out, in, sizeof(float) * std::min(e.components, s.components));
+				}break;
+				case VertexFormat::HalfFloat: {
+					unsigned short* halves = (unsigned short*)out;
+					for (int i = 0; i < e.components && i < s.components; ++i) {
+						halves[i] = FloatToHalf(in[i]);
+					}
+				}break;
+				case VertexFormat::UNorm8: {
+					if (e.attribute == VertexAttribute::JointWeights && s.components == 4) {
+						PackWeights(in, (unsigned char*)out);
+						break;
+					}
+					for (int i = 0; i < e.components && i < s.components; ++i) {
+						out[i] = (char)(unsigned char)std::lround(Clamp(in[i], 0.0f, 1.0f) * 255.0f);
+					}
+				}break;
+				case VertexFormat::UInt8: {
+					for (int i = 0; i < e.components && i < s.components; ++i) {
+						out[i] = (char)(unsigned char)std::lround(Clamp(in[i], 0.0f, 255.0f));
+					}
+				}break;
+				case VertexFormat::SNorm10_10_10_2: {
+					unsigned int packed = PackSNorm10_10_10_2(in, s.components);
+					memcpy(out, &packed, sizeof(unsigned int));
+				}break;
+			}
+		}
+	}
+}
+
+//The same conversion the GPU does on the way into a shader
+Vector4 VertexLayout::Unpack(const char* vertex, const VertexElement& e) const {
+	Vector4 result(0, 0, 0, 0);
+	const char* in = vertex + e.offset;
+
+	switch (e.format) {
+		case VertexFormat::Float: {
+			float floats[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			memcpy(floats, in, sizeof(float) * e.components);
+			result = Vector4(floats[0], floats[1], floats[2], floats[3]);
+		}break;
+		case VertexFormat::HalfFloat: {
+			const unsigned short* halves = (const unsigned short*)in;
+			for (int i = 0; i < e.components; ++i) {
+				result[i] = HalfToFloat(halves[i]);
+			}
+		}break;
+		case VertexFormat::UNorm8: {
+			for (int i = 0; i < e.components; ++i) {
+				result[i] = (unsigned char)in[i] / 255.0f;
+			}
+		}break;
+		case VertexFormat::UInt8: {
+			for (int i = 0; i < e.components; ++i) {
+				result[i] = (unsigned char)in[i];
+			}
+		}break;
+		case VertexFormat::SNorm10_10_10_2: {
+			unsigned int packed;
+			memcpy(&packed, in, sizeof(unsigned int));
+			for (int i = 0; i < 3; ++i) {
+				int value = (int)(packed << (22 - i * 10)) >> 22; //sign extend
+				result[i] = std::max(value / 511.0f, -1.0f);
+			}
+			result.w = std::max((float)((int)packed >> 30), -1.0f);
+		}break;
+	}
+	return result;
+}
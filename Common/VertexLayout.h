@@ -0,0 +1,67 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "MeshGeometry.h"
+
+namespace NCL {
+	enum class VertexFormat {
+		Float,			//32 bit floats
+		HalfFloat,		//16 bit floats
+		UNorm8,			//0 to 255, read as 0 to 1
+		UInt8,			//0 to 255, read as 0 to 255
+		SNorm10_10_10_2	//three 10 bit components and a 2 bit one, read as -1 to 1
+	};
+
+	struct VertexElement {
+		VertexAttribute	attribute;
+		VertexFormat	format;
+		int				components;
+		int				offset;		//in bytes, from the start of the vertex
+	};
+
+	/*
+	Describes how a mesh's separate attribute streams are interleaved into a
+	single vertex buffer. The packed layout keeps positions as floats, but
+	stores normals and tangents as 10:10:10:2 (after normalising them),
+	texture coordinates as halves, and colours and skin weights as normalised
+	bytes - all formats the GPU expands back out by itself, so shaders see
+	the same inputs as before.
+	*/
+	class VertexLayout	{
+	public:
+		VertexLayout();
+
+		//Every stream as floats, just interleaved
+		static VertexLayout FloatLayout(const MeshGeometry& mesh);
+		//The smallest format that suits each of the mesh's streams
+		static VertexLayout PackedLayout(const MeshGeometry& mesh);
+
+		//Bytes uploaded for the mesh's vertex data as separate float streams
+		static size_t StreamSize(const MeshGeometry& mesh);
+
+		void	Pack(const MeshGeometry& mesh, vector<char>& output) const;
+		Vector4 Unpack(const char* vertex, const VertexElement& element) const;
+
+		const vector<VertexElement>& GetElements() const {
+			return elements;
+		}
+
+		int GetStride() const {
+			return stride;
+		}
+
+		static int FormatSize(VertexFormat format, int components);
+
+	protected:
+		void AddElement(VertexAttribute attribute, VertexFormat format, int components);
+
+		vector<VertexElement>	elements;
+		int						stride;
+	};
+}
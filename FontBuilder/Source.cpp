@@ -1,58 +1,283 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <iomanip>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "../Common/stb/stb_truetype.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "../Common/stb/stb_image_write.h"
+#include "../Common/TextureWriter.h"
+#include "../Common/ParallelFor.h"
 
 using std::string;
+using std::vector;
+using namespace NCL;
 
-int main(void) {
+const int startChar	= 32;
+const int numChars	= 96;
 
-	string inFont	= "PressStart2P.ttf";
-	string outTex	= "PressStart2P.png";
-	string outData	= "PressStart2P.fnt";
+//The bitmap font is baked at this size into an atlas this wide - distance field
+//fonts scale their metrics to match, so the same text size comes out the same
+const float	BitmapPixelHeight	= 48.0f;
+const int	BitmapAtlasSize		= 512;
 
-	int xSize = 512;
-	int ySize = 512;
+struct SDFGlyph {
+	unsigned char*	pixels	= nullptr;	//from stbtt, freed once packed
+	int				width	= 0;
+	int				height	= 0;
+	int				xOff	= 0;
+	int				yOff	= 0;
+	float			advance	= 0.0f;
+	int				x		= 0;		//where it ended up in the atlas
+	int				y		= 0;
+};
 
-	unsigned char* bitmapData	= new unsigned char[xSize * ySize];
+static vector<unsigned char> LoadFile(const string& filename) {
+	vector<unsigned char> data;
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cout << __FUNCTION__ << " can't open " << filename << std::endl;
+		return data;
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return data;
+}
 
-	unsigned char* fontData		= new unsigned char[1 << 20];
-	fread(fontData, 1, 1 << 20, fopen(inFont.c_str(), "rb"));
+static void WriteFontData(const string& filename, int xSize, int ySize, const vector<stbtt_bakedchar>& chars, const string& extra) {
+	std::ofstream fntFile(filename, std::ios::out);
 
-	int startChar	= 32;
-	int numChars	= 96;
+	fntFile << xSize	 << std::endl;
+	fntFile << ySize	 << std::endl;
+	fntFile << startChar << std::endl;
+	fntFile << numChars  << std::endl;
 
-	stbtt_bakedchar cdata[96];
+	for (const stbtt_bakedchar& c : chars) {
+		fntFile << c.x0		<< " "
+				<< c.y0		<< " "
+				<< c.x1		<< " "
+				<< c.y1		<< " "
+				<< c.xoff	<< " "
+				<< c.yoff	<< " "
+				<< c.xadvance
+				<< std::endl;
+	}
+	fntFile << extra;
+}
 
-	stbtt_BakeFontBitmap(fontData, 0, 48.0, bitmapData, xSize, ySize, startChar, numChars, cdata);
+//The original fixed size font - one atlas per size it's wanted at
+static bool BuildBitmapFont(const vector<unsigned char>& fontData, const string& outName) {
+	int xSize = BitmapAtlasSize;
+	int ySize = BitmapAtlasSize;
 
-	stbi_write_png(outTex.c_str(), xSize, ySize, 1, bitmapData, xSize * 1);
+	vector<unsigned char>	bitmapData(xSize * ySize);
+	vector<stbtt_bakedchar>	cdata(numChars);
 
-	delete fontData;
-	delete bitmapData;
+	stbtt_BakeFontBitmap(fontData.data(), 0, BitmapPixelHeight, bitmapData.data(), xSize, ySize, startChar, numChars, cdata.data());
 
+	if (!TextureWriter::WritePNG(outName + ".png", (const char*)bitmapData.data(), xSize, ySize, 1, PNGCompression::Default)) {
+		return false;
+	}
+	WriteFontData(outName + ".fnt", xSize, ySize, cdata, "");
+	return true;
+}
 
-	std::ofstream fntFile(outData, std::ios::out);
+/*
+Skyline packing - the atlas is tracked as the height it's filled to along
+its width, and each glyph goes wherever its top would end up lowest. Tallest
+glyphs go first, so rows of mixed heights don't leave the gaps shelves do.
+*/
+static bool PackGlyphs(vector<SDFGlyph>& glyphs, int atlasWidth, int atlasHeight, int gutter) {
+	struct Segment {
+		int x;
+		int y;
+		int width;
+	};
+	vector<int> order(glyphs.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&glyphs](int a, int b) {
+		return glyphs[a].height != glyphs[b].height ? glyphs[a].height > glyphs[b].height : glyphs[a].width > glyphs[b].width;
+	});
 
-	fntFile << xSize	 << std::endl;
-	fntFile << ySize	 << std::endl;
-	fntFile << startChar << std::endl;
-	fntFile << numChars  << std::endl;
+	vector<Segment> skyline = { { 0, 0, atlasWidth } };
+	for (int i : order) {
+		SDFGlyph& g = glyphs[i];
+		if (g.width == 0 || g.height == 0) {
+			continue;
+		}
+		int w = g.width + gutter;
+		int h = g.height + gutter;
 
-	for (int i = 0; i < 96; ++i) {
-		fntFile << cdata[i].x0		<< " "
-				<< cdata[i].y0		<< " "
-				<< cdata[i].x1		<< " "
-				<< cdata[i].y1		<< " "
-				<< cdata[i].xoff	<< " "
-				<< cdata[i].yoff	<< " "
-				<< cdata[i].xadvance
-				<< std::endl;
+		int bestY		= INT_MAX;
+		int bestWidth	= INT_MAX;
+		int bestIndex	= -1;
+		for (size_t s = 0; s < skyline.size(); ++s) {
+			if (skyline[s].x + w > atlasWidth) {
+				break;
+			}
+			//Resting on the highest segment it spans
+			int y			= 0;
+			int remaining	= w;
+			for (size_t k = s; remaining > 0; ++k) {
+				y			= std::max(y, skyline[k].y);
+				remaining	-= skyline[k].width;
+			}
+			if (y + h > atlasHeight) {
+				continue;
+			}
+			if (y < bestY || (y == bestY && skyline[s].width < bestWidth)) {
+				bestY		= y;
+				bestWidth	= skyline[s].width;
+				bestIndex	= (int)s;
+			}
+		}
+		if (bestIndex < 0) {
+			return false;
+		}
+		g.x = skyline[bestIndex].x;
+		g.y = bestY;
+
+		Segment added = { g.x, bestY + h, w };
+		skyline.insert(skyline.begin() + bestIndex, added);
+
+		//Trim back whatever the new segment now covers
+		size_t s = bestIndex + 1;
+		while (s < skyline.size() && skyline[s].x < added.x + added.width) {
+			int overlap = added.x + added.width - skyline[s].x;
+			if (overlap >= skyline[s].width) {
+				skyline.erase(skyline.begin() + s);
+				continue;
+			}
+			skyline[s].x		+= overlap;
+			skyline[s].width	-= overlap;
+			break;
+		}
+		for (size_t m = 0; m + 1 < skyline.size();) {
+			if (skyline[m].y == skyline[m + 1].y) {
+				skyline[m].width += skyline[m + 1].width;
+				skyline.erase(skyline.begin() + m + 1);
+			}
+			else {
+				++m;
+			}
+		}
+	}
+	return true;
+}
+
+/*
+A signed distance field font - each texel holds how far it is from the
+glyph's edge, with the edge itself at 0.5, out to spread texels either side.
+Filtering between texels gives a smooth edge at any scale, so one small atlas
+serves every text size. Glyphs are generated in parallel, then packed into
+the smallest power of two atlas they fit.
+*/
+static bool BuildDistanceFieldFont(const vector<unsigned char>& fontData, const string& outName, float pixelHeight, int spread) {
+	stbtt_fontinfo info;
+	if (!stbtt_InitFont(&info, fontData.data(), stbtt_GetFontOffsetForIndex(fontData.data(), 0))) {
+		std::cout << __FUNCTION__ << " can't read the font!" << std::endl;
+		return false;
+	}
+	float scale = stbtt_ScaleForPixelHeight(&info, pixelHeight);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	vector<SDFGlyph> glyphs(numChars);
+	ParallelFor(glyphs.size(), 8, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) {
+			SDFGlyph&	g			= glyphs[i];
+			int			codepoint	= startChar + (int)i;
+			g.pixels = stbtt_GetCodepointSDF(&info, scale, codepoint, spread, 128, 128.0f / spread, &g.width, &g.height, &g.xOff, &g.yOff);
+			if (!g.pixels) {
+				g.width		= 0;
+				g.height	= 0;
+			}
+			int advance;
+			int leftBearing;
+			stbtt_GetCodepointHMetrics(&info, codepoint, &advance, &leftBearing);
+			g.advance = advance * scale;
+		}
+	});
+	float generateMS = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	//A texel between glyphs, so filtering at their edges never reaches a neighbour
+	const int gutter = 1;
+
+	int xSize = 0;
+	int ySize = 0;
+	for (int size = 64; size <= 4096 && xSize == 0; size *= 2) {
+		if (PackGlyphs(glyphs, size, size / 2, gutter)) {
+			xSize = size;
+			ySize = size / 2;
+		}
+		else if (PackGlyphs(glyphs, size, size, gutter)) {
+			xSize = size;
+			ySize = size;
+		}
+	}
+	if (xSize == 0) {
+		std::cout << __FUNCTION__ << " glyphs don't fit in a 4096 atlas!" << std::endl;
+		for (SDFGlyph& g : glyphs) {
+			stbtt_FreeSDF(g.pixels, nullptr);
+		}
+		return false;
+	}
+
+	vector<unsigned char>	atlas(xSize * ySize, 0);
+	vector<stbtt_bakedchar>	cdata(numChars);
+	for (int i = 0; i < numChars; ++i) {
+		SDFGlyph& g = glyphs[i];
+		for (int row = 0; row < g.height; ++row) {
+			std::copy(g.pixels + row * g.width, g.pixels + (row + 1) * g.width, atlas.begin() + (g.y + row) * xSize + g.x);
+		}
+		stbtt_FreeSDF(g.pixels, nullptr);
+		g.pixels = nullptr;
+
+		stbtt_bakedchar& c = cdata[i];
+		c.x0		= (unsigned short)g.x;
+		c.y0		= (unsigned short)g.y;
+		c.x1		= (unsigned short)(g.x + g.width);
+		c.y1		= (unsigned short)(g.y + g.height);
+		c.xoff		= (float)g.xOff;
+		c.yoff		= (float)g.yOff;
+		c.xadvance	= g.advance;
+	}
+
+	if (!TextureWriter::WritePNG(outName + ".png", (const char*)atlas.data(), xSize, ySize, 1, PNGCompression::Default)) {
+		return false;
+	}
+	//How much of the atlas one unit of text size covers, matching the bitmap font's
+	float layoutScale = (BitmapPixelHeight / BitmapAtlasSize) / pixelHeight;
+	std::ostringstream sdfData;
+	sdfData << std::setprecision(9) << "sdf " << spread << " " << layoutScale << std::endl;
+	WriteFontData(outName + ".fnt", xSize, ySize, cdata, sdfData.str());
+
+	std::cout << outName << ": " << numChars << " glyphs at " << pixelHeight << "px in " << generateMS << "ms, "
+		<< xSize << "x" << ySize << " atlas (" << xSize * ySize / 1024 << "KB), bitmap font was "
+		<< BitmapAtlasSize << "x" << BitmapAtlasSize << " (" << BitmapAtlasSize * BitmapAtlasSize / 1024 << "KB) per size" << std::endl;
+	return true;
+}
+
+//FontBuilder [font.ttf] [output name] [sdf|bitmap] [pixel height] [spread]
+int main(int argc, char** argv) {
+	string inFont	= argc > 1 ? argv[1] : "PressStart2P.ttf";
+	string outName	= argc > 2 ? argv[2] : "PressStart2P_SDF";
+	string type		= argc > 3 ? argv[3] : "sdf";
+	float pixelHeight	= argc > 4 ? (float)atof(argv[4]) : 32.0f;
+	int spread			= argc > 5 ? atoi(argv[5]) : 4;
+
+	vector<unsigned char> fontData = LoadFile(inFont);
+	if (fontData.empty()) {
+		return 1;
 	}
+	bool built = type == "bitmap" ?
+		BuildBitmapFont(fontData, outName) :
+		BuildDistanceFieldFont(fontData, outName, pixelHeight, std::max(spread, 1));
 
-	return 0;
+	return built ? 0 : 1;
 }
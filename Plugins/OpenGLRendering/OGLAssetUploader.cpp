@@ -0,0 +1,30 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "OGLAssetUploader.h"
+#include "OGLMesh.h"
+#include "OGLTexture.h"
+
+using namespace NCL;
+using namespace NCL::Rendering;
+
+//OGLMesh only talks to GL in UploadToGPU, so constructing it off the main thread is fine
+MeshGeometry* OGLAssetUploader::CreateMesh(const std::string& filename) {
+	OGLMesh* mesh = new OGLMesh(filename);
+	mesh->SetPrimitiveType(GeometryPrimitive::Triangles);
+	mesh->SetPackedVertices(true); //loaded meshes are static, so can be packed down
+	return mesh;
+}
+
+void OGLAssetUploader::UploadMesh(MeshGeometry* mesh) {
+	mesh->UploadToGPU();
+}
+
+TextureBase* OGLAssetUploader::UploadTexture(const TextureData& data) {
+	return OGLTexture::TextureFromData(data.data, data.width, data.height, data.channels, data.flags);
+}
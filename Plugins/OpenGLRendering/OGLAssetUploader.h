@@ -0,0 +1,21 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "../../Common/AssetManager.h"
+
+namespace NCL {
+	namespace Rendering {
+		class OGLAssetUploader : public AssetUploader	{
+		public:
+			MeshGeometry*	CreateMesh(const std::string& filename) override;
+			void			UploadMesh(MeshGeometry* mesh) override;
+			TextureBase*	UploadTexture(const TextureData& data) override;
+		};
+	}
+}
@@ -19,6 +19,9 @@ OGLMesh::OGLMesh() {
 	vao			= 0;
 	subCount	= 1;
 
+	packVertices		= false;
+	vertexBufferSize	= 0;
+
 	for (int i = 0; i < VertexAttribute::MAX_ATTRIBUTES; ++i) {
 		attributeBuffers[i] = 0;
 	}
@@ -29,6 +32,9 @@ OGLMesh::OGLMesh(const std::string&filename) : MeshGeometry(filename){
 	vao		 = 0;
 	subCount = 1;
 
+	packVertices		= false;
+	vertexBufferSize	= 0;
+
 	for (int i = 0; i < VertexAttribute::MAX_ATTRIBUTES; ++i) {
 		attributeBuffers[i] = 0;
 	}
@@ -55,16 +61,39 @@ void OGLMesh::BindVertexAttribute(int attribSlot, int buffer, int bindingID, int
 	glBindVertexBuffer(bindingID, buffer, elementOffset, elementSize);
 }
 
-void OGLMesh::UploadToGPU(Rendering::RendererBase* renderer) {
-	if (!ValidateMeshData()) {
-		return;
+static void GetOGLFormat(VertexFormat format, GLenum& type, GLboolean& normalised) {
+	switch (format) {
+		case VertexFormat::HalfFloat:		type = GL_HALF_FLOAT;			normalised = GL_FALSE;	break;
+		case VertexFormat::UNorm8:			type = GL_UNSIGNED_BYTE;		normalised = GL_TRUE;	break;
+		case VertexFormat::UInt8:			type = GL_UNSIGNED_BYTE;		normalised = GL_FALSE;	break;
+		case VertexFormat::SNorm10_10_10_2: type = GL_INT_2_10_10_10_REV;	normalised = GL_TRUE;	break;
+		default:							type = GL_FLOAT;				normalised = GL_FALSE;	break;
 	}
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
+}
 
-	int numVertices = GetVertexCount();
-	int numIndices	= GetIndexCount();
+//Every attribute comes from the one buffer, bound at binding 0
+void OGLMesh::UploadPackedVertices() {
+	packedLayout = VertexLayout::PackedLayout(*this);
+
+	vector<char> vertexData;
+	packedLayout.Pack(*this, vertexData);
+	vertexBufferSize = vertexData.size();
+
+	CreateVertexBuffer(attributeBuffers[VertexAttribute::Positions], (int)vertexData.size(), vertexData.data());
+
+	for (const VertexElement& e : packedLayout.GetElements()) {
+		GLenum		type;
+		GLboolean	normalised;
+		GetOGLFormat(e.format, type, normalised);
+
+		glEnableVertexAttribArray(e.attribute);
+		glVertexAttribFormat(e.attribute, e.components, type, normalised, e.offset);
+		glVertexAttribBinding(e.attribute, 0);
+	}
+	glBindVertexBuffer(0, attributeBuffers[VertexAttribute::Positions], 0, packedLayout.GetStride());
+}
 
+void OGLMesh::UploadFloatVertices(int numVertices) {
 	if (!GetPositionData().empty()) {
 		CreateVertexBuffer(attributeBuffers[VertexAttribute::Positions], numVertices * sizeof(Vector3), (char*)GetPositionData().data());
 		BindVertexAttribute(VertexAttribute::Positions, attributeBuffers[VertexAttribute::Positions], VertexAttribute::Positions, 3, sizeof(Vector3), 0);
@@ -98,17 +127,68 @@ void OGLMesh::UploadToGPU(Rendering::RendererBase* renderer) {
 		CreateVertexBuffer(attributeBuffers[VertexAttribute::JointIndices], numVertices * sizeof(Vector4), (char*)GetSkinIndexData().data());
 		BindVertexAttribute(VertexAttribute::JointIndices, attributeBuffers[VertexAttribute::JointIndices], VertexAttribute::JointIndices, 4, sizeof(Vector4), 0);
 	}
+	vertexBufferSize = VertexLayout::StreamSize(*this);
+}
 
-	if (!GetIndexData().empty()) {		//buffer index data
-		glGenBuffers(1, &attributeBuffers[VertexAttribute::MAX_ATTRIBUTES]);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, attributeBuffers[VertexAttribute::MAX_ATTRIBUTES]);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), (int*)GetIndexData().data(), GL_STATIC_DRAW);
+void OGLMesh::UploadToGPU(Rendering::RendererBase* renderer) {
+	if (!ValidateMeshData()) {
+		return;
+	}
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	int numVertices = GetVertexCount();
+	int numIndices	= GetLODIndexCount();
+
+	if (packVertices) {
+		UploadPackedVertices();
+	}
+	else {
+		UploadFloatVertices(numVertices);
+	}
+
+	if (!GetIndexData().empty()) {		//buffer index data, with any LODs after the full mesh
+		glGenBuffers(1, &indexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+		size_t offset = GetIndexCount() * sizeof(GLuint);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, offset, GetIndexData().data());
+		for (const MeshLOD& lod : GetLODData()) {
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, lod.indices.size() * sizeof(GLuint), lod.indices.data());
+			offset += lod.indices.size() * sizeof(GLuint);
+		}
 	}
 
 	glBindVertexArray(0);
 }
 
+void OGLMesh::SwapWith(MeshGeometry& other) {
+	MeshGeometry::SwapWith(other);
+
+	OGLMesh& o = (OGLMesh&)other;
+	std::swap(vao,			o.vao);
+	std::swap(oglType,		o.oglType);
+	std::swap(subCount,		o.subCount);
+	std::swap(indexBuffer,	o.indexBuffer);
+	std::swap(packVertices,	o.packVertices);
+	std::swap(packedLayout,	o.packedLayout);
+	std::swap(vertexBufferSize, o.vertexBufferSize);
+	for (int i = 0; i < VertexAttribute::MAX_ATTRIBUTES; ++i) {
+		std::swap(attributeBuffers[i], o.attributeBuffers[i]);
+	}
+}
+
 void OGLMesh::UpdateGPUBuffers(unsigned int startVertex, unsigned int vertexCount) {
+	if (packVertices) {
+		const int stride = packedLayout.GetStride();
+		vector<char> vertexData;
+		packedLayout.Pack(*this, vertexData);
+		glBindBuffer(GL_ARRAY_BUFFER, attributeBuffers[VertexAttribute::Positions]);
+		glBufferSubData(GL_ARRAY_BUFFER, startVertex * stride, vertexCount * stride, &vertexData[startVertex * stride]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return;
+	}
 	if (!GetPositionData().empty()) {
 		glBindBuffer(GL_ARRAY_BUFFER, attributeBuffers[VertexAttribute::Positions]);
 		glBufferSubData(GL_ARRAY_BUFFER, startVertex * sizeof(Vector3), vertexCount * sizeof(Vector3), (char*)&GetPositionData()[startVertex]);
@@ -144,33 +224,3 @@ void OGLMesh::UpdateGPUBuffers(unsigned int startVertex, unsigned int vertexCoun
 	//}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
-
-
-void OGLMesh::RecalculateNormals() {
-	normals.clear();
-
-	if (indices.size() > 0) {
-		for (size_t i = 0; i < positions.size(); i++) {
-			normals.emplace_back(Vector3());
-		}
-
-		for (size_t i = 0; i < indices.size(); i += 3) {
-			Vector3& a = positions[indices[i+0]];
-			Vector3& b = positions[indices[i+1]];
-			Vector3& c = positions[indices[i+2]];
-
-			Vector3 normal = Vector3::Cross(b - a, c - a);
-			normal.Normalise();
-
-			normals[indices[i + 0]] += normal;
-			normals[indices[i + 1]] += normal;
-			normals[indices[i + 2]] += normal;
-		}
-		for (size_t i = 0; i < normals.size(); ++i) {
-			normals[i].Normalise();
-		}
-	}
-	else {
-
-	}
-}
\ No newline at end of file
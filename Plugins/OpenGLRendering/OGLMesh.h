@@ -8,6 +8,7 @@ https://research.ncl.ac.uk/game/
 */
 #pragma once
 #include "../../Common/MeshGeometry.h"
+#include "../../Common/VertexLayout.h"
 #include "glad\glad.h"
 
 #include <string>
@@ -22,14 +23,27 @@ namespace NCL {
 			OGLMesh(const std::string&filename);
 			~OGLMesh();
 
-			void RecalculateNormals();
-
 			void UploadToGPU(Rendering::RendererBase* renderer = nullptr) override;
 			void UpdateGPUBuffers(unsigned int startVertex, unsigned int vertexCount);
 
+			void SwapWith(MeshGeometry& other) override;
+
+			//Uploads one interleaved buffer of quantised attributes (see
+			//VertexLayout) instead of a float buffer per attribute
+			void SetPackedVertices(bool packed) {
+				packVertices = packed;
+			}
+
+			//Size of the vertex data on the GPU
+			size_t GetVertexBufferSize() const {
+				return vertexBufferSize;
+			}
+
 		protected:
 			GLuint	GetVAO()			const { return vao;			}
 			void BindVertexAttribute(int attribSlot, int bufferID, int bindingID, int elementCount, int elementSize, int elementOffset);
+			void UploadFloatVertices(int numVertices);
+			void UploadPackedVertices();
 
 			int		subCount;
 
@@ -37,6 +51,10 @@ namespace NCL {
 			GLuint oglType;
 			GLuint attributeBuffers[VertexAttribute::MAX_ATTRIBUTES];
 			GLuint indexBuffer;
+
+			bool			packVertices;
+			VertexLayout	packedLayout;
+			size_t			vertexBufferSize;
 		};
 	}
 }
\ No newline at end of file
@@ -10,9 +10,12 @@ https://research.ncl.ac.uk/game/
 #include "OGLShader.h"
 #include "OGLMesh.h"
 #include "OGLTexture.h"
+#include "OGLStreamBuffer.h"
 
 #include "../../Common/SimpleFont.h"
+#include "../../Common/TextLayoutCache.h"
 #include "../../Common/TextureLoader.h"
+#include "../../Common/TextureCooker.h"
 
 #include "../../Common/Vector2.h"
 #include "../../Common/Vector3.h"
@@ -20,6 +23,8 @@ https://research.ncl.ac.uk/game/
 
 #include "../../Common/MeshGeometry.h"
 
+#include <cstddef>
+
 #ifdef _WIN32
 #include "../../Common/Win32Window.h"
 
@@ -46,22 +51,28 @@ OGLRenderer::OGLRenderer(Window& w) : RendererBase(w)	{
 #endif
 	boundMesh	= nullptr;
 	boundShader = nullptr;
+	font		= nullptr;
+	textLayout	= nullptr;
 
 	currentWidth	= (int)w.GetScreenSize().x;
 	currentHeight	= (int)w.GetScreenSize().y;
 
 	if (initState) {
 		TextureLoader::RegisterAPILoadFunction(OGLTexture::RGBATextureFromFilename);
+		TextureCooker::RegisterLoadFunction();
 
-		font = new SimpleFont("PressStart2P.fnt", "PressStart2P.png");
+		font = new SimpleFont("PressStart2P_SDF.fnt", "PressStart2P_SDF.png");
+		textLayout = new TextLayoutCache(*font);
 
 		OGLTexture* t = (OGLTexture*)font->GetTexture();
 
 		if (t) {
+			//Distances have to be filtered between texels to find the edge - coverage is kept crisp
+			GLint filter = font->IsDistanceField() ? GL_LINEAR : GL_NEAREST;
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, t->GetObjectID());
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
 			glBindTexture(GL_TEXTURE_2D, 0);
 		}
 		glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
@@ -70,26 +81,23 @@ OGLRenderer::OGLRenderer(Window& w) : RendererBase(w)	{
 
 	forceValidDebugState = false;
 
-	debugLinesMesh		= new OGLMesh();
-	debugTextMesh		= new OGLMesh();
-
-
-	debugLinesMesh->SetVertexPositions(std::vector<Vector3>(5000, Vector3()));
-	debugLinesMesh->SetVertexColours(std::vector<Vector4>(5000, Vector3()));
-
-	debugTextMesh->SetVertexPositions(std::vector<Vector3>(5000, Vector3()));
-	debugTextMesh->SetVertexColours(std::vector<Vector4>(5000, Vector3()));
-	debugTextMesh->SetVertexTextureCoords(std::vector<Vector2>(5000, Vector3()));
-
-	debugTextMesh->UploadToGPU();
-	debugLinesMesh->UploadToGPU();
-
-	debugLinesMesh->SetPrimitiveType(GeometryPrimitive::Lines);
+	debugLineBuffer = nullptr;
+	debugTextBuffer = nullptr;
+	debugLineVAO	= 0;
+	debugTextVAO	= 0;
+	if (initState) {
+		CreateDebugBuffers();
+	}
 }
 
 OGLRenderer::~OGLRenderer()	{
+	delete textLayout;
 	delete font;
 	delete debugShader;
+	delete debugLineBuffer;
+	delete debugTextBuffer;
+	glDeleteVertexArrays(1, &debugLineVAO);
+	glDeleteVertexArrays(1, &debugTextVAO);
 
 #ifdef _WIN32
 	DestroyWithWin32();
@@ -154,7 +162,7 @@ void OGLRenderer::BindMesh(MeshGeometry*m) {
 	}
 }
 
-void OGLRenderer::DrawBoundMesh(int subLayer, int numInstances) {
+void OGLRenderer::DrawBoundMesh(int subLayer, int numInstances, int lodLevel) {
 	if (!boundMesh) {
 		std::cout << __FUNCTION__ << " has been called without a bound mesh!" << std::endl;
 		return;
@@ -167,7 +175,12 @@ void OGLRenderer::DrawBoundMesh(int subLayer, int numInstances) {
 	int		count	= 0;
 	int		offset	= 0;
 
-	if (boundMesh->GetSubMeshCount() == 0) {
+	SubMesh lodRange;
+	if (lodLevel > 0 && boundMesh->GetLODSubMesh(lodLevel, subLayer, lodRange)) {
+		offset = lodRange.start;
+		count  = lodRange.count;
+	}
+	else if (boundMesh->GetSubMeshCount() == 0) {
 		if (boundMesh->GetIndexCount() > 0) {
 			count = boundMesh->GetIndexCount();
 		}
@@ -191,11 +204,37 @@ void OGLRenderer::DrawBoundMesh(int subLayer, int numInstances) {
 	}
 
 	if (boundMesh->GetIndexCount() > 0) {
-		glDrawElements(mode, count, GL_UNSIGNED_INT, (const GLvoid*)(offset * sizeof(unsigned int)));
+		if (numInstances > 1) {
+			glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, (const GLvoid*)(offset * sizeof(unsigned int)), numInstances);
+		}
+		else {
+			glDrawElements(mode, count, GL_UNSIGNED_INT, (const GLvoid*)(offset * sizeof(unsigned int)));
+		}
 	}
 	else {
-		glDrawArrays(mode, 0, count);
+		if (numInstances > 1) {
+			glDrawArraysInstanced(mode, 0, count, numInstances);
+		}
+		else {
+			glDrawArrays(mode, 0, count);
+		}
+	}
+}
+
+void OGLRenderer::BindInstanceBuffer(unsigned int buffer, size_t offset, size_t stride) {
+	if (!boundMesh) {
+		std::cout << __FUNCTION__ << " has been called without a bound mesh!" << std::endl;
+		return;
+	}
+	//A mat4 takes up 4 attribute slots, one per column, followed by the colour
+	for (int i = 0; i < 5; ++i) {
+		GLuint location = InstanceAttributeLocation + i;
+		glEnableVertexAttribArray(location);
+		glVertexAttribFormat(location, 4, GL_FLOAT, GL_FALSE, i * sizeof(float) * 4);
+		glVertexAttribBinding(location, InstanceBufferBinding);
 	}
+	glVertexBindingDivisor(InstanceBufferBinding, 1);
+	glBindVertexBuffer(InstanceBufferBinding, buffer, offset, (GLsizei)stride);
 }
 
 void OGLRenderer::BindTextureToShader(const TextureBase*t, const std::string& uniform, int texUnit) const{
@@ -206,7 +245,7 @@ void OGLRenderer::BindTextureToShader(const TextureBase*t, const std::string& un
 		return;//Debug message time!
 	}
 	
-	GLuint slot = glGetUniformLocation(boundShader->programID, uniform.c_str());
+	GLint slot = boundShader->GetUniformLocation(uniform);
 
 	if (slot < 0) {
 		return;
@@ -222,21 +261,41 @@ void OGLRenderer::BindTextureToShader(const TextureBase*t, const std::string& un
 	glUniform1i(slot, texUnit);
 }
 
-void OGLRenderer::DrawString(const std::string& text, const Vector2&pos, const Vector4& colour, float size) {
-	DebugString s;
-	s.colour	= colour;
-	s.pos		= pos;
-	s.size		= size;
-	s.text		= text;
-	debugStrings.emplace_back(s);
+void OGLRenderer::DrawString(const std::string& text, const Vector2&pos, const Vector4& colour, float size, TextUsage usage) {
+	debugDraw.AddText(text, Vector3(pos.x, pos.y, 0.0f), colour, size, false, usage);
 }
 
 void OGLRenderer::DrawLine(const Vector3& start, const Vector3& end, const Vector4& colour) {
-	DebugLine l;
-	l.start		= start;
-	l.end		= end;
-	l.colour	= colour;
-	debugLines.emplace_back(l);
+	debugDraw.AddLine(start, end, colour);
+}
+
+//Both formats share a binding point, so a frame's vertices can be pointed at wherever they were written
+void OGLRenderer::CreateDebugBuffers() {
+	debugLineBuffer = new OGLStreamBuffer(debugDraw.GetLineVertexCapacity() * sizeof(DebugLineVertex));
+	debugTextBuffer = new OGLStreamBuffer(4096 * 6 * sizeof(DebugTextVertex));
+
+	glGenVertexArrays(1, &debugLineVAO);
+	glBindVertexArray(debugLineVAO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(DebugLineVertex, position));
+	glVertexAttribBinding(0, DebugVertexBinding);
+	glEnableVertexAttribArray(1);
+	glVertexAttribFormat(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(DebugLineVertex, colour));
+	glVertexAttribBinding(1, DebugVertexBinding);
+
+	glGenVertexArrays(1, &debugTextVAO);
+	glBindVertexArray(debugTextVAO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(DebugTextVertex, position));
+	glVertexAttribBinding(0, DebugVertexBinding);
+	glEnableVertexAttribArray(1);
+	glVertexAttribFormat(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(DebugTextVertex, colour));
+	glVertexAttribBinding(1, DebugVertexBinding);
+	glEnableVertexAttribArray(2);
+	glVertexAttribFormat(2, 2, GL_FLOAT, GL_FALSE, offsetof(DebugTextVertex, texCoord));
+	glVertexAttribBinding(2, DebugVertexBinding);
+
+	glBindVertexArray(0);
 }
 
 Matrix4 OGLRenderer::SetupDebugLineMatrix() const {
@@ -247,7 +306,8 @@ Matrix4 OGLRenderer::SetupDebugStringMatrix()const {
 }
 
 void OGLRenderer::DrawDebugData() {
-	if (debugStrings.empty() && debugLines.empty()) {
+	if (!debugLineBuffer || (debugDraw.GetLineVertexCount() == 0 && debugDraw.GetTexts().empty())) {
+		EndDebugFrame();
 		return; //don't mess with OGL state if there's no point!
 	}
 	BindShader(debugShader);
@@ -258,24 +318,24 @@ void OGLRenderer::DrawDebugData() {
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
 
-	int matLocation		= glGetUniformLocation(debugShader->GetProgramID(), "viewProjMatrix");
+	int matLocation		= debugShader->GetUniformLocation("viewProjMatrix");
 	Matrix4 pMat;
 
 	BindTextureToShader(font->GetTexture(), "mainTex", 0);
 
-	GLuint texSlot = glGetUniformLocation(boundShader->programID, "useTexture");
+	GLint texSlot = boundShader->GetUniformLocation("useTexture");
 
-	if (debugLines.size() > 0) {
+	if (debugDraw.GetLineVertexCount() > 0) {
 		pMat = SetupDebugLineMatrix();
 		glUniformMatrix4fv(matLocation, 1, false, pMat.array);
 		glUniform1i(texSlot, 0);
 		DrawDebugLines();
 	}
 
-	if (debugStrings.size() > 0) {
+	if (!debugDraw.GetTexts().empty()) {
 		pMat = SetupDebugStringMatrix();
 		glUniformMatrix4fv(matLocation, 1, false, pMat.array);
-		glUniform1i(texSlot, 1);
+		glUniform1i(texSlot, font->IsDistanceField() ? 2 : 1);
 		DrawDebugStrings();
 	}
 
@@ -284,48 +344,66 @@ void OGLRenderer::DrawDebugData() {
 		glEnable(GL_DEPTH_TEST);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
+	EndDebugFrame();
 }
 
-void OGLRenderer::DrawDebugStrings() {
-	vector<Vector3> vertPos;
-	vector<Vector2> vertTex;
-	vector<Vector4> vertColours;
-
-	for (DebugString&s : debugStrings) {
-		font->BuildVerticesForString(s.text, s.pos, s.colour, s.size, vertPos, vertTex, vertColours);
+void OGLRenderer::EndDebugFrame() {
+	debugDraw.Clear();
+	if (textLayout) {
+		textLayout->EndFrame();
 	}
+}
 
-	debugTextMesh->SetVertexPositions(vertPos);
-	debugTextMesh->SetVertexTextureCoords(vertTex);
-	debugTextMesh->SetVertexColours(vertColours);
-	debugTextMesh->UpdateGPUBuffers(0, vertPos.size());
+//Strings that were drawn last frame too are copied out of the layout cache, rather than laid out again
+void OGLRenderer::DrawDebugStrings() {
+	debugTextVertices.clear();
+
+	//World space text is placed wherever its position lands on screen, and skipped if that's behind us
+	Matrix4 worldToClip		= SetupDebugLineMatrix();
+	Matrix4 clipToString	= SetupDebugStringMatrix().Inverse();
+
+	for (const DebugText& t : debugDraw.GetTexts()) {
+		Vector2 pos(t.position.x, t.position.y);
+		if (t.worldSpace) {
+			Vector4 clip = worldToClip * Vector4(t.position, 1.0f);
+			if (clip.w <= 0.0f) {
+				continue;
+			}
+			Vector4 screen = clipToString * Vector4(clip.x / clip.w, clip.y / clip.w, 0.0f, 1.0f);
+			pos = Vector2(screen.x, screen.y);
+		}
+		textLayout->AppendString(debugDraw.GetTextChars(t), t.length, pos, t.size, t.colour, t.usage, debugTextVertices);
+	}
+	size_t count = debugTextVertices.size();
+	if (count == 0) {
+		return;
+	}
+	size_t bytes = count * sizeof(DebugTextVertex);
+	debugTextBuffer->BeginFrame();
+	debugTextBuffer->Reserve(bytes);
+	size_t offset = debugTextBuffer->Write(debugTextVertices.data(), bytes);
 
-	BindMesh(debugTextMesh);
-	DrawBoundMesh();
+	glBindVertexArray(debugTextVAO);
+	glBindVertexBuffer(DebugVertexBinding, debugTextBuffer->GetBuffer(), offset, sizeof(DebugTextVertex));
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)count);
+	debugTextBuffer->EndFrame();
 
-	debugStrings.clear();
+	BindMesh(nullptr);
 }
 
 void OGLRenderer::DrawDebugLines() {
-	vector<Vector3> vertPos;
-	vector<Vector4> vertCol;
+	size_t count = debugDraw.GetLineVertexCount();
+	size_t bytes = count * sizeof(DebugLineVertex);
+	debugLineBuffer->BeginFrame();
+	debugLineBuffer->Reserve(bytes);
+	size_t offset = debugLineBuffer->Write(debugDraw.GetLineVertices(), bytes);
 
-	for (DebugLine&s : debugLines) {
-		vertPos.emplace_back(s.start);
-		vertPos.emplace_back(s.end);
+	glBindVertexArray(debugLineVAO);
+	glBindVertexBuffer(DebugVertexBinding, debugLineBuffer->GetBuffer(), offset, sizeof(DebugLineVertex));
+	glDrawArrays(GL_LINES, 0, (GLsizei)count);
+	debugLineBuffer->EndFrame();
 
-		vertCol.emplace_back(s.colour);
-		vertCol.emplace_back(s.colour);
-	}
-
-	debugLinesMesh->SetVertexPositions(vertPos);
-	debugLinesMesh->SetVertexColours(vertCol);
-	debugLinesMesh->UpdateGPUBuffers(0, vertPos.size());
-
-	BindMesh(debugLinesMesh);
-	DrawBoundMesh();
-
-	debugLines.clear();
+	BindMesh(nullptr);
 }
 
 #ifdef _WIN32
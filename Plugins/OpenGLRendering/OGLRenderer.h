@@ -11,6 +11,7 @@ https://research.ncl.ac.uk/game/
 
 #include "../../Common/Vector3.h"
 #include "../../Common/Vector4.h"
+#include "../../Common/DebugDrawBuffer.h"
 
 
 #ifdef _WIN32
@@ -38,8 +39,10 @@ namespace NCL {
 
 		class OGLMesh;
 		class OGLShader;
+		class OGLStreamBuffer;
 
 		class SimpleFont;
+		class TextLayoutCache;
 		
 		class OGLRenderer : public RendererBase
 		{
@@ -59,9 +62,14 @@ namespace NCL {
 
 			virtual bool SetVerticalSync(VerticalSyncState s);
 
-			void DrawString(const std::string& text, const Vector2&pos, const Vector4& colour = Vector4(0.75f, 0.75f, 0.75f,1), float size = 20.0f );
+			void DrawString(const std::string& text, const Vector2&pos, const Vector4& colour = Vector4(0.75f, 0.75f, 0.75f,1), float size = 20.0f, TextUsage usage = TextUsage::Dynamic);
 			void DrawLine(const Vector3& start, const Vector3& end, const Vector4& colour);
 
+			//Everything debug drawn this frame - shapes, timed shapes and world space text
+			DebugDrawBuffer& GetDebugDraw() {
+				return debugDraw;
+			}
+
 			virtual Matrix4 SetupDebugLineMatrix()	const;
 			virtual Matrix4 SetupDebugStringMatrix()const;
 
@@ -78,7 +86,12 @@ namespace NCL {
 			void BindShader(ShaderBase*s);
 			void BindTextureToShader(const TextureBase*t, const std::string& uniform, int texUnit) const;
 			void BindMesh(MeshGeometry*m);
-			void DrawBoundMesh(int subLayer = 0, int numInstances = 1);
+			void DrawBoundMesh(int subLayer = 0, int numInstances = 1, int lodLevel = 0);
+
+			//Per-instance model matrix + colour, read from attribute locations 8 to 12
+			static const unsigned int InstanceAttributeLocation	= 8;
+			static const unsigned int InstanceBufferBinding		= 8;
+			void BindInstanceBuffer(unsigned int buffer, size_t offset, size_t stride);
 #ifdef _WIN32
 			void InitWithWin32(Window& w);
 			void DestroyWithWin32();
@@ -86,29 +99,26 @@ namespace NCL {
 			HGLRC	renderContext;		//Permanent Rendering Context		
 #endif
 		private:
-			struct DebugString {
-				Maths::Vector4 colour;
-				Maths::Vector2	pos;
-				float			size;
-				std::string		text;
-			};
-
-			struct DebugLine {
-				Maths::Vector3 start;
-				Maths::Vector3 end;
-				Maths::Vector4 colour;
-			};
-
-			OGLMesh* debugLinesMesh;
-			OGLMesh* debugTextMesh;
+			void CreateDebugBuffers();
+			void EndDebugFrame();
 
 			OGLMesh*	boundMesh;
 			OGLShader*	boundShader;
 
 			OGLShader*  debugShader;
 			SimpleFont* font;
-			std::vector<DebugString>	debugStrings;
-			std::vector<DebugLine>		debugLines;
+			TextLayoutCache* textLayout;
+
+			//Debug vertices are streamed straight from the DebugDrawBuffer, through their own vertex arrays
+			static const unsigned int DebugVertexBinding = 0;
+			DebugDrawBuffer		debugDraw;
+			OGLStreamBuffer*	debugLineBuffer;
+			OGLStreamBuffer*	debugTextBuffer;
+			unsigned int		debugLineVAO;
+			unsigned int		debugTextVAO;
+
+			//Reused every frame, so building text doesn't allocate once it's grown
+			std::vector<DebugTextVertex>	debugTextVertices;
 
 			bool initState;
 			bool forceValidDebugState;
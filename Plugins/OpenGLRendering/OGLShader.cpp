@@ -8,7 +8,9 @@ https://research.ncl.ac.uk/game/
 */
 #include "OGLShader.h"
 #include "../../Common/Assets.h"
+#include "../../Common/UniformData.h"
 #include <iostream>
+#include <vector>
 
 using namespace NCL;
 using namespace NCL::Rendering;
@@ -84,6 +86,48 @@ void OGLShader::ReloadShader() {
 	else {
 		std::cout << "Shader loaded!" << std::endl;
 	}
+	CacheUniforms();
+}
+
+/*
+Stores where every active uniform lives, and points any of the shared
+uniform blocks this program uses at their binding points.
+*/
+void	OGLShader::CacheUniforms() {
+	uniformLocations.clear();
+	if (programValid != GL_TRUE) {
+		return;
+	}
+	int uniformCount	= 0;
+	int maxNameLength	= 0;
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<char> nameData(maxNameLength + 1);
+	for (int i = 0; i < uniformCount; ++i) {
+		GLsizei nameLength	= 0;
+		GLint	size		= 0;
+		GLenum	type		= 0;
+		glGetActiveUniform(programID, i, (GLsizei)nameData.size(), &nameLength, &size, &type, nameData.data());
+
+		string name(nameData.data(), nameLength);
+		GLint location = glGetUniformLocation(programID, name.c_str());
+		if (location < 0) {
+			continue; //lives in a uniform block
+		}
+		uniformLocations[name] = location;
+		//Arrays are reported as name[0], but are usually asked for by just their name
+		size_t bracket = name.find("[0]");
+		if (bracket != string::npos) {
+			uniformLocations[name.substr(0, bracket)] = location;
+		}
+	}
+	for (int i = 0; i < MaxBlockBindings; ++i) {
+		GLuint blockIndex = glGetUniformBlockIndex(programID, UniformBlockName(i));
+		if (blockIndex != GL_INVALID_INDEX) {
+			glUniformBlockBinding(programID, blockIndex, i);
+		}
+	}
 }
 
 void	OGLShader::DeleteIDs() {
@@ -9,6 +9,7 @@ https://research.ncl.ac.uk/game/
 #pragma once
 #include "../../Common/ShaderBase.h"
 #include "glad\glad.h"
+#include <unordered_map>
 
 namespace NCL {
 	namespace Rendering {
@@ -28,17 +29,26 @@ namespace NCL {
 			int GetProgramID() const {
 				return programID;
 			}	
+
+			//Looked up once at link time rather than asking the driver each time - -1 if not found
+			GLint GetUniformLocation(const string& name) const {
+				auto i = uniformLocations.find(name);
+				return i == uniformLocations.end() ? -1 : i->second;
+			}
 			
 			static void	PrintCompileLog(GLuint object);
 			static void	PrintLinkLog(GLuint program);
 
 		protected:
 			void	DeleteIDs();
+			void	CacheUniforms();
 
 			GLuint	programID;
 			GLuint	shaderIDs[(int)ShaderStages::SHADER_MAX];
 			int		shaderValid[(int)ShaderStages::SHADER_MAX];
 			int		programValid;
+
+			std::unordered_map<string, GLint> uniformLocations;
 		};
 	}
 }
\ No newline at end of file
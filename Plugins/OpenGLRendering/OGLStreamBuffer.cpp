@@ -0,0 +1,115 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#include "OGLStreamBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace NCL;
+using namespace NCL::Rendering;
+
+OGLStreamBuffer::OGLStreamBuffer(size_t bytesPerFrame, size_t alignment) : ring(bytesPerFrame, MaxFramesInFlight, alignment) {
+	buffer		= 0;
+	mappedData	= nullptr;
+	for (int i = 0; i < MaxFramesInFlight; ++i) {
+		fences[i] = nullptr;
+	}
+	CreateBuffer(bytesPerFrame);
+}
+
+OGLStreamBuffer::~OGLStreamBuffer() {
+	DeleteBuffer();
+}
+
+void OGLStreamBuffer::CreateBuffer(size_t bytesPerFrame) {
+	ring.Resize(bytesPerFrame);
+	size_t totalSize = ring.GetTotalSize();
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	if (GLAD_GL_VERSION_4_4) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+		mappedData = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags);
+		if (!mappedData) {
+			std::cout << __FUNCTION__ << " couldn't persistently map buffer, falling back to glBufferSubData" << std::endl;
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		}
+	}
+	if (!mappedData) {
+		glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OGLStreamBuffer::DeleteBuffer() {
+	for (int i = 0; i < MaxFramesInFlight; ++i) {
+		if (fences[i]) {
+			glDeleteSync(fences[i]);
+			fences[i] = nullptr;
+		}
+	}
+	if (mappedData) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		mappedData = nullptr;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void OGLStreamBuffer::Reserve(size_t bytesPerFrame) {
+	if (bytesPerFrame <= ring.GetFrameSize()) {
+		return;
+	}
+	//Deleting a buffer the GPU is still using is fine, GL keeps it alive until it's done
+	DeleteBuffer();
+	CreateBuffer(bytesPerFrame + bytesPerFrame / 2);
+}
+
+void OGLStreamBuffer::BeginFrame() {
+	ring.BeginFrame();
+
+	GLsync& fence = fences[ring.GetCurrentFrame()];
+	if (fence) {
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (result == GL_TIMEOUT_EXPIRED) {
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); //1ms at a time
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
+
+void OGLStreamBuffer::EndFrame() {
+	if (mappedData) {
+		fences[ring.GetCurrentFrame()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+size_t OGLStreamBuffer::Write(const void* data, size_t bytes) {
+	size_t offset = 0;
+	if (!ring.Allocate(bytes, offset)) {
+		std::cout << __FUNCTION__ << " frame region is full! Reserve more space first" << std::endl;
+		return ring.GetFrameSize() * ring.GetCurrentFrame();
+	}
+	if (mappedData) {
+		memcpy(mappedData + offset, data, bytes);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, bytes, data);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	return offset;
+}
@@ -0,0 +1,69 @@
+/*
+Part of Newcastle University's Game Engineering source code.
+
+Use as you see fit!
+
+Comments and queries to: richard-gordon.davison AT ncl.ac.uk
+https://research.ncl.ac.uk/game/
+*/
+#pragma once
+#include "glad\glad.h"
+#include "../../Common/FrameRingAllocator.h"
+
+namespace NCL {
+	namespace Rendering {
+		/*
+		A buffer for data that's rewritten every frame, split into a region
+		per frame in flight. Where the driver supports GL 4.4 the buffer is
+		mapped once, persistently, and written to directly - a fence on each
+		region stops us writing over data the GPU hasn't drawn from yet.
+		Otherwise each write goes through glBufferSubData. Any buffer target
+		can use one - vertices, uniforms or storage.
+		*/
+		class OGLStreamBuffer {
+		public:
+			static const int	MaxFramesInFlight	= 3;
+			static const size_t	DefaultAlignment	= 256;	//enough for any vertex buffer offset
+
+			//alignment is where each Write starts - uniform buffers need GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+			OGLStreamBuffer(size_t bytesPerFrame, size_t alignment = DefaultAlignment);
+			~OGLStreamBuffer();
+
+			//Grows the buffer if a frame needs more room - call before any Writes that frame
+			void Reserve(size_t bytesPerFrame);
+
+			//Waits until the GPU has finished with this frame's region
+			void BeginFrame();
+			void EndFrame();
+
+			//Copies data in, and returns its offset from the start of the buffer
+			size_t Write(const void* data, size_t bytes);
+
+			GLuint GetBuffer() const {
+				return buffer;
+			}
+
+			//How much of a frame's region a Write of this many bytes uses up
+			size_t AlignedSize(size_t bytes) const {
+				return ring.AlignedSize(bytes);
+			}
+
+			size_t GetAlignment() const {
+				return ring.GetAlignment();
+			}
+
+			bool IsPersistent() const {
+				return mappedData != nullptr;
+			}
+
+		protected:
+			void CreateBuffer(size_t bytesPerFrame);
+			void DeleteBuffer();
+
+			FrameRingAllocator	ring;
+			GLuint				buffer;
+			char*				mappedData;
+			GLsync				fences[MaxFramesInFlight];
+		};
+	}
+}
@@ -11,6 +11,8 @@ https://research.ncl.ac.uk/game/
 
 #include "../../Common/TextureLoader.h"
 
+#include <algorithm>
+
 using namespace NCL;
 using namespace NCL::Rendering;
 
@@ -46,7 +48,7 @@ TextureBase* OGLTexture::RGBATextureFromData(char* data, int width, int height,
 
 	glBindTexture(GL_TEXTURE_2D, tex->texID);
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, sourceType, GL_UNSIGNED_BYTE, data);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, sourceType, GL_UNSIGNED_BYTE, data);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -58,6 +60,46 @@ TextureBase* OGLTexture::RGBATextureFromData(char* data, int width, int height,
 	return tex;
 }
 
+TextureBase* OGLTexture::TextureFromData(char* data, int width, int height, int channels, int flags) {
+	TextureFormat	format		= TextureLoader::GetFormat(flags);
+	int				mipCount	= TextureLoader::GetMipCount(flags);
+
+	if (format == TextureFormat::RGBA8 && mipCount == 1) {
+		return RGBATextureFromData(data, width, height, channels);
+	}
+	GLenum internalFormat = GL_RGBA8;
+	switch (format) {
+		case TextureFormat::BC1: internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;	break;
+		case TextureFormat::BC3: internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;	break;
+		case TextureFormat::BC5: internalFormat = GL_COMPRESSED_RG_RGTC2;			break;
+		default: break;
+	}
+	OGLTexture* tex = new OGLTexture();
+	glBindTexture(GL_TEXTURE_2D, tex->texID);
+
+	char* level = data;
+	for (int i = 0; i < mipCount; ++i) {
+		int		levelWidth	= std::max(width  >> i, 1);
+		int		levelHeight = std::max(height >> i, 1);
+		size_t	levelSize	= TextureLoader::GetMipSize(format, width, height, i);
+
+		if (format == TextureFormat::RGBA8) {
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+		}
+		else {
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, levelWidth, levelHeight, 0, (GLsizei)levelSize, level);
+		}
+		level += levelSize;
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return tex;
+}
+
 TextureBase* OGLTexture::RGBATextureFromFilename(const std::string&name) {
 	char* texData	= nullptr;
 	int width		= 0;
@@ -66,7 +108,7 @@ TextureBase* OGLTexture::RGBATextureFromFilename(const std::string&name) {
 	int flags		= 0;
 	TextureLoader::LoadTexture(name, texData, width, height, channels, flags);  
 
-	TextureBase* glTex = RGBATextureFromData(texData, width, height, channels);
+	TextureBase* glTex = TextureFromData(texData, width, height, channels, flags);
 
 	free(texData);
 
@@ -23,9 +23,16 @@ namespace NCL {
 			~OGLTexture();
 
 			static TextureBase* RGBATextureFromData(char* data, int width, int height, int channels);
+			//Takes whatever a TextureLoadFunction gave back - block compressed
+			//data and any mip levels it came with are uploaded as they are
+			static TextureBase* TextureFromData(char* data, int width, int height, int channels, int flags);
 
 			static TextureBase* RGBATextureFromFilename(const std::string&name);
 
+			void SwapWith(TextureBase& other) override {
+				std::swap(texID, ((OGLTexture&)other).texID);
+			}
+
 			GLuint GetObjectID() const	{
 				return texID;
 			}